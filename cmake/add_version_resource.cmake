@@ -1,6 +1,11 @@
 include_guard(GLOBAL)
 
 function(add_version_resource TARGET)
+  # `.rc` files are Windows-only
+  if(NOT WIN32)
+    return()
+  endif()
+
   set(VERSION_RC "${CMAKE_CURRENT_BINARY_DIR}/${TARGET}.version.rc")
   set(VERSION_RC_CONFIGURED "${CMAKE_CURRENT_BINARY_DIR}/${TARGET}.version.rc.configured")
 
@@ -21,7 +21,14 @@ class ApiLayerApi {
     Pending,
   };
   using LogFrameHook = LogFrameHookResult (*)(Frame*);
-  virtual void AppendLogFrameHook(LogFrameHook logFrameHook) = 0;
+  // Called instead of the `LogFrameHook` if the frame is published without
+  // waiting for it - e.g. if the hook timed out - so that the hook can
+  // release any per-frame state. May be null.
+  using LogFrameAbandonedHook = void (*)(const Frame*);
+  virtual void AppendLogFrameHook(
+    LogFrameHook logFrameHook,
+    LogFrameAbandonedHook logFrameAbandonedHook)
+    = 0;
 
   [[nodiscard]] std::optional<LUID> GetActiveGpu() const noexcept {
     return mActiveGpu;
@@ -0,0 +1,108 @@
+// Copyright 2024 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+
+#include "LogConversionJobs.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <functional>
+
+#include "Win32Utils.hpp"
+
+LogConversionJobs::Job::Job(Input&& input)
+  : mReader(std::move(input.mReader)), mOutputPath(input.mOutputPath) {
+  mTotalBytes = mReader->GetStreamSize();
+}
+
+LogConversionJobs::LogConversionJobs(
+  std::vector<Input> inputs,
+  const size_t framesPerRow)
+  : mFramesPerRow(framesPerRow) {
+  mJobs.reserve(inputs.size());
+  for (auto&& input: inputs) {
+    mJobs.push_back(std::make_unique<Job>(std::move(input)));
+  }
+
+  // Conversion is CPU-bound, so one worker per core
+  const auto workerCount = std::clamp<size_t>(
+    std::thread::hardware_concurrency(), 1, std::max<size_t>(mJobs.size(), 1));
+  for (size_t i = 0; i < workerCount; ++i) {
+    mWorkers.emplace_back(std::bind_front(&LogConversionJobs::Run, this));
+  }
+}
+
+LogConversionJobs::~LogConversionJobs() {
+  this->Cancel();
+  mWorkers.clear();
+}
+
+void LogConversionJobs::Cancel() {
+  for (auto&& worker: mWorkers) {
+    worker.request_stop();
+  }
+}
+
+std::vector<LogConversionJobs::Status> LogConversionJobs::GetStatus() const {
+  std::vector<Status> ret;
+  ret.reserve(mJobs.size());
+  for (auto&& job: mJobs) {
+    const auto state = job->mState.load();
+    const auto total = job->mTotalBytes.load();
+    ret.push_back({
+      .mOutputPath = job->mOutputPath,
+      .mState = state,
+      .mProgress = total
+        ? static_cast<float>(static_cast<double>(job->mBytesRead) / total)
+        : 0.0f,
+      .mError = (state == State::Failed) ? job->mError : std::string {},
+    });
+  }
+  return ret;
+}
+
+bool LogConversionJobs::IsFinished() const noexcept {
+  return mFinishedJobs == mJobs.size();
+}
+
+void LogConversionJobs::Run(std::stop_token tok) {
+  SetThreadDescription(GetCurrentThread(), L"XRFrameTools Log Conversion");
+
+  while (true) {
+    const auto index = mNextJob++;
+    if (index >= mJobs.size()) {
+      return;
+    }
+    auto& job = *mJobs.at(index);
+    if (tok.stop_requested()) {
+      job.mState = State::Cancelled;
+    } else {
+      job.mState = State::Running;
+      this->RunJob(job, tok);
+    }
+    job.mReader.reset();
+    ++mFinishedJobs;
+  }
+}
+
+void LogConversionJobs::RunJob(Job& job, const std::stop_token& tok) {
+  try {
+    const auto result = CSVWriter::Write(
+      std::move(*job.mReader),
+      job.mOutputPath,
+      mFramesPerRow,
+      {
+        .mStopToken = tok,
+        .mProgress =
+          [&job](const uint64_t bytesRead, uint64_t) {
+            job.mBytesRead = bytesRead;
+          },
+      });
+    job.mState = result.mCancelled ? State::Cancelled : State::Completed;
+  } catch (const std::exception& e) {
+    // Not just `std::system_error`; anything else, e.g. `std::bad_alloc`,
+    // would otherwise escape the worker thread and terminate the app
+    dprint("converting `{}` failed: {}", job.mOutputPath.string(), e.what());
+    job.mError = e.what();
+    job.mState = State::Failed;
+  }
+}
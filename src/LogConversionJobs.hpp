@@ -0,0 +1,84 @@
+// Copyright 2024 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <atomic>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BinaryLogReader.hpp"
+#include "CSVWriter.hpp"
+
+/** Converts binary logs to CSV on a pool of worker threads.
+ *
+ * Status can be queried at any time without waiting for the workers, so it
+ * can be shown by the UI every frame.
+ */
+class LogConversionJobs final {
+ public:
+  enum class State {
+    Queued,
+    Running,
+    Completed,
+    Failed,
+    Cancelled,
+  };
+
+  struct Input {
+    BinaryLogReader mReader;
+    std::filesystem::path mOutputPath;
+  };
+
+  struct Status {
+    std::filesystem::path mOutputPath;
+    State mState {State::Queued};
+    // 0 to 1
+    float mProgress {};
+    // Only set if `mState` is `Failed`
+    std::string mError;
+  };
+
+  LogConversionJobs() = delete;
+  LogConversionJobs(const LogConversionJobs&) = delete;
+  LogConversionJobs(LogConversionJobs&&) = delete;
+  LogConversionJobs& operator=(const LogConversionJobs&) = delete;
+  LogConversionJobs& operator=(LogConversionJobs&&) = delete;
+
+  LogConversionJobs(std::vector<Input> inputs, size_t framesPerRow);
+  /// Cancels any unfinished jobs
+  ~LogConversionJobs();
+
+  void Cancel();
+
+  [[nodiscard]]
+  std::vector<Status> GetStatus() const;
+  [[nodiscard]]
+  bool IsFinished() const noexcept;
+
+ private:
+  struct Job {
+    explicit Job(Input&& input);
+
+    std::optional<BinaryLogReader> mReader;
+    const std::filesystem::path mOutputPath;
+
+    std::atomic<State> mState {State::Queued};
+    std::atomic<uint64_t> mBytesRead {};
+    std::atomic<uint64_t> mTotalBytes {};
+    // Written before `mState` is set to `Failed`
+    std::string mError;
+  };
+
+  const size_t mFramesPerRow {};
+  std::vector<std::unique_ptr<Job>> mJobs;
+  std::atomic<size_t> mNextJob {};
+  std::atomic<size_t> mFinishedJobs {};
+  std::vector<std::jthread> mWorkers;
+
+  void Run(std::stop_token);
+  void RunJob(Job&, const std::stop_token&);
+};
@@ -0,0 +1,53 @@
+// Copyright 2024 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+
+#include "LogViewer.hpp"
+
+#include <functional>
+
+#include "Win32Utils.hpp"
+
+LogViewer::LogViewer(BinaryLogReader reader)
+  : mReader(std::move(reader)),
+    mLogFilePath(mReader->GetLogFilePath()),
+    mExecutablePath(mReader->GetExecutablePath()) {
+  mThread = std::jthread {std::bind_front(&LogViewer::Run, this)};
+}
+
+LogViewer::~LogViewer() {
+  mThread = {};
+}
+
+std::filesystem::path LogViewer::GetLogFilePath() const noexcept {
+  return mLogFilePath;
+}
+
+std::filesystem::path LogViewer::GetExecutablePath() const noexcept {
+  return mExecutablePath;
+}
+
+bool LogViewer::IsFinished() const noexcept {
+  return mFinished;
+}
+
+float LogViewer::GetProgress() const noexcept {
+  return mProgress;
+}
+
+const LogPyramid* LogViewer::GetPyramid() const noexcept {
+  if (!(mFinished && mPyramid)) {
+    return nullptr;
+  }
+  return &*mPyramid;
+}
+
+void LogViewer::Run(std::stop_token tok) {
+  SetThreadDescription(GetCurrentThread(), L"XRFrameTools Log Viewer");
+  // Interactive, but not as important as the UI thread
+  SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+
+  mPyramid = LogPyramid::LoadOrBuild(
+    *mReader, tok, [this](const float progress) { mProgress = progress; });
+  mReader.reset();
+  mFinished = true;
+}
@@ -0,0 +1,57 @@
+// Copyright 2024 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <atomic>
+#include <filesystem>
+#include <optional>
+#include <thread>
+
+#include "BinaryLogReader.hpp"
+#include "LogPyramid.hpp"
+
+/** Loads a `LogPyramid` for a log on a background thread.
+ *
+ * Status can be queried at any time without waiting for the thread, so it
+ * can be shown by the UI every frame.
+ */
+class LogViewer final {
+ public:
+  LogViewer() = delete;
+  LogViewer(const LogViewer&) = delete;
+  LogViewer(LogViewer&&) = delete;
+  LogViewer& operator=(const LogViewer&) = delete;
+  LogViewer& operator=(LogViewer&&) = delete;
+
+  explicit LogViewer(BinaryLogReader);
+  /// Cancels loading if it is unfinished
+  ~LogViewer();
+
+  [[nodiscard]]
+  std::filesystem::path GetLogFilePath() const noexcept;
+  [[nodiscard]]
+  std::filesystem::path GetExecutablePath() const noexcept;
+
+  [[nodiscard]]
+  bool IsFinished() const noexcept;
+  // 0 to 1
+  [[nodiscard]]
+  float GetProgress() const noexcept;
+  /// `nullptr` until finished, or if the log contains no frames
+  [[nodiscard]]
+  const LogPyramid* GetPyramid() const noexcept;
+
+ private:
+  std::optional<BinaryLogReader> mReader;
+  const std::filesystem::path mLogFilePath;
+  const std::filesystem::path mExecutablePath;
+
+  std::atomic<float> mProgress {};
+  // Written before `mFinished` is set
+  std::optional<LogPyramid> mPyramid;
+  std::atomic<bool> mFinished {false};
+
+  std::jthread mThread;
+
+  void Run(std::stop_token);
+};
@@ -4,13 +4,13 @@
 #include "MainWindow.hpp"
 
 #include <implot.h>
-#include <nvapi.h>
 #include <shellapi.h>
 #include <shlobj_core.h>
 #include <wil/com.h>
 #include <wil/resource.h>
 #include <wil/win32_helpers.h>
 
+#include <cmath>
 #include <magic_enum.hpp>
 #include <ranges>
 
@@ -25,6 +25,10 @@
 
 static const auto gPCM = PerformanceCounterMath::CreateForLiveData();
 
+using DecreaseReason
+  = FramePerformanceCounters::GpuPerformanceInfo::DecreaseReason;
+using VideoMemoryInfo = FramePerformanceCounters::VideoMemoryInfo;
+
 static constexpr auto RoundUp(auto value, auto multiplier) {
   const auto floor = (static_cast<int64_t>(value) / multiplier) * multiplier;
   if (
@@ -43,9 +47,55 @@ static void SetupMicrosecondsAxis(ImAxis axis, auto max) {
     axis, 0.0, RoundUp(max, 1000) + 1000, ImPlotCond_Always);
 }
 
+static int FormatHistoryTick(double value, char* buf, int size, void*) {
+  const auto seconds = std::llround(-value);
+  if (seconds == 0) {
+    return snprintf(buf, size, "now");
+  }
+  if (seconds < 60) {
+    return snprintf(buf, size, "-%llds", seconds);
+  }
+  if (seconds < 60 * 60) {
+    return snprintf(buf, size, "-%lld:%02lld", seconds / 60, seconds % 60);
+  }
+  return snprintf(
+    buf,
+    size,
+    "-%lld:%02lld:%02lld",
+    seconds / (60 * 60),
+    (seconds / 60) % 60,
+    seconds % 60);
+}
+
+static void SetupHistoryAxis(const LiveData::ChartView& view) {
+  ImPlot::SetupAxis(ImAxis_X1);
+  ImPlot::SetupAxisFormat(ImAxis_X1, &FormatHistoryTick);
+  ImPlot::SetupAxisLimits(
+    ImAxis_X1, -view.GetSeconds(), 0.0, ImPlotCond_Always);
+}
+
+namespace {
+struct LogViewerPlotData {
+  const LogPyramid::Bucket* mBuckets {};
+  LogPyramid::Metric mMetric {};
+};
+}// namespace
+
+template <auto Member>
+static ImPlotPoint PlotLogViewerSummary(int idx, void* user_data) {
+  const auto& data = *static_cast<const LogViewerPlotData*>(user_data);
+  const auto& bucket = data.mBuckets[idx];
+  return {
+    (bucket.mBegin + bucket.mEnd) / 2e6,
+    bucket.Get(data.mMetric).*Member,
+  };
+}
+
 MainWindow::MainWindow(HINSTANCE instance)
   : Window(instance, L"XRFrameTools"),
     mBaseConfig(Config::GetUserDefaults(Config::Access::ReadWrite)),
+    mLogCatalog(
+      GetKnownFolderPath(FOLDERID_LocalAppData) / "XRFrameTools" / "Logs"),
     mLiveDataThread(
       std::bind_front(&MainWindow::UpdateLiveDataThreadEntry, this)) {
   mThisExecutable
@@ -58,12 +108,58 @@ MainWindow::MainWindow(HINSTANCE instance)
         .value_or(CSVWriter::DefaultFramesPerRow)),
     1,
     std::numeric_limits<int>::max());
+
+  mLogCatalog.RefreshInBackground();
+  mLogCatalogRefreshedAt = std::chrono::steady_clock::now();
 }
 
 MainWindow::~MainWindow() = default;
 
-LiveData::LiveData() : mAggregator(gPCM) {
+LiveData::LiveData()
+  : mAggregator(gPCM),
+    mEventAggregator(gPCM),
+    mHistory(std::make_unique<History>(gPCM)) {
+}
+
+void LiveData::PushChartFrame(const FrameMetrics& frame) {
+  mChartFrames.push_back(frame);
+  if (const auto minute = mHistory->mMinutes.Push(frame)) {
+    mHistory->mHours.Push(*minute);
+  }
+}
+
+void LiveData::ResetHistory() {
+  mChartFrames = {BufferSize};
+  mHistory = std::make_unique<History>(gPCM);
+}
+
+LiveData::ChartView LiveData::GetChartView(const HistoryRange range) {
+  switch (range) {
+    case HistoryRange::Seconds:
+      return {
+        {mChartFrames.data(), mChartFrames.size()},
+        1.0 / ChartFPS,
+      };
+    case HistoryRange::Minutes: {
+      auto& points = mHistory->mMinutes.mPoints;
+      return {
+        {points.data(), points.size()},
+        static_cast<double>(MinutesTier::PointsPerMerge) / ChartFPS,
+      };
+    }
+    case HistoryRange::Hours: {
+      auto& points = mHistory->mHours.mPoints;
+      return {
+        {points.data(), points.size()},
+        static_cast<double>(
+          MinutesTier::PointsPerMerge * HoursTier::PointsPerMerge)
+          / ChartFPS,
+      };
+    }
+  }
+  std::unreachable();
 }
+
 void MainWindow::UpdateLiveDataThreadEntry(const std::stop_token tok) {
   auto interruptEvent = mLiveData.mInterruptEvent.get();
   const std::stop_callback interrupt {
@@ -210,7 +306,7 @@ void MainWindow::LogConversionControls() {
   const auto resolution = SingleValue(
     mBinaryLogFiles, "no log files", "varied", [](const auto& log) {
       return std::format(
-        "{}hz", log.GetPerformanceCounterMath().GetResolution().QuadPart);
+        "{}hz", log.GetPerformanceCounterMath().GetResolution());
     });
   ImGui::LabelText("Log resolution", "%s", resolution.c_str());
 
@@ -365,6 +461,11 @@ void MainWindow::LoggingSection() {
   ImGui::Separator();
 
   this->LogConversionControls();
+  this->LogConversionProgress();
+
+  ImGui::Separator();
+
+  this->LogCatalogOverview();
 
   // "OpenFolderHorizontal"
   if (ImGui::Button("\ued25Open logs folder")) {
@@ -380,6 +481,155 @@ void MainWindow::LoggingSection() {
   }
 }
 
+void MainWindow::LogCatalogOverview() {
+  // Pick up logs written since the tab was last shown; this is cheap unless
+  // there are new or changed logs
+  constexpr auto RefreshInterval = std::chrono::seconds(10);
+  const auto now = std::chrono::steady_clock::now();
+  if (
+    now - mLogCatalogRefreshedAt > RefreshInterval
+    && !mLogCatalog.IsRefreshing()) {
+    mLogCatalog.RefreshInBackground();
+    mLogCatalogRefreshedAt = now;
+    mLogCatalogSummary.reset();
+  }
+
+  if (!mLogCatalogSummary && !mLogCatalog.IsRefreshing()) {
+    LogCatalogSummary summary;
+    for (auto&& it: mLogCatalog.Query()) {
+      ++summary.mLogCount;
+      summary.mTotalBytes += it.mFileSize;
+      summary.mTotalDuration += it.mDuration;
+    }
+    mLogCatalogSummary = summary;
+  }
+
+  if (!mLogCatalogSummary) {
+    ImGui::TextDisabled("Indexing logs...");
+    return;
+  }
+
+  ImGui::Text(
+    "%s",
+    std::format(
+      "{} logs, {:.1f} MiB, {:.1f} hours recorded",
+      mLogCatalogSummary->mLogCount,
+      mLogCatalogSummary->mTotalBytes / (1024.0 * 1024.0),
+      std::chrono::duration<double, std::ratio<3600>>(
+        mLogCatalogSummary->mTotalDuration)
+        .count())
+      .c_str());
+}
+
+void MainWindow::LogViewerSection() {
+  const ImGuiScoped::ID idScope {"LogViewer"};
+
+  // "AreaChart" glyph
+  const auto tabItem = ImGuiScoped::TabItem("\ue9d2Log viewer");
+  if (!tabItem) {
+    return;
+  }
+
+  // "OpenFile" glyph
+  if (ImGui::Button("\ue8e5Open log...")) {
+    auto files = this->PickBinaryLogFiles();
+    if (!files.empty()) {
+      // Replacing the viewer cancels loading if it's still running
+      mLogViewer.reset();
+      mLogViewer.emplace(std::move(files.front()));
+    }
+  }
+  ImGui::SameLine();
+  if (!mLogViewer) {
+    ImGui::TextDisabled("Plots a whole log, without converting it to CSV");
+    return;
+  }
+  ImGui::TextDisabled(
+    "%s - %s",
+    mLogViewer->GetExecutablePath().filename().string().c_str(),
+    mLogViewer->GetLogFilePath().filename().string().c_str());
+
+  if (!mLogViewer->IsFinished()) {
+    ImGui::ProgressBar(mLogViewer->GetProgress(), {-FLT_MIN, 0}, "Indexing");
+    return;
+  }
+
+  const auto pyramid = mLogViewer->GetPyramid();
+  if (!pyramid) {
+    ImGui::TextUnformatted("The log doesn't contain any frames.");
+    return;
+  }
+  // Reset zoom when a different log is opened
+  const ImGuiScoped::ID logScope {
+    mLogViewer->GetLogFilePath().string().c_str()};
+  this->PlotLogViewer(*pyramid);
+}
+
+void MainWindow::PlotLogViewer(const LogPyramid& pyramid) {
+  const auto plot = ImGuiScoped::ImPlot("Frame Timings", {-1, -1});
+  if (!plot) {
+    return;
+  }
+
+  using Metric = LogPyramid::Metric;
+  const auto& total = pyramid.GetTotal();
+  const auto beginSeconds = total.mBegin / 1e6;
+  const auto endSeconds = std::max(total.mEnd / 1e6, beginSeconds + 1);
+  ImPlot::SetupAxis(ImAxis_X1, "seconds");
+  ImPlot::SetupAxisLimits(
+    ImAxis_X1, beginSeconds, endSeconds, ImPlotCond_Once);
+  ImPlot::SetupAxisLimitsConstraints(ImAxis_X1, beginSeconds, endSeconds);
+  ImPlot::SetupAxis(ImAxis_Y1, "µs");
+  ImPlot::SetupAxisLimits(
+    ImAxis_Y1,
+    0.0,
+    RoundUp(
+      static_cast<int64_t>(total.Get(Metric::FrameInterval).mMean * 2),
+      1000i64),
+    ImPlotCond_Once);
+
+  // Only plot the visible range, at roughly one bucket per pixel
+  const auto limits = ImPlot::GetPlotLimits();
+  const auto buckets = pyramid.Query(
+    std::chrono::microseconds {std::llround(limits.X.Min * 1e6)},
+    std::chrono::microseconds {std::llround(limits.X.Max * 1e6)},
+    std::max<size_t>(static_cast<size_t>(ImPlot::GetPlotSize().x), 1));
+  if (buckets.empty()) {
+    return;
+  }
+
+  constexpr std::tuple<const char*, Metric> metrics[] {
+    {"Frame Interval", Metric::FrameInterval},
+    {"Wait CPU", Metric::WaitFrameCpu},
+    {"App CPU", Metric::AppCpu},
+    {"Begin CPU", Metric::BeginFrameCpu},
+    {"Render CPU", Metric::RenderCpu},
+    {"Submit CPU", Metric::EndFrameCpu},
+    {"Render GPU", Metric::RenderGpu},
+  };
+  for (auto&& [label, metric]: metrics) {
+    LogViewerPlotData data {buckets.data(), metric};
+    if (metric == Metric::WaitFrameCpu || metric == Metric::BeginFrameCpu) {
+      ImPlot::HideNextItem(true, ImPlotCond_Once);
+    }
+    // Min-max range, with the same label so it's toggled with the mean
+    ImPlot::PushStyleVar(ImPlotStyleVar_FillAlpha, 0.25f);
+    ImPlot::PlotShadedG(
+      label,
+      &PlotLogViewerSummary<&LogPyramid::Summary::mMin>,
+      &data,
+      &PlotLogViewerSummary<&LogPyramid::Summary::mMax>,
+      &data,
+      static_cast<int>(buckets.size()));
+    ImPlot::PopStyleVar();
+    ImPlot::PlotLineG(
+      label,
+      &PlotLogViewerSummary<&LogPyramid::Summary::mMean>,
+      &data,
+      static_cast<int>(buckets.size()));
+  }
+}
+
 void MainWindow::RenderContent() {
   // Unicode escapes are glyphs from the Windows icon fonts:
   // - "Segoe MDL2 Assets" on Win10+ (including Win11)
@@ -395,22 +645,37 @@ void MainWindow::RenderContent() {
   if (const auto tabBar = ImGuiScoped::TabBar("##TabBar")) {
     this->LiveDataSection();
     this->LoggingSection();
+    this->LogViewerSection();
     this->AboutSection();
   }
 }
 std::optional<float> MainWindow::GetTargetFPS() const noexcept {
+  // Keep progress up to date, and show the results of background work as soon
+  // as it finishes, rather than on the next input event
+  constexpr float BackgroundWorkFPS = 10;
+  const auto converting
+    = mLogConversionJobs && !mLogConversionJobs->IsFinished();
+  const auto indexing = mLogViewer && !mLogViewer->IsFinished();
+  const auto working = converting || indexing || mLogCatalog.IsRefreshing();
+
   if (!mLiveData.mEnabled) {
+    if (working) {
+      return BackgroundWorkFPS;
+    }
     return std::nullopt;
   }
 
-  LARGE_INTEGER now {};
-  QueryPerformanceCounter(&now);
+  const auto now = win32::QueryPerformanceCounter();
 
   const auto liveDataAge = gPCM.ToDuration(mLiveData.mLatestMetricsAt, now);
   if (liveDataAge < std::chrono::seconds(LiveData::HistorySeconds)) {
     return LiveData::ChartFPS;
   }
 
+  if (working) {
+    return BackgroundWorkFPS;
+  }
+
   // If we have no data, but checking is enabled, let's always wake up at
   // least once per second to find out if we have any
   return 1;
@@ -541,37 +806,61 @@ void MainWindow::ConvertBinaryLogFiles() {
   const auto clearOnExit
     = wil::scope_exit([this]() { mBinaryLogFiles.clear(); });
 
+  std::vector<LogConversionJobs::Input> inputs;
+  if (mBinaryLogFiles.size() == 1) {
+    inputs.push_back({std::move(mBinaryLogFiles.front()), outputPath});
+  } else {
+    for (auto&& it: mBinaryLogFiles) {
+      auto itPath = (outputPath / it.GetLogFilePath().filename())
+                      .replace_extension(".csv");
+      inputs.push_back({std::move(it), std::move(itPath)});
+    }
+  }
+
+  // Replacing any previous jobs cancels them if they're still running
+  mLogConversionJobs.reset();
+  mLogConversionJobs.emplace(std::move(inputs), mCSVFramesPerRow);
+  mRevealedConvertedFiles = false;
+}
+
+void MainWindow::RevealConvertedFiles() {
+  std::vector<std::filesystem::path> csvFiles;
+  for (auto&& it: mLogConversionJobs->GetStatus()) {
+    if (it.mState == LogConversionJobs::State::Completed) {
+      csvFiles.push_back(it.mOutputPath);
+    }
+  }
+  if (csvFiles.empty()) {
+    return;
+  }
+
   using unique_idlist
     = wil::unique_any<LPITEMIDLIST, decltype(&ILFree), ILFree>;
 
-  if (mBinaryLogFiles.size() == 1) {
-    CSVWriter::Write(
-      std::move(mBinaryLogFiles.front()), outputPath, mCSVFramesPerRow);
+  if (csvFiles.size() == 1) {
     unique_idlist pidl;
-    outputShellItem.query<IPersistIDList>()->GetIDList(pidl.put());
+    SHParseDisplayName(
+      csvFiles.front().wstring().c_str(), nullptr, pidl.put(), 0, nullptr);
     SHOpenFolderAndSelectItems(pidl.get(), 0, nullptr, 0);
     return;
   }
 
-  std::vector<std::filesystem::path> csvFiles;
-
   using unique_childid
     = wil::unique_any<PITEMID_CHILD, decltype(&ILFree), ILFree>;
   std::vector<unique_childid> childIDs;
-  for (auto&& it: mBinaryLogFiles) {
-    const auto itPath
-      = (outputPath / it.GetLogFilePath().filename()).replace_extension(".csv");
-    csvFiles.push_back(itPath);
-    CSVWriter::Write(std::move(it), itPath, mCSVFramesPerRow);
-
+  for (auto&& it: csvFiles) {
     unique_idlist pidl;
-    SHParseDisplayName(
-      itPath.wstring().c_str(), nullptr, pidl.put(), 0, nullptr);
+    SHParseDisplayName(it.wstring().c_str(), nullptr, pidl.put(), 0, nullptr);
     childIDs.push_back(std::move(pidl));
   }
 
   unique_idlist folderPidl;
-  outputShellItem.query<IPersistIDList>()->GetIDList(folderPidl.put());
+  SHParseDisplayName(
+    csvFiles.front().parent_path().wstring().c_str(),
+    nullptr,
+    folderPidl.put(),
+    0,
+    nullptr);
 
   std::vector<PCITEMID_CHILD> childRawPtrs;
   for (auto&& it: childIDs) {
@@ -584,9 +873,58 @@ void MainWindow::ConvertBinaryLogFiles() {
     folderPidl.get(), childRawPtrs.size(), childRawPtrs.data(), 0);
 }
 
+void MainWindow::LogConversionProgress() {
+  if (!mLogConversionJobs) {
+    return;
+  }
+
+  const auto finished = mLogConversionJobs->IsFinished();
+  if (finished && !mRevealedConvertedFiles) {
+    mRevealedConvertedFiles = true;
+    this->RevealConvertedFiles();
+  }
+
+  using enum LogConversionJobs::State;
+  for (auto&& it: mLogConversionJobs->GetStatus()) {
+    const auto name = it.mOutputPath.filename().string();
+    switch (it.mState) {
+      case Queued:
+        ImGui::ProgressBar(0, {-FLT_MIN, 0}, "Queued");
+        break;
+      case Running:
+        ImGui::ProgressBar(it.mProgress, {-FLT_MIN, 0});
+        break;
+      case Completed:
+        ImGui::ProgressBar(1, {-FLT_MIN, 0}, "Done");
+        break;
+      case Failed:
+        ImGui::ProgressBar(it.mProgress, {-FLT_MIN, 0}, "Failed");
+        break;
+      case Cancelled:
+        ImGui::ProgressBar(it.mProgress, {-FLT_MIN, 0}, "Cancelled");
+        break;
+    }
+    ImGui::SameLine();
+    ImGui::TextUnformatted(name.c_str());
+    if (it.mState == Failed && ImGui::IsItemHovered()) {
+      ImGui::SetTooltip("%s", it.mError.c_str());
+    }
+  }
+
+  if (!finished) {
+    if (ImGui::Button("Cancel conversion")) {
+      mLogConversionJobs->Cancel();
+    }
+    return;
+  }
+  if (ImGui::Button("Clear")) {
+    mLogConversionJobs.reset();
+  }
+}
+
 void MainWindow::PlotNVAPI() {
   const auto haveNVAPI = std::ranges::any_of(
-    mLiveData.mChartFrames, [](const auto& frame) -> bool {
+    mLiveChart, [](const auto& frame) -> bool {
       return frame.mValidDataBits
         & std::to_underlying(FramePerformanceCounters::ValidDataBits::NVAPI);
     });
@@ -600,7 +938,7 @@ void MainWindow::PlotNVAPI() {
   }
 
   double maxPState = 0;
-  for (auto&& frame: mLiveData.mChartFrames) {
+  for (auto&& frame: mLiveChart) {
     if (frame.mGpuPStateMax > maxPState) {
       maxPState = frame.mGpuPStateMax;
     }
@@ -619,7 +957,7 @@ void MainWindow::PlotNVAPI() {
     pstateTickCStrings.emplace_back(tick.c_str());
   }
 
-  ImPlot::SetupAxis(ImAxis_X1);
+  SetupHistoryAxis(mLiveChart);
   ImPlot::SetupAxis(ImAxis_Y1);
   // 15 is the highest documented value; add a bit more so the line isn't at
   // the top if we ever get there
@@ -639,48 +977,49 @@ void MainWindow::PlotNVAPI() {
     &LiveData::PlotFrame<[](const FrameMetrics& frame) {
       return frame.mGpuPerformanceDecreaseReasons != 0;
     }>,
-    mLiveData.mChartFrames.data(),
-    mLiveData.mChartFrames.size());
+    &mLiveChart,
+    mLiveChart.mFrames.size());
   ImPlot::PlotDigitalG(
     "Thermal Limit",
     &LiveData::PlotFrame<[](const FrameMetrics& frame) {
       return (frame.mGpuPerformanceDecreaseReasons
-              & NV_GPU_PERF_DECREASE_REASON_THERMAL_PROTECTION)
+              & DecreaseReason::ThermalProtection)
         != 0;
     }>,
-    mLiveData.mChartFrames.data(),
-    mLiveData.mChartFrames.size());
+    &mLiveChart,
+    mLiveChart.mFrames.size());
   ImPlot::PlotDigitalG(
     "Power Limit",
     &LiveData::PlotFrame<[](const FrameMetrics& frame) {
       return (frame.mGpuPerformanceDecreaseReasons
-              & (NV_GPU_PERF_DECREASE_REASON_POWER_CONTROL | NV_GPU_PERF_DECREASE_REASON_AC_BATT | NV_GPU_PERF_DECREASE_REASON_INSUFFICIENT_POWER))
+              & (DecreaseReason::PowerControl | DecreaseReason::ACBattery
+                 | DecreaseReason::InsufficientPower))
         != 0;
     }>,
-    mLiveData.mChartFrames.data(),
-    mLiveData.mChartFrames.size());
+    &mLiveChart,
+    mLiveChart.mFrames.size());
   ImPlot::PlotDigitalG(
     "API Limit",
     &LiveData::PlotFrame<[](const FrameMetrics& frame) {
       return (frame.mGpuPerformanceDecreaseReasons
-              & NV_GPU_PERF_DECREASE_REASON_API_TRIGGERED)
+              & DecreaseReason::APITriggered)
         != 0;
     }>,
-    mLiveData.mChartFrames.data(),
-    mLiveData.mChartFrames.size());
+    &mLiveChart,
+    mLiveChart.mFrames.size());
   ImPlot::PopStyleVar();
 
   ImPlot::PushStyleVar(ImPlotStyleVar_LineWeight, ImGui::GetFont()->Scale * 3);
   ImPlot::PlotLineG(
     "Lowest P-State",
     &LiveData::PlotFrame<&FrameMetrics::mGpuPStateMin>,
-    mLiveData.mChartFrames.data(),
-    mLiveData.mChartFrames.size());
+    &mLiveChart,
+    mLiveChart.mFrames.size());
   ImPlot::PlotLineG(
     "Highest P-State",
     &LiveData::PlotFrame<&FrameMetrics::mGpuPStateMax>,
-    mLiveData.mChartFrames.data(),
-    mLiveData.mChartFrames.size());
+    &mLiveChart,
+    mLiveChart.mFrames.size());
   ImPlot::PopStyleVar();
 }
 
@@ -690,12 +1029,12 @@ void MainWindow::PlotFramerate(const double maxMicroseconds) {
     return;
   }
 
-  ImPlot::SetupAxis(ImAxis_X1);
+  SetupHistoryAxis(mLiveChart);
 
   ImPlot::SetupAxis(ImAxis_Y1, "hz");
 
   std::optional<double> minInterval;
-  for (auto&& frame: mLiveData.mChartFrames) {
+  for (auto&& frame: mLiveChart) {
     const auto interval = frame.mSincePreviousFrame.count();
     if (!interval) {
       continue;
@@ -716,35 +1055,29 @@ void MainWindow::PlotFramerate(const double maxMicroseconds) {
   ImPlot::PlotLineG(
     "FPS",
     [](int idx, void* user_data) -> ImPlotPoint {
-      const auto& frame
-        = static_cast<LiveData::ChartFrames*>(user_data)->at(idx);
-      const auto interval = frame.mSincePreviousFrame.count();
-      return LiveData::PlotPoint {
-        idx,
-        interval ? 1000000.0f / interval : 0,
-      };
+      const auto& view = *static_cast<const LiveData::ChartView*>(user_data);
+      const auto interval = view.mFrames[idx].mSincePreviousFrame.count();
+      return view.MakePoint(idx, interval ? 1000000.0f / interval : 0);
     },
-    mLiveData.mChartFrames.data(),
-    mLiveData.mChartFrames.size());
+    &mLiveChart,
+    mLiveChart.mFrames.size());
 
   ImPlot::SetAxes(ImAxis_X1, ImAxis_Y2);
   ImPlot::PlotLineG(
     "Frame Interval",
     [](int idx, void* user_data) -> ImPlotPoint {
-      const auto& frame
-        = static_cast<LiveData::ChartFrames*>(user_data)->at(idx);
-      return LiveData::PlotPoint {
-        idx,
-        frame.mSincePreviousFrame.count(),
-      };
+      const auto& view = *static_cast<const LiveData::ChartView*>(user_data);
+      return view.MakePoint(idx, view.mFrames[idx].mSincePreviousFrame.count());
     },
-    mLiveData.mChartFrames.data(),
-    mLiveData.mChartFrames.size());
+    &mLiveChart,
+    mLiveChart.mFrames.size());
+
+  this->PlotLiveEvents();
 }
 
 void MainWindow::PlotFrameTimings(const double maxMicroseconds) {
   if (const auto plot = ImGuiScoped::ImPlot("Frame Timings")) {
-    ImPlot::SetupAxis(ImAxis_X1);
+    SetupHistoryAxis(mLiveChart);
     SetupMicrosecondsAxis(ImAxis_Y1, maxMicroseconds);
     ImPlot::SetAxes(ImAxis_X1, ImAxis_Y1);
 
@@ -752,42 +1085,44 @@ void MainWindow::PlotFrameTimings(const double maxMicroseconds) {
     sap.Plot(
       "Begin CPU",
       &LiveData::PlotMicroseconds<&FrameMetrics::mBeginFrameCpu>,
-      mLiveData.mChartFrames.data(),
-      mLiveData.mChartFrames.size());
+      &mLiveChart,
+      mLiveChart.mFrames.size());
     sap.Plot(
       "App CPU",
       &LiveData::PlotMicroseconds<&FrameMetrics::mAppCpu>,
-      mLiveData.mChartFrames.data(),
-      mLiveData.mChartFrames.size());
+      &mLiveChart,
+      mLiveChart.mFrames.size());
     sap.Plot(
       "Render CPU",
       &LiveData::PlotMicroseconds<&FrameMetrics::mRenderCpu>,
-      mLiveData.mChartFrames.data(),
-      mLiveData.mChartFrames.size());
+      &mLiveChart,
+      mLiveChart.mFrames.size());
     sap.Plot(
       "Submit CPU",
       &LiveData::PlotMicroseconds<&FrameMetrics::mEndFrameCpu>,
-      mLiveData.mChartFrames.data(),
-      mLiveData.mChartFrames.size());
+      &mLiveChart,
+      mLiveChart.mFrames.size());
     sap.HideNextItem(ImPlotCond_Once);
     sap.Plot(
       "Wait CPU",
       &LiveData::PlotMicroseconds<&FrameMetrics::mWaitFrameCpu>,
-      mLiveData.mChartFrames.data(),
-      mLiveData.mChartFrames.size());
+      &mLiveChart,
+      mLiveChart.mFrames.size());
 
     ImPlot::PlotLineG(
       "Render GPU",
       &LiveData::PlotMicroseconds<&FrameMetrics::mRenderGpu>,
-      mLiveData.mChartFrames.data(),
-      mLiveData.mChartFrames.size());
+      &mLiveChart,
+      mLiveChart.mFrames.size());
 
     ImPlot::HideNextItem(ImPlotCond_Once);
     ImPlot::PlotLineG(
       "Frame Interval",
       &LiveData::PlotMicroseconds<&FrameMetrics::mSincePreviousFrame>,
-      mLiveData.mChartFrames.data(),
-      mLiveData.mChartFrames.size());
+      &mLiveChart,
+      mLiveChart.mFrames.size());
+
+    this->PlotLiveEvents();
   }
 
   using PlotKind = ImStackedAreaPlotter::Kind;
@@ -801,22 +1136,111 @@ void MainWindow::PlotFrameTimings(const double maxMicroseconds) {
   }
 }
 
+void MainWindow::PlotLiveEvents() {
+  const auto now = win32::QueryPerformanceCounter();
+  const auto oldest = -mLiveChart.GetSeconds();
+
+  struct Marker {
+    double mX {};
+    std::string_view mLabel;
+  };
+  std::vector<Marker> hitches;
+  std::vector<Marker> steps;
+  for (auto&& event: mLiveData.mEvents) {
+    const auto x = -std::chrono::duration<double>(
+                      gPCM.ToDurationAllowNegative(event.mStartTime, now))
+                      .count();
+    if (x < oldest) {
+      continue;
+    }
+    auto& markers
+      = (event.mKind == FrameEventDetector::Kind::Hitch) ? hitches : steps;
+    markers.emplace_back(x, magic_enum::enum_name(event.mStage));
+  }
+
+  for (auto&& [label, markers]: {
+         std::pair {"Hitches", &hitches},
+         std::pair {"Step Changes", &steps},
+       }) {
+    if (markers->empty()) {
+      continue;
+    }
+    ImPlot::PlotInfLines(
+      label,
+      &markers->front().mX,
+      static_cast<int>(markers->size()),
+      0,
+      0,
+      sizeof(Marker));
+    const auto color = ImPlot::GetLastItemColor();
+    for (auto&& marker: *markers) {
+      ImPlot::TagX(
+        marker.mX,
+        color,
+        "%.*s",
+        static_cast<int>(marker.mLabel.size()),
+        marker.mLabel.data());
+    }
+  }
+}
+
+void MainWindow::PlotFramePacing() {
+  const auto haveDisplayPeriod
+    = std::ranges::any_of(mLiveChart, [](const FrameMetrics& frame) {
+        return frame.mPacing.mDisplayPeriod.count() != 0;
+      });
+  if (!haveDisplayPeriod) {
+    return;
+  }
+
+  const auto plot = ImGuiScoped::ImPlot("Frame Pacing");
+  if (!plot) {
+    return;
+  }
+
+  SetupHistoryAxis(mLiveChart);
+  ImPlot::SetupAxis(ImAxis_Y1, "%");
+  ImPlot::SetupAxisLimits(ImAxis_Y1, 0.0, 100.0, ImPlotCond_Always);
+  ImPlot::SetupAxis(ImAxis_Y2, "µs", ImPlotAxisFlags_AutoFit);
+
+  ImPlot::SetAxes(ImAxis_X1, ImAxis_Y1);
+  ImPlot::PlotLineG(
+    "Late Frames",
+    &LiveData::PlotFrame<[](const FrameMetrics& frame) {
+      if (!frame.mFrameCount) {
+        return 0.0;
+      }
+      return (100.0 * frame.mPacing.mLateFrameCount) / frame.mFrameCount;
+    }>,
+    &mLiveChart,
+    mLiveChart.mFrames.size());
+
+  ImPlot::SetAxes(ImAxis_X1, ImAxis_Y2);
+  ImPlot::PlotLineG(
+    "Display Jitter",
+    &LiveData::PlotMicroseconds<[](const FrameMetrics& frame) {
+      return frame.mPacing.mJitter;
+    }>,
+    &mLiveChart,
+    mLiveChart.mFrames.size());
+}
+
 void MainWindow::PlotVideoMemory() {
   const auto plot = ImGuiScoped::ImPlot("Video Memory");
   if (!plot) {
     return;
   }
   const auto max = std::ranges::max_element(
-    mLiveData.mChartFrames, {}, [](const FrameMetrics& frame) {
+    mLiveChart, {}, [](const FrameMetrics& frame) {
       return std::max(
-        frame.mVideoMemoryInfo.AvailableForReservation,
-        frame.mVideoMemoryInfo.Budget);
+        frame.mVideoMemoryInfo.mAvailableForReservation,
+        frame.mVideoMemoryInfo.mBudget);
     });
 
   const auto vramAxisLimit = RoundUp(
                                std::max(
-                                 max->mVideoMemoryInfo.AvailableForReservation,
-                                 max->mVideoMemoryInfo.Budget),
+                                 max->mVideoMemoryInfo.mAvailableForReservation,
+                                 max->mVideoMemoryInfo.mBudget),
                                5ui64 * 1024 * 1024 * 1024)
 
     / (1024 * 1024);
@@ -833,7 +1257,7 @@ void MainWindow::PlotVideoMemory() {
     labelCStrings.push_back(label.c_str());
   }
 
-  ImPlot::SetupAxis(ImAxis_X1);
+  SetupHistoryAxis(mLiveChart);
   ImPlot::SetupAxis(ImAxis_Y1, "mb");
   ImPlot::SetupAxisLimits(ImAxis_Y1, 0.0, vramAxisLimit, ImPlotCond_Always);
   ImPlot::SetupAxisTicks(
@@ -846,26 +1270,40 @@ void MainWindow::PlotVideoMemory() {
 
   ImPlot::PlotLineG(
     "Current Usage",
-    &LiveData::PlotVideoMemory<&DXGI_QUERY_VIDEO_MEMORY_INFO::CurrentUsage>,
-    mLiveData.mChartFrames.data(),
-    mLiveData.mChartFrames.size());
+    &LiveData::PlotVideoMemory<&VideoMemoryInfo::mCurrentUsage>,
+    &mLiveChart,
+    mLiveChart.mFrames.size());
   ImPlot::PlotLineG(
     "Budget",
-    &LiveData::PlotVideoMemory<&DXGI_QUERY_VIDEO_MEMORY_INFO::Budget>,
-    mLiveData.mChartFrames.data(),
-    mLiveData.mChartFrames.size());
+    &LiveData::PlotVideoMemory<&VideoMemoryInfo::mBudget>,
+    &mLiveChart,
+    mLiveChart.mFrames.size());
   ImPlot::PlotLineG(
     "Current Reservation",
-    &LiveData::PlotVideoMemory<
-      &DXGI_QUERY_VIDEO_MEMORY_INFO::CurrentReservation>,
-    mLiveData.mChartFrames.data(),
-    mLiveData.mChartFrames.size());
+    &LiveData::PlotVideoMemory<&VideoMemoryInfo::mCurrentReservation>,
+    &mLiveChart,
+    mLiveChart.mFrames.size());
   ImPlot::PlotLineG(
     "Available for Reservation",
-    &LiveData::PlotVideoMemory<
-      &DXGI_QUERY_VIDEO_MEMORY_INFO::AvailableForReservation>,
-    mLiveData.mChartFrames.data(),
-    mLiveData.mChartFrames.size());
+    &LiveData::PlotVideoMemory<&VideoMemoryInfo::mAvailableForReservation>,
+    &mLiveChart,
+    mLiveChart.mFrames.size());
+}
+
+void MainWindow::HistoryRangeControls() {
+  using Range = LiveData::HistoryRange;
+  auto& range = mLiveData.mHistoryRange;
+  if (ImGui::RadioButton("30 seconds", range == Range::Seconds)) {
+    range = Range::Seconds;
+  }
+  ImGui::SameLine();
+  if (ImGui::RadioButton("30 minutes", range == Range::Minutes)) {
+    range = Range::Minutes;
+  }
+  ImGui::SameLine();
+  if (ImGui::RadioButton("6 hours", range == Range::Hours)) {
+    range = Range::Hours;
+  }
 }
 
 void MainWindow::LiveDataSection() {
@@ -899,7 +1337,10 @@ void MainWindow::LiveDataSection() {
     mLiveApp = {};
     mLiveData.mSHMFrameIndex = 0;
     mLiveData.mAggregator.Reset();
-    mLiveData.mChartFrames = {LiveData::BufferSize};
+    mLiveData.mEventAggregator.Reset();
+    mLiveData.mEventDetector = {};
+    mLiveData.mEvents.clear();
+    mLiveData.ResetHistory();
   }
 
   if (mSHM.IsValid() && mSHM->mWriterProcessID != mLiveApp.mProcessID) {
@@ -932,8 +1373,11 @@ void MainWindow::LiveDataSection() {
         .c_str());
   }
 
+  this->HistoryRangeControls();
+  mLiveChart = mLiveData.GetChartView(mLiveData.mHistoryRange);
+
   const auto slowestFrameMicroseconds
-    = std::ranges::max_element(mLiveData.mChartFrames, {}, [](const auto& it) {
+    = std::ranges::max_element(mLiveChart, {}, [](const auto& it) {
         return it.mSincePreviousFrame.count();
       })->mSincePreviousFrame.count();
   const auto maxMicroseconds = std::clamp(
@@ -943,6 +1387,7 @@ void MainWindow::LiveDataSection() {
 
   this->PlotFramerate(maxMicroseconds);
   this->PlotFrameTimings(maxMicroseconds);
+  this->PlotFramePacing();
   this->PlotSystemFrequencies();
   this->PlotVideoMemory();
   this->PlotNVAPI();
@@ -953,30 +1398,30 @@ void MainWindow::PlotSystemFrequencies() {
   if (!plot) {
     return;
   }
-  ImPlot::SetupAxis(ImAxis_X1);
+  SetupHistoryAxis(mLiveChart);
   ImPlot::SetupAxis(ImAxis_Y1, "MHz", ImPlotAxisFlags_AutoFit);
   ImPlot::SetAxes(ImAxis_X1, ImAxis_Y1);
 
   ImPlot::PlotLineG(
     "GPU Min",
     &LiveData::PlotFrame<&FrameMetrics::mGpuGraphicsKHzMin, 1000.0>,
-    mLiveData.mChartFrames.data(),
-    mLiveData.mChartFrames.size());
+    &mLiveChart,
+    mLiveChart.mFrames.size());
   ImPlot::PlotLineG(
     "GPU Max",
     &LiveData::PlotFrame<&FrameMetrics::mGpuGraphicsKHzMax, 1000.0>,
-    mLiveData.mChartFrames.data(),
-    mLiveData.mChartFrames.size());
+    &mLiveChart,
+    mLiveChart.mFrames.size());
   ImPlot::PlotLineG(
     "VRAM Clock Min",
     &LiveData::PlotFrame<&FrameMetrics::mGpuMemoryKHzMin, 1000.0>,
-    mLiveData.mChartFrames.data(),
-    mLiveData.mChartFrames.size());
+    &mLiveChart,
+    mLiveChart.mFrames.size());
   ImPlot::PlotLineG(
     "VRAM Clock Max",
     &LiveData::PlotFrame<&FrameMetrics::mGpuMemoryKHzMax, 1000.0>,
-    mLiveData.mChartFrames.data(),
-    mLiveData.mChartFrames.size());
+    &mLiveChart,
+    mLiveChart.mFrames.size());
 }
 
 void MainWindow::AboutSection() {
@@ -1029,6 +1474,17 @@ void MainWindow::UpdateLiveData() {
       const auto& frame = mSHM->GetFramePerformanceCounters(i);
       mLiveData.mLatestMetricsAt = frame.mCore.mEndFrameStop;
       mLiveData.mAggregator.Push(frame);
+
+      mLiveData.mEventAggregator.Push(frame);
+      const auto metrics = mLiveData.mEventAggregator.Flush();
+      if (!metrics) {
+        continue;
+      }
+      auto& events = mLiveData.mEvents;
+      events.append_range(mLiveData.mEventDetector.Push(*metrics));
+      while (events.size() > LiveData::MaxEvents) {
+        events.pop_front();
+      }
     }
   }
 
@@ -1039,8 +1495,7 @@ void MainWindow::UpdateLiveData() {
   }
   mLiveData.mLastChartFrameAt = scNow;
 
-  LARGE_INTEGER pcNow {};
-  QueryPerformanceCounter(&pcNow);
+  const auto pcNow = win32::QueryPerformanceCounter();
 
   auto metrics = mLiveData.mAggregator.Flush();
   if (metrics) {
@@ -1050,7 +1505,7 @@ void MainWindow::UpdateLiveData() {
     <= LiveData::ChartInterval * 5) {
     metrics = mLiveData.mLatestMetrics;
   } else {
-    mLiveData.mChartFrames.push_back({});
+    mLiveData.PushChartFrame({});
     return;
   }
 
@@ -1064,5 +1519,5 @@ void MainWindow::UpdateLiveData() {
     return;
   }
 
-  mLiveData.mChartFrames.push_back(*metrics);
+  mLiveData.PushChartFrame(*metrics);
 }
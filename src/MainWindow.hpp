@@ -5,6 +5,9 @@
 #include <imgui.h>
 #include <implot.h>
 
+#include <deque>
+#include <memory>
+#include <span>
 #include <vector>
 
 #include "AutoUpdater.hpp"
@@ -12,21 +15,17 @@
 #include "CSVWriter.hpp"
 #include "Config.hpp"
 #include "ContiguousRingBuffer.hpp"
+#include "FrameEventDetector.hpp"
 #include "ImStackedAreaPlotter.hpp"
+#include "LogCatalog.hpp"
+#include "LogConversionJobs.hpp"
+#include "LogViewer.hpp"
 #include "MetricsAggregator.hpp"
 #include "SHMReader.hpp"
 #include "Window.hpp"
 
 struct LiveData {
   LiveData();
-  template <class T>
-  struct PlotPoint : ImPlotPoint {
-    PlotPoint(const int idx, const T value)
-      : ImPlotPoint(
-          static_cast<double>(idx) / LiveData::ChartFPS,
-          static_cast<double>(value)) {
-    }
-  };
 
   static constexpr size_t ChartFPS = 30;
   static constexpr auto ChartInterval
@@ -40,7 +39,7 @@ struct LiveData {
 
   bool mEnabled {true};
   std::chrono::steady_clock::time_point mLastChartFrameAt {};
-  LARGE_INTEGER mLatestMetricsAt {};
+  int64_t mLatestMetricsAt {};
   FrameMetrics mLatestMetrics {};
 
   uint64_t mSHMFrameIndex {};
@@ -51,13 +50,104 @@ struct LiveData {
 
   ChartFrames mChartFrames {BufferSize};
 
+  // Fed every frame, unlike `mAggregator`, so that single-frame hitches
+  // aren't averaged away
+  MetricsAggregator mEventAggregator;
+  FrameEventDetector mEventDetector;
+  static constexpr size_t MaxEvents = 64;
+  std::deque<FrameEventDetector::Event> mEvents;
+
+  /** Lower-resolution history, fed by merging points from the tier above.
+   *
+   * Each point is a `MetricsAggregator` merge of `PointsPerMerge` points from
+   * the previous tier, so averages are still weighted by frame count.
+   */
+  template <size_t TPointsPerMerge, size_t TCapacity>
+  struct HistoryTier {
+    static constexpr size_t PointsPerMerge = TPointsPerMerge;
+    static constexpr size_t Capacity = TCapacity;
+
+    explicit HistoryTier(const PerformanceCounterMath& pcm)
+      : mAggregator(pcm) {
+    }
+
+    ContiguousRingBuffer<FrameMetrics, Capacity> mPoints {Capacity};
+    MetricsAggregator mAggregator;
+    size_t mPendingPoints {};
+
+    /// Returns the merged point, if this completed one
+    std::optional<FrameMetrics> Push(const FrameMetrics& point) {
+      mAggregator.Push(point);
+      if (++mPendingPoints < PointsPerMerge) {
+        return std::nullopt;
+      }
+      mPendingPoints = 0;
+      // Keep gaps so that every point covers the same amount of time
+      const auto merged = mAggregator.Flush().value_or(FrameMetrics {});
+      mPoints.push_back(merged);
+      return merged;
+    }
+  };
+  // One point per second for 30 minutes
+  using MinutesTier = HistoryTier<ChartFPS, 30 * 60>;
+  // One point per 10 seconds for 6 hours
+  using HoursTier = HistoryTier<10, 6 * 60 * 6>;
+
+  struct History {
+    explicit History(const PerformanceCounterMath& pcm)
+      : mMinutes(pcm),
+        mHours(pcm) {
+    }
+
+    MinutesTier mMinutes;
+    HoursTier mHours;
+  };
+  // Fixed size, but too large for MainWindow, which is on the stack
+  std::unique_ptr<History> mHistory;
+
+  enum class HistoryRange {
+    Seconds,
+    Minutes,
+    Hours,
+  };
+  HistoryRange mHistoryRange {HistoryRange::Seconds};
+
+  /// Add a point to the full-resolution chart, and feed the other tiers
+  void PushChartFrame(const FrameMetrics&);
+  void ResetHistory();
+
+  /// Points from the tier for a `HistoryRange`, oldest first
+  struct ChartView {
+    std::span<FrameMetrics> mFrames;
+    double mSecondsPerPoint {};
+
+    [[nodiscard]]
+    double GetSeconds() const noexcept {
+      return mFrames.size() * mSecondsPerPoint;
+    }
+
+    /// X is seconds before the newest point
+    [[nodiscard]]
+    ImPlotPoint MakePoint(const int idx, const auto value) const noexcept {
+      const auto age = static_cast<double>(idx)
+        - static_cast<double>(mFrames.size() - 1);
+      return {age * mSecondsPerPoint, static_cast<double>(value)};
+    }
+
+    auto begin() const noexcept {
+      return mFrames.begin();
+    }
+    auto end() const noexcept {
+      return mFrames.end();
+    }
+  };
+  [[nodiscard]]
+  ChartView GetChartView(HistoryRange);
+
   template <auto Getter, double Scale = 1.0>
   static ImPlotPoint PlotFrame(int idx, void* user_data) {
-    const auto& frame = static_cast<LiveData::ChartFrames*>(user_data)->at(idx);
-    return PlotPoint {
-      idx,
-      std::invoke(Getter, frame) / Scale,
-    };
+    const auto& view = *static_cast<const ChartView*>(user_data);
+    return view.MakePoint(idx, std::invoke(Getter, view.mFrames[idx]) / Scale);
   }
 
   template <auto Getter>
@@ -95,16 +185,38 @@ class MainWindow final : public Window {
 
   int mCSVFramesPerRow {CSVWriter::DefaultFramesPerRow};
   std::vector<BinaryLogReader> mBinaryLogFiles;
+  std::optional<LogConversionJobs> mLogConversionJobs;
+  bool mRevealedConvertedFiles {false};
+
+  struct LogCatalogSummary {
+    size_t mLogCount {};
+    uint64_t mTotalBytes {};
+    std::chrono::microseconds mTotalDuration {};
+  };
+  LogCatalog mLogCatalog;
+  std::optional<LogCatalogSummary> mLogCatalogSummary;
+  std::chrono::steady_clock::time_point mLogCatalogRefreshedAt {};
   [[nodiscard]] std::vector<BinaryLogReader> PickBinaryLogFiles();
   void ConvertBinaryLogFiles();
+  void RevealConvertedFiles();
   void LoggingControls();
   void LogConversionControls();
+  void LogConversionProgress();
+  void LogCatalogOverview();
   void LoggingSection();
+
+  std::optional<LogViewer> mLogViewer;
+  void LogViewerSection();
+  void PlotLogViewer(const LogPyramid&);
   void PlotNVAPI();
   void PlotSystemFrequencies();
   void PlotFramerate(double maxMicroseconds);
   void PlotFrameTimings(double maxMicroseconds);
+  void PlotFramePacing();
+  // Markers for `LiveData::mEvents`; call inside a plot
+  void PlotLiveEvents();
   void PlotVideoMemory();
+  void HistoryRangeControls();
   void LiveDataSection();
   void AboutSection();
 
@@ -122,6 +234,8 @@ class MainWindow final : public Window {
   LiveApp mLiveApp;
 
   LiveData mLiveData;
+  // The tier of `mLiveData` currently being plotted
+  LiveData::ChartView mLiveChart;
   std::mutex mLiveDataMutex;
   std::jthread mLiveDataThread;
   void UpdateLiveDataThreadEntry(const std::stop_token);
@@ -9,12 +9,20 @@
 #include <openxr/openxr.h>
 #include <openxr/openxr_loader_negotiation.h>
 
+#include <algorithm>
 #include <atomic>
+#include <chrono>
 #include <format>
+#include <memory>
+#include <thread>
 
 #include "BinaryLogWriter.hpp"
 #include "Config.hpp"
+#include "FlightRecorder.hpp"
 #include "FrameMetricsStore.hpp"
+#include "HostMetrics.hpp"
+#include "MetricsSampler.hpp"
+#include "PerformanceCounterMath.hpp"
 #include "SHMWriter.hpp"
 #include "Win32Utils.hpp"
 
@@ -33,19 +41,69 @@ TRACELOGGING_DEFINE_PROVIDER(
   (0xdc51862b, 0xa5c6, 0x53e5, 0x4d, 0xad, 0xaf, 0xee, 0x57, 0xd3, 0xe7, 0x59));
 
 static auto gConfig = Config::GetForOpenXRAPILayer();
+static const auto gPCM = PerformanceCounterMath::CreateForLiveData();
 
 static SHMWriter gSHM;
 static std::optional<BinaryLogWriter> gBinaryLogger;
+static std::optional<FlightRecorder> gFlightRecorder;
+// `gConfig.GetChangeCount()` when the flight recorder was last configured; the
+// config is loaded on construction, so the count is never 0
+static uint64_t gFlightRecorderConfigChangeCount {};
 static FrameMetricsStore gFrameMetrics;
-static std::vector<ApiLayerApi::LogFrameHook> gLoggingHooks;
+static std::unique_ptr<MetricsSampler<HostMetrics::Sample>>
+  gHostMetricsSampler;
+// As `gFlightRecorderConfigChangeCount`
+static uint64_t gHostMetricsConfigChangeCount {};
+// Destroying a sampler waits for its thread, so replaced samplers are
+// destroyed here instead of on the app's thread
+static std::jthread gHostMetricsSamplerRetirement;
+
+// Each queued frame tracks hook completion as a bitmask
+static constexpr size_t MaxLoggingHooks = 64;
+struct LoggingHook {
+  ApiLayerApi::LogFrameHook mHook {};
+  ApiLayerApi::LogFrameAbandonedHook mOnAbandoned {};
+};
+static std::vector<LoggingHook> gLoggingHooks;
+
+// Hooks are run for every queued frame, but frames are only published in
+// display time order; if this many frames are waiting on the oldest one,
+// we stop waiting for it.
+static constexpr size_t LogQueueReorderWindow = 8;
+// If a hook isn't ready for a frame after this long, we give up on that hook
+// for that frame
+static constexpr auto LogFrameHookTimeout = std::chrono::milliseconds(250);
+// ... and if that happens this many times in a row, we give up on the hook
+static constexpr uint32_t LogFrameHookMaxConsecutiveTimeouts = 10;
+
+struct LogFrameHookState {
+  uint32_t mConsecutiveTimeouts {};
+  bool mIsUsable {true};
+};
+static std::array<LogFrameHookState, MaxLoggingHooks> gLoggingHookStates;
+
+struct QueuedFrame {
+  Frame mFrame {};
+  int64_t mEnqueuedAt {};
+  int64_t mCompletedAt {};
+  // Bit `i` is set if `gLoggingHooks[i]` has not yet returned `Ready`
+  uint64_t mPendingHooks {};
+};
 
-static std::deque<Frame> gLogQueue;
+static std::deque<QueuedFrame> gLogQueue;
 static std::mutex gLogQueueMutex;
 
 static class APILayerAPIImpl final : public ApiLayerApi {
  public:
-  void AppendLogFrameHook(LogFrameHook logFrameHook) override {
-    gLoggingHooks.push_back(logFrameHook);
+  void AppendLogFrameHook(
+    LogFrameHook logFrameHook,
+    LogFrameAbandonedHook logFrameAbandonedHook) override {
+    std::unique_lock lock(gLogQueueMutex);
+    if (gLoggingHooks.size() >= MaxLoggingHooks) {
+      dprint("core_metrics: too many logging hooks, ignoring");
+      return;
+    }
+    gLoggingHooks.push_back({logFrameHook, logFrameAbandonedHook});
   }
 } gApiLayerApi {};
 
@@ -62,35 +120,270 @@ ApiLayerApi* XRFrameTools_GetApiLayerApi(
   return &gApiLayerApi;
 }
 
-enum class LogFrameResult {
-  Complete,
-  Pending,
-};
+static std::optional<FlightRecorder::Settings> GetFlightRecorderSettings() {
+  const auto preTriggerSeconds = gConfig.GetFlightRecorderSeconds();
+  if (preTriggerSeconds <= 0) {
+    return std::nullopt;
+  }
+  // The registry values aren't validated; clamp them the same way as
+  // `FlightRecorder`, so that the settings still compare equal
+  const auto seconds = [](const int64_t value) {
+    return std::chrono::seconds {std::clamp<int64_t>(
+      value, 0, FlightRecorder::MaxDuration.count())};
+  };
+  const auto microseconds = [](const int64_t value) {
+    return std::chrono::microseconds {std::clamp<int64_t>(
+      value,
+      0,
+      std::chrono::microseconds {FlightRecorder::MaxDuration}.count())};
+  };
+  return FlightRecorder::Settings {
+    .mPreTriggerDuration = seconds(preTriggerSeconds),
+    .mPostTriggerDuration
+    = seconds(gConfig.GetFlightRecorderPostTriggerSeconds()),
+    .mFrameIntervalTrigger = microseconds(
+      gConfig.GetFlightRecorderFrameIntervalTriggerMicroseconds()),
+    .mGpuTimeTrigger
+    = microseconds(gConfig.GetFlightRecorderGpuTimeTriggerMicroseconds()),
+    .mGpuThrottlingTrigger
+    = gConfig.GetFlightRecorderGpuThrottlingTrigger() != 0,
+  };
+}
+
+static void ReconfigureFlightRecorder() {
+  const auto settings = GetFlightRecorderSettings();
+  if (!settings) {
+    if (gFlightRecorder) {
+      dprint("tearing down flight recorder");
+      gFlightRecorder = std::nullopt;
+    }
+    return;
+  }
+
+  if (gFlightRecorder && gFlightRecorder->GetSettings() != *settings) {
+    dprint("flight recorder settings changed");
+    gFlightRecorder = std::nullopt;
+  }
+  if (!gFlightRecorder) {
+    dprint(
+      "creating flight recorder with {}s history",
+      settings->mPreTriggerDuration.count());
+    gFlightRecorder.emplace(*settings);
+  }
+}
+
+static void UpdateFlightRecorder(const Frame& frame) {
+  // The settings are several registry-backed reads, so only read them again
+  // if the config has changed
+  if (const auto changeCount = gConfig.GetChangeCount();
+      changeCount != gFlightRecorderConfigChangeCount) {
+    gFlightRecorderConfigChangeCount = changeCount;
+    ReconfigureFlightRecorder();
+  }
+
+  if (gFlightRecorder) {
+    gFlightRecorder->LogFrame(frame);
+  }
+}
 
-[[nodiscard]]
-static LogFrameResult LogFrame(Frame& frame) {
-  for (auto&& hook: gLoggingHooks) {
-    if (hook(&frame) == ApiLayerApi::LogFrameHookResult::Pending) {
-      return LogFrameResult::Pending;
+static void RetireHostMetricsSampler() {
+  // Assigning joins the previous retirement thread, which will have finished
+  // long ago
+  gHostMetricsSamplerRetirement
+    = std::jthread {[sampler = std::move(gHostMetricsSampler)] {}};
+}
+
+static void ReconfigureHostMetrics() {
+  const std::chrono::milliseconds interval {
+    gConfig.GetHostMetricsSampleIntervalMilliseconds()};
+  if (interval <= std::chrono::milliseconds::zero()) {
+    if (gHostMetricsSampler) {
+      dprint("tearing down host metrics sampler");
+      RetireHostMetricsSampler();
     }
+    return;
+  }
+
+  if (gHostMetricsSampler && gHostMetricsSampler->GetInterval() != interval) {
+    dprint("host metrics sample interval changed");
+    RetireHostMetricsSampler();
+  }
+  if (!gHostMetricsSampler) {
+    dprint(
+      "creating host metrics sampler with {}ms interval", interval.count());
+    gHostMetricsSampler = std::make_unique<MetricsSampler<HostMetrics::Sample>>(
+      interval,
+      [source = std::shared_ptr {HostMetrics::Source::Create()}]() {
+        return source->GetSample();
+      });
+  }
+}
+
+static void AttachHostMetrics(Frame& frame) {
+  // As with the flight recorder, only read the config again if it has changed
+  if (const auto changeCount = gConfig.GetChangeCount();
+      changeCount != gHostMetricsConfigChangeCount) {
+    gHostMetricsConfigChangeCount = changeCount;
+    ReconfigureHostMetrics();
+  }
+  if (!gHostMetricsSampler) {
+    return;
+  }
+
+  const auto sample
+    = gHostMetricsSampler->GetNearest(frame.mCore.mEndFrameStart);
+  if (!sample) {
+    return;
+  }
+  using Bits = FramePerformanceCounters::ValidDataBits;
+  if (sample->mCpu.mSampleTime) {
+    frame.mHostCpu = sample->mCpu;
+    frame.mValidDataBits |= Bits::HostCpu;
+  }
+  if (sample->mProcess.mSampleTime) {
+    frame.mProcessResources = sample->mProcess;
+    frame.mValidDataBits |= Bits::ProcessResources;
+  }
+}
+
+static BinaryLog::LoggingPolicy GetBinaryLoggingPolicy() {
+  using Kind = BinaryLog::LoggingPolicy::Kind;
+  const auto kind = gConfig.GetBinaryLoggingPolicy();
+  if (kind <= std::to_underlying(Kind::Full)
+      || kind > std::to_underlying(Kind::Adaptive)) {
+    // Normalized the same way as BinaryLogWriter, so they compare equal
+    return {.mKind = Kind::Full, .mInterval = 1};
   }
+  return {
+    .mKind = static_cast<Kind>(kind),
+    .mInterval = static_cast<uint32_t>(std::clamp<int64_t>(
+      gConfig.GetBinaryLoggingPolicyInterval(),
+      1,
+      std::numeric_limits<uint16_t>::max())),
+    .mAdaptiveThresholdPercent = static_cast<uint32_t>(std::clamp<int64_t>(
+      gConfig.GetBinaryLoggingAdaptiveThresholdPercent(), 0, 1000)),
+  };
+}
+
+static BinaryLogWriter::Options GetBinaryLogWriterOptions() {
+  // Negative values are treated as 'unlimited', the same as 0
+  const auto get = [](const int64_t value) {
+    return static_cast<uint64_t>(std::max<int64_t>(value, 0));
+  };
+  constexpr uint64_t Megabyte = 1024 * 1024;
+
+  BinaryLogWriter::Options ret {
+    .mLoggingPolicy = GetBinaryLoggingPolicy(),
+  };
+  ret.mMaxSegmentBytes
+    = get(gConfig.GetBinaryLoggingMaxSegmentMegabytes()) * Megabyte;
+  ret.mMaxSegmentDuration
+    = std::chrono::minutes {get(gConfig.GetBinaryLoggingMaxSegmentMinutes())};
+  ret.mRetention.mMaxTotalBytes
+    = get(gConfig.GetLogRetentionMaxTotalMegabytes()) * Megabyte;
+  ret.mRetention.mMaxAge
+    = std::chrono::days {get(gConfig.GetLogRetentionMaxAgeDays())};
+  return ret;
+}
+
+static void PublishFrame(const Frame& frame) {
   gSHM.LogFrame(frame);
+  UpdateFlightRecorder(frame);
 
   if (!gConfig.IsBinaryLoggingEnabled()) {
     if (gBinaryLogger) {
       dprint("tearing down binary logger");
       gBinaryLogger = std::nullopt;
     }
-    return LogFrameResult::Complete;
+    return;
   }
 
+  const auto options = GetBinaryLogWriterOptions();
+  if (gBinaryLogger && gBinaryLogger->GetOptions() != options) {
+    dprint("binary logging options changed, starting new log");
+    gBinaryLogger = std::nullopt;
+  }
   if (!gBinaryLogger) {
-    dprint("creating binary logger");
-    gBinaryLogger.emplace();
+    dprint(
+      "creating binary logger with policy {}",
+      std::to_underlying(options.mLoggingPolicy.mKind));
+    gBinaryLogger.emplace(options);
   }
 
   gBinaryLogger->LogFrame(frame);
-  return LogFrameResult::Complete;
+}
+
+static void MarkCompleted(QueuedFrame& it, const int64_t now) {
+  it.mPendingHooks = 0;
+  it.mCompletedAt = now;
+}
+
+// Publish the frame without waiting for the hook any longer
+static void AbandonLogFrameHook(const size_t hookIndex, QueuedFrame& it) {
+  it.mPendingHooks &= ~(uint64_t {1} << hookIndex);
+  if (const auto onAbandoned = gLoggingHooks.at(hookIndex).mOnAbandoned) {
+    onAbandoned(&it.mFrame);
+  }
+}
+
+static void OnLogFrameHookTimeout(const size_t hookIndex, QueuedFrame& it) {
+  auto& state = gLoggingHookStates.at(hookIndex);
+  AbandonLogFrameHook(hookIndex, it);
+
+  TraceLoggingWrite(
+    gTraceProvider,
+    "LogFrameHook/Timeout",
+    TraceLoggingValue(static_cast<uint32_t>(hookIndex), "HookIndex"),
+    TraceLoggingValue(it.mFrame.mCore.mXrDisplayTime, "DisplayTime"),
+    TraceLoggingValue(state.mConsecutiveTimeouts, "ConsecutiveTimeouts"));
+
+  if (
+    state.mIsUsable
+    && ++state.mConsecutiveTimeouts >= LogFrameHookMaxConsecutiveTimeouts) {
+    dprint(
+      "core_metrics: logging hook {} timed out {} times in a row; marking "
+      "unusable",
+      hookIndex,
+      state.mConsecutiveTimeouts);
+    state.mIsUsable = false;
+  }
+}
+
+static void RunLogFrameHooks(QueuedFrame& it, const int64_t now) {
+  if (!it.mPendingHooks) {
+    return;
+  }
+
+  const auto timedOut
+    = gPCM.ToDurationAllowNegative(it.mEnqueuedAt, now) > LogFrameHookTimeout;
+
+  for (size_t i = 0; i < gLoggingHooks.size(); ++i) {
+    const auto bit = uint64_t {1} << i;
+    if (!(it.mPendingHooks & bit)) {
+      continue;
+    }
+    auto& state = gLoggingHookStates.at(i);
+    if (!state.mIsUsable) {
+      AbandonLogFrameHook(i, it);
+      continue;
+    }
+
+    if (
+      gLoggingHooks.at(i).mHook(&it.mFrame)
+      == ApiLayerApi::LogFrameHookResult::Ready) {
+      it.mPendingHooks &= ~bit;
+      state.mConsecutiveTimeouts = 0;
+      continue;
+    }
+
+    if (timedOut) {
+      OnLogFrameHookTimeout(i, it);
+    }
+  }
+
+  if (!it.mPendingHooks) {
+    MarkCompleted(it, now);
+  }
 }
 
 static void FlushMetrics() {
@@ -98,10 +391,52 @@ static void FlushMetrics() {
     return;
   }
   std::unique_lock<std::mutex> lock(gLogQueueMutex);
+
+  const auto now = win32::QueryPerformanceCounter();
+
+  // Frames are completed independently, so one slow hook on one frame doesn't
+  // stop other frames from collecting their data...
+  for (auto&& it: gLogQueue) {
+    RunLogFrameHooks(it, now);
+  }
+
+  // ... but they're still published in order
   while (!gLogQueue.empty()) {
-    if (LogFrame(gLogQueue.front()) == LogFrameResult::Pending) {
-      break;
+    auto& front = gLogQueue.front();
+    if (front.mPendingHooks) {
+      if (gLogQueue.size() <= LogQueueReorderWindow) {
+        break;
+      }
+      // This is backpressure rather than the hook timing out, so it doesn't
+      // count towards `LogFrameHookMaxConsecutiveTimeouts`
+      TraceLoggingWrite(
+        gTraceProvider,
+        "LogQueue/ReorderWindowFull",
+        TraceLoggingValue(front.mFrame.mCore.mXrDisplayTime, "DisplayTime"),
+        TraceLoggingValue(front.mPendingHooks, "PendingHooks"));
+      for (size_t i = 0; i < gLoggingHooks.size(); ++i) {
+        if (front.mPendingHooks & (uint64_t {1} << i)) {
+          AbandonLogFrameHook(i, front);
+        }
+      }
+      MarkCompleted(front, now);
     }
+
+    TraceLoggingWrite(
+      gTraceProvider,
+      "LogQueue/PublishFrame",
+      TraceLoggingValue(front.mFrame.mCore.mXrDisplayTime, "DisplayTime"),
+      TraceLoggingValue(static_cast<uint32_t>(gLogQueue.size()), "QueueDepth"),
+      TraceLoggingValue(
+        gPCM.ToDurationAllowNegative(front.mEnqueuedAt, front.mCompletedAt)
+          .count(),
+        "TimeToCompleteMicroseconds"),
+      TraceLoggingValue(
+        gPCM.ToDurationAllowNegative(front.mEnqueuedAt, now).count(),
+        "TimeToPublishMicroseconds"));
+
+    AttachHostMetrics(front.mFrame);
+    PublishFrame(front.mFrame);
     gLogQueue.pop_front();
   }
 }
@@ -113,9 +448,9 @@ XrResult hooked_xrWaitFrame(
   XrFrameState* frameState) noexcept {
   auto& frame = gFrameMetrics.GetForWaitFrame();
   auto& core = frame.mCore;
-  QueryPerformanceCounter(&core.mWaitFrameStart);
+  core.mWaitFrameStart = win32::QueryPerformanceCounter();
   const auto ret = next_xrWaitFrame(session, frameWaitInfo, frameState);
-  QueryPerformanceCounter(&core.mWaitFrameStop);
+  core.mWaitFrameStop = win32::QueryPerformanceCounter();
 
   if (XR_FAILED(ret)) [[unlikely]] {
     frame.Reset();
@@ -136,9 +471,9 @@ XrResult hooked_xrBeginFrame(
   auto& frame = gFrameMetrics.GetForBeginFrame();
   auto& core = frame.mCore;
 
-  QueryPerformanceCounter(&core.mBeginFrameStart);
+  core.mBeginFrameStart = win32::QueryPerformanceCounter();
   const auto ret = next_xrBeginFrame(session, frameBeginInfo);
-  QueryPerformanceCounter(&core.mBeginFrameStop);
+  core.mBeginFrameStop = win32::QueryPerformanceCounter();
 
   if (XR_FAILED(ret)) [[unlikely]] {
     frame.Reset();
@@ -154,13 +489,30 @@ XrResult hooked_xrEndFrame(
   auto& frame = gFrameMetrics.GetForEndFrame(frameEndInfo->displayTime);
   auto& core = frame.mCore;
 
-  QueryPerformanceCounter(&core.mEndFrameStart);
+  core.mEndFrameStart = win32::QueryPerformanceCounter();
   const auto ret = next_xrEndFrame(session, frameEndInfo);
-  QueryPerformanceCounter(&core.mEndFrameStop);
+  core.mEndFrameStop = win32::QueryPerformanceCounter();
 
   if (XR_SUCCEEDED(ret)) [[likely]] {
     std::unique_lock lock(gLogQueueMutex);
-    gLogQueue.push_back({static_cast<const Frame&>(frame)});
+    QueuedFrame queued {
+      .mFrame = static_cast<const Frame&>(frame),
+      .mEnqueuedAt = core.mEndFrameStop,
+      .mPendingHooks = gLoggingHooks.size() == MaxLoggingHooks
+        ? ~uint64_t {0}
+        : ((uint64_t {1} << gLoggingHooks.size()) - 1),
+    };
+    if (!queued.mPendingHooks) {
+      queued.mCompletedAt = queued.mEnqueuedAt;
+    }
+    // Usually a no-op as the frames are submitted in order, but keep the queue
+    // sorted by display time, as that's the order we publish them in
+    const auto it = std::ranges::upper_bound(
+      gLogQueue,
+      core.mXrDisplayTime,
+      {},
+      [](const QueuedFrame& f) { return f.mFrame.mCore.mXrDisplayTime; });
+    gLogQueue.insert(it, std::move(queued));
   }
 
   frame.Reset();
@@ -10,6 +10,7 @@
 #define APILAYER_API __declspec(dllimport)
 
 #include <d3d11.h>
+#include <dxgi1_4.h>
 #include <openxr/openxr.h>
 #include <openxr/openxr_loader_negotiation.h>
 #include <openxr/openxr_platform.h>
@@ -18,14 +19,16 @@
 #include <atomic>
 #include <expected>
 #include <format>
+#include <functional>
 #include <mutex>
 #include <numeric>
 #include <span>
 
 #include "ApiLayerApi.hpp"
-#include "CheckHResult.hpp"
+#include "Config.hpp"
 #include "D3D11GpuTimer.hpp"
 #include "FrameMetricsStore.hpp"
+#include "MetricsSampler.hpp"
 #include "Win32Utils.hpp"
 
 /* PS>
@@ -42,17 +45,11 @@ namespace {
 struct D3D11Frame {
   D3D11Frame() = delete;
   explicit D3D11Frame(ID3D11Device* device) : mGpuTimer(device) {
-    wil::com_ptr<IDXGIDevice> dxgiDevice;
-    CheckHResult(device->QueryInterface(dxgiDevice.put()));
-    wil::com_ptr<IDXGIAdapter> dxgiAdapter;
-    CheckHResult(dxgiDevice->GetAdapter(dxgiAdapter.put()));
-    CheckHResult(dxgiAdapter->QueryInterface(mAdapter.put()));
   }
 
   void StartRender(uint64_t predictedDisplayTime) {
     mPredictedDisplayTime = predictedDisplayTime;
     mDisplayTime = {};
-    mVideoMemoryInfo = {};
     mGpuTimer.Start();
   }
 
@@ -65,20 +62,6 @@ struct D3D11Frame {
     }
 #endif
     mGpuTimer.Stop();
-
-    const auto qvmiResult = mAdapter->QueryVideoMemoryInfo(
-      0, DXGI_MEMORY_SEGMENT_GROUP_LOCAL, &mVideoMemoryInfo);
-    if (FAILED(qvmiResult)) {
-      TraceLoggingWrite(
-        gTraceProvider,
-        "QueryVideoMemoryInfo/Failure",
-        TraceLoggingValue(qvmiResult, "HRESULT"),
-        TraceLoggingValue(mDisplayTime, "DisplayTime"));
-    }
-  }
-
-  void GetVideoMemoryInfo(DXGI_QUERY_VIDEO_MEMORY_INFO& it) {
-    it = mVideoMemoryInfo;
   }
 
   uint64_t GetPredictedDisplayTime() const noexcept {
@@ -96,24 +79,52 @@ struct D3D11Frame {
       return ret;
     }
 
+    this->Release();
+    return ret;
+  }
+
+  // Make this available for another frame, e.g. if core_metrics stopped
+  // waiting for the timer
+  void Release() {
     mPredictedDisplayTime = {};
     mDisplayTime = {};
-
-    return ret;
   }
 
  private:
-  wil::com_ptr<IDXGIAdapter3> mAdapter;
   uint64_t mPredictedDisplayTime {};
   uint64_t mDisplayTime {};
 
-  DXGI_QUERY_VIDEO_MEMORY_INFO mVideoMemoryInfo {};
   D3D11GpuTimer mGpuTimer;
 };
 
+// `QueryVideoMemoryInfo()` is too slow to call every frame on the game's
+// submit thread, so it's called by `gVideoMemorySampler` instead
+std::optional<FramePerformanceCounters::VideoMemoryInfo> GetVideoMemoryInfo(
+  IDXGIAdapter3* adapter) {
+  DXGI_QUERY_VIDEO_MEMORY_INFO info {};
+  const auto result
+    = adapter->QueryVideoMemoryInfo(0, DXGI_MEMORY_SEGMENT_GROUP_LOCAL, &info);
+  if (FAILED(result)) {
+    TraceLoggingWrite(
+      gTraceProvider,
+      "QueryVideoMemoryInfo/Failure",
+      TraceLoggingValue(result, "HRESULT"));
+    return std::nullopt;
+  }
+  return FramePerformanceCounters::VideoMemoryInfo {
+    .mBudget = info.Budget,
+    .mCurrentUsage = info.CurrentUsage,
+    .mAvailableForReservation = info.AvailableForReservation,
+    .mCurrentReservation = info.CurrentReservation,
+  };
+}
+
 ID3D11Device* gDevice {nullptr};
 std::mutex gFramesMutex;
 std::vector<D3D11Frame> gFrames;
+wil::com_ptr<IDXGIAdapter3> gAdapter;
+std::optional<MetricsSampler<FramePerformanceCounters::VideoMemoryInfo>>
+  gVideoMemorySampler;
 uint64_t gBeginFrameCounter {0};
 std::uint64_t gWaitedDisplayTime = {};
 
@@ -199,11 +210,15 @@ static ApiLayerApi::LogFrameHookResult LoggingHook(Frame* frame) {
   const auto timer = it->GetRenderMicroseconds();
   if (timer.has_value()) {
     frame->mRenderGpu = timer.value();
-    it->GetVideoMemoryInfo(frame->mVideoMemoryInfo);
-
-    frame->mValidDataBits
-      |= std::to_underlying(FramePerformanceCounters::ValidDataBits::GpuTime)
-      | std::to_underlying(FramePerformanceCounters::ValidDataBits::VRAM);
+    frame->mValidDataBits |= FramePerformanceCounters::ValidDataBits::GpuTime;
+
+    const auto vram = gVideoMemorySampler
+      ? gVideoMemorySampler->GetNearest(frame->mCore.mEndFrameStart)
+      : std::nullopt;
+    if (vram) {
+      frame->mVideoMemoryInfo = *vram;
+      frame->mValidDataBits |= FramePerformanceCounters::ValidDataBits::VRAM;
+    }
     return Result::Ready;
   }
   switch (timer.error()) {
@@ -215,6 +230,15 @@ static ApiLayerApi::LogFrameHookResult LoggingHook(Frame* frame) {
   return Result::Ready;
 }
 
+static void LoggingHookAbandoned(const Frame* frame) {
+  std::unique_lock lock(gFramesMutex);
+  const auto it = std::ranges::find(
+    gFrames, frame->mCore.mXrDisplayTime, &D3D11Frame::GetDisplayTime);
+  if (it != gFrames.end()) {
+    it->Release();
+  }
+}
+
 PFN_xrCreateSession next_xrCreateSession {nullptr};
 XrResult hooked_xrCreateSession(
   XrInstance instance,
@@ -244,13 +268,14 @@ XrResult hooked_xrCreateSession(
     dxgiDevice->GetAdapter(dxgiAdapter.put());
     DXGI_ADAPTER_DESC adapterDesc {};
     dxgiAdapter->GetDesc(&adapterDesc);
+    gAdapter = dxgiAdapter.try_query<IDXGIAdapter3>();
 
     if (!gHooked.test_and_set()) {
       const auto api = ApiLayerApi::Get("d3d11_metrics");
       if (!api) {
         return ret;
       }
-      api->AppendLogFrameHook(&LoggingHook);
+      api->AppendLogFrameHook(&LoggingHook, &LoggingHookAbandoned);
       dprint("d3d11_metrics: added logging hook");
       api->SetActiveGpu(adapterDesc.AdapterLuid);
       dprint(
@@ -260,6 +285,16 @@ XrResult hooked_xrCreateSession(
       gIsEnabled = true;
     }
 
+    if (gIsEnabled && gAdapter) {
+      std::unique_lock lock(gFramesMutex);
+      gVideoMemorySampler.emplace(
+        std::chrono::milliseconds {std::max<int64_t>(
+          Config::GetForOpenXRAPILayer()
+            .GetGpuMetricsSampleIntervalMilliseconds(),
+          1)},
+        std::bind_front(&GetVideoMemoryInfo, gAdapter.get()));
+    }
+
     return ret;
   }
 
@@ -292,6 +327,8 @@ XrResult hooked_xrDestroySession(XrSession session) {
   {
     std::unique_lock lock {gFramesMutex};
     gFrames.clear();
+    gVideoMemorySampler.reset();
+    gAdapter.reset();
     gDevice = nullptr;
     gIsEnabled = false;
   }
@@ -11,16 +11,18 @@
 #include <openxr/openxr_loader_negotiation.h>
 
 #include <atomic>
+#include <mutex>
 
 #include "Win32Utils.hpp"
 
 #define APILAYER_API __declspec(dllimport)
 
-#include <mutex>
-#include <queue>
+#include <functional>
 #include <span>
 
 #include "ApiLayerApi.hpp"
+#include "Config.hpp"
+#include "MetricsSampler.hpp"
 
 /* PS>
  * [System.Diagnostics.Tracing.EventSource]::new("XRFrameTools.nvapi_metrics")
@@ -34,14 +36,34 @@ TRACELOGGING_DEFINE_PROVIDER(
 using GpuPerformanceInfo = FramePerformanceCounters::GpuPerformanceInfo;
 using EncoderInfo = FramePerformanceCounters::EncoderInfo;
 
+// Logs store the raw NVAPI bits, and readers don't include `nvapi.h`
+static_assert(
+  GpuPerformanceInfo::ThermalProtection
+  == NV_GPU_PERF_DECREASE_REASON_THERMAL_PROTECTION);
+static_assert(
+  GpuPerformanceInfo::PowerControl
+  == NV_GPU_PERF_DECREASE_REASON_POWER_CONTROL);
+static_assert(
+  GpuPerformanceInfo::ACBattery == NV_GPU_PERF_DECREASE_REASON_AC_BATT);
+static_assert(
+  GpuPerformanceInfo::APITriggered
+  == NV_GPU_PERF_DECREASE_REASON_API_TRIGGERED);
+static_assert(
+  GpuPerformanceInfo::InsufficientPower
+  == NV_GPU_PERF_DECREASE_REASON_INSUFFICIENT_POWER);
+
 namespace {
+// Hooks can't be removed, so this is only installed once
 std::atomic_flag gHooked;
-std::optional<NvPhysicalGpuHandle> gPhysicalGpuHandle;
+// Cleared when the session is destroyed, as the next session may use a
+// different GPU
+std::atomic_flag gStarted;
 
 ApiLayerApi::LogFrameHookResult LoggingHook(Frame* frame);
+void StartSampler(NvPhysicalGpuHandle);
 
 void InstallHook() {
-  if (gHooked.test_and_set()) {
+  if (gStarted.test_and_set()) {
     return;
   }
 
@@ -49,7 +71,6 @@ void InstallHook() {
   if (!api) {
     return;
   }
-  api->AppendLogFrameHook(&LoggingHook);
   const auto activeLuid = api->GetActiveGpu();
   if (!activeLuid.has_value()) {
     dprint("nvapi_metrics: active GPU LUID is not available");
@@ -90,8 +111,12 @@ void InstallHook() {
       std::bit_cast<uint64_t>(luid)
       == std::bit_cast<uint64_t>(activeLuid.value())) {
       if (data.physicalGpuCount > 0) {
-        gPhysicalGpuHandle.emplace(data.physicalGpuHandles[0]);
         dprint("nvapi_metrics: found physical GPU handle matching active LUID");
+        StartSampler(data.physicalGpuHandles[0]);
+        if (!gHooked.test_and_set()) {
+          // Samples aren't per-frame, so there's nothing to release
+          api->AppendLogFrameHook(&LoggingHook, nullptr);
+        }
       } else {
         dprint(
           "nvapi_metrics: found matching LUID, but no corresponding physical "
@@ -102,69 +127,26 @@ void InstallHook() {
   }
 }
 
-struct FrameData {
-  uint64_t mDisplayTime {};
+struct Sample {
   GpuPerformanceInfo mGpuPerformanceInfo {};
   EncoderInfo mEncoderInfo {};
 };
 
-std::deque<FrameData> gFrames;
-std::mutex gFramesMutex;
-
-void EnqueueFrameData(
-  uint64_t displayTime,
-  const GpuPerformanceInfo& gpu,
-  const EncoderInfo& encoder) {
-  std::unique_lock lock(gFramesMutex);
-  if (gFrames.size() >= 10) {
-    dprint("nvapi_metrics: too many frames enqueued");
-    gFrames.pop_front();
-  }
-  gFrames.emplace_back(displayTime, gpu, encoder);
-}
-
-ApiLayerApi::LogFrameHookResult LoggingHook(Frame* frame) {
-  std::unique_lock lock(gFramesMutex);
-  auto it = std::ranges::find(
-    gFrames, frame->mCore.mXrDisplayTime, &FrameData::mDisplayTime);
-  if (it != gFrames.end()) {
-    frame->mGpuPerformanceInformation = it->mGpuPerformanceInfo;
-    frame->mValidDataBits |= FramePerformanceCounters::ValidDataBits::NVAPI;
-    if (it->mEncoderInfo.mSessionCount > 0) {
-      frame->mEncoders = it->mEncoderInfo;
-      frame->mValidDataBits |= FramePerformanceCounters::ValidDataBits::NVEnc;
-    }
-    gFrames.erase(it);
-  }
-  return ApiLayerApi::LogFrameHookResult::Ready;
-}
-}// namespace
-
-PFN_xrEndFrame next_xrEndFrame {nullptr};
-
-XrResult hooked_xrEndFrame(
-  XrSession session,
-  const XrFrameEndInfo* frameEndInfo) noexcept {
-  InstallHook();
-  if (!gPhysicalGpuHandle) {
-    return next_xrEndFrame(session, frameEndInfo);
-  }
+// These calls take long enough that we don't want them on the game's submit
+// thread, so they're made by `gSampler` instead
+Sample GetSample(const NvPhysicalGpuHandle gpu) {
+  Sample ret {};
 
   NvU32 perfDecrease {};
   NV_GPU_PERF_PSTATE_ID pstate {};
   NV_GPU_CLOCK_FREQUENCIES frequencies {
     .version = NV_GPU_CLOCK_FREQUENCIES_VER,
   };
-  GpuPerformanceInfo retGpu {};
   if (
-    NvAPI_GPU_GetPerfDecreaseInfo(gPhysicalGpuHandle.value(), &perfDecrease)
-      == NVAPI_OK
-    && NvAPI_GPU_GetCurrentPstate(gPhysicalGpuHandle.value(), &pstate)
-      == NVAPI_OK
-    && NvAPI_GPU_GetAllClockFrequencies(
-         gPhysicalGpuHandle.value(), &frequencies)
-      == NVAPI_OK) {
-    retGpu = {
+    NvAPI_GPU_GetPerfDecreaseInfo(gpu, &perfDecrease) == NVAPI_OK
+    && NvAPI_GPU_GetCurrentPstate(gpu, &pstate) == NVAPI_OK
+    && NvAPI_GPU_GetAllClockFrequencies(gpu, &frequencies) == NVAPI_OK) {
+    ret.mGpuPerformanceInfo = {
       .mDecreaseReasons = perfDecrease,
       .mPState = static_cast<uint32_t>(pstate),
       .mGraphicsKHz = static_cast<uint32_t>(
@@ -182,10 +164,8 @@ XrResult hooked_xrEndFrame(
     .version = NV_ENCODER_SESSIONS_INFO_VER,
     .pSessionInfo = encoderSessions.data(),
   };
-  EncoderInfo retEncoder {};
-  if (
-    NvAPI_GPU_GetEncoderSessionsInfo(gPhysicalGpuHandle.value(), &encoderInfo)
-    == NVAPI_OK) {
+  if (NvAPI_GPU_GetEncoderSessionsInfo(gpu, &encoderInfo) == NVAPI_OK) {
+    auto& retEncoder = ret.mEncoderInfo;
     retEncoder.mSessionCount = encoderInfo.sessionsCount;
     const auto sessionCount = std::min(
       static_cast<uint32_t>(encoderInfo.sessionsCount),
@@ -204,11 +184,63 @@ XrResult hooked_xrEndFrame(
     }
   }
 
-  EnqueueFrameData(frameEndInfo->displayTime, retGpu, retEncoder);
+  return ret;
+}
 
+std::mutex gSamplerMutex;
+std::optional<MetricsSampler<Sample>> gSampler;
+
+void StartSampler(const NvPhysicalGpuHandle gpu) {
+  const auto interval = std::chrono::milliseconds {std::max<int64_t>(
+    Config::GetForOpenXRAPILayer().GetGpuMetricsSampleIntervalMilliseconds(),
+    1)};
+  {
+    std::unique_lock lock {gSamplerMutex};
+    gSampler.emplace(interval, std::bind_front(&GetSample, gpu));
+  }
+  dprint("nvapi_metrics: sampling every {}ms", interval.count());
+}
+
+ApiLayerApi::LogFrameHookResult LoggingHook(Frame* frame) {
+  std::unique_lock lock {gSamplerMutex};
+  if (!gSampler) {
+    return ApiLayerApi::LogFrameHookResult::Ready;
+  }
+  const auto sample = gSampler->GetNearest(frame->mCore.mEndFrameStart);
+  if (sample) {
+    frame->mGpuPerformanceInformation = sample->mGpuPerformanceInfo;
+    frame->mValidDataBits |= FramePerformanceCounters::ValidDataBits::NVAPI;
+    if (sample->mEncoderInfo.mSessionCount > 0) {
+      frame->mEncoders = sample->mEncoderInfo;
+      frame->mValidDataBits |= FramePerformanceCounters::ValidDataBits::NVEnc;
+    }
+  }
+  return ApiLayerApi::LogFrameHookResult::Ready;
+}
+}// namespace
+
+PFN_xrEndFrame next_xrEndFrame {nullptr};
+
+XrResult hooked_xrEndFrame(
+  XrSession session,
+  const XrFrameEndInfo* frameEndInfo) noexcept {
+  InstallHook();
   return next_xrEndFrame(session, frameEndInfo);
 }
 
-#define HOOKED_OPENXR_FUNCS(X) X(EndFrame)
+PFN_xrDestroySession next_xrDestroySession {nullptr};
+XrResult hooked_xrDestroySession(XrSession session) {
+  dprint("In nvapi_metrics::xrDestroySession");
+  {
+    std::unique_lock lock {gSamplerMutex};
+    gSampler.reset();
+  }
+  gStarted.clear();
+  return next_xrDestroySession(session);
+}
+
+#define HOOKED_OPENXR_FUNCS(X) \
+  X(DestroySession) \
+  X(EndFrame)
 
 #include "APILayerEntrypoints.inc.cpp"
@@ -6,6 +6,8 @@ add_executable(
   AutoUpdater.cpp AutoUpdater.hpp
   ImGuiHelpers.hpp
   ImStackedAreaPlotter.cpp ImStackedAreaPlotter.hpp
+  LogConversionJobs.cpp LogConversionJobs.hpp
+  LogViewer.cpp LogViewer.hpp
   Window.cpp Window.hpp
   MainWindow.cpp MainWindow.hpp
   "${VERSION_HPP}"
@@ -23,6 +25,9 @@ target_link_libraries(
   Config
   CSVWriter
   D3D11GpuTimer
+  FrameEventDetector
+  LogCatalog
+  LogPyramid
   SHMReader
   Version
   # vcpkg
@@ -32,8 +37,6 @@ target_link_libraries(
   # System libraries
   D3D11
   DXGI
-  # Third-party
-  nvapi
 )
 target_include_directories(app PRIVATE "${CMAKE_CURRENT_BINARY_DIR}/include")
 include(add_version_resource)
@@ -0,0 +1,122 @@
+// Copyright 2024 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+
+#include "BenchmarkInputs.hpp"
+
+#include <charconv>
+#include <cstdlib>
+#include <format>
+#include <map>
+#include <string_view>
+#include <utility>
+
+namespace BenchmarkInputs {
+
+namespace {
+using ValidDataBits = FramePerformanceCounters::ValidDataBits;
+
+std::vector<int64_t> GetListFromEnvironment(
+  const char* name,
+  const std::vector<int64_t>& defaultValue) {
+  const auto value = std::getenv(name);
+  if (!(value && *value)) {
+    return defaultValue;
+  }
+  std::vector<int64_t> ret;
+  std::string_view remaining {value};
+  while (!remaining.empty()) {
+    const auto end = std::min(remaining.find(','), remaining.size());
+    int64_t it {};
+    const auto item = remaining.substr(0, end);
+    if (
+      std::from_chars(item.data(), item.data() + item.size(), it).ec
+      == std::errc {}) {
+      ret.push_back(it);
+    }
+    remaining.remove_prefix(std::min(end + 1, remaining.size()));
+  }
+  return ret.empty() ? defaultValue : ret;
+}
+
+class LogFiles final {
+ public:
+  ~LogFiles() {
+    for (auto&& [key, path]: mPaths) {
+      std::error_code ec;
+      std::filesystem::remove(path, ec);
+    }
+  }
+
+  const std::filesystem::path& Get(const benchmark::State& state) {
+    const std::pair key {state.range(0), state.range(1)};
+    if (const auto it = mPaths.find(key); it != mPaths.end()) {
+      return it->second;
+    }
+    const auto path = std::filesystem::temp_directory_path()
+      / std::format("XRFrameTools-benchmark-{}-{}.XRFTBinLog",
+                    key.first,
+                    key.second);
+    SyntheticLog::Write(path, GetOptions(state));
+    return mPaths.emplace(key, path).first->second;
+  }
+
+ private:
+  std::map<std::pair<int64_t, int64_t>, std::filesystem::path> mPaths;
+};
+
+}// namespace
+
+std::vector<int64_t> GetFrameCounts() {
+  // About 2 minutes and 20 minutes at 90hz
+  return GetListFromEnvironment("XRFT_BENCHMARK_FRAMES", {10'000, 100'000});
+}
+
+std::vector<int64_t> GetPacketMixes() {
+  return GetListFromEnvironment(
+    "XRFT_BENCHMARK_PACKET_MIXES",
+    {
+      std::to_underlying(PacketMix::CoreOnly),
+      std::to_underlying(PacketMix::Typical),
+      std::to_underlying(PacketMix::Everything),
+    });
+}
+
+void AddLogArguments(benchmark::internal::Benchmark* benchmark) {
+  benchmark->ArgNames({"frames", "mix"})
+    ->ArgsProduct({GetFrameCounts(), GetPacketMixes()});
+}
+
+SyntheticLog::Options GetOptions(const benchmark::State& state) {
+  SyntheticLog::Options ret {
+    .mFrameCount = static_cast<uint64_t>(state.range(0)),
+  };
+  switch (static_cast<PacketMix>(state.range(1))) {
+    case PacketMix::CoreOnly:
+      ret.mValidDataBits = 0;
+      break;
+    case PacketMix::Typical:
+      // The defaults
+      break;
+    case PacketMix::Everything:
+      ret.mValidDataBits |= ValidDataBits::NVEnc;
+      ret.mEncoderSessionCount
+        = FramePerformanceCounters::EncoderInfo {}.mSessions.size();
+      break;
+  }
+  return ret;
+}
+
+const std::filesystem::path& GetLogPath(const benchmark::State& state) {
+  static LogFiles files;
+  return files.Get(state);
+}
+
+std::filesystem::path GetNullDevicePath() {
+#ifdef _WIN32
+  return "NUL";
+#else
+  return "/dev/null";
+#endif
+}
+
+}// namespace BenchmarkInputs
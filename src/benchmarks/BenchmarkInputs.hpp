@@ -0,0 +1,58 @@
+// Copyright 2024 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+#include "SyntheticLog.hpp"
+
+/* Synthetic inputs, shared by all benchmarks.
+ *
+ * Benchmarks that use these take the frame count as their first argument,
+ * and a `PacketMix` as their second argument.
+ */
+namespace BenchmarkInputs {
+
+enum class PacketMix : int64_t {
+  CoreOnly = 0,
+  // As recorded with the core, d3d11, and nvapi layers
+  Typical = 1,
+  // Every packet type, with the maximum number of encoder sessions
+  Everything = 2,
+};
+
+/** Frame counts to benchmark.
+ *
+ * Override with a comma-separated list in the `XRFT_BENCHMARK_FRAMES`
+ * environment variable, e.g. `XRFT_BENCHMARK_FRAMES=1000000`.
+ */
+[[nodiscard]]
+std::vector<int64_t> GetFrameCounts();
+
+/** Packet mixes to benchmark.
+ *
+ * Override with a comma-separated list of `PacketMix` values in the
+ * `XRFT_BENCHMARK_PACKET_MIXES` environment variable.
+ */
+[[nodiscard]]
+std::vector<int64_t> GetPacketMixes();
+
+/// For `benchmark::internal::Benchmark::Apply()`
+void AddLogArguments(benchmark::internal::Benchmark*);
+
+[[nodiscard]]
+SyntheticLog::Options GetOptions(const benchmark::State&);
+
+/// Created on first use, and deleted when the process exits
+[[nodiscard]]
+const std::filesystem::path& GetLogPath(const benchmark::State&);
+
+/// Discards everything written to it
+[[nodiscard]]
+std::filesystem::path GetNullDevicePath();
+
+}// namespace BenchmarkInputs
@@ -0,0 +1,34 @@
+// Copyright 2024 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+
+#include <benchmark/benchmark.h>
+
+#include "BenchmarkInputs.hpp"
+#include "BinaryLogEncoder.hpp"
+
+namespace {
+
+// The encoding half of `BinaryLogWriter`'s worker thread, without any I/O
+void BinaryLogEncoder_EncodeFrame(benchmark::State& state) {
+  const auto frames
+    = SyntheticLog::GenerateFrames(BenchmarkInputs::GetOptions(state));
+
+  int64_t bytes {};
+  for (auto _: state) {
+    BinaryLogEncoder encoder;
+    for (auto&& frame: frames) {
+      const auto packets = encoder.EncodeFrame(frame);
+      benchmark::DoNotOptimize(packets.data());
+      bytes += static_cast<int64_t>(packets.size());
+    }
+  }
+  state.SetItemsProcessed(
+    static_cast<int64_t>(frames.size())
+    * static_cast<int64_t>(state.iterations()));
+  state.SetBytesProcessed(bytes);
+}
+BENCHMARK(BinaryLogEncoder_EncodeFrame)
+  ->Apply(&BenchmarkInputs::AddLogArguments)
+  ->Unit(benchmark::kMicrosecond);
+
+}// namespace
@@ -0,0 +1,37 @@
+// Copyright 2024 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+
+#include <benchmark/benchmark.h>
+
+#include <filesystem>
+
+#include "BenchmarkInputs.hpp"
+#include "BinaryLogReader.hpp"
+
+namespace {
+
+void BinaryLogReader_GetNextFrame(benchmark::State& state) {
+  const auto& path = BenchmarkInputs::GetLogPath(state);
+  const auto fileSize = std::filesystem::file_size(path);
+
+  int64_t frames {};
+  for (auto _: state) {
+    auto reader = BinaryLogReader::Create(path);
+    if (!reader) {
+      state.SkipWithError("failed to open synthetic log");
+      return;
+    }
+    while (const auto frame = reader->GetNextFrame()) {
+      benchmark::DoNotOptimize(*frame);
+      ++frames;
+    }
+  }
+  state.SetItemsProcessed(frames);
+  state.SetBytesProcessed(
+    static_cast<int64_t>(fileSize) * static_cast<int64_t>(state.iterations()));
+}
+BENCHMARK(BinaryLogReader_GetNextFrame)
+  ->Apply(&BenchmarkInputs::AddLogArguments)
+  ->Unit(benchmark::kMillisecond);
+
+}// namespace
@@ -0,0 +1,50 @@
+// Copyright 2024 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+
+#include <benchmark/benchmark.h>
+
+#include "BenchmarkInputs.hpp"
+#include "CSVWriter.hpp"
+
+namespace {
+
+// Reading, aggregation, and row formatting; the output is discarded. The third
+// argument is the number of frames per row
+void CSVWriter_Write(benchmark::State& state) {
+  const auto& path = BenchmarkInputs::GetLogPath(state);
+  const auto framesPerRow = static_cast<size_t>(state.range(2));
+
+  auto output = PlatformFile::Open(
+    BenchmarkInputs::GetNullDevicePath(), PlatformFile::Mode::Write);
+  if (!output) {
+    state.SkipWithError("failed to open null device");
+    return;
+  }
+
+  int64_t rows {};
+  int64_t frames {};
+  for (auto _: state) {
+    auto reader = BinaryLogReader::Create(path);
+    if (!reader) {
+      state.SkipWithError("failed to open synthetic log");
+      return;
+    }
+    const auto result
+      = CSVWriter::Write(std::move(*reader), *output, framesPerRow);
+    rows += static_cast<int64_t>(result.mRowCount);
+    frames += static_cast<int64_t>(result.mFrameCount);
+  }
+  state.SetItemsProcessed(rows);
+  state.counters["frames"] = benchmark::Counter(
+    static_cast<double>(frames), benchmark::Counter::kIsRate);
+}
+BENCHMARK(CSVWriter_Write)
+  ->ArgNames({"frames", "mix", "perRow"})
+  ->ArgsProduct({
+    BenchmarkInputs::GetFrameCounts(),
+    BenchmarkInputs::GetPacketMixes(),
+    {1, CSVWriter::DefaultFramesPerRow},
+  })
+  ->Unit(benchmark::kMillisecond);
+
+}// namespace
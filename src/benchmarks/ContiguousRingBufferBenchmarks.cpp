@@ -0,0 +1,33 @@
+// Copyright 2024 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+
+#include "ContiguousRingBuffer.hpp"
+#include "FrameMetrics.hpp"
+
+namespace {
+
+// Sizes are the UI's live chart (30 seconds at 30 points per second), and its
+// longest history tier
+template <size_t N>
+void ContiguousRingBuffer_PushBack(benchmark::State& state) {
+  // Too large for the stack
+  const auto buffer
+    = std::make_unique<ContiguousRingBuffer<FrameMetrics, N>>(N);
+  FrameMetrics point {};
+  for (auto _: state) {
+    ++point.mFrameCount;
+    buffer->push_back(point);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+  state.SetBytesProcessed(
+    static_cast<int64_t>(state.iterations() * sizeof(FrameMetrics) * N));
+}
+BENCHMARK(ContiguousRingBuffer_PushBack<30 * 30>);
+BENCHMARK(ContiguousRingBuffer_PushBack<6 * 60 * 6>);
+
+}// namespace
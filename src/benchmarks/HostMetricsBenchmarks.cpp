@@ -0,0 +1,20 @@
+// Copyright 2024 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+
+#include <benchmark/benchmark.h>
+
+#include "HostMetrics.hpp"
+
+namespace {
+
+// The cost of each host metrics sample; this is on the sampler's thread, not
+// the app's, but it's CPU time taken from the app at every interval
+void HostMetrics_GetSample(benchmark::State& state) {
+  const auto source = HostMetrics::Source::Create();
+  for (auto _: state) {
+    benchmark::DoNotOptimize(source->GetSample());
+  }
+}
+BENCHMARK(HostMetrics_GetSample)->Unit(benchmark::kMicrosecond);
+
+}// namespace
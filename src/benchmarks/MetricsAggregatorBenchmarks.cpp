@@ -0,0 +1,77 @@
+// Copyright 2024 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+
+#include <benchmark/benchmark.h>
+
+#include "BenchmarkInputs.hpp"
+#include "MetricsAggregator.hpp"
+#include "PerformanceCounterMath.hpp"
+
+namespace {
+
+// The third argument is the number of frames per `Flush()`, e.g. per CSV row
+void MetricsAggregator_PushFlush(benchmark::State& state) {
+  const auto frames
+    = SyntheticLog::GenerateFrames(BenchmarkInputs::GetOptions(state));
+  const auto framesPerFlush = state.range(2);
+  const PerformanceCounterMath pcm {
+    SyntheticLog::PerformanceCounterFrequency};
+
+  for (auto _: state) {
+    MetricsAggregator aggregator {pcm};
+    int64_t pending {};
+    for (auto&& frame: frames) {
+      aggregator.Push(frame);
+      if (++pending == framesPerFlush) {
+        benchmark::DoNotOptimize(aggregator.Flush());
+        pending = 0;
+      }
+    }
+  }
+  state.SetItemsProcessed(
+    static_cast<int64_t>(frames.size())
+    * static_cast<int64_t>(state.iterations()));
+}
+BENCHMARK(MetricsAggregator_PushFlush)
+  ->ArgNames({"frames", "mix", "perFlush"})
+  ->ArgsProduct({
+    BenchmarkInputs::GetFrameCounts(),
+    BenchmarkInputs::GetPacketMixes(),
+    {1, 10, 90},
+  })
+  ->Unit(benchmark::kMillisecond);
+
+// Merging lower-resolution history, as in the UI's history tiers
+void MetricsAggregator_PushMetrics(benchmark::State& state) {
+  const auto frames
+    = SyntheticLog::GenerateFrames(BenchmarkInputs::GetOptions(state));
+  const PerformanceCounterMath pcm {
+    SyntheticLog::PerformanceCounterFrequency};
+
+  std::vector<FrameMetrics> points;
+  {
+    MetricsAggregator aggregator {pcm};
+    for (auto&& frame: frames) {
+      aggregator.Push(frame);
+      if (const auto point = aggregator.Flush()) {
+        points.push_back(*point);
+      }
+    }
+  }
+
+  for (auto _: state) {
+    MetricsAggregator aggregator {pcm};
+    for (auto&& point: points) {
+      aggregator.Push(point);
+    }
+    benchmark::DoNotOptimize(aggregator.Flush());
+  }
+  state.SetItemsProcessed(
+    static_cast<int64_t>(points.size())
+    * static_cast<int64_t>(state.iterations()));
+}
+BENCHMARK(MetricsAggregator_PushMetrics)
+  ->Apply(&BenchmarkInputs::AddLogArguments)
+  ->Unit(benchmark::kMillisecond);
+
+}// namespace
@@ -0,0 +1,52 @@
+// Copyright 2024 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+#include "MetricsSampler.hpp"
+#include "PerformanceCounterMath.hpp"
+
+namespace {
+
+// Similar in size to the nvapi layer's samples
+struct Sample {
+  uint32_t mGraphicsClock {};
+  uint32_t mMemoryClock {};
+  uint32_t mUtilization {};
+  uint32_t mDecreaseReasons {};
+};
+
+// The cost added to a `LogFrameHook` - and so potentially to `xrEndFrame()` -
+// by looking up a sample; the argument is how long ago the frame was, as
+// hooks run once the frame's GPU work has completed.
+//
+// The sampler is running, so this includes contention with the writer.
+void MetricsSampler_GetNearest(benchmark::State& state) {
+  using namespace std::chrono_literals;
+  constexpr auto Interval = 1ms;
+  const MetricsSampler<Sample> sampler {
+    Interval,
+    [] { return std::optional<Sample> {Sample {.mUtilization = 100}}; },
+  };
+  // Fill the buffer
+  std::this_thread::sleep_for(Interval * MetricsSampler<Sample>::Capacity);
+
+  const auto frequency
+    = PerformanceCounterMath::CreateForLiveData().GetResolution();
+  const auto age = (frequency * state.range(0)) / 1000;
+  for (auto _: state) {
+    benchmark::DoNotOptimize(
+      sampler.GetNearest(PerformanceCounterMath::GetLiveDataTime() - age));
+  }
+}
+BENCHMARK(MetricsSampler_GetNearest)
+  ->ArgName("ageMs")
+  ->Arg(0)
+  ->Arg(20)
+  ->Arg(60);
+
+}// namespace
@@ -0,0 +1,75 @@
+// Copyright 2024 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "PerformanceCounterMath.hpp"
+
+namespace {
+
+constexpr size_t TickCount = 4096;
+
+// Frame-sized durations, and a few much larger ones, e.g. time since the
+// start of the log
+std::vector<int64_t> GetTicks(const int64_t frequency) {
+  std::vector<int64_t> ret;
+  ret.reserve(TickCount);
+  uint64_t state = 1;
+  for (size_t i = 0; i < TickCount; ++i) {
+    // Numerical Recipes LCG; this only needs to be cheap and deterministic
+    state = (state * 6364136223846793005) + 1442695040888963407;
+    const auto fraction = static_cast<int64_t>(state >> 48);
+    ret.push_back(
+      (i % 16 == 0) ? (frequency * 60 * 60) + fraction
+                    : (frequency / 90) + (fraction % (frequency / 1000)));
+  }
+  return ret;
+}
+
+// The argument is the performance counter frequency:
+// - 10MHz: `QueryPerformanceCounter()` on most Windows systems
+// - 1GHz: `CLOCK_MONOTONIC` nanoseconds
+// - 3.579545MHz: the ACPI PM timer; this doesn't reduce to a small fraction
+// - 24MHz: common on ARM
+void PerformanceCounterMath_ToDuration(benchmark::State& state) {
+  const PerformanceCounterMath pcm {state.range(0)};
+  const auto ticks = GetTicks(state.range(0));
+  for (auto _: state) {
+    for (auto&& it: ticks) {
+      benchmark::DoNotOptimize(pcm.ToDuration(it));
+    }
+  }
+  state.SetItemsProcessed(
+    static_cast<int64_t>(state.iterations() * ticks.size()));
+}
+BENCHMARK(PerformanceCounterMath_ToDuration)
+  ->ArgName("frequency")
+  ->Arg(10'000'000)
+  ->Arg(1'000'000'000)
+  ->Arg(3'579'545)
+  ->Arg(24'000'000);
+
+void PerformanceCounterMath_ToDurations(benchmark::State& state) {
+  const PerformanceCounterMath pcm {state.range(0)};
+  const auto ticks = GetTicks(state.range(0));
+  std::vector<std::chrono::microseconds> out(ticks.size());
+  for (auto _: state) {
+    pcm.ToDurations(ticks, out);
+    benchmark::DoNotOptimize(out.data());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(
+    static_cast<int64_t>(state.iterations() * ticks.size()));
+}
+BENCHMARK(PerformanceCounterMath_ToDurations)
+  ->ArgName("frequency")
+  ->Arg(10'000'000)
+  ->Arg(1'000'000'000)
+  ->Arg(3'579'545)
+  ->Arg(24'000'000);
+
+}// namespace
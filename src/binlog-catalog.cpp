@@ -0,0 +1,212 @@
+// Copyright 2024 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+
+// clang-format off
+#include <Windows.h>
+#include <TraceLoggingProvider.h>
+#include <shlobj_core.h>
+// clang-format on
+
+#include <chrono>
+#include <expected>
+#include <print>
+#include <sstream>
+#include <thread>
+
+#include "LogCatalog.hpp"
+#include "Win32Utils.hpp"
+
+/* PS>
+ * [System.Diagnostics.Tracing.EventSource]::new("XRFrameTools.binlog-catalog")
+ * 97d33c38-1830-5b96-fd4e-de3e7ce0ce03
+ */
+TRACELOGGING_DEFINE_PROVIDER(
+  gTraceProvider,
+  "XRFrameTools.binlog-catalog",
+  (0x97d33c38, 0x1830, 0x5b96, 0xfd, 0x4e, 0xde, 0x3e, 0x7c, 0xe0, 0xce, 0x03));
+
+namespace {
+
+std::filesystem::path GetDefaultRoot() {
+  return GetKnownFolderPath(FOLDERID_LocalAppData) / "XRFrameTools" / "Logs";
+}
+
+struct Arguments {
+  std::filesystem::path mRoot;
+  LogCatalog::Filter mFilter;
+  size_t mJobs {std::max(std::thread::hardware_concurrency(), 1u)};
+  bool mRefresh {true};
+};
+
+void ShowUsage(std::FILE* stream, std::string_view exe) {
+  std::println(
+    stream,
+    "USAGE: {0} [--help] [--root PATH] [--no-refresh] [--jobs COUNT]\n"
+    "       [--executable NAME] [--after DATE] [--before DATE]\n"
+    "       [--min-duration SECONDS] [--max-duration SECONDS]\n"
+    "       [--min-fps FPS] [--max-fps FPS]\n\n"
+    "Lists binary logs as tab-separated values, oldest first.\n\n"
+    "  --root PATH\n\n"
+    "    directory to search for logs; default {1}\n\n"
+    "  --no-refresh\n\n"
+    "    only use the existing index; do not look for new or changed logs\n\n"
+    "  --jobs COUNT\n\n"
+    "    number of logs to index concurrently; default {2}\n\n"
+    "  --executable NAME\n\n"
+    "    only list logs where the executable's file name contains NAME\n\n"
+    "  --after DATE, --before DATE\n\n"
+    "    only list logs started on or after, or before, a UTC date in\n"
+    "    YYYY-MM-DD format\n\n"
+    "  --min-duration SECONDS, --max-duration SECONDS\n"
+    "  --min-fps FPS, --max-fps FPS\n\n"
+    "    only list logs within the given length, or average frame rate",
+    std::filesystem::path {exe}.stem().string(),
+    GetDefaultRoot().string(),
+    Arguments {}.mJobs);
+}
+
+std::expected<std::chrono::system_clock::time_point, int> ParseDate(
+  std::string_view arg,
+  const std::string& value) {
+  std::istringstream stream {value};
+  std::chrono::sys_days ret {};
+  stream >> std::chrono::parse("%F", ret);
+  if (stream.fail() || stream.peek() != std::char_traits<char>::eof()) {
+    std::println(stderr, "{} value must be a date in YYYY-MM-DD format", arg);
+    return std::unexpected {EXIT_FAILURE};
+  }
+  return ret;
+}
+
+std::expected<Arguments, int> ParseArguments(int argc, char* argv[]) {
+  Arguments ret;
+  const std::string_view thisExe {argv[0]};
+
+  for (size_t i = 1; i < argc; ++i) {
+    const std::string_view arg {argv[i]};
+    if (arg == "--help") {
+      ShowUsage(stdout, thisExe);
+      return std::unexpected {EXIT_SUCCESS};
+    }
+  }
+
+  for (size_t i = 1; i < argc; ++i) {
+    const std::string_view arg {argv[i]};
+    if (arg == "--no-refresh") {
+      ret.mRefresh = false;
+      continue;
+    }
+
+    if (!arg.starts_with("--")) {
+      ShowUsage(stderr, thisExe);
+      return std::unexpected {EXIT_FAILURE};
+    }
+
+    ++i;
+    if (i >= argc) {
+      std::println(stderr, "{} requires a value", arg);
+      return std::unexpected {EXIT_FAILURE};
+    }
+    const std::string value {argv[i]};
+
+    if (arg == "--root") {
+      ret.mRoot = std::filesystem::absolute(value);
+      continue;
+    }
+    if (arg == "--executable") {
+      ret.mFilter.mExecutable = std::filesystem::path {value}.wstring();
+      continue;
+    }
+    if (arg == "--after" || arg == "--before") {
+      const auto date = ParseDate(arg, value);
+      if (!date) {
+        return std::unexpected {date.error()};
+      }
+      if (arg == "--after") {
+        ret.mFilter.mStartedAfter = *date;
+      } else {
+        ret.mFilter.mStartedBefore = *date;
+      }
+      continue;
+    }
+
+    double number {};
+    try {
+      number = std::stod(value);
+    } catch (...) {
+      std::println(stderr, "{} value must be a number", arg);
+      return std::unexpected {EXIT_FAILURE};
+    }
+    if (number < 0) {
+      std::println(stderr, "{} value must not be negative", arg);
+      return std::unexpected {EXIT_FAILURE};
+    }
+
+    const auto duration = std::chrono::round<std::chrono::microseconds>(
+      std::chrono::duration<double> {number});
+    if (arg == "--jobs" && number >= 1) {
+      ret.mJobs = static_cast<size_t>(number);
+    } else if (arg == "--min-duration") {
+      ret.mFilter.mMinDuration = duration;
+    } else if (arg == "--max-duration") {
+      ret.mFilter.mMaxDuration = duration;
+    } else if (arg == "--min-fps") {
+      ret.mFilter.mMinAverageFPS = number;
+    } else if (arg == "--max-fps") {
+      ret.mFilter.mMaxAverageFPS = number;
+    } else {
+      ShowUsage(stderr, thisExe);
+      return std::unexpected {EXIT_FAILURE};
+    }
+  }
+
+  if (ret.mRoot.empty()) {
+    ret.mRoot = GetDefaultRoot();
+  }
+  return ret;
+}
+
+}// namespace
+
+int main(int argc, char** argv) {
+#ifndef NDEBUG
+  if (GetACP() != CP_UTF8) {
+    std::println(
+      stderr,
+      "BUILD ERROR: process code page should be forced to UTF-8 via manifest");
+    return EXIT_FAILURE;
+  }
+#endif
+
+  const auto args = ParseArguments(argc, argv);
+  if (!args) {
+    return args.error();
+  }
+
+  if (!std::filesystem::is_directory(args->mRoot)) {
+    std::println(stderr, "`{}` is not a directory", args->mRoot.string());
+    return EXIT_FAILURE;
+  }
+
+  LogCatalog catalog {args->mRoot};
+  if (args->mRefresh) {
+    catalog.Refresh(args->mJobs);
+  }
+
+  std::println(
+    "path\texecutable\tstart_utc\tduration_seconds\tframes\taverage_fps\t"
+    "size_bytes\tcomplete");
+  for (auto&& it: catalog.Query(args->mFilter)) {
+    std::println(
+      "{}\t{}\t{:%FT%TZ}\t{:.1f}\t{}\t{:.1f}\t{}\t{}",
+      it.mPath.string(),
+      it.mExecutable.string(),
+      std::chrono::floor<std::chrono::seconds>(it.mStartTime),
+      std::chrono::duration<double>(it.mDuration).count(),
+      it.mFrameCount,
+      it.GetAverageFPS(),
+      it.mFileSize,
+      it.mHasFooter ? "yes" : "no");
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,173 @@
+// Copyright 2024 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+
+#ifdef _WIN32
+// clang-format off
+#include <Windows.h>
+#include <TraceLoggingProvider.h>
+// clang-format on
+#endif
+
+#include <BinaryLogReader.hpp>
+#include <expected>
+#include <magic_enum.hpp>
+#include <print>
+#include <string>
+
+#include "FrameEventDetector.hpp"
+#include "MetricsAggregator.hpp"
+
+#ifdef _WIN32
+/* PS>
+ * [System.Diagnostics.Tracing.EventSource]::new("XRFrameTools.binlog-events")
+ * 0b9f8477-b249-530c-101f-494a9c2b4c13
+ */
+TRACELOGGING_DEFINE_PROVIDER(
+  gTraceProvider,
+  "XRFrameTools.binlog-events",
+  (0x0b9f8477, 0xb249, 0x530c, 0x10, 0x1f, 0x49, 0x4a, 0x9c, 0x2b, 0x4c, 0x13));
+#endif
+
+namespace {
+
+struct Arguments {
+  std::filesystem::path mInput;
+  bool mHitchesOnly {false};
+};
+
+void ShowUsage(std::FILE* stream, std::string_view exe) {
+  std::println(
+    stream,
+    "USAGE: {} [--help] [--hitches-only] INPUT_PATH\n\n"
+    "Writes a tab-separated list of hitches and step changes in frame timings\n"
+    "to stdout.\n\n"
+    "  --hitches-only\n\n"
+    "    don't include step changes",
+    std::filesystem::path {exe}.stem().string());
+}
+
+[[nodiscard]]
+std::expected<Arguments, int> ParseArguments(int argc, char* argv[]) {
+  Arguments ret;
+  const std::string_view thisExe {argv[0]};
+
+  for (size_t i = 1; i < argc; ++i) {
+    const std::string_view arg {argv[i]};
+    if (arg == "--help") {
+      ShowUsage(stdout, thisExe);
+      return std::unexpected {EXIT_SUCCESS};
+    }
+    if (arg == "--hitches-only") {
+      ret.mHitchesOnly = true;
+      continue;
+    }
+    if (arg.starts_with("-") || !ret.mInput.empty()) {
+      ShowUsage(stderr, thisExe);
+      return std::unexpected {EXIT_FAILURE};
+    }
+    ret.mInput = {arg};
+  }
+
+  if (ret.mInput.empty()) {
+    ShowUsage(stderr, thisExe);
+    return std::unexpected {EXIT_FAILURE};
+  }
+  return ret;
+}
+
+[[nodiscard]]
+std::string GetGpuLimitNames(const uint32_t bits) {
+  std::string ret;
+  const auto append = [&](const uint32_t mask, const std::string_view name) {
+    if ((bits & mask) == 0) {
+      return;
+    }
+    if (!ret.empty()) {
+      ret += ',';
+    }
+    ret += name;
+  };
+  using enum FramePerformanceCounters::GpuPerformanceInfo::DecreaseReason;
+  append(ThermalProtection, "thermal");
+  append(PowerControl | ACBattery | InsufficientPower, "power");
+  append(APITriggered, "api");
+  return ret;
+}
+
+void PrintEvent(const FrameEventDetector::Event& event) {
+  std::println(
+    "{}\t{}\t{:.03f}\t{:.03f}\t{}\t{:.0f}\t{:.0f}\t{:#010x}\t{}",
+    magic_enum::enum_name(event.mKind),
+    magic_enum::enum_name(event.mStage),
+    event.mStart.count() / 1e6,
+    event.mDuration.count() / 1e3,
+    event.mFrameCount,
+    event.mBaseline,
+    event.mValue,
+    event.mGpuPerformanceDecreaseReasons,
+    GetGpuLimitNames(event.mGpuPerformanceDecreaseReasons));
+}
+
+}// namespace
+
+int main(int argc, char** argv) {
+#if defined(_WIN32) && !defined(NDEBUG)
+  if (GetACP() != CP_UTF8) {
+    std::println(
+      stderr,
+      "BUILD ERROR: process code page should be forced to UTF-8 via manifest");
+    return EXIT_FAILURE;
+  }
+#endif
+
+  const auto args = ParseArguments(argc, argv);
+  if (!args) {
+    return args.error();
+  }
+
+  auto reader = BinaryLogReader::Create(args->mInput);
+  if (!reader) {
+    std::println(
+      stderr,
+      "Opening binary log failed: {}",
+      magic_enum::enum_name(reader.error().GetCode()));
+    return EXIT_FAILURE;
+  }
+
+  MetricsAggregator aggregator {reader->GetPerformanceCounterMath()};
+  FrameEventDetector detector;
+  size_t hitchCount {};
+  size_t stepCount {};
+  const auto print = [&](const auto& events) {
+    for (auto&& event: events) {
+      if (event.mKind == FrameEventDetector::Kind::Hitch) {
+        ++hitchCount;
+      } else if (args->mHitchesOnly) {
+        continue;
+      } else {
+        ++stepCount;
+      }
+      PrintEvent(event);
+    }
+  };
+
+  std::println(
+    "kind\tstage\tstart_seconds\tduration_ms\tframes\tbaseline_us\tvalue_us\t"
+    "gpu_limit_bits\tgpu_limits");
+
+  while (const auto frame = reader->GetNextFrame()) {
+    // Aggregated logs are already a row of metrics per frame
+    auto metrics = reader->GetFrameSummary();
+    if (!metrics) {
+      aggregator.Push(*frame, reader->GetRepresentedFrameCount());
+      metrics = aggregator.Flush();
+    }
+    if (metrics) {
+      print(detector.Push(*metrics));
+    }
+  }
+  print(detector.Finish());
+
+  std::println(stderr, "Found {} hitches and {} steps", hitchCount, stepCount);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,432 @@
+// Copyright 2024 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+
+// clang-format off
+#include <Windows.h>
+#include <TraceLoggingProvider.h>
+#include <shlobj_core.h>
+// clang-format on
+
+#include <wil/resource.h>
+#include <wil/win32_helpers.h>
+
+#include <BinaryLogReader.hpp>
+#include <algorithm>
+#include <expected>
+#include <magic_enum.hpp>
+#include <print>
+#include <ranges>
+
+#include "Config.hpp"
+#include "LayerHarness.hpp"
+#include "Win32Utils.hpp"
+
+/* PS>
+ * [System.Diagnostics.Tracing.EventSource]::new("XRFrameTools.binlog-replay")
+ * 89059059-89e2-5cba-ba62-a7a40a3a6115
+ */
+TRACELOGGING_DEFINE_PROVIDER(
+  gTraceProvider,
+  "XRFrameTools.binlog-replay",
+  (0x89059059, 0x89e2, 0x5cba, 0xba, 0x62, 0xa7, 0xa4, 0x0a, 0x3a, 0x61, 0x15));
+
+namespace {
+
+using namespace std::chrono_literals;
+
+struct Arguments {
+  std::filesystem::path mInput;
+  std::filesystem::path mCoreMetrics;
+  double mSpeed {1.0};
+  std::chrono::microseconds mTolerance {1000};
+};
+
+void ShowUsage(std::FILE* stream, std::string_view exe) {
+  std::println(
+    stream,
+    "USAGE: {} [--help] [--speed MULTIPLIER] [--tolerance MICROSECONDS] "
+    "INPUT_PATH CORE_METRICS_DLL\n\n"
+    "Replays the frame timings in INPUT_PATH through the core_metrics API "
+    "layer,\n"
+    "using a fake OpenXR runtime, then compares the new log to the input.\n\n"
+    "  --speed MULTIPLIER\n\n"
+    "    replay faster (or slower) than the original; default 1\n\n"
+    "  --tolerance MICROSECONDS\n\n"
+    "    report stage timings that differ from the input by more than this;\n"
+    "    default 1000",
+    std::filesystem::path {exe}.stem().string());
+}
+
+[[nodiscard]]
+std::expected<Arguments, int> ParseArguments(int argc, char* argv[]) {
+  Arguments ret;
+  const std::string_view thisExe {argv[0]};
+
+  std::vector<std::filesystem::path> positional;
+  bool parse = true;// set to false after seeing `--` by itself
+  for (size_t i = 1; i < argc; ++i) {
+    const std::string_view arg {argv[i]};
+    if (parse && arg == "--help") {
+      ShowUsage(stdout, thisExe);
+      return std::unexpected {EXIT_SUCCESS};
+    }
+
+    if (parse && (arg == "--speed" || arg == "--tolerance")) {
+      ++i;
+      if (i >= argc) {
+        std::println(stderr, "{} requires a value", arg);
+        return std::unexpected {EXIT_FAILURE};
+      }
+      try {
+        const auto value = std::stod(argv[i]);
+        if (!(value > 0)) {
+          std::println(stderr, "{} value must be positive", arg);
+          return std::unexpected {EXIT_FAILURE};
+        }
+        if (arg == "--speed") {
+          ret.mSpeed = value;
+        } else {
+          ret.mTolerance
+            = std::chrono::microseconds {static_cast<int64_t>(value)};
+        }
+        continue;
+      } catch (...) {
+        std::println(stderr, "{} value must be a number", arg);
+        return std::unexpected {EXIT_FAILURE};
+      }
+    }
+
+    if (parse && arg == "--") {
+      parse = false;
+      continue;
+    }
+
+    if (parse && arg.starts_with("-")) {
+      ShowUsage(stderr, thisExe);
+      return std::unexpected {EXIT_FAILURE};
+    }
+
+    const std::filesystem::path path {arg};
+    if (!std::filesystem::is_regular_file(path)) {
+      std::println(stderr, "`{}` is not a regular file", arg);
+      return std::unexpected {EXIT_FAILURE};
+    }
+    positional.push_back(std::filesystem::canonical(path));
+  }
+
+  if (positional.size() != 2) {
+    ShowUsage(stderr, thisExe);
+    return std::unexpected {EXIT_FAILURE};
+  }
+  ret.mInput = positional.at(0);
+  ret.mCoreMetrics = positional.at(1);
+
+  return ret;
+}
+
+// Time spent in, and between, each OpenXR call for a single frame
+struct StageDurations {
+  static constexpr size_t StageCount = 6;
+  std::chrono::microseconds mAppBeforeWait {};
+  std::chrono::microseconds mWaitFrame {};
+  std::chrono::microseconds mAppBeforeBegin {};
+  std::chrono::microseconds mBeginFrame {};
+  std::chrono::microseconds mRender {};
+  std::chrono::microseconds mEndFrame {};
+
+  [[nodiscard]]
+  auto AsArray() const noexcept {
+    return std::array {
+      mAppBeforeWait,
+      mWaitFrame,
+      mAppBeforeBegin,
+      mBeginFrame,
+      mRender,
+      mEndFrame,
+    };
+  }
+};
+
+class StageDurationCalculator {
+ public:
+  explicit StageDurationCalculator(const PerformanceCounterMath& pcm)
+    : mPerformanceCounterMath(pcm) {
+  }
+
+  StageDurations Push(const FramePerformanceCounters::Core& core) {
+    // Pipelined or unmatched frames can have overlapping or missing stamps;
+    // we can't replay negative time, so clamp to zero
+    const auto between = [this](const int64_t a, const int64_t b) {
+      if (!(a && b)) {
+        return std::chrono::microseconds::zero();
+      }
+      return std::max(
+        mPerformanceCounterMath.ToDurationAllowNegative(a, b),
+        std::chrono::microseconds::zero());
+    };
+
+    const StageDurations ret {
+      .mAppBeforeWait = between(mPreviousEndFrameStop, core.mWaitFrameStart),
+      .mWaitFrame = between(core.mWaitFrameStart, core.mWaitFrameStop),
+      .mAppBeforeBegin = between(core.mWaitFrameStop, core.mBeginFrameStart),
+      .mBeginFrame = between(core.mBeginFrameStart, core.mBeginFrameStop),
+      .mRender = between(core.mBeginFrameStop, core.mEndFrameStart),
+      .mEndFrame = between(core.mEndFrameStart, core.mEndFrameStop),
+    };
+    if (core.mEndFrameStop) {
+      mPreviousEndFrameStop = core.mEndFrameStop;
+    }
+    return ret;
+  }
+
+ private:
+  PerformanceCounterMath mPerformanceCounterMath;
+  int64_t mPreviousEndFrameStop {};
+};
+
+std::optional<std::filesystem::path> FindNewestLog(
+  const std::filesystem::path& directory,
+  const std::filesystem::file_time_type& notBefore) {
+  std::optional<std::filesystem::path> ret;
+  std::filesystem::file_time_type newest {};
+  std::error_code ec;
+  for (auto&& it: std::filesystem::directory_iterator(directory, ec)) {
+    if (it.path().extension() != ".XRFTBinLog") {
+      continue;
+    }
+    const auto time = it.last_write_time(ec);
+    if (ec || time < notBefore || (ret && time < newest)) {
+      continue;
+    }
+    newest = time;
+    ret = it.path();
+  }
+  return ret;
+}
+
+void PrintDistribution(
+  std::string_view name,
+  std::vector<std::chrono::nanoseconds>& values) {
+  if (values.empty()) {
+    return;
+  }
+  std::ranges::sort(values);
+  const auto percentile = [&values](const double p) {
+    return values.at(static_cast<size_t>(p * (values.size() - 1))).count();
+  };
+  const auto total = std::ranges::fold_left(
+    values, std::chrono::nanoseconds {}, std::plus {});
+  std::println(
+    "{}: mean {}ns, p50 {}ns, p99 {}ns, max {}ns",
+    name,
+    total.count() / static_cast<int64_t>(values.size()),
+    percentile(0.5),
+    percentile(0.99),
+    values.back().count());
+}
+
+}// namespace
+
+int main(int argc, char** argv) {
+  const auto args = ParseArguments(argc, argv);
+  if (!args) {
+    return args.error();
+  }
+
+  auto reader = BinaryLogReader::Create(args->mInput);
+  if (!reader) {
+    std::println(
+      stderr,
+      "Opening binary log failed: {}",
+      magic_enum::enum_name(reader.error().GetCode()));
+    return EXIT_FAILURE;
+  }
+
+  // The layer reads its configuration from the registry, keyed by the
+  // executable path - which is us.
+  const auto thisExe = std::filesystem::canonical(
+    std::filesystem::path {wil::QueryFullProcessImageNameW().get()});
+  auto config = Config::GetForOpenXRApp(Config::Access::ReadWrite, thisExe);
+  config.SetBinaryLoggingEnabledUntil(Config::BinaryLoggingPermanentlyEnabled);
+  const auto disableLogging = wil::scope_exit([&config]() {
+    config.SetBinaryLoggingEnabledUntil(Config::BinaryLoggingDisabled);
+  });
+
+  const auto logDirectory = GetKnownFolderPath(FOLDERID_LocalAppData)
+    / L"XRFrameTools" / "Logs" / thisExe.stem();
+  const auto replayStartedAt = std::filesystem::file_time_type::clock::now();
+
+  std::optional<LayerHarness> harness;
+  try {
+    const std::array layers {args->mCoreMetrics};
+    harness.emplace(layers);
+  } catch (const std::exception& e) {
+    std::println(stderr, "❌ {}", e.what());
+    return EXIT_FAILURE;
+  }
+
+  const auto scaled = [speed = args->mSpeed](std::chrono::microseconds in) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::duration<double, std::micro>(in.count() / speed));
+  };
+
+  StageDurationCalculator inputStages {reader->GetPerformanceCounterMath()};
+  std::vector<std::chrono::nanoseconds> overheadPerFrame;
+  overheadPerFrame.reserve(reader->GetOrComputeFileFooter().mFrameCount);
+  XrTime lastDisplayTime {};
+  uint64_t failedCalls {};
+
+  std::println(
+    stderr, "Replaying `{}` at {}x speed...", args->mInput.string(), args->mSpeed);
+  const auto startTime = std::chrono::steady_clock::now();
+  while (const auto frame = reader->GetNextFrame()) {
+    const auto& core = frame->mCore;
+    const auto stages = inputStages.Push(core);
+    LayerHarness::CallTiming wait {};
+    LayerHarness::CallTiming begin {};
+    LayerHarness::CallTiming end {};
+
+    LayerHarness::Spin(scaled(stages.mAppBeforeWait));
+    harness->SetNextPredictedDisplayTime(core.mXrDisplayTime);
+    if (XR_FAILED(
+          harness->WaitFrame(scaled(stages.mWaitFrame), nullptr, &wait))) {
+      ++failedCalls;
+    }
+    LayerHarness::Spin(scaled(stages.mAppBeforeBegin));
+    if (XR_FAILED(harness->BeginFrame(scaled(stages.mBeginFrame), &begin))) {
+      ++failedCalls;
+    }
+    LayerHarness::Spin(scaled(stages.mRender));
+    if (XR_FAILED(harness->EndFrame(
+          scaled(stages.mEndFrame), core.mXrDisplayTime, &end))) {
+      ++failedCalls;
+    }
+
+    overheadPerFrame.push_back(
+      wait.GetLayerOverhead() + begin.GetLayerOverhead()
+      + end.GetLayerOverhead());
+    lastDisplayTime = core.mXrDisplayTime;
+  }
+  const auto replayTime = std::chrono::steady_clock::now() - startTime;
+
+  // The layer notices the registry change asynchronously, and only closes the
+  // log - writing the footer - when it next publishes a frame; keep producing
+  // frames until that happens. Any frames logged before then are ignored
+  // below, as they're after the end of the input.
+  config.SetBinaryLoggingEnabledUntil(Config::BinaryLoggingDisabled);
+  std::optional<BinaryLogReader> output;
+  for (const auto deadline = std::chrono::steady_clock::now() + 10s;
+       std::chrono::steady_clock::now() < deadline;) {
+    constexpr XrDuration FlushFramePeriod {1'000'000'000 / 90};
+    lastDisplayTime += FlushFramePeriod;
+    harness->SetNextPredictedDisplayTime(lastDisplayTime);
+    harness->WaitFrame({}, nullptr);
+    harness->BeginFrame({});
+    harness->EndFrame({}, lastDisplayTime);
+
+    // The writer doesn't share write access, so this fails until the layer
+    // has closed the log
+    if (const auto path = FindNewestLog(logDirectory, replayStartedAt)) {
+      if (auto it = BinaryLogReader::Create(*path);
+          it && it->GetFileFooter()) {
+        output.emplace(std::move(it).value());
+        break;
+      }
+    }
+    Sleep(10);
+  }
+  if (!output) {
+    std::println(stderr, "❌ core_metrics did not produce a complete log");
+    return EXIT_FAILURE;
+  }
+
+  std::println(
+    "Replayed {} frames in {:.03f}s",
+    overheadPerFrame.size(),
+    std::chrono::duration_cast<std::chrono::duration<double>>(replayTime)
+      .count());
+  PrintDistribution("Layer CPU cost per frame", overheadPerFrame);
+  std::println("Output log: {}", output->GetLogFilePath().string());
+
+  // Compare the re-logged output with the input
+  auto input = BinaryLogReader::Create(args->mInput);
+  if (!input) {
+    std::println(stderr, "❌ Failed to reopen input log");
+    return EXIT_FAILURE;
+  }
+  StageDurationCalculator expectedStages {input->GetPerformanceCounterMath()};
+  StageDurationCalculator actualStages {output->GetPerformanceCounterMath()};
+
+  uint64_t inputFrames {};
+  uint64_t missingFrames {};
+  uint64_t displayTimeMismatches {};
+  uint64_t framesOutsideTolerance {};
+  std::chrono::microseconds maxStageError {};
+  std::chrono::microseconds totalStageError {};
+  while (const auto expected = input->GetNextFrame()) {
+    ++inputFrames;
+    const auto expectedDurations = expectedStages.Push(expected->mCore);
+    const auto actual = output->GetNextFrame();
+    if (!actual) {
+      ++missingFrames;
+      continue;
+    }
+    if (actual->mCore.mXrDisplayTime != expected->mCore.mXrDisplayTime) {
+      ++displayTimeMismatches;
+    }
+
+    const auto actualDurations = actualStages.Push(actual->mCore).AsArray();
+    bool outsideTolerance = false;
+    for (auto&& [expectedStage, actualStage]:
+         std::views::zip(expectedDurations.AsArray(), actualDurations)) {
+      const auto error = std::chrono::abs(
+        std::chrono::duration_cast<std::chrono::microseconds>(
+          scaled(expectedStage))
+        - actualStage);
+      maxStageError = std::max(maxStageError, error);
+      totalStageError += error;
+      if (error > args->mTolerance) {
+        outsideTolerance = true;
+      }
+    }
+    if (outsideTolerance) {
+      ++framesOutsideTolerance;
+    }
+  }
+
+  const auto outputFooter = output->GetFileFooter().value();
+  std::println(
+    "Frames: {} in input, {} in output ({} flush frames after end of input)",
+    inputFrames,
+    outputFooter.mFrameCount,
+    outputFooter.mFrameCount - std::min(outputFooter.mFrameCount, inputFrames));
+  std::println("Missing frames: {}", missingFrames);
+  std::println("Display time mismatches: {}", displayTimeMismatches);
+  std::println(
+    "Stage timing error: mean {}µs, max {}µs; {} frames outside {}µs "
+    "tolerance",
+    inputFrames ? totalStageError.count()
+        / static_cast<int64_t>(inputFrames * StageDurations::StageCount)
+                : 0,
+    maxStageError.count(),
+    framesOutsideTolerance,
+    args->mTolerance.count());
+  if (outputFooter.mDroppedFrameCount) {
+    std::println(
+      "Writer ring buffer: overflowed, dropping {} frames",
+      outputFooter.mDroppedFrameCount);
+  } else {
+    std::println("Writer ring buffer: no overflow");
+  }
+
+  // Timing errors are reported, but not failures: they are mostly down to
+  // scheduling on the machine running the replay
+  if (
+    failedCalls || missingFrames || displayTimeMismatches
+    || outputFooter.mDroppedFrameCount) {
+    std::println(stderr, "❌ replay does not match input");
+    return EXIT_FAILURE;
+  }
+  std::println(stderr, "✅ replay matches input");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,285 @@
+// Copyright 2024 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+
+#ifdef _WIN32
+// clang-format off
+#include <Windows.h>
+#include <TraceLoggingProvider.h>
+// clang-format on
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <expected>
+#include <print>
+#include <string>
+#include <system_error>
+#include <thread>
+
+#include "SyntheticLog.hpp"
+
+#ifdef _WIN32
+/* PS>
+ * [System.Diagnostics.Tracing.EventSource]::new("XRFrameTools.binlog-synth")
+ * b14c964c-241f-5b64-b727-3bad9e91f866
+ */
+TRACELOGGING_DEFINE_PROVIDER(
+  gTraceProvider,
+  "XRFrameTools.binlog-synth",
+  (0xb14c964c, 0x241f, 0x5b64, 0xb7, 0x27, 0x3b, 0xad, 0x9e, 0x91, 0xf8, 0x66));
+#endif
+
+namespace {
+
+using ValidDataBits = FramePerformanceCounters::ValidDataBits;
+
+struct Arguments {
+  std::filesystem::path mOutput;
+  // NVEnc data is only included if `--encoders` is used
+  SyntheticLog::Options mOptions {.mEncoderSessionCount = 0};
+  size_t mJobs {std::max(std::thread::hardware_concurrency(), 1u)};
+};
+
+void ShowUsage(std::FILE* stream, std::string_view exe) {
+  const SyntheticLog::Options defaults {};
+  std::println(
+    stream,
+    "USAGE: {0} [--help] [OPTIONS...] OUTPUT_PATH\n\n"
+    "Writes a synthetic binary log, for testing and load-testing the log\n"
+    "tools. The output only depends on the options, not on --jobs.\n\n"
+    "  --frames COUNT\n\n"
+    "    default {1}\n\n"
+    "  --fps RATE\n\n"
+    "    default {2}\n\n"
+    "  --seed NUMBER\n\n"
+    "    default {3}\n\n"
+    "  --jobs COUNT\n\n"
+    "    number of threads to generate frames on; default {4}\n\n"
+    "  --begin-frame MEAN[,STDDEV]\n"
+    "  --app-cpu MEAN[,STDDEV]\n"
+    "  --end-frame MEAN[,STDDEV]\n"
+    "  --render-gpu MEAN[,STDDEV]\n\n"
+    "    duration of each stage, as a percentage of the frame interval.\n"
+    "    App CPU is from xrBeginFrame() returning to xrEndFrame() being\n"
+    "    called; the xrWaitFrame() time is whatever is left. Defaults are\n"
+    "    {9}, {10}, {11}, and {12}.\n\n"
+    "  --hitches PER_MINUTE\n"
+    "  --hitch-duration MEAN[,STDDEV]\n\n"
+    "    extra app CPU or render GPU time for a single frame, in frame\n"
+    "    intervals; default {5}\n\n"
+    "  --throttle PER_MINUTE\n"
+    "  --throttle-duration MEAN[,STDDEV]\n"
+    "  --throttle-clock PERCENT\n\n"
+    "    GPU throttling episodes, in seconds; default {6}. The GPU clock is\n"
+    "    reduced to PERCENT of normal; default {7}\n\n"
+    "  --encoders COUNT\n"
+    "  --encoder-churn PER_MINUTE\n\n"
+    "    include NVEnc sessions; COUNT is both the initial and the maximum\n"
+    "    number of sessions, up to 4. Churn starts or stops sessions.\n\n"
+    "  --no-gpu-time\n"
+    "  --no-vram\n"
+    "  --no-nvapi\n"
+    "  --no-host-metrics\n\n"
+    "    don't include these optional packets\n\n"
+    "  --host-metrics-interval MILLISECONDS\n\n"
+    "    default {8}\n\n"
+    "  --no-footer\n\n"
+    "    as if the game was killed between frames\n\n"
+    "  --truncate\n\n"
+    "    as if the game was killed while writing the last frame",
+    std::filesystem::path {exe}.stem().string(),
+    defaults.mFrameCount,
+    defaults.mFramesPerSecond,
+    defaults.mSeed,
+    Arguments {}.mJobs,
+    defaults.mHitchDuration.mMean,
+    defaults.mThrottleDuration.mMean,
+    defaults.mThrottleClockRatio * 100,
+    defaults.mHostMetricsInterval.count(),
+    defaults.mBeginFrame.mMean * 100,
+    defaults.mAppCpu.mMean * 100,
+    defaults.mEndFrame.mMean * 100,
+    defaults.mRenderGpu.mMean * 100);
+}
+
+// MEAN[,STDDEV]; if STDDEV is omitted, it is left unchanged
+[[nodiscard]]
+bool ParseDistribution(
+  const std::string& value,
+  const double scale,
+  SyntheticLog::Distribution& distribution) {
+  size_t mean {};
+  distribution.mMean = std::stod(value, &mean) * scale;
+  if (mean == value.size()) {
+    return true;
+  }
+  if (value.at(mean) != ',') {
+    return false;
+  }
+  size_t stdDev {};
+  const auto rest = value.substr(mean + 1);
+  distribution.mStandardDeviation = std::stod(rest, &stdDev) * scale;
+  return stdDev == rest.size();
+}
+
+[[nodiscard]]
+std::expected<Arguments, int> ParseArguments(int argc, char* argv[]) {
+  Arguments ret;
+  auto& options = ret.mOptions;
+  const std::string_view thisExe {argv[0]};
+
+  const auto clearBits = [&options](const ValidDataBits bit) {
+    options.mValidDataBits &= ~std::to_underlying(bit);
+  };
+
+  for (size_t i = 1; i < argc; ++i) {
+    const std::string_view arg {argv[i]};
+    if (arg == "--help") {
+      ShowUsage(stdout, thisExe);
+      return std::unexpected {EXIT_SUCCESS};
+    }
+
+    if (arg == "--no-gpu-time") {
+      clearBits(ValidDataBits::GpuTime);
+      continue;
+    }
+    if (arg == "--no-vram") {
+      clearBits(ValidDataBits::VRAM);
+      continue;
+    }
+    if (arg == "--no-nvapi") {
+      clearBits(ValidDataBits::NVAPI);
+      continue;
+    }
+    if (arg == "--no-host-metrics") {
+      clearBits(ValidDataBits::HostCpu);
+      clearBits(ValidDataBits::ProcessResources);
+      continue;
+    }
+    if (arg == "--no-footer") {
+      options.mEnding = SyntheticLog::Ending::NoFooter;
+      continue;
+    }
+    if (arg == "--truncate") {
+      options.mEnding = SyntheticLog::Ending::Truncated;
+      continue;
+    }
+
+    if (arg.starts_with("--")) {
+      ++i;
+      if (i >= argc) {
+        std::println(stderr, "{} requires a value", arg);
+        return std::unexpected {EXIT_FAILURE};
+      }
+      const std::string value {argv[i]};
+      // Stage durations are percentages of the frame interval
+      constexpr auto percent = 0.01;
+      bool valid = true;
+      try {
+        if (arg == "--frames") {
+          options.mFrameCount = std::stoull(value);
+        } else if (arg == "--fps") {
+          options.mFramesPerSecond = std::stod(value);
+          valid = options.mFramesPerSecond > 0;
+        } else if (arg == "--seed") {
+          options.mSeed = std::stoull(value);
+        } else if (arg == "--jobs") {
+          ret.mJobs = std::stoull(value);
+          valid = ret.mJobs >= 1;
+        } else if (arg == "--begin-frame") {
+          valid = ParseDistribution(value, percent, options.mBeginFrame);
+        } else if (arg == "--app-cpu") {
+          valid = ParseDistribution(value, percent, options.mAppCpu);
+        } else if (arg == "--end-frame") {
+          valid = ParseDistribution(value, percent, options.mEndFrame);
+        } else if (arg == "--render-gpu") {
+          valid = ParseDistribution(value, percent, options.mRenderGpu);
+        } else if (arg == "--hitches") {
+          options.mHitchesPerMinute = std::stod(value);
+        } else if (arg == "--hitch-duration") {
+          valid = ParseDistribution(value, 1, options.mHitchDuration);
+        } else if (arg == "--throttle") {
+          options.mThrottleEpisodesPerMinute = std::stod(value);
+        } else if (arg == "--throttle-duration") {
+          valid = ParseDistribution(value, 1, options.mThrottleDuration);
+        } else if (arg == "--throttle-clock") {
+          options.mThrottleClockRatio = std::stod(value) * percent;
+          valid = options.mThrottleClockRatio > 0
+            && options.mThrottleClockRatio <= 1;
+        } else if (arg == "--encoders") {
+          options.mEncoderSessionCount = std::stoul(value);
+          valid = options.mEncoderSessionCount <= 4;
+        } else if (arg == "--encoder-churn") {
+          options.mEncoderSessionChangesPerMinute = std::stod(value);
+        } else if (arg == "--host-metrics-interval") {
+          options.mHostMetricsInterval
+            = std::chrono::milliseconds {std::stoul(value)};
+        } else {
+          ShowUsage(stderr, thisExe);
+          return std::unexpected {EXIT_FAILURE};
+        }
+      } catch (...) {
+        valid = false;
+      }
+      if (!valid) {
+        std::println(stderr, "`{}` is not a valid value for {}", value, arg);
+        return std::unexpected {EXIT_FAILURE};
+      }
+      continue;
+    }
+
+    if (arg.starts_with("-") || !ret.mOutput.empty()) {
+      ShowUsage(stderr, thisExe);
+      return std::unexpected {EXIT_FAILURE};
+    }
+    ret.mOutput = {arg};
+  }
+
+  if (ret.mOutput.empty()) {
+    ShowUsage(stderr, thisExe);
+    return std::unexpected {EXIT_FAILURE};
+  }
+
+  if (options.mEncoderSessionCount > 0) {
+    options.mValidDataBits |= ValidDataBits::NVEnc;
+  }
+  return ret;
+}
+
+}// namespace
+
+int main(int argc, char** argv) {
+#if defined(_WIN32) && !defined(NDEBUG)
+  if (GetACP() != CP_UTF8) {
+    std::println(
+      stderr,
+      "BUILD ERROR: process code page should be forced to UTF-8 via manifest");
+    return EXIT_FAILURE;
+  }
+#endif
+
+  auto args = ParseArguments(argc, argv);
+  if (!args) {
+    return args.error();
+  }
+
+  const auto startTime = std::chrono::steady_clock::now();
+  try {
+    SyntheticLog::Write(args->mOutput, args->mOptions, args->mJobs);
+  } catch (const std::system_error& e) {
+    std::println(
+      stderr, "Writing `{}` failed: {}", args->mOutput.string(), e.what());
+    return EXIT_FAILURE;
+  }
+  const auto seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - startTime)
+                         .count();
+
+  std::println(
+    "Wrote {} frames ({} bytes) in {:.03f}s; {:.0f} frames per minute",
+    args->mOptions.mFrameCount,
+    std::filesystem::file_size(args->mOutput),
+    seconds,
+    (args->mOptions.mFrameCount * 60) / seconds);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,184 @@
+// Copyright 2024 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+
+// clang-format off
+#include <Windows.h>
+#include <TraceLoggingProvider.h>
+#include <shlobj_core.h>
+// clang-format on
+
+#include <BinaryLogReader.hpp>
+#include <expected>
+#include <magic_enum.hpp>
+#include <print>
+#include <stop_token>
+
+#include "CSVWriter.hpp"
+#include "Win32Utils.hpp"
+
+/* PS>
+ * [System.Diagnostics.Tracing.EventSource]::new("XRFrameTools.binlog-tail")
+ * b75a2c68-4540-56b2-d3b7-d0322c1e83d2
+ */
+TRACELOGGING_DEFINE_PROVIDER(
+  gTraceProvider,
+  "XRFrameTools.binlog-tail",
+  (0xb75a2c68, 0x4540, 0x56b2, 0xd3, 0xb7, 0xd0, 0x32, 0x2c, 0x1e, 0x83, 0xd2));
+
+namespace {
+
+std::stop_source gStopSource;
+
+struct Arguments {
+  std::filesystem::path mInput;
+  size_t mFramesPerRow {CSVWriter::DefaultFramesPerRow};
+};
+
+void ShowUsage(std::FILE* stream, std::string_view exe) {
+  std::println(
+    stream,
+    "USAGE: {0} [--help] [--frames-per-row COUNT] [INPUT_PATH]\n\n"
+    "Writes CSV rows to stdout as a binary log is written, until the log is\n"
+    "finished or Ctrl+C is pressed; rotated logs are followed into the next\n"
+    "part. If INPUT_PATH is not specified, the most recently modified log is\n"
+    "used.\n\n"
+    "  --frames-per-row COUNT\n\n"
+    "    number of frames to include in each row; default {1}",
+    std::filesystem::path {exe}.stem().string(),
+    CSVWriter::DefaultFramesPerRow);
+}
+
+[[nodiscard]]
+std::expected<Arguments, int> ParseArguments(int argc, char* argv[]) {
+  Arguments ret;
+  const std::string_view thisExe {argv[0]};
+
+  for (size_t i = 1; i < argc; ++i) {
+    const std::string_view arg {argv[i]};
+    if (arg == "--help") {
+      ShowUsage(stdout, thisExe);
+      return std::unexpected {EXIT_SUCCESS};
+    }
+
+    if (arg == "--frames-per-row") {
+      ++i;
+      if (i >= argc) {
+        std::println(stderr, "{} requires a value", arg);
+        return std::unexpected {EXIT_FAILURE};
+      }
+      try {
+        const auto value = std::stoi(std::string {argv[i]});
+        if (value < 1) {
+          std::println(stderr, "{} value must be at least 1", arg);
+          return std::unexpected {EXIT_FAILURE};
+        }
+        ret.mFramesPerRow = static_cast<size_t>(value);
+        continue;
+      } catch (...) {
+        std::println(stderr, "{} value must be a number", arg);
+        return std::unexpected {EXIT_FAILURE};
+      }
+    }
+
+    if (arg.starts_with("-") || !ret.mInput.empty()) {
+      ShowUsage(stderr, thisExe);
+      return std::unexpected {EXIT_FAILURE};
+    }
+    ret.mInput = {arg};
+  }
+  return ret;
+}
+
+[[nodiscard]]
+std::optional<std::filesystem::path> FindNewestLog() {
+  const auto root
+    = GetKnownFolderPath(FOLDERID_LocalAppData) / "XRFrameTools" / "Logs";
+  std::optional<std::filesystem::path> ret;
+  std::filesystem::file_time_type newest {};
+
+  std::error_code ec;
+  for (auto it = std::filesystem::recursive_directory_iterator(root, ec);
+       !ec && it != std::filesystem::recursive_directory_iterator();
+       it.increment(ec)) {
+    if (
+      !it->is_regular_file(ec)
+      || _wcsicmp(it->path().extension().c_str(), L".XRFTBinLog") != 0) {
+      continue;
+    }
+    const auto lastWriteTime = it->last_write_time(ec);
+    if (ec) {
+      ec.clear();
+      continue;
+    }
+    if (!ret || lastWriteTime > newest) {
+      ret = it->path();
+      newest = lastWriteTime;
+    }
+  }
+  return ret;
+}
+
+BOOL WINAPI ConsoleCtrlHandler(DWORD ctrlType) {
+  if (ctrlType != CTRL_C_EVENT && ctrlType != CTRL_BREAK_EVENT) {
+    return FALSE;
+  }
+  gStopSource.request_stop();
+  return TRUE;
+}
+
+}// namespace
+
+int main(int argc, char** argv) {
+#ifndef NDEBUG
+  if (GetACP() != CP_UTF8) {
+    std::println(
+      stderr,
+      "BUILD ERROR: process code page should be forced to UTF-8 via manifest");
+    return EXIT_FAILURE;
+  }
+#endif
+
+  auto args = ParseArguments(argc, argv);
+  if (!args) {
+    return args.error();
+  }
+
+  if (args->mInput.empty()) {
+    const auto newest = FindNewestLog();
+    if (!newest) {
+      std::println(stderr, "Couldn't find any binary logs");
+      return EXIT_FAILURE;
+    }
+    args->mInput = *newest;
+  }
+
+  auto reader = BinaryLogReader::Create(args->mInput);
+  if (!reader) {
+    std::println(
+      stderr,
+      "Opening binary log failed: {}",
+      magic_enum::enum_name(reader.error().GetCode()));
+    return EXIT_FAILURE;
+  }
+  std::println(stderr, "Following `{}`", args->mInput.string());
+
+  SetConsoleCtrlHandler(&ConsoleCtrlHandler, TRUE);
+
+  auto out = PlatformFile::GetStandardOutput();
+  const auto result = CSVWriter::Write(
+    std::move(reader).value(),
+    out,
+    args->mFramesPerRow,
+    {
+      .mStopToken = gStopSource.get_token(),
+      .mFollow = true,
+    });
+
+  std::println(
+    stderr,
+    "{} after {} rows covering {} frames",
+    result.mCancelled ? "Stopped" : "Log finished",
+    result.mRowCount,
+    result.mFrameCount);
+  return EXIT_SUCCESS;
+}
@@ -1,22 +1,37 @@
 // Copyright 2024 Fred Emmott <fred@fredemmott.com>
 // SPDX-License-Identifier: MIT
 
+#ifdef _WIN32
 // clang-format off
 #include <Windows.h>
 #include <TraceLoggingProvider.h>
 // clang-format on
 
 #include <wil/filesystem.h>
+#else
+#include <fnmatch.h>
+#endif
 
 #include <BinaryLogReader.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
 #include <expected>
+#include <format>
+#include <fstream>
 #include <functional>
 #include <magic_enum.hpp>
+#include <map>
+#include <mutex>
 #include <print>
+#include <thread>
+#include <vector>
 
 #include "CSVWriter.hpp"
-#include "Win32Utils.hpp"
+#include "DebugPrint.hpp"
+#include "PlatformFile.hpp"
 
+#ifdef _WIN32
 /* PS>
  * [System.Diagnostics.Tracing.EventSource]::new("XRFrameTools.binlog-to-csv")
  * 36fe3cde-e5a7-531c-dc77-0eea71c447bd
@@ -25,36 +40,140 @@ TRACELOGGING_DEFINE_PROVIDER(
   gTraceProvider,
   "XRFrameTools.binlog-to-csv",
   (0x36fe3cde, 0xe5a7, 0x531c, 0xdc, 0x77, 0x0e, 0xea, 0x71, 0xc4, 0x47, 0xbd));
+#endif
 
 namespace {
 
 struct Arguments {
-  std::filesystem::path mInput;
+  std::vector<std::filesystem::path> mInputs;
   std::filesystem::path mOutput;
+  std::filesystem::path mOutputDirectory;
   size_t mFramesPerRow {CSVWriter::DefaultFramesPerRow};
+  size_t mJobs {std::max(std::thread::hardware_concurrency(), 1u)};
+  bool mForce {false};
+  // Set if there may be more than one input, even if there is only one
+  bool mIsBatch {false};
 };
 
 void ShowUsage(std::FILE* stream, std::string_view exe) {
   std::println(
     stream,
-    "USAGE: {} [--help] [--output PATH] [--frames-per-row COUNT] INPUT_PATH\n\n"
+    "USAGE: {0} [--help] [--output PATH] [--frames-per-row COUNT] INPUT_PATH\n"
+    "       {0} [--help] --output-dir PATH [--frames-per-row COUNT] "
+    "[--jobs COUNT] [--force] INPUT...\n\n"
     "  --frames-per-row COUNT\n\n"
-    "    number of frames to include in each row; default {}",
+    "    number of frames to include in each row; default {1}\n\n"
+    "  --output-dir PATH\n\n"
+    "    convert every INPUT to a CSV file in PATH. Each INPUT can be a file,\n"
+    "    a directory to search for logs, or a wildcard pattern.\n"
+    "    A tab-separated summary of each file is written to stdout.\n\n"
+    "  --jobs COUNT\n\n"
+    "    number of files to convert concurrently; default {2}\n\n"
+    "  --force\n\n"
+    "    convert files even if the output is newer than the input, and was\n"
+    "    written with the same options",
     std::filesystem::path {exe}.stem().string(),
-    CSVWriter::DefaultFramesPerRow);
+    CSVWriter::DefaultFramesPerRow,
+    Arguments {}.mJobs);
+}
+
+[[nodiscard]]
+bool IsLogFile(const std::filesystem::path& path) {
+  constexpr std::string_view Extension {".XRFTBinLog"};
+  const auto extension = path.extension().string();
+  return std::ranges::equal(
+    extension, Extension, [](const char a, const char b) {
+      return std::tolower(static_cast<unsigned char>(a))
+        == std::tolower(static_cast<unsigned char>(b));
+    });
 }
 
-std::optional<std::filesystem::path> ArgToInputPath(std::string_view arg) {
+// Expands directories and wildcards; returns false on error
+[[nodiscard]]
+bool AppendInputPaths(
+  std::string_view arg,
+  std::vector<std::filesystem::path>& paths,
+  bool& isBatch) {
   const std::filesystem::path path {arg};
+
+  if (arg.find_first_of("*?") != std::string_view::npos) {
+    isBatch = true;
+    std::vector<std::filesystem::path> matches;
+    // Wildcards are only supported in the last component
+#ifdef _WIN32
+    WIN32_FIND_DATAW findData {};
+    wil::unique_hfind find {FindFirstFileW(path.c_str(), &findData)};
+    if (find) {
+      do {
+        if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+          continue;
+        }
+        matches.push_back(
+          path.parent_path() / std::filesystem::path {findData.cFileName});
+      } while (FindNextFileW(find.get(), &findData));
+    } else if (GetLastError() != ERROR_FILE_NOT_FOUND) {
+      std::println(stderr, "`{}` is not accessible", arg);
+      return false;
+    }
+#else
+    // Usually expanded by the shell, but not if quoted
+    const auto directory = path.has_parent_path()
+      ? path.parent_path()
+      : std::filesystem::current_path();
+    const auto pattern = path.filename().string();
+    std::error_code ec;
+    std::filesystem::directory_iterator it {directory, ec};
+    if (ec && ec != std::errc::no_such_file_or_directory) {
+      std::println(stderr, "`{}` is not accessible", arg);
+      return false;
+    }
+    for (auto&& entry: it) {
+      if (
+        (!entry.is_directory())
+        && fnmatch(pattern.c_str(), entry.path().filename().c_str(), 0) == 0) {
+        matches.push_back(entry.path());
+      }
+    }
+#endif
+    if (matches.empty()) {
+      std::println(stderr, "`{}` doesn't match any files", arg);
+      return false;
+    }
+    // As with directories, so that files found by several inputs are only
+    // converted once
+    for (auto&& match: matches) {
+      std::error_code ec;
+      auto canonical = std::filesystem::canonical(match, ec);
+      if (ec) {
+        std::println(
+          stderr, "`{}` is not accessible: {}", match.string(), ec.message());
+        return false;
+      }
+      paths.push_back(std::move(canonical));
+    }
+    return true;
+  }
+
   try {
+    if (std::filesystem::is_directory(path)) {
+      isBatch = true;
+      for (auto&& entry:
+           std::filesystem::recursive_directory_iterator {path}) {
+        if (entry.is_regular_file() && IsLogFile(entry.path())) {
+          paths.push_back(std::filesystem::canonical(entry.path()));
+        }
+      }
+      return true;
+    }
     if (std::filesystem::is_regular_file(path)) {
-      return std::filesystem::canonical(path);
+      paths.push_back(std::filesystem::canonical(path));
+      return true;
     }
-    std::println(stderr, "`{}` is not a regular file", arg);
-    return std::nullopt;
+    std::println(stderr, "`{}` is not a regular file or directory", arg);
+    return false;
   } catch (const std::filesystem::filesystem_error& ec) {
     std::println(stderr, "`{}` is not accessible: {}", arg, ec.what());
-    return std::nullopt;
+    return false;
   }
 }
 
@@ -81,34 +200,48 @@ std::expected<Arguments, int> ParseArguments(int argc, char* argv[]) {
   for (size_t i = 1; i < argc; ++i) {
     const std::string_view arg {argv[i]};
     // --help is handled above
-    if (parse && arg == "--frames-per-row") {
+    if (parse && (arg == "--frames-per-row" || arg == "--jobs")) {
       ++i;
       if (i >= argc) {
-        std::println(stderr, "--frames-per-row requires a value");
+        std::println(stderr, "{} requires a value", arg);
         return std::unexpected {EXIT_FAILURE};
       }
       std::string stringValue {argv[i]};
       try {
         const auto value = std::stoi(stringValue);
         if (value < 1) {
-          std::println(stderr, "--frames-per-row value must be at least 1");
+          std::println(stderr, "{} value must be at least 1", arg);
           return std::unexpected {EXIT_FAILURE};
         }
-        ret.mFramesPerRow = static_cast<size_t>(value);
+        if (arg == "--jobs") {
+          ret.mJobs = static_cast<size_t>(value);
+        } else {
+          ret.mFramesPerRow = static_cast<size_t>(value);
+        }
         continue;
       } catch (...) {
-        std::println(stderr, "--frames-per-row value must be a number");
+        std::println(stderr, "{} value must be a number", arg);
         return std::unexpected {EXIT_FAILURE};
       }
     }
 
-    if (parse && arg == "--output") {
+    if (parse && (arg == "--output" || arg == "--output-dir")) {
       ++i;
       if (i >= argc) {
-        std::println(stderr, "--output requires a value");
+        std::println(stderr, "{} requires a value", arg);
         return std::unexpected {EXIT_FAILURE};
       }
-      ret.mOutput = {argv[i]};
+      if (arg == "--output") {
+        ret.mOutput = std::filesystem::path {argv[i]};
+      } else {
+        ret.mOutputDirectory = std::filesystem::absolute(argv[i]);
+        ret.mIsBatch = true;
+      }
+      continue;
+    }
+
+    if (parse && arg == "--force") {
+      ret.mForce = true;
       continue;
     }
 
@@ -122,23 +255,28 @@ std::expected<Arguments, int> ParseArguments(int argc, char* argv[]) {
       return std::unexpected {EXIT_FAILURE};
     }
 
-    if (!ret.mInput.empty()) {
-      std::println(
-        stderr,
-        "Multiple input files specified:\n  {}\n  {}",
-        ret.mInput.string(),
-        arg);
+    if (!AppendInputPaths(arg, ret.mInputs, ret.mIsBatch)) {
       return std::unexpected {EXIT_FAILURE};
     }
+  }
 
-    const auto path = ArgToInputPath(arg);
-    if (!path) {
+  if (ret.mInputs.size() > 1) {
+    ret.mIsBatch = true;
+  }
+
+  if (ret.mIsBatch) {
+    if (ret.mOutputDirectory.empty()) {
+      std::println(stderr, "--output-dir is required for multiple inputs");
+      return std::unexpected {EXIT_FAILURE};
+    }
+    if (!ret.mOutput.empty()) {
+      std::println(stderr, "--output can only be used with a single input");
       return std::unexpected {EXIT_FAILURE};
     }
-    ret.mInput = *path;
+    return ret;
   }
 
-  if (ret.mInput.empty()) {
+  if (ret.mInputs.empty()) {
     ShowUsage(stderr, thisExe);
     return std::unexpected {EXIT_FAILURE};
   }
@@ -146,10 +284,230 @@ std::expected<Arguments, int> ParseArguments(int argc, char* argv[]) {
   return ret;
 }
 
+struct BatchResult {
+  enum class Status {
+    Converted,
+    Skipped,
+    Failed,
+  };
+  Status mStatus {Status::Failed};
+  CSVWriter::Result mCSV;
+  std::chrono::milliseconds mConversionTime {};
+  std::string mError;
+};
+
+// Records the options used to write each output, so that changing them
+// isn't mistaken for an up-to-date output
+[[nodiscard]]
+std::filesystem::path GetOptionsPath(const std::filesystem::path& output) {
+  auto ret = output;
+  ret += ".options";
+  return ret;
+}
+
+[[nodiscard]]
+std::string GetOptionsString(const Arguments& args) {
+  return std::format("frames-per-row\t{}\n", args.mFramesPerRow);
+}
+
+// The output exists, was written after the input was last modified, and was
+// written with the same options
+[[nodiscard]]
+bool IsUpToDate(
+  const Arguments& args,
+  const std::filesystem::path& input,
+  const std::filesystem::path& output) {
+  std::error_code ec;
+  const auto outputSize = std::filesystem::file_size(output, ec);
+  if (ec || outputSize == 0) {
+    return false;
+  }
+  const auto outputTime = std::filesystem::last_write_time(output, ec);
+  if (ec) {
+    return false;
+  }
+  const auto inputTime = std::filesystem::last_write_time(input, ec);
+  if (ec || outputTime < inputTime) {
+    return false;
+  }
+
+  std::ifstream options {GetOptionsPath(output), std::ios::binary};
+  const std::string content {
+    std::istreambuf_iterator<char> {options},
+    std::istreambuf_iterator<char> {}};
+  return content == GetOptionsString(args);
+}
+
+[[nodiscard]]
+BatchResult ConvertOne(
+  const Arguments& args,
+  const std::filesystem::path& input,
+  const std::filesystem::path& output) {
+  const auto startTime = std::chrono::steady_clock::now();
+  BatchResult ret;
+
+  if ((!args.mForce) && IsUpToDate(args, input, output)) {
+    ret.mStatus = BatchResult::Status::Skipped;
+    return ret;
+  }
+
+  auto reader = BinaryLogReader::Create(input);
+  if (!reader) {
+    ret.mError = magic_enum::enum_name(reader.error().GetCode());
+    return ret;
+  }
+
+  // Removed first, so that if anything below fails, the output isn't
+  // considered up to date
+  const auto optionsPath = GetOptionsPath(output);
+  std::error_code ec;
+  std::filesystem::remove(optionsPath, ec);
+
+  try {
+    ret.mCSV = CSVWriter::Write(
+      std::move(reader).value(), output, args.mFramesPerRow);
+  } catch (const std::exception& e) {
+    // Not just `std::system_error`; anything else, e.g. `std::bad_alloc`,
+    // would otherwise escape the worker thread and terminate the process
+    ret.mError = e.what();
+    return ret;
+  }
+  ret.mConversionTime = std::chrono::duration_cast<std::chrono::milliseconds>(
+    std::chrono::steady_clock::now() - startTime);
+
+  if (ret.mCSV.mFrameCount == 0) {
+    // Don't leave a header-only CSV; it would be skipped by later runs
+    std::filesystem::remove(output, ec);
+    ret.mError = "log doesn't contain any frames";
+    return ret;
+  }
+
+  std::ofstream options {optionsPath, std::ios::binary | std::ios::trunc};
+  options << GetOptionsString(args);
+  if (!options) {
+    ret.mError = std::format("couldn't write `{}`", optionsPath.string());
+    return ret;
+  }
+
+  ret.mStatus = BatchResult::Status::Converted;
+  return ret;
+}
+
+int ConvertBatch(const Arguments& args) {
+  const auto startTime = std::chrono::steady_clock::now();
+
+  try {
+    std::filesystem::create_directories(args.mOutputDirectory);
+  } catch (const std::filesystem::filesystem_error& ec) {
+    std::println(
+      stderr,
+      "Couldn't create `{}`: {}",
+      args.mOutputDirectory.string(),
+      ec.what());
+    return EXIT_FAILURE;
+  }
+
+  // The same file can be found more than once, e.g. via a directory and a
+  // wildcard
+  auto inputs = args.mInputs;
+  std::ranges::sort(inputs);
+  const auto [first, last] = std::ranges::unique(inputs);
+  inputs.erase(first, last);
+
+  std::vector<std::filesystem::path> outputs;
+  outputs.reserve(inputs.size());
+  std::map<std::filesystem::path, size_t> outputCounts;
+  for (auto&& input: inputs) {
+    outputs.push_back(
+      (args.mOutputDirectory / input.filename()).replace_extension(".csv"));
+    ++outputCounts[outputs.back()];
+  }
+
+  // Machine-readable; human-readable output goes to stderr
+  std::println(
+    "status\tinput\toutput\trows\tframes\tlog_seconds\tconversion_seconds\t"
+    "error");
+
+  std::mutex stdoutMutex;
+  std::atomic<size_t> nextInput {};
+  std::atomic<size_t> convertedCount {};
+  std::atomic<size_t> skippedCount {};
+  std::atomic<size_t> failedCount {};
+
+  const auto worker = [&]() {
+    while (true) {
+      const auto i = nextInput++;
+      if (i >= inputs.size()) {
+        return;
+      }
+      const auto& input = inputs.at(i);
+      const auto& output = outputs.at(i);
+
+      BatchResult result;
+      if (outputCounts.at(output) > 1) {
+        result.mError = "another input has the same file name";
+      } else {
+        result = ConvertOne(args, input, output);
+      }
+
+      using enum BatchResult::Status;
+      switch (result.mStatus) {
+        case Converted:
+          ++convertedCount;
+          break;
+        case Skipped:
+          ++skippedCount;
+          break;
+        case Failed:
+          ++failedCount;
+          break;
+      }
+
+      const auto logSeconds = result.mCSV.mLogDuration
+        ? (result.mCSV.mLogDuration->count() / 1000.0)
+        : 0.0;
+      std::unique_lock lock(stdoutMutex);
+      std::println(
+        "{}\t{}\t{}\t{}\t{}\t{:.03f}\t{:.03f}\t{}",
+        magic_enum::enum_name(result.mStatus),
+        input.string(),
+        output.string(),
+        result.mCSV.mRowCount,
+        result.mCSV.mFrameCount,
+        logSeconds,
+        result.mConversionTime.count() / 1000.0,
+        result.mError);
+      if (result.mStatus == Failed) {
+        std::println(stderr, "❌ `{}`: {}", input.string(), result.mError);
+      }
+    }
+  };
+
+  {
+    std::vector<std::jthread> workers;
+    for (size_t i = 0; i < std::min(args.mJobs, inputs.size()); ++i) {
+      workers.emplace_back(worker);
+    }
+  }
+
+  const auto batchTime = std::chrono::duration_cast<std::chrono::milliseconds>(
+    std::chrono::steady_clock::now() - startTime);
+  std::println(
+    stderr,
+    "{} converted {}, skipped {}, failed {} in {:.03f}s",
+    failedCount ? "⚠️" : "✅",
+    convertedCount.load(),
+    skippedCount.load(),
+    failedCount.load(),
+    batchTime.count() / 1000.0f);
+
+  return failedCount ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
 }// namespace
 
 int main(int argc, char** argv) {
-#ifndef NDEBUG
+#if defined(_WIN32) && !defined(NDEBUG)
   if (GetACP() != CP_UTF8) {
     std::println(
       stderr,
@@ -164,7 +522,11 @@ int main(int argc, char** argv) {
     return args.error();
   }
 
-  auto reader = BinaryLogReader::Create(args->mInput);
+  if (args->mIsBatch) {
+    return ConvertBatch(*args);
+  }
+
+  auto reader = BinaryLogReader::Create(args->mInputs.front());
   if (!reader) {
     std::println(
       stderr,
@@ -173,6 +535,7 @@ int main(int argc, char** argv) {
     return EXIT_FAILURE;
   }
 
+#ifdef _WIN32
   const auto stderrHandle = GetStdHandle(STD_ERROR_HANDLE);
   DWORD stderrMode {};
   GetConsoleMode(stderrHandle, &stderrMode);
@@ -181,51 +544,49 @@ int main(int argc, char** argv) {
   SetConsoleMode(
     stderrHandle,
     stderrMode | ENABLE_PROCESSED_OUTPUT | ENABLE_VIRTUAL_TERMINAL_PROCESSING);
+#endif
 
   const auto pcm = reader->GetPerformanceCounterMath();
 
   std::println(
     stderr,
     "\x1b[1;7mLog resolution:\x1b[22m     {} ticks per second\x1b[m",
-    pcm.GetResolution().QuadPart);
+    pcm.GetResolution());
   std::println(
     stderr,
     "\x1b[1;7mOpenXR application:\x1b[22m {}\x1b[m",
     reader->GetExecutablePath().string());
-
-  wil::unique_hfile outputFile;
-  if (!args->mOutput.empty()) {
-    const auto path = std::filesystem::absolute(args->mOutput);
+  const auto loggingPolicy = reader->GetLoggingPolicy();
+  std::println(
+    stderr,
+    "\x1b[1;7mLogging policy:\x1b[22m     {} (interval {})\x1b[m",
+    magic_enum::enum_name(loggingPolicy.mKind),
+    loggingPolicy.mInterval);
+  const auto fileSize = reader->GetFileSize();
+
+  CSVWriter::Result result;
+  if (args->mOutput.empty()) {
+    auto out = PlatformFile::GetStandardOutput();
+    result
+      = CSVWriter::Write(std::move(reader).value(), out, args->mFramesPerRow);
+  } else {
+    // Replaces the output only once the conversion succeeds
     try {
-      if (!std::filesystem::is_directory(path.parent_path())) {
-        std::filesystem::create_directories(path.parent_path());
-      }
-    } catch (const std::filesystem::filesystem_error& ec) {
-      std::println(
-        stderr,
-        "Couldn't create `{}`: {}",
-        args->mOutput.parent_path().string(),
-        ec.what());
-      return EXIT_FAILURE;
-    }
-
-    auto [handle, error] = wil::try_open_or_truncate_existing_file(
-      path.wstring().c_str(), GENERIC_WRITE);
-    if (!handle) {
-      const std::error_code ec {
-        HRESULT_FROM_WIN32(error), std::system_category()};
-      std::println(stderr, "Couldn't open output file `{}`", ec.message());
+      result = CSVWriter::Write(
+        std::move(reader).value(),
+        std::filesystem::absolute(args->mOutput),
+        args->mFramesPerRow);
+    } catch (const std::exception& e) {
+      std::println(stderr, "❌ {}", e.what());
       return EXIT_FAILURE;
     }
-    outputFile = std::move(handle);
   }
 
-  const auto out
-    = outputFile ? outputFile.get() : GetStdHandle(STD_OUTPUT_HANDLE);
-  const auto result
-    = CSVWriter::Write(std::move(reader).value(), out, args->mFramesPerRow);
-
   if (result.mFrameCount == 0) {
+    if (!args->mOutput.empty()) {
+      std::error_code ec;
+      std::filesystem::remove(args->mOutput, ec);
+    }
     std::println(stderr, "❌ log doesn't contain any frames");
     return EXIT_FAILURE;
   }
@@ -241,6 +602,36 @@ int main(int argc, char** argv) {
       stderr,
       "⏱️ {:.03f} seconds recorded in log",
       result.mLogDuration->count() / 1000.0f);
+    if (result.mLogDuration->count() > 0) {
+      std::println(
+        stderr,
+        "💾 {:.01f}MiB per hour with this logging policy",
+        (fileSize / (1024.0 * 1024.0))
+          * (std::chrono::duration<double> {std::chrono::hours {1}}
+             / *result.mLogDuration));
+    }
+  }
+
+  const auto classifiedFrames = std::ranges::fold_left(
+    result.mBottleneckFrameCounts, uint64_t {}, std::plus {});
+  if (classifiedFrames) {
+    std::println(stderr, "🔍 bottlenecks:");
+    for (auto&& [bottleneck, label]: {
+           std::pair {FrameBottleneck::AppCpu, "App CPU"},
+           std::pair {FrameBottleneck::RenderCpu, "Render CPU"},
+           std::pair {FrameBottleneck::RenderGpu, "Render GPU"},
+           std::pair {FrameBottleneck::Compositor, "Compositor"},
+           std::pair {FrameBottleneck::Unknown, "Unknown"},
+         }) {
+      const auto count
+        = result.mBottleneckFrameCounts.at(std::to_underlying(bottleneck));
+      std::println(
+        stderr,
+        "    {:<12}{:>6.01f}% ({} frames)",
+        label,
+        (100.0 * count) / classifiedFrames,
+        count);
+    }
   }
 
   const auto conversionTime
@@ -0,0 +1,371 @@
+// Copyright 2024 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+
+#ifdef _WIN32
+// clang-format off
+#include <Windows.h>
+#include <TraceLoggingProvider.h>
+// clang-format on
+#endif
+
+#include <BinaryLogReader.hpp>
+#include <cstdio>
+#include <expected>
+#include <format>
+#include <magic_enum.hpp>
+#include <memory>
+#include <print>
+#include <utility>
+
+#ifdef _WIN32
+/* PS>
+ * [System.Diagnostics.Tracing.EventSource]::new("XRFrameTools.binlog-to-trace")
+ * 1213d31e-c74b-59c5-e20b-31c1d0f65ba4
+ */
+TRACELOGGING_DEFINE_PROVIDER(
+  gTraceProvider,
+  "XRFrameTools.binlog-to-trace",
+  (0x1213d31e, 0xc74b, 0x59c5, 0xe2, 0x0b, 0x31, 0xc1, 0xd0, 0xf6, 0x5b, 0xa4));
+#endif
+
+namespace {
+
+struct Arguments {
+  std::filesystem::path mInput;
+  std::filesystem::path mOutput;
+};
+
+void ShowUsage(std::FILE* stream, std::string_view exe) {
+  std::println(
+    stream,
+    "USAGE: {} [--help] [--output PATH] INPUT_PATH\n\n"
+    "Converts a binary log to a Chrome JSON trace, which can be opened in\n"
+    "ui.perfetto.dev or chrome://tracing.\n\n"
+    "  --output PATH\n\n"
+    "    file to write; default is stdout",
+    std::filesystem::path {exe}.stem().string());
+}
+
+[[nodiscard]]
+std::expected<Arguments, int> ParseArguments(int argc, char* argv[]) {
+  Arguments ret;
+  const std::string_view thisExe {argv[0]};
+
+  for (size_t i = 1; i < argc; ++i) {
+    const std::string_view arg {argv[i]};
+    if (arg == "--help") {
+      ShowUsage(stdout, thisExe);
+      return std::unexpected {EXIT_SUCCESS};
+    }
+    if (arg == "--output") {
+      ++i;
+      if (i >= argc) {
+        std::println(stderr, "{} requires a value", arg);
+        return std::unexpected {EXIT_FAILURE};
+      }
+      ret.mOutput = std::filesystem::absolute(argv[i]);
+      continue;
+    }
+    if (arg.starts_with("-") || !ret.mInput.empty()) {
+      ShowUsage(stderr, thisExe);
+      return std::unexpected {EXIT_FAILURE};
+    }
+    ret.mInput = {arg};
+  }
+
+  if (ret.mInput.empty()) {
+    ShowUsage(stderr, thisExe);
+    return std::unexpected {EXIT_FAILURE};
+  }
+  return ret;
+}
+
+// Each stage is a track ("thread") in the trace.
+//
+// Whole frames are not: frames are pipelined, so a frame starts before the
+// previous one has ended. Slices on a thread must nest, so frames are async
+// slices instead.
+enum class Track : uint32_t {
+  WaitFrame = 1,
+  AppCpu,
+  BeginFrame,
+  RenderCpu,
+  EndFrame,
+};
+
+constexpr std::string_view GetTrackName(const Track track) {
+  switch (track) {
+    case Track::WaitFrame:
+      return "xrWaitFrame";
+    case Track::AppCpu:
+      return "App CPU";
+    case Track::BeginFrame:
+      return "xrBeginFrame";
+    case Track::RenderCpu:
+      return "Render CPU";
+    case Track::EndFrame:
+      return "xrEndFrame";
+  }
+  std::unreachable();
+}
+
+std::string EscapeJSON(const std::string_view in) {
+  std::string ret;
+  ret.reserve(in.size());
+  for (auto&& c: in) {
+    switch (c) {
+      case '"':
+        ret += "\\\"";
+        break;
+      case '\\':
+        ret += "\\\\";
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          ret += std::format("\\u{:04x}", static_cast<unsigned int>(c));
+        } else {
+          ret += c;
+        }
+    }
+  }
+  return ret;
+}
+
+/** Streams Chrome JSON trace events.
+ *
+ * Events are written as they are read, and the format doesn't require them to
+ * be sorted, so memory usage does not depend on the size of the log.
+ */
+class TraceWriter {
+ public:
+  TraceWriter() = delete;
+  TraceWriter(std::FILE* out, const uint32_t pid) : mOut(out), mPID(pid) {
+    std::print(mOut, "{{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+  }
+
+  ~TraceWriter() {
+    std::println(mOut, "\n]}}");
+  }
+
+  void Metadata(
+    const std::string_view name,
+    const uint32_t tid,
+    const std::string_view value) {
+    this->BeginEvent();
+    std::print(
+      mOut,
+      R"({{"ph":"M","name":"{}","pid":{},"tid":{},"args":{{"name":"{}"}}}})",
+      name,
+      mPID,
+      tid,
+      EscapeJSON(value));
+  }
+
+  void Slice(
+    const Track track,
+    const std::string_view name,
+    const std::chrono::microseconds begin,
+    const std::chrono::microseconds duration,
+    const uint64_t frame) {
+    if (duration < std::chrono::microseconds::zero()) {
+      return;
+    }
+    this->BeginEvent();
+    std::print(
+      mOut,
+      R"({{"ph":"X","name":"{}","pid":{},"tid":{},"ts":{},"dur":{},)"
+      R"("args":{{"frame":{}}}}})",
+      name,
+      mPID,
+      std::to_underlying(track),
+      begin.count(),
+      duration.count(),
+      frame);
+  }
+
+  // Async slices may overlap; they're grouped by name, category, and ID
+  void AsyncSlice(
+    const std::string_view name,
+    const std::chrono::microseconds begin,
+    const std::chrono::microseconds duration,
+    const uint64_t id) {
+    if (duration < std::chrono::microseconds::zero()) {
+      return;
+    }
+    this->BeginEvent();
+    std::print(
+      mOut,
+      R"({{"ph":"b","cat":"{}","name":"{}","id":{},"pid":{},"ts":{},)"
+      R"("args":{{"frame":{}}}}})",
+      name,
+      name,
+      id,
+      mPID,
+      begin.count(),
+      id);
+    this->BeginEvent();
+    std::print(
+      mOut,
+      R"({{"ph":"e","cat":"{}","name":"{}","id":{},"pid":{},"ts":{}}})",
+      name,
+      name,
+      id,
+      mPID,
+      (begin + duration).count());
+  }
+
+  template <class T>
+  void Counter(
+    const std::string_view name,
+    const std::chrono::microseconds at,
+    const T value) {
+    this->BeginEvent();
+    std::print(
+      mOut,
+      R"({{"ph":"C","name":"{}","pid":{},"ts":{},"args":{{"value":{}}}}})",
+      name,
+      mPID,
+      at.count(),
+      value);
+  }
+
+ private:
+  std::FILE* mOut {};
+  uint32_t mPID {};
+  bool mFirstEvent {true};
+
+  void BeginEvent() {
+    std::print(mOut, "{}\n", mFirstEvent ? "" : ",");
+    mFirstEvent = false;
+  }
+};
+
+}// namespace
+
+int main(int argc, char** argv) {
+#if defined(_WIN32) && !defined(NDEBUG)
+  if (GetACP() != CP_UTF8) {
+    std::println(
+      stderr,
+      "BUILD ERROR: process code page should be forced to UTF-8 via manifest");
+    return EXIT_FAILURE;
+  }
+#endif
+  const auto startTime = std::chrono::steady_clock::now();
+
+  const auto args = ParseArguments(argc, argv);
+  if (!args) {
+    return args.error();
+  }
+
+  auto reader = BinaryLogReader::Create(args->mInput);
+  if (!reader) {
+    std::println(
+      stderr,
+      "Opening binary log failed: {}",
+      magic_enum::enum_name(reader.error().GetCode()));
+    return EXIT_FAILURE;
+  }
+
+  std::unique_ptr<std::FILE, decltype(&std::fclose)> outputFile {
+    nullptr, &std::fclose};
+  if (!args->mOutput.empty()) {
+#ifdef _WIN32
+    std::FILE* file {};
+    _wfopen_s(&file, args->mOutput.c_str(), L"wb");
+#else
+    const auto file = std::fopen(args->mOutput.c_str(), "wb");
+#endif
+    if (!file) {
+      std::println(
+        stderr, "Couldn't open output file `{}`", args->mOutput.string());
+      return EXIT_FAILURE;
+    }
+    outputFile.reset(file);
+  }
+  const auto out = outputFile ? outputFile.get() : stdout;
+  // Trace events are small, so avoid a write per event
+  setvbuf(out, nullptr, _IOFBF, 1024 * 1024);
+
+  const auto pcm = reader->GetPerformanceCounterMath();
+  const auto logStart = reader->GetClockCalibration().mQueryPerformanceCounter;
+  const auto toTraceTime = [&](const int64_t time) {
+    return pcm.ToDurationAllowNegative(logStart, time);
+  };
+
+  uint64_t frameCount {};
+  {
+    TraceWriter trace {out, reader->GetProcessID()};
+    trace.Metadata(
+      "process_name", 0, reader->GetExecutablePath().filename().string());
+    for (auto&& track: magic_enum::enum_values<Track>()) {
+      trace.Metadata(
+        "thread_name", std::to_underlying(track), GetTrackName(track));
+    }
+
+    while (const auto frame = reader->GetNextFrame()) {
+      const auto& core = frame->mCore;
+      if (!(core.mWaitFrameStart && core.mBeginFrameStart
+            && core.mEndFrameStop)) {
+        // Couldn't match xrEndFrame with xrWaitFrame; see MetricsAggregator
+        continue;
+      }
+      const auto index = frameCount++;
+
+      const auto slice = [&](
+                           const Track track,
+                           const int64_t begin,
+                           const int64_t end) {
+        trace.Slice(
+          track,
+          GetTrackName(track),
+          toTraceTime(begin),
+          pcm.ToDurationAllowNegative(begin, end),
+          index);
+      };
+      trace.AsyncSlice(
+        "Frame",
+        toTraceTime(core.mWaitFrameStart),
+        pcm.ToDurationAllowNegative(core.mWaitFrameStart, core.mEndFrameStop),
+        index);
+      slice(Track::WaitFrame, core.mWaitFrameStart, core.mWaitFrameStop);
+      slice(Track::AppCpu, core.mWaitFrameStop, core.mBeginFrameStart);
+      slice(Track::BeginFrame, core.mBeginFrameStart, core.mBeginFrameStop);
+      slice(Track::RenderCpu, core.mBeginFrameStop, core.mEndFrameStart);
+      slice(Track::EndFrame, core.mEndFrameStart, core.mEndFrameStop);
+
+      using Bits = FramePerformanceCounters::ValidDataBits;
+      const auto at = toTraceTime(core.mEndFrameStop);
+      if (std::to_underlying(frame->mValidDataBits & Bits::GpuTime)) {
+        trace.Counter("Render GPU (µs)", at, frame->mRenderGpu);
+      }
+      if (std::to_underlying(frame->mValidDataBits & Bits::NVAPI)) {
+        const auto& gpu = frame->mGpuPerformanceInformation;
+        trace.Counter("GPU graphics clock (MHz)", at, gpu.mGraphicsKHz / 1000);
+        trace.Counter("GPU memory clock (MHz)", at, gpu.mMemoryKHz / 1000);
+        trace.Counter("GPU P-State", at, gpu.mPState);
+        trace.Counter("GPU throttle reasons", at, gpu.mDecreaseReasons);
+      }
+    }
+  }
+
+  if (std::ferror(out) || std::fflush(out) != 0) {
+    std::println(stderr, "❌ writing trace failed");
+    return EXIT_FAILURE;
+  }
+
+  if (frameCount == 0) {
+    std::println(stderr, "❌ log doesn't contain any frames");
+    return EXIT_FAILURE;
+  }
+
+  const auto conversionTime
+    = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - startTime);
+  std::println(
+    stderr,
+    "✅ exported {} frames in {:.03f}s",
+    frameCount,
+    conversionTime.count() / 1000.0f);
+  return EXIT_SUCCESS;
+}
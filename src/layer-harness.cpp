@@ -0,0 +1,376 @@
+// Copyright 2024 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+
+#include <Windows.h>
+
+#include <algorithm>
+#include <deque>
+#include <expected>
+#include <fstream>
+#include <print>
+#include <ranges>
+#include <string>
+#include <vector>
+
+#include "LayerHarness.hpp"
+#include "SHM.hpp"
+#include "SHMReader.hpp"
+
+namespace {
+
+/* Script format
+ * =============
+ *
+ * One operation per line; `#` starts a comment.
+ *
+ * - `wait [RUNTIME_US] [@DISPLAY_TIME]`: call `xrWaitFrame()`; if a display
+ *   time is specified, it is used instead of the stub clock's
+ * - `begin [RUNTIME_US]`: call `xrBeginFrame()`
+ * - `end [RUNTIME_US] [@DISPLAY_TIME]`: call `xrEndFrame()`; by default, the
+ *   oldest display time returned by `wait` that hasn't yet been ended is used
+ * - `app US`: busy-wait, simulating app CPU time
+ *
+ * `RUNTIME_US` is how long the fake runtime should busy-wait inside the call.
+ *
+ * If no script is provided, each frame is `wait`, `begin`, `end`.
+ */
+struct Operation {
+  enum class Kind {
+    WaitFrame,
+    BeginFrame,
+    EndFrame,
+    App,
+  };
+  Kind mKind {};
+  std::chrono::microseconds mDuration {};
+  std::optional<XrTime> mDisplayTime;
+};
+
+struct Arguments {
+  std::vector<std::filesystem::path> mLayers;
+  std::filesystem::path mScript;
+  uint64_t mFrames {10000};
+  uint32_t mFPS {90};
+  bool mDumpSHM {false};
+};
+
+void ShowUsage(std::FILE* stream, std::string_view exe) {
+  std::println(
+    stream,
+    "USAGE: {} [--help] [--frames COUNT] [--fps HZ] [--script PATH] "
+    "[--dump-shm] LAYER_DLL...\n\n"
+    "  --frames COUNT\n\n"
+    "    number of frames to run, or number of times to run the script; "
+    "default 10000\n\n"
+    "  --fps HZ\n\n"
+    "    display period of the stub clock; default 90\n\n"
+    "  --script PATH\n\n"
+    "    run the operations in PATH for each frame, instead of\n"
+    "    wait/begin/end\n\n"
+    "  --dump-shm\n\n"
+    "    print the frames core_metrics published to shared memory",
+    std::filesystem::path {exe}.stem().string());
+}
+
+std::optional<std::vector<Operation>> ParseScript(
+  const std::filesystem::path& path) {
+  std::ifstream f(path);
+  if (!f) {
+    std::println(stderr, "Couldn't open script `{}`", path.string());
+    return std::nullopt;
+  }
+
+  std::vector<Operation> ret;
+  std::string line;
+  for (size_t lineNumber = 1; std::getline(f, line); ++lineNumber) {
+    if (const auto comment = line.find('#'); comment != std::string::npos) {
+      line.erase(comment);
+    }
+    auto words = line | std::views::split(' ')
+      | std::views::filter([](auto&& it) { return !std::ranges::empty(it); })
+      | std::views::transform(
+                   [](auto&& it) { return std::string(it.begin(), it.end()); })
+      | std::ranges::to<std::vector>();
+    if (words.empty()) {
+      continue;
+    }
+
+    Operation op;
+    using enum Operation::Kind;
+    const auto& verb = words.front();
+    if (verb == "wait") {
+      op.mKind = WaitFrame;
+    } else if (verb == "begin") {
+      op.mKind = BeginFrame;
+    } else if (verb == "end") {
+      op.mKind = EndFrame;
+    } else if (verb == "app") {
+      op.mKind = App;
+    } else {
+      std::println(
+        stderr, "{}:{}: unknown operation `{}`", path.string(), lineNumber, verb);
+      return std::nullopt;
+    }
+
+    try {
+      for (auto&& word: words | std::views::drop(1)) {
+        if (word.starts_with('@')) {
+          if (op.mKind != WaitFrame && op.mKind != EndFrame) {
+            std::println(
+              stderr,
+              "{}:{}: `{}` does not take a display time",
+              path.string(),
+              lineNumber,
+              verb);
+            return std::nullopt;
+          }
+          op.mDisplayTime = std::stoll(word.substr(1));
+          continue;
+        }
+        op.mDuration = std::chrono::microseconds {std::stoll(word)};
+      }
+    } catch (const std::logic_error&) {
+      std::println(
+        stderr, "{}:{}: invalid number in `{}`", path.string(), lineNumber, line);
+      return std::nullopt;
+    }
+    ret.push_back(op);
+  }
+  return ret;
+}
+
+[[nodiscard]]
+std::expected<Arguments, int> ParseArguments(int argc, char* argv[]) {
+  Arguments ret;
+  const std::string_view thisExe {argv[0]};
+
+  const auto parseNumber
+    = [&](size_t& i, std::string_view name, auto& out) -> bool {
+    ++i;
+    if (i >= argc) {
+      std::println(stderr, "{} requires a value", name);
+      return false;
+    }
+    try {
+      const auto value = std::stoll(argv[i]);
+      if (value < 1) {
+        std::println(stderr, "{} value must be at least 1", name);
+        return false;
+      }
+      out = static_cast<std::decay_t<decltype(out)>>(value);
+      return true;
+    } catch (...) {
+      std::println(stderr, "{} value must be a number", name);
+      return false;
+    }
+  };
+
+  bool parse = true;// set to false after seeing `--` by itself
+  for (size_t i = 1; i < argc; ++i) {
+    const std::string_view arg {argv[i]};
+    if (parse && arg == "--help") {
+      ShowUsage(stdout, thisExe);
+      return std::unexpected {EXIT_SUCCESS};
+    }
+    if (parse && arg == "--frames") {
+      if (!parseNumber(i, arg, ret.mFrames)) {
+        return std::unexpected {EXIT_FAILURE};
+      }
+      continue;
+    }
+    if (parse && arg == "--fps") {
+      if (!parseNumber(i, arg, ret.mFPS)) {
+        return std::unexpected {EXIT_FAILURE};
+      }
+      continue;
+    }
+    if (parse && arg == "--script") {
+      ++i;
+      if (i >= argc) {
+        std::println(stderr, "--script requires a value");
+        return std::unexpected {EXIT_FAILURE};
+      }
+      ret.mScript = {argv[i]};
+      continue;
+    }
+    if (parse && arg == "--dump-shm") {
+      ret.mDumpSHM = true;
+      continue;
+    }
+    if (parse && arg == "--") {
+      parse = false;
+      continue;
+    }
+    if (parse && arg.starts_with("-")) {
+      ShowUsage(stderr, thisExe);
+      return std::unexpected {EXIT_FAILURE};
+    }
+
+    const std::filesystem::path path {arg};
+    if (!std::filesystem::is_regular_file(path)) {
+      std::println(stderr, "`{}` is not a regular file", arg);
+      return std::unexpected {EXIT_FAILURE};
+    }
+    ret.mLayers.push_back(std::filesystem::absolute(path));
+  }
+
+  if (ret.mLayers.empty()) {
+    ShowUsage(stderr, thisExe);
+    return std::unexpected {EXIT_FAILURE};
+  }
+
+  return ret;
+}
+
+class CallStats {
+ public:
+  void Push(const LayerHarness::CallTiming& timing) {
+    mOverheads.push_back(timing.GetLayerOverhead());
+  }
+
+  void Print(std::string_view name) {
+    if (mOverheads.empty()) {
+      std::println("{:12} no calls", name);
+      return;
+    }
+    std::ranges::sort(mOverheads);
+    const auto percentile = [this](const double p) {
+      const auto index = static_cast<size_t>(p * (mOverheads.size() - 1));
+      return mOverheads.at(index).count();
+    };
+    const auto total = std::ranges::fold_left(
+      mOverheads, std::chrono::nanoseconds {}, std::plus {});
+    std::println(
+      "{:12} {:>10} calls; layer overhead mean {:>8}ns, p50 {:>8}ns, "
+      "p99 {:>8}ns, max {:>8}ns",
+      name,
+      mOverheads.size(),
+      total.count() / static_cast<int64_t>(mOverheads.size()),
+      percentile(0.5),
+      percentile(0.99),
+      mOverheads.back().count());
+  }
+
+ private:
+  std::vector<std::chrono::nanoseconds> mOverheads;
+};
+
+void DumpSHM() {
+  SHMReader shm;
+  if (!shm.IsValid()) {
+    std::println(stderr, "Shared memory is not available");
+    return;
+  }
+  const auto frameCount = shm->mFrameCount;
+  const auto first = frameCount > SHM::MaxFrameCount
+    ? frameCount - SHM::MaxFrameCount
+    : 0;
+  // One line per frame, with a flag for each matched call; this is
+  // deterministic, so it can be compared against expected output
+  for (auto i = first; i < frameCount; ++i) {
+    const auto& core = shm->GetFramePerformanceCounters(i).mCore;
+    std::println(
+      "{}\t{}{}{}",
+      core.mXrDisplayTime,
+      core.mWaitFrameStart ? 'W' : '-',
+      core.mBeginFrameStart ? 'B' : '-',
+      core.mEndFrameStart ? 'E' : '-');
+  }
+}
+
+}// namespace
+
+int main(int argc, char** argv) {
+  const auto args = ParseArguments(argc, argv);
+  if (!args) {
+    return args.error();
+  }
+
+  std::vector<Operation> script;
+  if (args->mScript.empty()) {
+    using enum Operation::Kind;
+    script = {{WaitFrame}, {BeginFrame}, {EndFrame}};
+  } else if (auto parsed = ParseScript(args->mScript)) {
+    script = std::move(parsed).value();
+  } else {
+    return EXIT_FAILURE;
+  }
+
+  try {
+    LayerHarness harness(args->mLayers);
+    harness.SetDisplayPeriod(1'000'000'000 / args->mFPS);
+
+    CallStats waitStats;
+    CallStats beginStats;
+    CallStats endStats;
+    uint64_t failedCalls {};
+    std::deque<XrTime> waitedDisplayTimes;
+
+    const auto startTime = std::chrono::steady_clock::now();
+    for (uint64_t frame = 0; frame < args->mFrames; ++frame) {
+      for (auto&& op: script) {
+        LayerHarness::CallTiming timing {};
+        XrResult result {XR_SUCCESS};
+        using enum Operation::Kind;
+        switch (op.mKind) {
+          case WaitFrame: {
+            if (op.mDisplayTime) {
+              harness.SetNextPredictedDisplayTime(*op.mDisplayTime);
+            }
+            XrTime displayTime {};
+            result = harness.WaitFrame(op.mDuration, &displayTime, &timing);
+            waitedDisplayTimes.push_back(displayTime);
+            waitStats.Push(timing);
+            break;
+          }
+          case BeginFrame:
+            result = harness.BeginFrame(op.mDuration, &timing);
+            beginStats.Push(timing);
+            break;
+          case EndFrame: {
+            XrTime displayTime {};
+            if (op.mDisplayTime) {
+              displayTime = *op.mDisplayTime;
+            } else if (!waitedDisplayTimes.empty()) {
+              displayTime = waitedDisplayTimes.front();
+              waitedDisplayTimes.pop_front();
+            }
+            result = harness.EndFrame(op.mDuration, displayTime, &timing);
+            endStats.Push(timing);
+            break;
+          }
+          case App:
+            LayerHarness::Spin(op.mDuration);
+            break;
+        }
+        if (XR_FAILED(result)) {
+          ++failedCalls;
+        }
+      }
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - startTime;
+    const auto seconds
+      = std::chrono::duration_cast<std::chrono::duration<double>>(elapsed)
+          .count();
+
+    std::println(
+      "Ran {} iterations in {:.03f}s ({:.0f} per second)",
+      args->mFrames,
+      seconds,
+      args->mFrames / seconds);
+    waitStats.Print("xrWaitFrame");
+    beginStats.Print("xrBeginFrame");
+    endStats.Print("xrEndFrame");
+    if (failedCalls) {
+      std::println(stderr, "❌ {} calls failed", failedCalls);
+    }
+
+    if (args->mDumpSHM) {
+      DumpSHM();
+    }
+    return failedCalls ? EXIT_FAILURE : EXIT_SUCCESS;
+  } catch (const std::exception& e) {
+    std::println(stderr, "❌ {}", e.what());
+    return EXIT_FAILURE;
+  }
+}
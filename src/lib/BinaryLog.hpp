@@ -2,10 +2,18 @@
 // SPDX-License-Identifier: MIT
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <format>
 #include <stdexcept>
+#include <string_view>
+#include <type_traits>
 
+#include "FrameMetrics.hpp"
 #include "FramePerformanceCounters.hpp"
 
 namespace BinaryLog {
@@ -14,15 +22,15 @@ namespace BinaryLog {
  *
  * The binary log contains:
  * 1. a human-readable header
- * 2. a `LARGE_INTEGER` (int64_t) containing the result of
- *   `QueryPerformanceFrequency()`
- * 3. a `LARGE_INTEGER` (int64_t) containing the result of
- *   `QueryPerformanceCounter()`
+ * 2. an `int64_t` containing the result of `QueryPerformanceFrequency()`
+ * 3. an `int64_t` containing the result of `QueryPerformanceCounter()`
  * 4. a `uint64_t` containing the number of microseconds since
  *   1970-01-01 00:00:00Z.
- * 5. a contiguous stream of `PacketHeader` structs followed by a
+ * 5. a `LoggingPolicy` packet
+ * 6. a `SessionInfo` packet
+ * 7. a contiguous stream of `PacketHeader` structs followed by a
  *   variable-length packet data
- * 6. optionally, a file footer, followed by `FileFooter::Magic`
+ * 8. optionally, a file footer, followed by `FileFooter::Magic`
  *
  * There is no separator between sections or between
  * packets.
@@ -52,34 +60,38 @@ namespace BinaryLog {
  * HUMAN_READABLE_APP_NAME_AND_VERSION should not be parsed or validated by
  * any readers - it is purely for debugging
  */
-static constexpr auto Version = "2025-06-05#02";
+static constexpr auto Version = "2026-10-18#01";
 static constexpr auto Magic = "XRFrameTools binary log";
+// Readers also accept this version. It has no `LoggingPolicy` or `SessionInfo`
+// packets, and uses `ProcessInfo` instead of `CompactProcessInfo`
+static constexpr auto PreviousVersion = "2025-06-05#02";
 
-inline auto GetVersionLine() noexcept {
-  return std::format(
-    "BLv{}/FPCv{}", BinaryLog::Version, FramePerformanceCounters::Version);
+inline auto GetVersionLine(
+  const std::string_view version = BinaryLog::Version) noexcept {
+  return std::format("BLv{}/FPCv{}", version, FramePerformanceCounters::Version);
 }
 
 struct FileHeader {
-  LARGE_INTEGER mQueryPerformanceFrequency {};
-  LARGE_INTEGER mQueryPerformanceCounter {};
+  int64_t mQueryPerformanceFrequency {};
+  int64_t mQueryPerformanceCounter {};
   uint64_t mMicrosecondsSinceEpoch {};
   uint32_t mProcessID {};
   uint32_t mReserved {/* make struct identical on 32-bit and 64-bit builds */};
 
-  static FileHeader Now() {
+  // Only available in `BinaryLogWriter`, as it needs the Windows APIs
+  static FileHeader Now();
+
+  // For logs that weren't recorded, e.g. synthetic logs for benchmarks
+  static FileHeader Create(
+    const int64_t queryPerformanceFrequency,
+    const int64_t queryPerformanceCounter,
+    const uint64_t microsecondsSinceEpoch,
+    const uint32_t processID) {
     FileHeader ret {};
-    QueryPerformanceFrequency(&ret.mQueryPerformanceFrequency);
-    QueryPerformanceCounter(&ret.mQueryPerformanceCounter);
-    ret.mProcessID = GetCurrentProcessId();
-
-    static_assert(
-      __cpp_lib_chrono >= 201907L,
-      "Need std::chrono::system_clock to be guaranteed to use the Unix epoch");
-    ret.mMicrosecondsSinceEpoch
-      = duration_cast<std::chrono::microseconds>(
-          std::chrono::system_clock::now().time_since_epoch())
-          .count();
+    ret.mQueryPerformanceFrequency = queryPerformanceFrequency;
+    ret.mQueryPerformanceCounter = queryPerformanceCounter;
+    ret.mMicrosecondsSinceEpoch = microsecondsSinceEpoch;
+    ret.mProcessID = processID;
     return ret;
   }
 
@@ -104,15 +116,21 @@ struct FileFooter {
 
   uint64_t mFrameCount {};
   uint64_t mValidDataBits {};
-  LARGE_INTEGER mFirstEndFrameTime {};
-  LARGE_INTEGER mLastEndFrameTime {};
+  int64_t mFirstEndFrameTime {};
+  int64_t mLastEndFrameTime {};
   uint32_t mMaxEncoderSessionCount {};
-  uint32_t mReserved {};// force 64-bit size on 32-bit builds
+  // Frames lost because the writer's ring buffer overflowed; this was
+  // reserved padding in older versions, so was always 0
+  uint32_t mDroppedFrameCount {};
 
-  void Update(const FramePerformanceCounters& fpc) {
-    ++mFrameCount;
+  // `representedFrames` is more than 1 if the logging policy skipped frames;
+  // `mFrameCount` includes frames that were not written
+  void Update(
+    const FramePerformanceCounters& fpc,
+    const uint64_t representedFrames = 1) {
+    mFrameCount += representedFrames;
     mValidDataBits |= fpc.mValidDataBits;
-    if (!mFirstEndFrameTime.QuadPart) {
+    if (!mFirstEndFrameTime) {
       mFirstEndFrameTime = fpc.mCore.mEndFrameStart;
     }
     mLastEndFrameTime = fpc.mCore.mEndFrameStart;
@@ -133,8 +151,16 @@ struct PacketHeader {
     VRAM,
     NVAPI,
     NVEncSession,
-    ProcessInfo,
+    ProcessInfo,// Only in older logs; replaced by CompactProcessInfo
     FileFooter,
+    CompactProcessInfo,
+    LoggingPolicy,
+    RepresentedFrames,
+    FrameSummary,
+    SessionInfo,
+    // Only written when the sample differs from the previously-written one
+    HostCpu,
+    ProcessResources,
   };
   PacketType mType {};
   uint32_t mSize {};
@@ -148,10 +174,136 @@ struct PacketHeader {
 };
 static_assert(sizeof(PacketHeader) == 8);
 
+// Written by versions before 2026-10-18#01; readers should still accept it,
+// but writers should use `CompactProcessInfo`
 struct ProcessInfo {
-  wchar_t mPath[64 * 1024] {};
+  // UTF-16, as `wchar_t` is only 16 bits on Windows
+  char16_t mPath[64 * 1024] {};
   uint32_t mPathLength {};
   uint32_t mProcessID {};
 };
 static_assert(sizeof(ProcessInfo) == 131080);
+
+/* Followed by `mPathByteCount` bytes of UTF-8, without a trailing null.
+ *
+ * The `PacketHeader::mSize` is `sizeof(CompactProcessInfo) + mPathByteCount`.
+ *
+ * Written some time after the first frame that references the process. If a
+ * PID is reused by another process, it is written again, and the most recent
+ * packet applies.
+ *
+ * When a log is rotated, processes that were still being looked up are only
+ * written to the next segment.
+ */
+struct CompactProcessInfo {
+  // Windows paths are at most 32767 UTF-16 code units, each of which is at
+  // most 3 bytes of UTF-8; readers reject larger paths
+  static constexpr uint32_t MaxPathByteCount = 32767 * 3;
+
+  uint32_t mProcessID {};
+  uint32_t mPathByteCount {};
+};
+static_assert(sizeof(CompactProcessInfo) == 8);
+
+/* How the writer chose which frames to log.
+ *
+ * Always the first packet after the binary header; if a frame was written
+ * in place of others, it is followed by a `RepresentedFrames` packet.
+ */
+struct LoggingPolicy {
+  enum class Kind : uint32_t {
+    // Every frame
+    Full = 0,
+    // One frame in every `mInterval`
+    EveryNthFrame,
+    // One frame in every `mInterval`, followed by a `FrameSummary` packet
+    // aggregating all of them
+    Aggregated,
+    // As `EveryNthFrame`, but every frame is written while the frame interval
+    // or GPU time differs from a running baseline by more than
+    // `mAdaptiveThresholdPercent`
+    Adaptive,
+  };
+
+  Kind mKind {Kind::Full};
+  uint32_t mInterval {1};
+  uint32_t mAdaptiveThresholdPercent {};
+  uint32_t mReserved {};
+
+  bool operator==(const LoggingPolicy&) const noexcept = default;
+};
+static_assert(sizeof(LoggingPolicy) == 16);
+
+// Number of frames, including this one, that this frame was written in
+// place of
+struct RepresentedFrames {
+  uint64_t mFrameCount {};
+};
+static_assert(sizeof(RepresentedFrames) == 8);
+
+/* Aggregate of the frames represented by the frame it is written with.
+ *
+ * This is the on-disk form of `FrameMetrics`; durations are in microseconds.
+ */
+struct FrameSummary {
+  uint32_t mFrameCount {};
+  uint32_t mReserved0 {};
+  int64_t mSincePreviousFrame {};
+  int64_t mSinceFirstFrame {};
+  uint64_t mLastXrDisplayTime {};
+  int64_t mLastEndFrameStop {};
+
+  uint64_t mValidDataBits {};
+
+  int64_t mWaitFrameCpu {};
+  int64_t mBeginFrameCpu {};
+  int64_t mEndFrameCpu {};
+  int64_t mRenderCpu {};
+  int64_t mAppCpu {};
+  int64_t mRenderGpu {};
+
+  FramePerformanceCounters::VideoMemoryInfo mVideoMemoryInfo {};
+
+  uint32_t mGpuPerformanceDecreaseReasons {};
+  uint32_t mGpuPStateMin {};
+  uint32_t mGpuPStateMax {};
+  uint32_t mGpuGraphicsKHzMin {};
+  uint32_t mGpuGraphicsKHzMax {};
+  uint32_t mGpuMemoryKHzMin {};
+  uint32_t mGpuMemoryKHzMax {};
+
+  FramePerformanceCounters::EncoderInfo mEncoders {};
+
+  int64_t mDisplayPeriod {};
+  int64_t mJitter {};
+  uint32_t mLateFrameCount {};
+  uint32_t mSkippedSlots {};
+  uint32_t mRepeatedSlots {};
+  uint32_t mReserved1 {};
+
+  // Indexed by `FrameBottleneck`
+  std::array<uint32_t, 5> mBottleneckFrameCounts {};
+  uint32_t mReserved2 {};
+
+  FrameMetrics::HostCpu mHostCpu {};
+  FrameMetrics::ProcessResources mProcessResources {};
+};
+static_assert(FrameBottleneckCount == 5);
+static_assert(sizeof(FrameSummary) == 336);
+// No implicit padding, so the layout is the same in every build
+static_assert(std::has_unique_object_representations_v<FrameSummary>);
+
+/* Identifies files that were written by the same logger.
+ *
+ * Always follows the `LoggingPolicy` packet. When a log is rotated, each
+ * segment is a complete log with the same `mSessionID`, and the next
+ * `mSegmentIndex`.
+ */
+struct SessionInfo {
+  // A `GUID`
+  std::array<uint8_t, 16> mSessionID {};
+  uint32_t mSegmentIndex {};
+  uint32_t mReserved {};
+};
+static_assert(sizeof(SessionInfo) == 24);
 };// namespace BinaryLog
\ No newline at end of file
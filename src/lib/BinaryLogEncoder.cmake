@@ -0,0 +1,15 @@
+include_guard(DIRECTORY)
+
+include(FrameMetrics.cmake)
+
+add_library(
+  BinaryLogEncoder
+  STATIC
+  BinaryLog.hpp
+  BinaryLogEncoder.cpp BinaryLogEncoder.hpp
+)
+target_link_libraries(
+  BinaryLogEncoder
+  PUBLIC
+  FrameMetrics
+)
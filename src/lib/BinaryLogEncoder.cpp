@@ -0,0 +1,177 @@
+// Copyright 2024 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+
+#include "BinaryLogEncoder.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <format>
+
+namespace {
+template <class T>
+void Append(std::string& out, const T& data) {
+  out.append(reinterpret_cast<const char*>(&data), sizeof(T));
+}
+
+BinaryLog::FrameSummary ToSummary(const FrameMetrics& in) noexcept {
+  return {
+    .mFrameCount = in.mFrameCount,
+    .mSincePreviousFrame = in.mSincePreviousFrame.count(),
+    .mSinceFirstFrame = in.mSinceFirstFrame.count(),
+    .mLastXrDisplayTime = in.mLastXrDisplayTime,
+    .mLastEndFrameStop = in.mLastEndFrameStop,
+    .mValidDataBits = in.mValidDataBits,
+    .mWaitFrameCpu = in.mWaitFrameCpu.count(),
+    .mBeginFrameCpu = in.mBeginFrameCpu.count(),
+    .mEndFrameCpu = in.mEndFrameCpu.count(),
+    .mRenderCpu = in.mRenderCpu.count(),
+    .mAppCpu = in.mAppCpu.count(),
+    .mRenderGpu = in.mRenderGpu.count(),
+    .mVideoMemoryInfo = in.mVideoMemoryInfo,
+    .mGpuPerformanceDecreaseReasons = in.mGpuPerformanceDecreaseReasons,
+    .mGpuPStateMin = in.mGpuPStateMin,
+    .mGpuPStateMax = in.mGpuPStateMax,
+    .mGpuGraphicsKHzMin = in.mGpuGraphicsKHzMin,
+    .mGpuGraphicsKHzMax = in.mGpuGraphicsKHzMax,
+    .mGpuMemoryKHzMin = in.mGpuMemoryKHzMin,
+    .mGpuMemoryKHzMax = in.mGpuMemoryKHzMax,
+    .mEncoders = in.mEncoders,
+    .mDisplayPeriod = in.mPacing.mDisplayPeriod.count(),
+    .mJitter = in.mPacing.mJitter.count(),
+    .mLateFrameCount = in.mPacing.mLateFrameCount,
+    .mSkippedSlots = in.mPacing.mSkippedSlots,
+    .mRepeatedSlots = in.mPacing.mRepeatedSlots,
+    .mBottleneckFrameCounts = in.mBottleneckFrameCounts,
+    .mHostCpu = in.mHostCpu,
+    .mProcessResources = in.mProcessResources,
+  };
+}
+}// namespace
+
+std::string BinaryLogEncoder::EncodeHeader(
+  const TextHeader& text,
+  const BinaryLog::FileHeader& binaryHeader,
+  const BinaryLog::LoggingPolicy& policy,
+  const BinaryLog::SessionInfo& session) {
+  using namespace BinaryLog;
+
+  auto ret = std::format(
+    "{}\n{}\nProduced by: {}\n{}\nuncompressed\n",
+    Magic,
+    GetVersionLine(),
+    text.mProducedBy,
+    text.mExecutablePath);
+  Append(ret, binaryHeader);
+  Append(
+    ret,
+    PacketHeader {PacketHeader::PacketType::LoggingPolicy, sizeof(policy)});
+  Append(ret, policy);
+  Append(
+    ret,
+    PacketHeader {PacketHeader::PacketType::SessionInfo, sizeof(session)});
+  Append(ret, session);
+  return ret;
+}
+
+std::string BinaryLogEncoder::EncodeProcess(
+  const uint32_t processID,
+  const std::u8string_view path) {
+  using namespace BinaryLog;
+  const CompactProcessInfo packet {
+    .mProcessID = processID,
+    .mPathByteCount = static_cast<uint32_t>(path.size()),
+  };
+  std::string ret;
+  ret.reserve(sizeof(PacketHeader) + sizeof(packet) + path.size());
+  Append(
+    ret,
+    PacketHeader {
+      PacketHeader::PacketType::CompactProcessInfo,
+      static_cast<uint32_t>(sizeof(packet) + path.size()),
+    });
+  Append(ret, packet);
+  ret.append(reinterpret_cast<const char*>(path.data()), path.size());
+  return ret;
+}
+
+std::string BinaryLogEncoder::EncodeFooter(
+  const BinaryLog::FileFooter& footer) {
+  using namespace BinaryLog;
+  std::string ret;
+  Append(
+    ret, PacketHeader {PacketHeader::PacketType::FileFooter, sizeof(footer)});
+  Append(ret, footer);
+  Append(ret, FileFooter::TrailingMagic);
+  return ret;
+}
+
+template <class T>
+void BinaryLogEncoder::AppendPacket(
+  const BinaryLog::PacketHeader::PacketType kind,
+  const T& payload) noexcept {
+  const BinaryLog::PacketHeader header {kind, sizeof(T)};
+  memcpy(&mBuffer[mSize], &header, sizeof(header));
+  mSize += sizeof(header);
+  memcpy(&mBuffer[mSize], &payload, sizeof(T));
+  mSize += sizeof(T);
+}
+
+std::span<const char> BinaryLogEncoder::EncodeFrame(
+  const FramePerformanceCounters& fpc,
+  const uint64_t representedFrames,
+  const std::optional<FrameMetrics>& summary) noexcept {
+  using FPC = FramePerformanceCounters;
+  using PT = BinaryLog::PacketHeader::PacketType;
+
+  const auto hasData = [bits = fpc.mValidDataBits](const FPC::ValidDataBits b) {
+    return (bits & b) == b;
+  };
+
+  mSize = 0;
+  this->AppendPacket(PT::Core, fpc.mCore);
+  if (representedFrames != 1) {
+    this->AppendPacket(
+      PT::RepresentedFrames, BinaryLog::RepresentedFrames {representedFrames});
+  }
+  if (summary) {
+    this->AppendPacket(PT::FrameSummary, ToSummary(*summary));
+  }
+  if (hasData(FPC::ValidDataBits::GpuTime)) {
+    this->AppendPacket(PT::GpuTime, fpc.mRenderGpu);
+  }
+  if (hasData(FPC::ValidDataBits::VRAM)) {
+    this->AppendPacket(PT::VRAM, fpc.mVideoMemoryInfo);
+  }
+  if (hasData(FPC::ValidDataBits::NVAPI)) {
+    this->AppendPacket(PT::NVAPI, fpc.mGpuPerformanceInformation);
+  }
+  if (hasData(FPC::ValidDataBits::NVEnc)) {
+    const auto count = std::min<size_t>(
+      fpc.mEncoders.mSessionCount, fpc.mEncoders.mSessions.size());
+    for (auto&& session: std::span {fpc.mEncoders.mSessions}.first(count)) {
+      this->AppendPacket(PT::NVEncSession, session);
+    }
+  }
+
+  // Sampled much less often than frames are produced, so only write each
+  // sample once
+  if (
+    hasData(FPC::ValidDataBits::HostCpu)
+    && fpc.mHostCpu.mSampleTime != mLastHostCpuSampleTime) {
+    this->AppendPacket(PT::HostCpu, fpc.mHostCpu);
+    mLastHostCpuSampleTime = fpc.mHostCpu.mSampleTime;
+  }
+  if (
+    hasData(FPC::ValidDataBits::ProcessResources)
+    && fpc.mProcessResources.mSampleTime != mLastProcessResourcesSampleTime) {
+    this->AppendPacket(PT::ProcessResources, fpc.mProcessResources);
+    mLastProcessResourcesSampleTime = fpc.mProcessResources.mSampleTime;
+  }
+
+  return std::span {mBuffer}.first(mSize);
+}
+
+void BinaryLogEncoder::Reset() noexcept {
+  mLastHostCpuSampleTime = {};
+  mLastProcessResourcesSampleTime = {};
+}
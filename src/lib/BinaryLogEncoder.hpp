@@ -0,0 +1,79 @@
+// Copyright 2024 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+
+#include "BinaryLog.hpp"
+#include "FrameMetrics.hpp"
+#include "FramePerformanceCounters.hpp"
+
+/** Encodes binary log data, without doing any I/O.
+ *
+ * This is the part of `BinaryLogWriter` that doesn't need the Windows APIs, so
+ * that logs can also be produced by other tools - e.g. synthetic logs for
+ * benchmarks - and so that encoding can be measured on its own.
+ */
+class BinaryLogEncoder final {
+ public:
+  struct TextHeader {
+    // Only for debugging, e.g. `XRFrameTools v1.2.3`
+    std::string_view mProducedBy;
+    // UTF-8
+    std::string_view mExecutablePath;
+  };
+
+  // Every packet for a frame; each payload is a member of
+  // `FramePerformanceCounters`, apart from `RepresentedFrames` and the summary
+  static constexpr size_t MaxFrameBytes
+    = (sizeof(BinaryLog::PacketHeader) * 12) + sizeof(FramePerformanceCounters)
+    + sizeof(BinaryLog::RepresentedFrames) + sizeof(BinaryLog::FrameSummary);
+
+  /// Everything before the first frame
+  [[nodiscard]]
+  static std::string EncodeHeader(
+    const TextHeader&,
+    const BinaryLog::FileHeader&,
+    const BinaryLog::LoggingPolicy&,
+    const BinaryLog::SessionInfo&);
+
+  /// A `CompactProcessInfo` packet
+  [[nodiscard]]
+  static std::string EncodeProcess(uint32_t processID, std::u8string_view path);
+
+  /// The footer packet, followed by `FileFooter::TrailingMagic`
+  [[nodiscard]]
+  static std::string EncodeFooter(const BinaryLog::FileFooter&);
+
+  /** Every packet for a frame.
+   *
+   * `representedFrames` and `summary` are from the logging policy.
+   *
+   * `HostMetrics` samples are only encoded if they differ from the previous
+   * frame's; call `Reset()` when starting a new file.
+   *
+   * The result is valid until the next call.
+   */
+  [[nodiscard]]
+  std::span<const char> EncodeFrame(
+    const FramePerformanceCounters&,
+    uint64_t representedFrames = 1,
+    const std::optional<FrameMetrics>& summary = std::nullopt) noexcept;
+
+  void Reset() noexcept;
+
+ private:
+  std::array<char, MaxFrameBytes> mBuffer {};
+  size_t mSize {};
+
+  int64_t mLastHostCpuSampleTime {};
+  int64_t mLastProcessResourcesSampleTime {};
+
+  template <class T>
+  void AppendPacket(BinaryLog::PacketHeader::PacketType, const T&) noexcept;
+};
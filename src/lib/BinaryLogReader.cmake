@@ -1,5 +1,7 @@
 include_guard(DIRECTORY)
 
+include(PlatformFile.cmake)
+
 add_library(
   BinaryLogReader
   STATIC
@@ -9,7 +11,7 @@ add_library(
 target_link_libraries(
   BinaryLogReader
   PUBLIC
-  WIL::WIL
+  PlatformFile
   PRIVATE
   PerformanceCounters
 )
@@ -3,12 +3,74 @@
 
 #include "BinaryLogReader.hpp"
 
-#include <wil/filesystem.h>
-
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <limits>
 #include <magic_enum.hpp>
+#include <memory>
+#include <mutex>
+#include <string_view>
 
 #include "BinaryLog.hpp"
-#include "Win32Utils.hpp"
+#include "DebugPrint.hpp"
+
+namespace {
+// As `wil::scope_exit()`, which is Windows-only
+template <class F>
+class ScopeExit final {
+ public:
+  explicit ScopeExit(F&& f) : mFunction(std::move(f)) {
+  }
+  ScopeExit(const ScopeExit&) = delete;
+  ScopeExit& operator=(const ScopeExit&) = delete;
+
+  ~ScopeExit() {
+    mFunction();
+  }
+
+ private:
+  F mFunction;
+};
+
+FrameMetrics FromSummary(const BinaryLog::FrameSummary& in) noexcept {
+  using std::chrono::microseconds;
+  return {
+    .mFrameCount = static_cast<uint16_t>(std::min<uint32_t>(
+      in.mFrameCount, std::numeric_limits<uint16_t>::max())),
+    .mSincePreviousFrame = microseconds {in.mSincePreviousFrame},
+    .mSinceFirstFrame = microseconds {in.mSinceFirstFrame},
+    .mLastXrDisplayTime = in.mLastXrDisplayTime,
+    .mLastEndFrameStop = in.mLastEndFrameStop,
+    .mValidDataBits = in.mValidDataBits,
+    .mWaitFrameCpu = microseconds {in.mWaitFrameCpu},
+    .mBeginFrameCpu = microseconds {in.mBeginFrameCpu},
+    .mEndFrameCpu = microseconds {in.mEndFrameCpu},
+    .mRenderCpu = microseconds {in.mRenderCpu},
+    .mAppCpu = microseconds {in.mAppCpu},
+    .mRenderGpu = microseconds {in.mRenderGpu},
+    .mVideoMemoryInfo = in.mVideoMemoryInfo,
+    .mGpuPerformanceDecreaseReasons = in.mGpuPerformanceDecreaseReasons,
+    .mGpuPStateMin = in.mGpuPStateMin,
+    .mGpuPStateMax = in.mGpuPStateMax,
+    .mGpuGraphicsKHzMin = in.mGpuGraphicsKHzMin,
+    .mGpuGraphicsKHzMax = in.mGpuGraphicsKHzMax,
+    .mGpuMemoryKHzMin = in.mGpuMemoryKHzMin,
+    .mGpuMemoryKHzMax = in.mGpuMemoryKHzMax,
+    .mEncoders = in.mEncoders,
+    .mPacing = {
+      .mDisplayPeriod = microseconds {in.mDisplayPeriod},
+      .mJitter = microseconds {in.mJitter},
+      .mLateFrameCount = in.mLateFrameCount,
+      .mSkippedSlots = in.mSkippedSlots,
+      .mRepeatedSlots = in.mRepeatedSlots,
+    },
+    .mBottleneckFrameCounts = in.mBottleneckFrameCounts,
+    .mHostCpu = in.mHostCpu,
+    .mProcessResources = in.mProcessResources,
+  };
+}
+}// namespace
 
 using OpenError = BinaryLogReader::OpenError;
 
@@ -16,8 +78,8 @@ OpenError::OpenError(Code code, decltype(mDetails)&& details)
   : mCode(code), mDetails(std::move(details)) {
 }
 
-OpenError OpenError::FailedToOpenFile(HRESULT result) {
-  return {Code::FailedToOpenFile, result};
+OpenError OpenError::FailedToOpenFile(const std::error_code& error) {
+  return {Code::FailedToOpenFile, error};
 }
 
 OpenError OpenError::BadMagic(
@@ -42,46 +104,40 @@ OpenError OpenError::UnsupportedCompression(const std::string& actual) {
 
 BinaryLogReader::BinaryLogReader(
   const std::filesystem::path& logFilePath,
-  wil::unique_hfile file,
+  PlatformFile file,
   const std::filesystem::path& executable,
   uint32_t processID,
   PerformanceCounterMath pcm,
-  ClockCalibration cc)
+  ClockCalibration cc,
+  const BinaryLog::LoggingPolicy& loggingPolicy,
+  const std::optional<BinaryLog::SessionInfo>& sessionInfo)
   : mLogFilePath(logFilePath),
     mFile(std::move(file)),
     mExecutable(executable),
     mProcessID(processID),
     mPerformanceCounterMath(pcm),
-    mClockCalibration(cc) {
+    mClockCalibration(cc),
+    mLoggingPolicy(loggingPolicy),
+    mSessionInfo(sessionInfo) {
   mProcesses[mProcessID] = executable;
 
-  LARGE_INTEGER fileSize {};
-  GetFileSizeEx(mFile.get(), &fileSize);
-  mFileSize = fileSize.QuadPart;
+  mFileSize = mFile.GetSize().value_or(0);
+  mStreamOffset = mFile.GetPosition().value_or(0);
+  mStreamSize = mFileSize - mStreamOffset;
 
-  LARGE_INTEGER initialOffset {};
-  SetFilePointerEx(mFile.get(), {}, &initialOffset, FILE_CURRENT);
-  mStreamSize = mFileSize - initialOffset.QuadPart;
-
-  const auto resetPosition
-    = wil::scope_exit([offset = initialOffset, f = mFile.get()]() {
-        SetFilePointerEx(f, offset, nullptr, FILE_BEGIN);
-      });
+  const ScopeExit resetPosition([this]() {
+    mFile.Seek(static_cast<int64_t>(mStreamOffset), SeekOrigin::Begin);
+  });
 
   using FileFooter = BinaryLog::FileFooter;
   constexpr auto MagicLength = std::size(FileFooter::TrailingMagic);
   constexpr auto FooterLength = sizeof(FileFooter) + MagicLength;
-  SetFilePointerEx(
-    mFile.get(),
-    {.QuadPart = -static_cast<int64_t>(FooterLength)},
-    nullptr,
-    FILE_END);
-  char footerBuf[FooterLength] {};
-  DWORD bytesRead {};
-  if (!ReadFile(mFile.get(), footerBuf, FooterLength, &bytesRead, nullptr)) {
+  if (mStreamSize < FooterLength) {
     return;
   }
-  if (bytesRead != FooterLength) {
+  mFile.Seek(-static_cast<int64_t>(FooterLength), SeekOrigin::End);
+  char footerBuf[FooterLength] {};
+  if (mFile.Read(footerBuf, FooterLength) != FooterLength) {
     return;
   }
 
@@ -114,8 +170,28 @@ PerformanceCounterMath BinaryLogReader::GetPerformanceCounterMath()
   return mPerformanceCounterMath;
 }
 
+BinaryLog::LoggingPolicy BinaryLogReader::GetLoggingPolicy() const noexcept {
+  return mLoggingPolicy;
+}
+
+std::optional<BinaryLog::SessionInfo> BinaryLogReader::GetSessionInfo()
+  const noexcept {
+  return mSessionInfo;
+}
+
+uint64_t BinaryLogReader::GetRepresentedFrameCount() const noexcept {
+  return mRepresentedFrameCount;
+}
+
+std::optional<FrameMetrics> BinaryLogReader::GetFrameSummary() const noexcept {
+  return mFrameSummary;
+}
+
 std::optional<FramePerformanceCounters>
 BinaryLogReader::GetNextFrame() noexcept {
+  mRepresentedFrameCount = 1;
+  mFrameSummary.reset();
+
   if (mEndOfFile || !mFile) {
     return std::nullopt;
   }
@@ -123,42 +199,17 @@ BinaryLogReader::GetNextFrame() noexcept {
   auto& header = mNextPacketHeader;
   using Type = BinaryLog::PacketHeader::PacketType;
   if (header.mType == Type::Invalid) {
-    DWORD bytesRead {};
-
-    if (!ReadFile(
-          mFile.get(),
-          &header,
-          sizeof(BinaryLog::PacketHeader),
-          &bytesRead,
-          nullptr)) {
-      return std::nullopt;
-    }
-    if (bytesRead != sizeof(BinaryLog::PacketHeader)) {
+    if (mFile.Read(&header, sizeof(header)) != sizeof(header)) {
       return std::nullopt;
     }
   }
 
-  while (header.mType == Type::ProcessInfo) {
-    if (header.mSize != sizeof(BinaryLog::ProcessInfo)) {
-      dprint("ProcessInfo size mismatch");
+  while (header.mType == Type::ProcessInfo
+         || header.mType == Type::CompactProcessInfo) {
+    if (!this->ReadProcessInfo(header)) {
       return std::nullopt;
     }
-    DWORD bytesRead {};
-    BinaryLog::ProcessInfo info {};
-    if (!ReadFile(mFile.get(), &info, sizeof(info), &bytesRead, nullptr)) {
-      dprint("Failed to read ProcessInfo");
-      return std::nullopt;
-    }
-    if (bytesRead != sizeof(BinaryLog::ProcessInfo)) {
-      dprint("Failed to read sufficient bytes for ProcessInfo");
-      return std::nullopt;
-    }
-    mProcesses[info.mProcessID] = std::filesystem::path {
-      std::wstring_view {info.mPath, info.mPathLength}};
-    if (!ReadFile(mFile.get(), &header, sizeof(header), &bytesRead, nullptr)) {
-      return std::nullopt;
-    }
-    if (bytesRead != sizeof(BinaryLog::PacketHeader)) {
+    if (mFile.Read(&header, sizeof(header)) != sizeof(header)) {
       return std::nullopt;
     }
   }
@@ -188,12 +239,12 @@ BinaryLogReader::GetNextFrame() noexcept {
       return std::unexpected {WrongSize};
     }
 
-    DWORD bytesRead {};
-    if (!ReadFile(mFile.get(), dest, sizeof(T), &bytesRead, 0)) {
+    const auto bytesRead = mFile.Read(dest, sizeof(T));
+    if (!bytesRead) {
       return std::unexpected {ReadFailed};
     }
 
-    if (bytesRead != header.mSize) {
+    if (*bytesRead != header.mSize) {
       return std::unexpected {ReadPartiallyFailed};
     }
     return {};
@@ -206,21 +257,19 @@ BinaryLogReader::GetNextFrame() noexcept {
     return std::nullopt;
   }
 
-  const auto updateFooter
-    = wil::scope_exit([this, &fpc]() { mComputedFooter.Update(fpc); });
+  const ScopeExit updateFooter([this, &fpc]() {
+    mComputedFooter.Update(fpc, mRepresentedFrameCount);
+  });
 
   while (true) {
     header = {};
-    DWORD bytesRead {};
-    if (!ReadFile(
-          mFile.get(),
-          &header,
-          sizeof(BinaryLog::PacketHeader),
-          &bytesRead,
-          nullptr)) {
+    const auto bytesRead = mFile.Read(&header, sizeof(header));
+    if (!bytesRead) {
       return fpc;
     }
-    if (bytesRead != sizeof(BinaryLog::PacketHeader)) {
+    if (*bytesRead != sizeof(header)) {
+      // Truncated, e.g. the log is still being written
+      header = {};
       return fpc;
     }
 
@@ -260,17 +309,56 @@ BinaryLogReader::GetNextFrame() noexcept {
         fpc.mValidDataBits |= FramePerformanceCounters::ValidDataBits::NVEnc;
         break;
       }
-      case Type::ProcessInfo: {
-        BinaryLog::ProcessInfo info {};
-        if (!readPacket(Type::ProcessInfo, &info)) {
+      case Type::HostCpu:
+        if (!readPacket(Type::HostCpu, &fpc.mHostCpu)) {
+          return fpc;
+        }
+        fpc.mValidDataBits |= FramePerformanceCounters::ValidDataBits::HostCpu;
+        break;
+      case Type::ProcessResources:
+        if (!readPacket(Type::ProcessResources, &fpc.mProcessResources)) {
+          return fpc;
+        }
+        fpc.mValidDataBits
+          |= FramePerformanceCounters::ValidDataBits::ProcessResources;
+        break;
+      case Type::ProcessInfo:
+      case Type::CompactProcessInfo:
+        if (!this->ReadProcessInfo(header)) {
+          return fpc;
+        }
+        break;
+      case Type::RepresentedFrames: {
+        BinaryLog::RepresentedFrames represented {};
+        if (!readPacket(Type::RepresentedFrames, &represented)) {
+          return fpc;
+        }
+        mRepresentedFrameCount = std::max<uint64_t>(represented.mFrameCount, 1);
+        break;
+      }
+      case Type::FrameSummary: {
+        BinaryLog::FrameSummary summary {};
+        if (!readPacket(Type::FrameSummary, &summary)) {
           return fpc;
         }
-        if (info.mProcessID != mProcessID) {
-          mProcesses[info.mProcessID]
-            = std::filesystem::path {std::wstring_view {
-              info.mPath,
-              info.mPathLength,
-            }};
+        mFrameSummary = FromSummary(summary);
+        break;
+      }
+      case Type::LoggingPolicy: {
+        // Only valid at the start of the stream
+        dprint("Ignoring LoggingPolicy packet in frame data");
+        BinaryLog::LoggingPolicy ignored {};
+        if (!readPacket(Type::LoggingPolicy, &ignored)) {
+          return fpc;
+        }
+        break;
+      }
+      case Type::SessionInfo: {
+        // Only valid at the start of the stream
+        dprint("Ignoring SessionInfo packet in frame data");
+        BinaryLog::SessionInfo ignored {};
+        if (!readPacket(Type::SessionInfo, &ignored)) {
+          return fpc;
         }
         break;
       }
@@ -278,11 +366,203 @@ BinaryLogReader::GetNextFrame() noexcept {
   }
 }
 
+std::optional<FramePerformanceCounters> BinaryLogReader::FollowNextFrame(
+  std::stop_token stopToken) noexcept {
+  // Polled, as change notifications aren't reliably sent while the writer
+  // still has the file open
+  constexpr auto MinimumPollInterval = std::chrono::milliseconds(10);
+  constexpr auto MaximumPollInterval = std::chrono::milliseconds(250);
+  auto pollInterval = MinimumPollInterval;
+
+  // Only used to sleep until the poll interval has passed, or a stop is
+  // requested
+  std::mutex mutex;
+  std::condition_variable_any wake;
+
+  while (!stopToken.stop_requested()) {
+    const auto frameStart = mFile.GetPosition();
+    if (!frameStart) {
+      return std::nullopt;
+    }
+    const auto savedNextHeader = mNextPacketHeader;
+    const auto savedComputedFooter = mComputedFooter;
+
+    auto frame = this->GetNextFrame();
+    using Type = BinaryLog::PacketHeader::PacketType;
+    if (mEndOfFile || (frame && mNextPacketHeader.mType == Type::Core)) {
+      return frame;
+    }
+    if (!this->IsAtEndOfData()) {
+      // Invalid, rather than incomplete
+      return frame;
+    }
+
+    // Incomplete; rewind to the start of the frame, and try again later
+    mFile.Seek(static_cast<int64_t>(*frameStart), SeekOrigin::Begin);
+    mNextPacketHeader = savedNextHeader;
+    mComputedFooter = savedComputedFooter;
+
+    {
+      std::unique_lock lock(mutex);
+      wake.wait_for(lock, stopToken, pollInterval, [] { return false; });
+    }
+    pollInterval = std::min(pollInterval * 2, MaximumPollInterval);
+
+    if (const auto fileSize = mFile.GetSize()) {
+      mFileSize = *fileSize;
+      mStreamSize = mFileSize - mStreamOffset;
+    }
+  }
+  return std::nullopt;
+}
+
+std::optional<BinaryLogReader> BinaryLogReader::FollowNextSegment(
+  std::stop_token stopToken) const noexcept {
+  if (!(mEndOfFile && mSessionInfo)) {
+    return std::nullopt;
+  }
+
+  // Files that aren't readable yet might be the next segment, before its
+  // header has been written; give up on them if they stay unreadable
+  constexpr auto PollInterval = std::chrono::milliseconds(50);
+  constexpr auto MaximumHeaderWait = std::chrono::seconds(10);
+  const auto giveUpAt = std::chrono::steady_clock::now() + MaximumHeaderWait;
+
+  std::mutex mutex;
+  std::condition_variable_any wake;
+
+  const auto& session = *mSessionInfo;
+  std::error_code ec;
+  while (!stopToken.stop_requested()) {
+    bool mightBeNext = false;
+    for (auto it = std::filesystem::directory_iterator(
+           mLogFilePath.parent_path(), ec);
+         !ec && it != std::filesystem::directory_iterator();
+         it.increment(ec)) {
+      if (
+        it->path().extension() != mLogFilePath.extension()
+        || !it->is_regular_file(ec)
+        || std::filesystem::equivalent(it->path(), mLogFilePath, ec)) {
+        ec.clear();
+        continue;
+      }
+      auto reader = Create(it->path());
+      if (!reader) {
+        mightBeNext = true;
+        continue;
+      }
+      const auto other = reader->GetSessionInfo();
+      if (
+        other && other->mSessionID == session.mSessionID
+        && other->mSegmentIndex == session.mSegmentIndex + 1) {
+        return std::move(reader).value();
+      }
+    }
+    if (!mightBeNext || std::chrono::steady_clock::now() > giveUpAt) {
+      return std::nullopt;
+    }
+
+    std::unique_lock lock(mutex);
+    wake.wait_for(lock, stopToken, PollInterval, [] { return false; });
+  }
+  return std::nullopt;
+}
+
+bool BinaryLogReader::IsAtEndOfData() const noexcept {
+  const auto position = mFile.GetPosition();
+  const auto fileSize = mFile.GetSize();
+  if (!(position && fileSize)) {
+    return false;
+  }
+  return *position >= *fileSize;
+}
+
+uint64_t BinaryLogReader::GetRemainingFileSize() const noexcept {
+  const auto position = mFile.GetPosition();
+  const auto fileSize = mFile.GetSize();
+  if (!(position && fileSize && *position < *fileSize)) {
+    return 0;
+  }
+  return *fileSize - *position;
+}
+
+bool BinaryLogReader::ReadProcessInfo(
+  const BinaryLog::PacketHeader& header) noexcept {
+  using Type = BinaryLog::PacketHeader::PacketType;
+
+  uint32_t processID {};
+  std::filesystem::path path;
+  if (header.mType == Type::ProcessInfo) {
+    // Older logs; this is large, so keep it off the stack
+    if (header.mSize != sizeof(BinaryLog::ProcessInfo)) {
+      dprint("ProcessInfo size mismatch");
+      return false;
+    }
+    const auto info = std::make_unique<BinaryLog::ProcessInfo>();
+    const auto bytesRead = mFile.Read(info.get(), sizeof(*info));
+    if (!bytesRead) {
+      dprint("Failed to read ProcessInfo");
+      return false;
+    }
+    if (*bytesRead != sizeof(*info)) {
+      dprint("Failed to read sufficient bytes for ProcessInfo");
+      return false;
+    }
+    processID = info->mProcessID;
+    path = std::u16string_view {
+      info->mPath,
+      std::min<size_t>(info->mPathLength, std::size(info->mPath)),
+    };
+  } else {
+    BinaryLog::CompactProcessInfo info {};
+    if (
+      header.mSize < sizeof(info)
+      || mFile.Read(&info, sizeof(info)) != sizeof(info)) {
+      dprint("Failed to read CompactProcessInfo");
+      return false;
+    }
+    if (header.mSize != sizeof(info) + info.mPathByteCount) {
+      dprint("CompactProcessInfo size mismatch");
+      return false;
+    }
+    // Corrupt or hostile logs shouldn't be able to make us allocate
+    // gigabytes, or throw `std::bad_alloc` from this `noexcept` function
+    if (
+      info.mPathByteCount > BinaryLog::CompactProcessInfo::MaxPathByteCount
+      || info.mPathByteCount > this->GetRemainingFileSize()) {
+      dprint(
+        "CompactProcessInfo path is too large ({} bytes)",
+        info.mPathByteCount);
+      return false;
+    }
+    std::u8string pathUtf8(info.mPathByteCount, u8'\0');
+    if (
+      mFile.Read(pathUtf8.data(), info.mPathByteCount)
+      != info.mPathByteCount) {
+      dprint("Failed to read CompactProcessInfo path");
+      return false;
+    }
+    processID = info.mProcessID;
+    try {
+      path = std::filesystem::path {pathUtf8};
+    } catch (const std::system_error& e) {
+      // Not fatal; the rest of the stream is still valid
+      dprint("Invalid UTF-8 in CompactProcessInfo path: {}", e.what());
+      return true;
+    }
+  }
+
+  if (processID != mProcessID) {
+    mProcesses[processID] = std::move(path);
+  }
+  return true;
+}
+
 std::filesystem::path BinaryLogReader::GetExecutablePath() const noexcept {
   return mExecutable;
 }
 
-DWORD BinaryLogReader::GetProcessID() const noexcept {
+uint32_t BinaryLogReader::GetProcessID() const noexcept {
   return mProcessID;
 }
 
@@ -302,6 +582,17 @@ uint64_t BinaryLogReader::GetStreamSize() const noexcept {
   return mStreamSize;
 }
 
+uint64_t BinaryLogReader::GetStreamPosition() const noexcept {
+  const auto offset = mFile.GetPosition();
+  if (!offset) {
+    return 0;
+  }
+  if (*offset < mStreamOffset) {
+    return 0;
+  }
+  return std::min(*offset - mStreamOffset, mStreamSize);
+}
+
 std::optional<BinaryLog::FileFooter> BinaryLogReader::GetFileFooter()
   const noexcept {
   return mFooter;
@@ -319,8 +610,9 @@ BinaryLog::FileFooter BinaryLogReader::GetOrComputeFileFooter() noexcept {
 
   dprint("Computing file footer as footer is missing");
   const auto savedNextHeader = mNextPacketHeader;
-  LARGE_INTEGER position {};
-  SetFilePointerEx(mFile.get(), {}, &position, FILE_CURRENT);
+  const auto savedRepresentedFrameCount = mRepresentedFrameCount;
+  const auto savedFrameSummary = mFrameSummary;
+  const auto position = mFile.GetPosition().value_or(mStreamOffset);
 
   while ((!mEndOfFile) && this->GetNextFrame()) {
     // calling GetNextFrame is the purpose
@@ -328,101 +620,168 @@ BinaryLog::FileFooter BinaryLogReader::GetOrComputeFileFooter() noexcept {
 
   mFooter = mComputedFooter;
   mNextPacketHeader = savedNextHeader;
+  mRepresentedFrameCount = savedRepresentedFrameCount;
+  mFrameSummary = savedFrameSummary;
   mEndOfFile = false;
-  SetFilePointerEx(mFile.get(), position, nullptr, FILE_BEGIN);
+  mFile.Seek(static_cast<int64_t>(position), SeekOrigin::Begin);
 
   return mComputedFooter;
 }
 
+BinaryLog::FileFooter BinaryLogReader::ComputeFileFooter(
+  FooterCheckpoint& checkpoint) noexcept {
+  if (mFooter) {
+    return *mFooter;
+  }
+
+  const FooterCheckpoint logStart {.mOffset = mStreamOffset};
+  if (checkpoint.mOffset < mStreamOffset || checkpoint.mOffset >= mFileSize) {
+    checkpoint = logStart;
+  }
+  const auto seekTo = [this](const FooterCheckpoint& it) {
+    mFile.Seek(static_cast<int64_t>(it.mOffset), SeekOrigin::Begin);
+    mNextPacketHeader = {};
+    mComputedFooter = it.mFooter;
+    mEndOfFile = false;
+  };
+  seekTo(checkpoint);
+
+  using Type = BinaryLog::PacketHeader::PacketType;
+  auto lastFrame = checkpoint;
+  bool isFirstFrame = true;
+  while (!mEndOfFile) {
+    const auto position = mFile.GetPosition();
+    if (!position) {
+      break;
+    }
+    const FooterCheckpoint frameStart {
+      .mOffset = (mNextPacketHeader.mType == Type::Invalid)
+        ? *position
+        : (*position - sizeof(BinaryLog::PacketHeader)),
+      .mFooter = mComputedFooter,
+    };
+    if (!this->GetNextFrame()) {
+      if (isFirstFrame && checkpoint.mOffset != logStart.mOffset) {
+        // Not a frame boundary in this file, e.g. it was replaced
+        dprint("Ignoring stale footer checkpoint");
+        checkpoint = lastFrame = logStart;
+        seekTo(logStart);
+        continue;
+      }
+      break;
+    }
+    isFirstFrame = false;
+    lastFrame = frameStart;
+  }
+
+  mFooter = mComputedFooter;
+  checkpoint = lastFrame;
+  seekTo(logStart);
+  mComputedFooter = {};
+  mRepresentedFrameCount = 1;
+  mFrameSummary = std::nullopt;
+
+  return *mFooter;
+}
+
 std::expected<BinaryLogReader, BinaryLogReader::OpenError>
 BinaryLogReader::Create(const std::filesystem::path& path) {
-  auto [file, openError] = wil::try_open_file(path.wstring().c_str());
-
+  auto file = PlatformFile::Open(path, PlatformFile::Mode::Read);
   if (!file) {
-    return std::unexpected {OpenError::FailedToOpenFile(openError)};
+    return std::unexpected {OpenError::FailedToOpenFile(file.error())};
   }
 
-  const auto magic = ReadLine(file.get());
+  const auto magic = ReadLine(*file);
   if (magic != BinaryLog::Magic) {
     return std::unexpected {OpenError::BadMagic(BinaryLog::Magic, magic)};
   }
 
-  const auto formatVersion = ReadLine(file.get());
-  if (formatVersion != BinaryLog::GetVersionLine()) {
+  const auto formatVersion = ReadLine(*file);
+  const auto isPreviousVersion
+    = formatVersion == BinaryLog::GetVersionLine(BinaryLog::PreviousVersion);
+  if (formatVersion != BinaryLog::GetVersionLine() && !isPreviousVersion) {
     return std::unexpected {
       OpenError::BadVersion(BinaryLog::GetVersionLine(), formatVersion)};
   }
-  const auto producer = ReadLine(file.get());
+  const auto producer = ReadLine(*file);
   dprint("Reading binary log - {}", producer);
 
-  const auto executableUtf8 = ReadLine(file.get());
-  const auto executableFromUtf8
-    = [&executableUtf8](wchar_t* buffer, const INT bufferSize) {
-        return MultiByteToWideChar(
-          CP_UTF8,
-          MB_ERR_INVALID_CHARS,
-          executableUtf8.c_str(),
-          executableUtf8.size(),
-          buffer,
-          bufferSize);
-      };
-  const auto executableWideCharCount = executableFromUtf8(nullptr, 0);
-  std::wstring executableWide;
-  executableWide.resize(executableWideCharCount, L'\0');
-  executableFromUtf8(executableWide.data(), executableWide.size());
-  while ((!executableWide.empty()) && (executableWide.back() == L'\0')) {
-    executableWide.pop_back();
-  }
-  const std::filesystem::path executable {executableWide};
-
-  const auto compression = ReadLine(file.get());
+  const auto executableUtf8 = ReadLine(*file);
+  std::filesystem::path executable;
+  try {
+    executable = std::u8string_view {
+      reinterpret_cast<const char8_t*>(executableUtf8.data()),
+      executableUtf8.size(),
+    };
+  } catch (const std::system_error& e) {
+    // Not fatal; it's only used for display
+    dprint("Invalid UTF-8 in executable path: {}", e.what());
+  }
+
+  const auto compression = ReadLine(*file);
   if (compression != "uncompressed") {
     return std::unexpected {OpenError::UnsupportedCompression(compression)};
   }
 
   using FileHeader = BinaryLog::FileHeader;
   char binaryHeaderData[sizeof(FileHeader)] {};
-  DWORD bytesRead {};
-  if (!ReadFile(
-        file.get(),
-        &binaryHeaderData,
-        sizeof(FileHeader),
-        &bytesRead,
-        nullptr)) {
-    return std::unexpected {OpenError::BadBinaryHeader()};
-  }
-  if (bytesRead != sizeof(FileHeader)) {
+  if (file->Read(binaryHeaderData, sizeof(FileHeader)) != sizeof(FileHeader)) {
     return std::unexpected {OpenError::BadBinaryHeader()};
   }
 
   const auto binaryHeader
     = FileHeader::FromData(binaryHeaderData, sizeof(FileHeader));
   if (!(binaryHeader.mMicrosecondsSinceEpoch
-        && binaryHeader.mQueryPerformanceFrequency.QuadPart
-        && binaryHeader.mQueryPerformanceCounter.QuadPart)) {
+        && binaryHeader.mQueryPerformanceFrequency
+        && binaryHeader.mQueryPerformanceCounter)) {
     return std::unexpected {OpenError::BadBinaryHeader()};
   }
 
+  const auto readMetadata = [&file]<class T>(
+                              const BinaryLog::PacketHeader::PacketType type,
+                              T* payload) {
+    BinaryLog::PacketHeader header {};
+    return file->Read(&header, sizeof(header)) == sizeof(header)
+      && header.mType == type && header.mSize == sizeof(T)
+      && file->Read(payload, sizeof(T)) == sizeof(T);
+  };
+
+  // The previous version doesn't have these packets, and is equivalent to
+  // the `Full` logging policy
+  using Type = BinaryLog::PacketHeader::PacketType;
+  BinaryLog::LoggingPolicy loggingPolicy {};
+  std::optional<BinaryLog::SessionInfo> sessionInfo;
+  if (!isPreviousVersion) {
+    if (!readMetadata(Type::LoggingPolicy, &loggingPolicy)) {
+      return std::unexpected {OpenError::BadBinaryHeader()};
+    }
+    if (!readMetadata(Type::SessionInfo, &sessionInfo.emplace())) {
+      return std::unexpected {OpenError::BadBinaryHeader()};
+    }
+  }
+
   return BinaryLogReader {
     path,
-    std::move(file),
+    std::move(*file),
     executable,
     binaryHeader.mProcessID,
     PerformanceCounterMath {binaryHeader.mQueryPerformanceFrequency},
     ClockCalibration {
       .mQueryPerformanceCounter = binaryHeader.mQueryPerformanceCounter,
       .mMicrosecondsSinceEpoch = binaryHeader.mMicrosecondsSinceEpoch,
-    }};
+    },
+    loggingPolicy,
+    sessionInfo,
+  };
 }
 
-std::string BinaryLogReader::ReadLine(HANDLE file) noexcept {
+std::string BinaryLogReader::ReadLine(PlatformFile& file) noexcept {
   // Byte-at-a-time so we don't overread and have to pass an offset to the
   // constructor
   std::string ret;
   while (ret.size() < 32 * 1024) {
     char byte {'\0'};
-    DWORD bytesRead {};
-    if (!(ReadFile(file, &byte, 1, &bytesRead, nullptr) && bytesRead)) {
+    if (file.Read(&byte, 1) != 1) {
       break;
     }
     ret += byte;
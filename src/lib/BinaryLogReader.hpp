@@ -2,28 +2,39 @@
 // SPDX-License-Identifier: MIT
 #pragma once
 
-#include <wil/resource.h>
-
+#include <cstdint>
 #include <expected>
 #include <filesystem>
+#include <stop_token>
+#include <system_error>
 #include <unordered_map>
 #include <variant>
 
 #include "BinaryLog.hpp"
 #include "FramePerformanceCounters.hpp"
 #include "PerformanceCounterMath.hpp"
+#include "PlatformFile.hpp"
 
 class BinaryLogReader {
  public:
   BinaryLogReader() = delete;
   BinaryLogReader(BinaryLogReader&&) = default;
+  BinaryLogReader& operator=(BinaryLogReader&&) = default;
   ~BinaryLogReader();
 
   struct ClockCalibration {
-    LARGE_INTEGER mQueryPerformanceCounter {};
+    int64_t mQueryPerformanceCounter {};
     uint64_t mMicrosecondsSinceEpoch {};
   };
 
+  /// A frame boundary, for resuming `ComputeFileFooter()`
+  struct FooterCheckpoint {
+    // Offset of the frame's `Core` packet header
+    uint64_t mOffset {};
+    // Footer for the frames before `mOffset`
+    BinaryLog::FileFooter mFooter {};
+  };
+
   class OpenError;
 
   [[nodiscard]] ClockCalibration GetClockCalibration() const noexcept;
@@ -38,7 +49,7 @@ class BinaryLogReader {
   std::filesystem::path GetExecutablePath() const noexcept;
 
   [[nodiscard]]
-  DWORD GetProcessID() const noexcept;
+  uint32_t GetProcessID() const noexcept;
 
   [[nodiscard]]
   std::optional<std::filesystem::path> GetExecutablePath(
@@ -51,15 +62,81 @@ class BinaryLogReader {
   [[nodiscard]]
   uint64_t GetStreamSize() const noexcept;
 
+  /// How much of `GetStreamSize()` has been read, e.g. for progress reporting
+  [[nodiscard]]
+  uint64_t GetStreamPosition() const noexcept;
+
   [[nodiscard]]
   std::optional<BinaryLog::FileFooter> GetFileFooter() const noexcept;
 
   [[nodiscard]]
   BinaryLog::FileFooter GetOrComputeFileFooter() noexcept;
 
+  /** As `GetOrComputeFileFooter()`, but for logs that are still being written.
+   *
+   * Reading starts at `checkpoint` if it is from a previous call for the same
+   * file, and from the start of the log otherwise. `checkpoint` is updated to
+   * the start of the last frame, as it might be incomplete.
+   *
+   * Call this before reading any frames.
+   */
+  [[nodiscard]]
+  BinaryLog::FileFooter ComputeFileFooter(
+    FooterCheckpoint& checkpoint) noexcept;
+
   [[nodiscard]]
   std::optional<FramePerformanceCounters> GetNextFrame() noexcept;
 
+  /** As `GetNextFrame()`, but for logs that are still being written.
+   *
+   * Instead of treating the end of the file as the end of the log, this waits
+   * for more data; a frame is only returned once the next frame or the file
+   * footer has been written, so it can't be missing any packets. If the end of
+   * the file is part-way through a frame, the frame is read again once more
+   * data is available.
+   *
+   * Returns `std::nullopt` after the last frame if the log has a footer, if the
+   * log is invalid, or if a stop is requested.
+   */
+  [[nodiscard]]
+  std::optional<FramePerformanceCounters> FollowNextFrame(
+    std::stop_token) noexcept;
+
+  /** For logs that were rotated: opens the next segment of the same session.
+   *
+   * Call this once `FollowNextFrame()` has returned `std::nullopt` because
+   * the footer was reached. Rotation creates the next segment before writing
+   * the footer, so if there is a next segment, it already exists; this waits
+   * for its header to be written.
+   *
+   * Returns `std::nullopt` if this is the last segment, or if a stop is
+   * requested.
+   */
+  [[nodiscard]]
+  std::optional<BinaryLogReader> FollowNextSegment(
+    std::stop_token) const noexcept;
+
+  /// Always `Full` for logs from versions without logging policies
+  [[nodiscard]]
+  BinaryLog::LoggingPolicy GetLoggingPolicy() const noexcept;
+
+  /// Only present in logs from versions that support rotation
+  [[nodiscard]]
+  std::optional<BinaryLog::SessionInfo> GetSessionInfo() const noexcept;
+
+  /** How many frames the frame most recently returned by `GetNextFrame()`
+   * was written in place of, including itself.
+   *
+   * This is always 1 for `LoggingPolicy::Kind::Full`.
+   */
+  [[nodiscard]]
+  uint64_t GetRepresentedFrameCount() const noexcept;
+
+  /// For `LoggingPolicy::Kind::Aggregated`: metrics for all of the frames
+  /// represented by the frame most recently returned by `GetNextFrame()`
+  [[nodiscard]]
+  std::optional<FrameMetrics> GetFrameSummary() const noexcept;
+
   [[nodiscard]]
   static std::expected<BinaryLogReader, OpenError> Create(
     const std::filesystem::path& path);
@@ -79,7 +156,7 @@ class BinaryLogReader {
       return mCode;
     }
 
-    static OpenError FailedToOpenFile(HRESULT result);
+    static OpenError FailedToOpenFile(const std::error_code&);
     static OpenError BadMagic(
       const std::string& expected,
       const std::string& actual);
@@ -93,7 +170,7 @@ class BinaryLogReader {
     Code mCode;
     std::variant<
       std::monostate,
-      HRESULT,
+      std::error_code,
       std::string,
       std::tuple<std::string, std::string>>
       mDetails;
@@ -104,28 +181,47 @@ class BinaryLogReader {
 
  private:
   std::filesystem::path mLogFilePath;
-  wil::unique_hfile mFile;
+  PlatformFile mFile;
   std::filesystem::path mExecutable;
   uint32_t mProcessID;
   PerformanceCounterMath mPerformanceCounterMath;
   ClockCalibration mClockCalibration {};
+  BinaryLog::LoggingPolicy mLoggingPolicy {};
+  std::optional<BinaryLog::SessionInfo> mSessionInfo;
   std::unordered_map<uint32_t, std::filesystem::path> mProcesses;
 
   uint64_t mFileSize {};
   uint64_t mStreamSize {};// File size, excluding header and footer
+  uint64_t mStreamOffset {};// Size of the header
   std::optional<BinaryLog::FileFooter> mFooter {};
 
   BinaryLog::FileFooter mComputedFooter {};
   BinaryLog::PacketHeader mNextPacketHeader {};
   bool mEndOfFile {false};
 
+  // State for the most recent frame
+  uint64_t mRepresentedFrameCount {1};
+  std::optional<FrameMetrics> mFrameSummary;
+
   BinaryLogReader(
     const std::filesystem::path& path,
-    wil::unique_hfile,
+    PlatformFile,
     const std::filesystem::path& executable,
     uint32_t processID,
     PerformanceCounterMath,
-    ClockCalibration);
+    ClockCalibration,
+    const BinaryLog::LoggingPolicy&,
+    const std::optional<BinaryLog::SessionInfo>&);
+
+  using SeekOrigin = PlatformFile::SeekOrigin;
 
-  static std::string ReadLine(HANDLE) noexcept;
+  static std::string ReadLine(PlatformFile&) noexcept;
+  [[nodiscard]]
+  bool IsAtEndOfData() const noexcept;
+  // Used to validate sizes from the file before allocating buffers for them
+  [[nodiscard]]
+  uint64_t GetRemainingFileSize() const noexcept;
+  // Read the payload for a `ProcessInfo` or `CompactProcessInfo` packet
+  [[nodiscard]]
+  bool ReadProcessInfo(const BinaryLog::PacketHeader&) noexcept;
 };
\ No newline at end of file
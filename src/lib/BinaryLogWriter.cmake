@@ -1,5 +1,8 @@
 include_guard(DIRECTORY)
 
+include(BinaryLogEncoder.cmake)
+include(FrameMetrics.cmake)
+include(PerformanceCounters.cmake)
 include(Version.cmake)
 include(Win32Utils.cmake)
 
@@ -8,11 +11,17 @@ add_library(
   STATIC
   BinaryLog.hpp
   BinaryLogWriter.cpp BinaryLogWriter.hpp
+  LogFileBackend.cpp LogFileBackend.hpp
+  LogRetention.cpp LogRetention.hpp
+  ProcessResolver.cpp ProcessResolver.hpp
 )
 target_link_libraries(
   BinaryLogWriter
   PUBLIC
   WIL::WIL
+  BinaryLogEncoder
+  FrameMetrics
+  PerformanceCounters
   PRIVATE
   Version
   Win32Utils
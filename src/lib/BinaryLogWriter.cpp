@@ -3,46 +3,160 @@
 
 #include "BinaryLogWriter.hpp"
 
+#include <combaseapi.h>
 #include <shlobj_core.h>
 #include <wil/win32_helpers.h>
 
+#include <algorithm>
 #include <chrono>
+#include <cmath>
 #include <filesystem>
 #include <format>
 #include <functional>
+#include <limits>
 #include <ranges>
 
 #include "BinaryLog.hpp"
+#include "BinaryLogEncoder.hpp"
 #include "FramePerformanceCounters.hpp"
+#include "PerformanceCounterMath.hpp"
 #include "Version.hpp"
 #include "Win32Utils.hpp"
 
-BinaryLogWriter::BinaryLogWriter() {
+namespace {
+void CreateSessionID(BinaryLog::SessionInfo& info) {
+  GUID guid {};
+  if (FAILED(CoCreateGuid(&guid))) {
+    dprint("failed to create binary log session ID");
+    return;
+  }
+  static_assert(sizeof(guid) == sizeof(info.mSessionID));
+  memcpy(info.mSessionID.data(), &guid, sizeof(guid));
+}
+}// namespace
+
+BinaryLog::FileHeader BinaryLog::FileHeader::Now() {
+  FileHeader ret {};
+  LARGE_INTEGER frequency {};
+  LARGE_INTEGER counter {};
+  QueryPerformanceFrequency(&frequency);
+  QueryPerformanceCounter(&counter);
+  ret.mQueryPerformanceFrequency = frequency.QuadPart;
+  ret.mQueryPerformanceCounter = counter.QuadPart;
+  ret.mProcessID = GetCurrentProcessId();
+
+  static_assert(
+    __cpp_lib_chrono >= 201907L,
+    "Need std::chrono::system_clock to be guaranteed to use the Unix epoch");
+  ret.mMicrosecondsSinceEpoch
+    = duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch())
+        .count();
+  return ret;
+}
+
+BinaryLogWriter::BinaryLogWriter(const Options& options)
+  : mOptions(options) {
+  using enum BinaryLog::LoggingPolicy::Kind;
+  auto& policy = mOptions.mLoggingPolicy;
+  if (policy.mKind == Full || policy.mInterval == 0) {
+    policy.mInterval = 1;
+  }
+  if (policy.mKind == Aggregated) {
+    // FrameMetrics::mFrameCount is a uint16_t
+    policy.mInterval = std::min<uint32_t>(
+      policy.mInterval, std::numeric_limits<uint16_t>::max());
+    mAggregator.emplace(PerformanceCounterMath::CreateForLiveData());
+  }
+  CreateSessionID(mSessionInfo);
+  if (mOptions.mRetention.IsEnabled()) {
+    mRetention.emplace(GetEffectiveLogsRoot(), mOptions.mRetention);
+  }
   mThread = std::jthread {std::bind_front(&BinaryLogWriter::Run, this)};
 }
 
+const BinaryLogWriter::Options& BinaryLogWriter::GetOptions() const noexcept {
+  return mOptions;
+}
+
+std::filesystem::path BinaryLogWriter::GetLogsRoot() {
+  return GetKnownFolderPath(FOLDERID_LocalAppData) / L"XRFrameTools" / "Logs";
+}
+
+std::filesystem::path BinaryLogWriter::GetEffectiveLogsRoot() const {
+  // Not normalized in the constructor, so that `GetOptions()` still compares
+  // equal to the options from the config
+  if (mOptions.mLogsRoot.empty()) {
+    return GetLogsRoot();
+  }
+  return mOptions.mLogsRoot;
+}
+
+BinaryLogWriter::BinaryLogWriter(SnapshotTag) {
+  CreateSessionID(mSessionInfo);
+}
+
+void BinaryLogWriter::WriteSnapshot(
+  std::wstring_view fileNameSuffix,
+  std::span<const FramePerformanceCounters> frames) {
+  BinaryLogWriter writer {SnapshotTag {}};
+  writer.OpenFile(fileNameSuffix);
+  if (!writer.mBackend) {
+    return;
+  }
+  writer.WriteFrames(frames);
+  // Footer is written by the destructor
+}
+
 BinaryLogWriter::~BinaryLogWriter() {
   mThread = {};
-  if (!mFile) {
+  if (!mBackend) {
     return;
   }
+  // There's no later segment to carry unresolved processes over to, so make
+  // sure the last file includes every process it references
+  mProcessResolver.WaitForPending();
   this->WriteFooter();
 }
 
 void BinaryLogWriter::WriteFooter() {
-  using namespace BinaryLog;
-  constexpr PacketHeader header {
-    PacketHeader::PacketType::FileFooter,
-    sizeof(FileFooter),
-  };
-  WriteFile(mFile.get(), &header, sizeof(header), nullptr, nullptr);
-  WriteFile(mFile.get(), &mFooter, sizeof(mFooter), nullptr, nullptr);
-  WriteFile(
-    mFile.get(),
-    &FileFooter::TrailingMagic,
-    std::size(FileFooter::TrailingMagic),
-    nullptr,
-    nullptr);
+  this->WriteResolvedProcesses();
+
+  const auto footer = BinaryLogEncoder::EncodeFooter(mFooter);
+  this->Append(footer.data(), footer.size());
+  this->Flush();
+
+  // Report the cost of the current policy, so it can be compared with others
+  const auto fileSize = mBytesWritten;
+  if (!(mFooter.mFirstEndFrameTime && mFooter.mLastEndFrameTime)) {
+    return;
+  }
+  const auto duration
+    = PerformanceCounterMath::CreateForLiveData().ToDurationAllowNegative(
+      mFooter.mFirstEndFrameTime, mFooter.mLastEndFrameTime);
+  if (duration <= std::chrono::microseconds::zero()) {
+    return;
+  }
+  const auto bytesPerHour = static_cast<uint64_t>(
+    fileSize
+    * (std::chrono::hours {1} / std::chrono::duration<double, std::micro> {
+         duration}));
+  dprint(
+    "binary log closed: policy {} (interval {}), {} bytes, ~{} bytes/hour",
+    std::to_underlying(mOptions.mLoggingPolicy.mKind),
+    mOptions.mLoggingPolicy.mInterval,
+    fileSize,
+    bytesPerHour);
+  TraceLoggingWrite(
+    gTraceProvider,
+    "BinaryLog/Closed",
+    TraceLoggingValue(
+      std::to_underlying(mOptions.mLoggingPolicy.mKind), "Policy"),
+    TraceLoggingValue(mOptions.mLoggingPolicy.mInterval, "Interval"),
+    TraceLoggingValue(mSessionInfo.mSegmentIndex, "SegmentIndex"),
+    TraceLoggingValue(mFooter.mFrameCount, "FrameCount"),
+    TraceLoggingValue(fileSize, "Bytes"),
+    TraceLoggingValue(bytesPerHour, "BytesPerHour"));
 }
 
 void BinaryLogWriter::LogFrame(const FramePerformanceCounters& fpc) {
@@ -54,9 +168,44 @@ void BinaryLogWriter::LogFrame(const FramePerformanceCounters& fpc) {
   SetEvent(mWakeEvent.get());
 }
 
-void BinaryLogWriter::OpenFile() {
+void BinaryLogWriter::OpenFile(std::wstring_view fileNameSuffix) {
+  this->StartFile(this->CreateBackend(fileNameSuffix));
+}
+
+std::unique_ptr<LogFileBackend> BinaryLogWriter::CreateBackend(
+  std::wstring_view fileNameSuffix) {
   const std::filesystem::path thisExe {wil::QueryFullProcessImageNameW().get()};
 
+  const auto now = std::chrono::system_clock::now();
+  const auto logPath = GetEffectiveLogsRoot() / thisExe.stem()
+    / std::format(L"{0} {1:%F} {1:%H-%M-%S} {1:%Z}{2}.XRFTBinLog",
+                  thisExe.stem().wstring(),
+                  now,
+                  fileNameSuffix);
+
+  try {
+    if (!std::filesystem::exists(logPath.parent_path())) {
+      std::filesystem::create_directories(logPath.parent_path());
+    }
+  } catch (const std::filesystem::filesystem_error& e) {
+    dprint("failed to create log file direction: {}", e.what());
+    return nullptr;
+  }
+
+  auto ret = mOptions.mBackendFactory(logPath);
+  if (!ret) {
+    dprint("failed to create binary log file");
+  }
+  return ret;
+}
+
+void BinaryLogWriter::StartFile(std::unique_ptr<LogFileBackend> backend) {
+  mBackend = std::move(backend);
+  if (!mBackend) {
+    return;
+  }
+
+  const std::filesystem::path thisExe {wil::QueryFullProcessImageNameW().get()};
   const auto thisExeToUtf8
     = [wide = thisExe.wstring()](char* buffer, const INT bufferSize) {
         return WideCharToMultiByte(
@@ -69,65 +218,82 @@ void BinaryLogWriter::OpenFile() {
           nullptr,
           nullptr);
       };
-  const auto thisExeUtf8Bytes = thisExeToUtf8(nullptr, 0);
-  if (thisExeUtf8Bytes <= 0) {
-    return;
-  }
   std::string thisExeUtf8;
-  thisExeUtf8.resize(static_cast<size_t>(thisExeUtf8Bytes), '\0');
-  if (thisExeToUtf8(thisExeUtf8.data(), thisExeUtf8.size()) <= 0) {
-    return;
-  }
-  {
-    const auto lastIdx = thisExeUtf8.find_last_not_of('\0');
-    if (lastIdx == std::string::npos) {
-      return;
+  const auto thisExeUtf8Bytes = thisExeToUtf8(nullptr, 0);
+  if (thisExeUtf8Bytes > 0) {
+    thisExeUtf8.resize(static_cast<size_t>(thisExeUtf8Bytes), '\0');
+    if (thisExeToUtf8(thisExeUtf8.data(), thisExeUtf8.size()) <= 0) {
+      thisExeUtf8.clear();
     }
-    thisExeUtf8.erase(lastIdx + 1);
+    const auto lastIdx = thisExeUtf8.find_last_not_of('\0');
+    thisExeUtf8.erase(lastIdx == std::string::npos ? 0 : lastIdx + 1);
+  }
+  if (thisExeUtf8.empty()) {
+    // The file has already been created, so still write a readable header
+    dprint("failed to convert executable path to UTF-8");
   }
 
-  const auto now = std::chrono::system_clock::now();
-  const auto logPath = GetKnownFolderPath(FOLDERID_LocalAppData)
-    / L"XRFrameTools" / "Logs" / thisExe.stem()
-    / std::format(L"{0} {1:%F} {1:%H-%M-%S} {1:%Z}.XRFTBinLog",
-                  thisExe.stem().wstring(),
-                  now);
+  for (auto&& buffer: mBuffers) {
+    buffer.resize(BufferSize);
+  }
+  mBytesWritten = 0;
 
-  try {
-    if (!std::filesystem::exists(logPath.parent_path())) {
-      std::filesystem::create_directories(logPath.parent_path());
-    }
-  } catch (const std::filesystem::filesystem_error& e) {
-    dprint("failed to create log file direction: {}", e.what());
-    return;
+  const auto producedBy
+    = std::format("{} v{}", Version::ProjectName, Version::SemVer);
+  const auto binaryHeader = BinaryLog::FileHeader::Now();
+  const auto header = BinaryLogEncoder::EncodeHeader(
+    {
+      .mProducedBy = producedBy,
+      .mExecutablePath = thisExeUtf8,
+    },
+    binaryHeader,
+    mOptions.mLoggingPolicy,
+    mSessionInfo);
+  this->Append(header.data(), header.size());
+  this->Flush();
+
+  // Already in the text header
+  mNextProcessRequestTimes[binaryHeader.mProcessID]
+    = std::chrono::steady_clock::time_point::max();
+  mSegmentStartTime = std::chrono::steady_clock::now();
+
+  if (mRetention) {
+    mRetention->Enforce();
   }
+}
 
-  mFile.reset(CreateFileA(
-    logPath.string().c_str(),
-    GENERIC_WRITE,
-    FILE_SHARE_READ,
-    nullptr,
-    CREATE_ALWAYS,
-    FILE_ATTRIBUTE_NORMAL,
-    nullptr));
-  if (!mFile) {
-    return;
+bool BinaryLogWriter::IsSegmentFull() {
+  if (
+    mOptions.mMaxSegmentDuration.count()
+    && (std::chrono::steady_clock::now() - mSegmentStartTime)
+      >= mOptions.mMaxSegmentDuration) {
+    return true;
   }
+  return mOptions.mMaxSegmentBytes
+    && mBytesWritten >= mOptions.mMaxSegmentBytes;
+}
 
-  const auto textHeader = std::format(
-    "{}\n{}\nProduced by: {} v{}\n{}\nuncompressed\n",
-    BinaryLog::Magic,
-    BinaryLog::GetVersionLine(),
-    Version::ProjectName,
-    Version::SemVer,
-    thisExeUtf8);
+void BinaryLogWriter::StartNextSegment() {
+  // Don't wait for processes that are still being looked up; rotation is on
+  // the frame-consuming thread. They are written to the next segment instead,
+  // as `WriteResolvedProcesses()` takes them once they are resolved.
+  //
+  // The next segment is created before the footer is written, so a reader
+  // that finds the footer can also find the next segment, e.g. `binlog-tail`.
+  ++mSessionInfo.mSegmentIndex;
+  auto next = this->CreateBackend(
+    std::format(L" - part {}", mSessionInfo.mSegmentIndex + 1));
+  this->WriteFooter();
+  mBackend.reset();
+  mFooter = {};
 
-  WriteFile(
-    mFile.get(), textHeader.data(), textHeader.size(), nullptr, nullptr);
+  // Each segment must be readable on its own, so process info needs to be
+  // written again
+  mNextProcessRequestTimes.clear();
+  mLoggedProcessCreationTimes.clear();
+  mEncoder.Reset();
 
-  const auto binaryHeader = BinaryLog::FileHeader::Now();
-  WriteFile(mFile.get(), &binaryHeader, sizeof(binaryHeader), nullptr, nullptr);
-  mLoggedProcesses.insert(binaryHeader.mProcessID);
+  this->StartFile(std::move(next));
 }
 
 uint64_t BinaryLogWriter::GetProduced() {
@@ -138,34 +304,31 @@ uint64_t BinaryLogWriter::GetProduced() {
 }
 
 void BinaryLogWriter::LogProcess(DWORD pid) {
-  if (mLoggedProcesses.contains(pid)) [[likely]] {
+  const auto now = std::chrono::steady_clock::now();
+  const auto [it, inserted] = mNextProcessRequestTimes.try_emplace(pid, now);
+  if (now < it->second) [[likely]] {
     return;
   }
-  mLoggedProcesses.insert(pid);
+  it->second = now + ProcessRefreshInterval;
+  mProcessResolver.Request(pid);
+}
 
-  wil::unique_process_handle process {
-    OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid)};
-  if (!process) {
-    return;
-  }
+void BinaryLogWriter::WriteResolvedProcesses() {
+  for (auto&& process: mProcessResolver.TakeResolved()) {
+    const auto [it, inserted] = mLoggedProcessCreationTimes.try_emplace(
+      process.mProcessID, process.mCreationTime);
+    if (!inserted) {
+      if (it->second == process.mCreationTime) {
+        continue;
+      }
+      // PID was reused; readers use the most recent path for each PID
+      it->second = process.mCreationTime;
+    }
 
-  BinaryLog::ProcessInfo packet {.mProcessID = pid};
-  DWORD pathLength {std::size(packet.mPath)};
-  if (!QueryFullProcessImageNameW(
-        process.get(), 0, packet.mPath, &pathLength)) {
-    return;
-  }
-  if (!pathLength) {
-    return;
+    const auto packet
+      = BinaryLogEncoder::EncodeProcess(process.mProcessID, process.mPath);
+    this->Append(packet.data(), packet.size());
   }
-  packet.mPathLength = pathLength;
-
-  constexpr BinaryLog::PacketHeader Header {
-    BinaryLog::PacketHeader::PacketType::ProcessInfo,
-    sizeof(packet),
-  };
-  WriteFile(mFile.get(), &Header, sizeof(Header), nullptr, nullptr);
-  WriteFile(mFile.get(), &packet, sizeof(packet), nullptr, nullptr);
 }
 
 void BinaryLogWriter::Run(std::stop_token tok) {
@@ -176,7 +339,7 @@ void BinaryLogWriter::Run(std::stop_token tok) {
     tok, std::bind_front(&SetEvent, mWakeEvent.get()));
 
   this->OpenFile();
-  if (!mFile) {
+  if (!mBackend) {
     return;
   }
 
@@ -192,66 +355,177 @@ void BinaryLogWriter::Run(std::stop_token tok) {
     if (produced == mConsumed) {
       continue;
     }
-
-    const auto firstIndex = mConsumed % RingBufferSize;
-    const auto lastIndex = (produced - 1) % RingBufferSize;
-
-    constexpr auto entrySize = sizeof(mRingBuffer.front());
+    if (produced - mConsumed > RingBufferSize) [[unlikely]] {
+      const auto dropped = produced - mConsumed - RingBufferSize;
+      dprint("binary logger ring buffer overflowed, dropped {} frames", dropped);
+      mFooter.mDroppedFrameCount += static_cast<uint32_t>(dropped);
+      mConsumed = produced - RingBufferSize;
+    }
 
     const auto markConsumed
       = wil::scope_exit([this, produced]() { mConsumed = produced; });
 
-    using FPC = FramePerformanceCounters;
+    // The ring buffer is contiguous, but the range we need might wrap around
+    const auto begin = mConsumed % RingBufferSize;
+    const auto count = produced - mConsumed;
+    const auto firstCount = std::min<uint64_t>(count, RingBufferSize - begin);
+    const std::span ring {mRingBuffer};
+    this->WriteFrames(ring.subspan(begin, firstCount));
+    this->WriteFrames(ring.subspan(0, count - firstCount));
+    this->WriteResolvedProcesses();
+
+    if (this->IsSegmentFull()) {
+      this->StartNextSegment();
+      if (!mBackend) {
+        return;
+      }
+      continue;
+    }
+    this->SubmitBufferIfIdle();
+  }
+}
+
+void BinaryLogWriter::Append(const void* data, const size_t size) {
+  if (BufferSize - mBufferOffset < size) [[unlikely]] {
+    this->SubmitBuffer();
+  }
+  memcpy_s(
+    &mBuffers[mActiveBuffer][mBufferOffset],
+    BufferSize - mBufferOffset,
+    data,
+    size);
+  mBufferOffset += size;
+  mBytesWritten += size;
+}
+
+void BinaryLogWriter::SubmitBuffer() {
+  if (mBufferOffset == 0) {
+    return;
+  }
+  // Only wait if the disk hasn't kept up with an entire buffer
+  mBackend->WaitForWrite();
+  mBackend->BeginWrite(
+    std::span {mBuffers[mActiveBuffer]}.first(mBufferOffset));
+  mActiveBuffer = (mActiveBuffer + 1) % mBuffers.size();
+  mBufferOffset = 0;
+}
 
-    static char buf[1024 * 1024];
-    size_t offset {0};
-    const auto appendBlob = [buf = &buf, &offset]<class T>(const T& data) {
-      memcpy_s(&(*buf)[offset], sizeof(*buf) - offset, &data, sizeof(T));
-      offset += sizeof(data);
-    };
+void BinaryLogWriter::SubmitBufferIfIdle() {
+  if (mBufferOffset && mBackend->IsWriteComplete()) {
+    this->SubmitBuffer();
+  }
+}
 
-    for (uint64_t i = mConsumed; i < produced; ++i) {
-      const auto& it = mRingBuffer.at(i % RingBufferSize);
+void BinaryLogWriter::Flush() {
+  this->SubmitBuffer();
+  mBackend->WaitForWrite();
+}
 
-      mFooter.Update(it);
+void BinaryLogWriter::WriteFrames(
+  std::span<const FramePerformanceCounters> frames) {
+  using FPC = FramePerformanceCounters;
 
-      using PH = BinaryLog::PacketHeader;
-      using PT = PH::PacketType;
+  for (auto&& it: frames) {
+    const auto policy = this->ApplyLoggingPolicy(it);
+    if (!policy.mRepresentedFrames) {
+      continue;
+    }
 
-      const auto appendPacket
-        = [appendBlob, activeBits = it.mValidDataBits]<class T>(
-            const PT kind,
-            const T& payload,
-            const FPC::ValidDataBits neededBits = {}) {
-            if ((activeBits & neededBits) != neededBits) {
-              return;
-            }
+    mFooter.Update(it, policy.mRepresentedFrames);
 
-            appendBlob(PH {kind, sizeof(T)});
-            appendBlob(payload);
-          };
+    if (
+      (it.mValidDataBits & FPC::ValidDataBits::NVEnc)
+      == FPC::ValidDataBits::NVEnc) {
+      for (int j = 0; j < it.mEncoders.mSessionCount; ++j) {
+        this->LogProcess(it.mEncoders.mSessions.at(j).mProcessID);
+      }
+    }
 
-      appendPacket(PT::Core, it.mCore);
-      appendPacket(PT::GpuTime, it.mRenderGpu, FPC::ValidDataBits::GpuTime);
-      appendPacket(PT::VRAM, it.mVideoMemoryInfo, FPC::ValidDataBits::VRAM);
-      appendPacket(
-        PT::NVAPI, it.mGpuPerformanceInformation, FPC::ValidDataBits::NVAPI);
+    const auto packets = mEncoder.EncodeFrame(
+      it, policy.mRepresentedFrames, policy.mSummary);
+    this->Append(packets.data(), packets.size());
+  }
+}
 
+BinaryLogWriter::PolicyResult BinaryLogWriter::ApplyLoggingPolicy(
+  const FramePerformanceCounters& fpc) {
+  using enum BinaryLog::LoggingPolicy::Kind;
+  const auto interval = mOptions.mLoggingPolicy.mInterval;
+  ++mUnwrittenFrameCount;
+
+  switch (mOptions.mLoggingPolicy.mKind) {
+    case Full:
+      break;
+    case EveryNthFrame:
+      if (mUnwrittenFrameCount < interval) {
+        return {};
+      }
+      break;
+    case Aggregated:
+      mAggregator->Push(fpc);
+      if (mUnwrittenFrameCount < interval) {
+        return {};
+      }
+      return {
+        .mRepresentedFrames = std::exchange(mUnwrittenFrameCount, 0),
+        .mSummary = mAggregator->Flush(),
+      };
+    case Adaptive:
+      // Always evaluate, so the baseline is kept up to date
       if (
-        (it.mValidDataBits & FPC::ValidDataBits::NVEnc)
-        == FPC::ValidDataBits::NVEnc) {
-        for (int j = 0; j < it.mEncoders.mSessionCount; ++j) {
-          const auto& session = it.mEncoders.mSessions.at(j);
-          this->LogProcess(session.mProcessID);
-          appendPacket(PT::NVEncSession, session, FPC::ValidDataBits::NVEnc);
-        }
+        !this->IsDeviatingFromBaseline(fpc)
+        && mUnwrittenFrameCount < interval) {
+        return {};
       }
-    }
+      break;
+  }
 
-    if (offset == 0) {
-      continue;
+  return {.mRepresentedFrames = std::exchange(mUnwrittenFrameCount, 0)};
+}
+
+bool BinaryLogWriter::IsDeviatingFromBaseline(
+  const FramePerformanceCounters& fpc) {
+  // Exponentially-weighted moving average; roughly the last second at 90hz
+  constexpr double Weight = 1.0 / 64;
+
+  auto& baseline = mAdaptiveBaseline;
+  const auto threshold
+    = mOptions.mLoggingPolicy.mAdaptiveThresholdPercent / 100.0;
+
+  const auto deviates = [threshold](double& average, const double value) {
+    if (average == 0) {
+      average = value;
+      return false;
     }
+    const auto ret = std::abs(value - average) > (average * threshold);
+    average += (value - average) * Weight;
+    return ret;
+  };
+
+  bool deviating = false;
+  const auto endFrameStop = fpc.mCore.mEndFrameStop;
+  const auto previousEndFrameStop
+    = std::exchange(baseline.mPreviousEndFrameStop, endFrameStop);
+  if (previousEndFrameStop && endFrameStop) {
+    deviating |= deviates(
+      baseline.mFrameInterval,
+      static_cast<double>(endFrameStop - previousEndFrameStop));
+  }
 
-    WriteFile(mFile.get(), buf, static_cast<DWORD>(offset), nullptr, nullptr);
+  using Bits = FramePerformanceCounters::ValidDataBits;
+  if ((fpc.mValidDataBits & Bits::GpuTime) == Bits::GpuTime) {
+    deviating
+      |= deviates(baseline.mRenderGpu, static_cast<double>(fpc.mRenderGpu));
+  }
+
+  // Keep full detail for a while, so there's context on how it recovered
+  if (deviating) {
+    baseline.mDetailFramesRemaining = mOptions.mLoggingPolicy.mInterval;
+    return true;
+  }
+  if (baseline.mDetailFramesRemaining) {
+    --baseline.mDetailFramesRemaining;
+    return true;
   }
+  return false;
 }
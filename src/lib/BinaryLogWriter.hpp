@@ -7,24 +7,101 @@
 
 #include <BinaryLog.hpp>
 #include <array>
+#include <chrono>
+#include <filesystem>
+#include <memory>
 #include <mutex>
+#include <optional>
+#include <span>
+#include <string_view>
 #include <thread>
-#include <unordered_set>
+#include <unordered_map>
+#include <vector>
 
+#include "BinaryLogEncoder.hpp"
 #include "FramePerformanceCounters.hpp"
+#include "LogFileBackend.hpp"
+#include "LogRetention.hpp"
+#include "MetricsAggregator.hpp"
+#include "ProcessResolver.hpp"
 
 class BinaryLogWriter {
  public:
-  BinaryLogWriter();
+  struct Options {
+    BinaryLog::LoggingPolicy mLoggingPolicy {};
+
+    // When either is exceeded, the current file is completed, and a new one
+    // is started with the same session ID; each is unlimited if 0
+    uint64_t mMaxSegmentBytes {};
+    std::chrono::seconds mMaxSegmentDuration {};
+
+    LogRetention::Policy mRetention {};
+
+    // Writes that extend a file are usually synchronous for overlapped I/O on
+    // NTFS, so use a worker thread by default
+    LogFileBackend::Factory mBackendFactory {&LogFileBackend::CreateThreaded};
+
+    // Where logs are written, and retention is applied; `GetLogsRoot()` if
+    // empty. This is for tests, which shouldn't touch the user's logs.
+    std::filesystem::path mLogsRoot {};
+
+    bool operator==(const Options&) const noexcept = default;
+  };
+
+  explicit BinaryLogWriter(const Options& = {});
   ~BinaryLogWriter();
 
   void LogFrame(const FramePerformanceCounters&);
 
+  /// The options that are in effect; these may be normalized, so can differ
+  /// from the options that were passed to the constructor
+  [[nodiscard]]
+  const Options& GetOptions() const noexcept;
+
+  /// `%LOCALAPPDATA%\XRFrameTools\Logs`
+  [[nodiscard]]
+  static std::filesystem::path GetLogsRoot();
+
+  /** Synchronously write a complete log containing only `frames`.
+   *
+   * `fileNameSuffix` is appended to the usual file name, before the
+   * extension.
+   */
+  static void WriteSnapshot(
+    std::wstring_view fileNameSuffix,
+    std::span<const FramePerformanceCounters> frames);
+
  private:
-  wil::unique_hfile mFile;
+  struct SnapshotTag {};
+  explicit BinaryLogWriter(SnapshotTag);
+
+  std::unique_ptr<LogFileBackend> mBackend;
 
   BinaryLog::FileFooter mFooter {};
 
+  Options mOptions {};
+
+  BinaryLog::SessionInfo mSessionInfo {};
+  std::chrono::steady_clock::time_point mSegmentStartTime {};
+  std::optional<LogRetention> mRetention;
+
+  // Applied on the writer thread, so decimation doesn't cost the app anything
+  uint64_t mUnwrittenFrameCount {};
+  std::optional<MetricsAggregator> mAggregator;
+  struct AdaptiveBaseline {
+    int64_t mPreviousEndFrameStop {};
+    double mFrameInterval {};// QPC ticks
+    double mRenderGpu {};// microseconds
+    uint32_t mDetailFramesRemaining {};
+  };
+  AdaptiveBaseline mAdaptiveBaseline {};
+
+  struct PolicyResult {
+    // 0 if the frame should not be written
+    uint64_t mRepresentedFrames {};
+    std::optional<FrameMetrics> mSummary;
+  };
+
   static constexpr auto RingBufferSize = 128;
   std::array<FramePerformanceCounters, RingBufferSize> mRingBuffer;
 
@@ -35,11 +112,56 @@ class BinaryLogWriter {
   wil::unique_handle mWakeEvent {CreateEventW(nullptr, FALSE, FALSE, nullptr)};
   std::jthread mThread;
 
-  std::unordered_set<DWORD> mLoggedProcesses;
+  // Processes are looked up on another thread, so the encode loop never waits
+  // on process handles. Each PID is looked up again every
+  // `ProcessRefreshInterval` in case it has been reused.
+  static constexpr std::chrono::seconds ProcessRefreshInterval {10};
+  ProcessResolver mProcessResolver;
+  std::unordered_map<DWORD, std::chrono::steady_clock::time_point>
+    mNextProcessRequestTimes;
+  std::unordered_map<DWORD, uint64_t> mLoggedProcessCreationTimes;
+
+  BinaryLogEncoder mEncoder;
+
+  // Double-buffered: one is filled while the other is being written
+  static constexpr size_t BufferSize = 1024 * 1024;
+  std::array<std::vector<char>, 2> mBuffers;
+  size_t mActiveBuffer {};
+  size_t mBufferOffset {};
+  uint64_t mBytesWritten {};// Including buffered data
+
+  void Append(const void* data, size_t size);
+  template <class T>
+  void Append(const T& data) {
+    this->Append(&data, sizeof(T));
+  }
+  // Start writing the active buffer, and switch to the other one
+  void SubmitBuffer();
+  // Submit the active buffer if the previous write has completed; this keeps
+  // the file reasonably up to date without ever waiting
+  void SubmitBufferIfIdle();
+  void Flush();
 
-  void OpenFile();
+  [[nodiscard]]
+  std::filesystem::path GetEffectiveLogsRoot() const;
+  void OpenFile(std::wstring_view fileNameSuffix = {});
+  // Creates an empty log file
+  [[nodiscard]]
+  std::unique_ptr<LogFileBackend> CreateBackend(
+    std::wstring_view fileNameSuffix);
+  // Makes `backend` the current file, and writes the header
+  void StartFile(std::unique_ptr<LogFileBackend> backend);
+  [[nodiscard]]
+  bool IsSegmentFull();
+  void StartNextSegment();
+  void WriteFrames(std::span<const FramePerformanceCounters>);
+  [[nodiscard]]
+  PolicyResult ApplyLoggingPolicy(const FramePerformanceCounters&);
+  [[nodiscard]]
+  bool IsDeviatingFromBaseline(const FramePerformanceCounters&);
   void Run(std::stop_token);
   uint64_t GetProduced();
   void LogProcess(DWORD pid);
+  void WriteResolvedProcesses();
   void WriteFooter();
 };
\ No newline at end of file
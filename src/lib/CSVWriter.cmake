@@ -1,7 +1,7 @@
 include_guard(DIRECTORY)
 
 include(BinaryLogReader.cmake)
-include(Win32Utils.cmake)
+include(PlatformFile.cmake)
 
 add_library(
   CSVWriter
@@ -12,8 +12,7 @@ target_link_libraries(
   CSVWriter
   PUBLIC
   BinaryLogReader
+  PlatformFile
   PRIVATE
-  nvapi
   FrameMetrics
-  Win32Utils
-)
\ No newline at end of file
+)
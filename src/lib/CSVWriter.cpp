@@ -3,28 +3,27 @@
 
 #include "CSVWriter.hpp"
 
-#include <Windows.h>
-#include <nvapi.h>
-#include <wil/filesystem.h>
-
+#include <chrono>
+#include <format>
 #include <functional>
+#include <random>
 #include <ranges>
 
 #include "MetricsAggregator.hpp"
-#include "Win32Utils.hpp"
 
 using namespace std::string_literals;
 
 namespace {
-auto ECFromWin32(DWORD value) {
-  return std::error_code {HRESULT_FROM_WIN32(value), std::system_category()};
-}
+using DecreaseReason
+  = FramePerformanceCounters::GpuPerformanceInfo::DecreaseReason;
 
 enum class ColumnUnit {
   Counter,
   Micros,
   Bytes,
   KHz,
+  MHz,
+  Percent,
   Opaque,
   Boolean,
 };
@@ -60,7 +59,7 @@ class Column {
 
   Column(
     std::string_view name,
-    Getter<uint64_t, DXGI_QUERY_VIDEO_MEMORY_INFO> auto getter)
+    Getter<uint64_t, FramePerformanceCounters::VideoMemoryInfo> auto getter)
     : Column(name, ColumnUnit::Bytes, [getter](const FrameMetrics& fm) {
         return std::to_string(std::invoke(getter, fm.mVideoMemoryInfo));
       }) {
@@ -72,6 +71,10 @@ class Column {
         return std::format("{} (µs)", mName);
       case ColumnUnit::KHz:
         return std::format("{} (KHz)", mName);
+      case ColumnUnit::MHz:
+        return std::format("{} (MHz)", mName);
+      case ColumnUnit::Percent:
+        return std::format("{} (%)", mName);
       default:
         return mName;
     }
@@ -94,6 +97,97 @@ bool HasData(const FrameMetrics& afm) {
 }
 constexpr auto& HasNVAPI
   = HasData<FramePerformanceCounters::ValidDataBits::NVAPI>;
+constexpr auto& HasHostCpu
+  = HasData<FramePerformanceCounters::ValidDataBits::HostCpu>;
+constexpr auto& HasProcessResources
+  = HasData<FramePerformanceCounters::ValidDataBits::ProcessResources>;
+
+// Host metrics are sampled less often than frames, so rows may not have a
+// sample; leave these empty rather than writing a misleading 0
+template <auto THasData>
+auto OptionalValue(auto getter) {
+  return [getter](const FrameMetrics& frame) -> std::string {
+    if (!THasData(frame)) {
+      return {};
+    }
+    return std::format("{}", std::invoke(getter, frame));
+  };
+}
+
+// Stored as hundredths of a percent
+double ToPercent(const uint32_t hundredths) {
+  return hundredths / 100.0;
+}
+
+const auto HostCpuColumns = std::array {
+  Column {
+    "CPU Clock",
+    ColumnUnit::MHz,
+    OptionalValue<HasHostCpu>(
+      [](const FrameMetrics& frame) { return frame.mHostCpu.mFrequencyMHz; }),
+  },
+  Column {
+    "CPU Utilization",
+    ColumnUnit::Percent,
+    OptionalValue<HasHostCpu>([](const FrameMetrics& frame) {
+      return ToPercent(frame.mHostCpu.mUtilization);
+    }),
+  },
+  Column {
+    "Busiest CPU Core Utilization",
+    ColumnUnit::Percent,
+    OptionalValue<HasHostCpu>([](const FrameMetrics& frame) {
+      return ToPercent(frame.mHostCpu.mBusiestCoreUtilization);
+    }),
+  },
+  Column {
+    "Host Metrics Sampling Cost",
+    ColumnUnit::Micros,
+    OptionalValue<HasHostCpu>([](const FrameMetrics& frame) {
+      return frame.mHostCpu.mSampleCostMicroseconds;
+    }),
+  },
+};
+
+const auto ProcessResourcesColumns = std::array {
+  Column {
+    "Process CPU Utilization",
+    ColumnUnit::Percent,
+    OptionalValue<HasProcessResources>([](const FrameMetrics& frame) {
+      return ToPercent(frame.mProcessResources.mCpuUtilization);
+    }),
+  },
+  Column {
+    "Process Working Set",
+    ColumnUnit::Bytes,
+    OptionalValue<HasProcessResources>([](const FrameMetrics& frame) {
+      return frame.mProcessResources.mWorkingSetBytes;
+    }),
+  },
+  Column {
+    "Process Private Bytes",
+    ColumnUnit::Bytes,
+    OptionalValue<HasProcessResources>([](const FrameMetrics& frame) {
+      return frame.mProcessResources.mPrivateBytes;
+    }),
+  },
+  Column {
+    "Process Page Faults",
+    ColumnUnit::Counter,
+    OptionalValue<HasProcessResources>([](const FrameMetrics& frame) {
+      return frame.mProcessResources.mPageFaults;
+    }),
+  },
+};
+
+template <FrameBottleneck T>
+double GetBottleneckPercent(const FrameMetrics& frame) {
+  if (!frame.mFrameCount) {
+    return 0.0;
+  }
+  return (100.0 * frame.mBottleneckFrameCounts[std::to_underlying(T)])
+    / frame.mFrameCount;
+}
 
 template <uint32_t TNVidiaBits>
 bool HasAnyOfGPUPerfDecreaseBits(const FrameMetrics& frame) {
@@ -151,19 +245,19 @@ const auto BaseColumns = std::array {
   },
   Column {
     "VRAM Budget",
-    &DXGI_QUERY_VIDEO_MEMORY_INFO::Budget,
+    &FramePerformanceCounters::VideoMemoryInfo::mBudget,
   },
   Column {
     "VRAM Current Usage ",
-    &DXGI_QUERY_VIDEO_MEMORY_INFO::CurrentUsage,
+    &FramePerformanceCounters::VideoMemoryInfo::mCurrentUsage,
   },
   Column {
     "VRAM Current Reservation",
-    &DXGI_QUERY_VIDEO_MEMORY_INFO::CurrentReservation,
+    &FramePerformanceCounters::VideoMemoryInfo::mCurrentReservation,
   },
   Column {
     "VRAM Available for Reservation",
-    &DXGI_QUERY_VIDEO_MEMORY_INFO::AvailableForReservation,
+    &FramePerformanceCounters::VideoMemoryInfo::mAvailableForReservation,
   },
   Column {
     "GPU API",
@@ -210,21 +304,67 @@ const auto BaseColumns = std::array {
   Column {
     "GPU Thermal Limit",
     ColumnUnit::Boolean,
-    &HasAnyOfGPUPerfDecreaseBits<
-      NV_GPU_PERF_DECREASE_REASON_THERMAL_PROTECTION>,
+    &HasAnyOfGPUPerfDecreaseBits<DecreaseReason::ThermalProtection>,
   },
   Column {
     "GPU Power Limit",
     ColumnUnit::Boolean,
     &HasAnyOfGPUPerfDecreaseBits<
-      NV_GPU_PERF_DECREASE_REASON_POWER_CONTROL
-      | NV_GPU_PERF_DECREASE_REASON_AC_BATT
-      | NV_GPU_PERF_DECREASE_REASON_INSUFFICIENT_POWER>,
+      DecreaseReason::PowerControl | DecreaseReason::ACBattery
+      | DecreaseReason::InsufficientPower>,
   },
   Column {
     "GPU API Limit",
     ColumnUnit::Boolean,
-    &HasAnyOfGPUPerfDecreaseBits<NV_GPU_PERF_DECREASE_REASON_API_TRIGGERED>,
+    &HasAnyOfGPUPerfDecreaseBits<DecreaseReason::APITriggered>,
+  },
+  Column {
+    "Display Period",
+    [](const FrameMetrics& frame) { return frame.mPacing.mDisplayPeriod; },
+  },
+  Column {
+    "Late Frames",
+    ColumnUnit::Percent,
+    [](const FrameMetrics& frame) {
+      if (!frame.mFrameCount) {
+        return 0.0;
+      }
+      return (100.0 * frame.mPacing.mLateFrameCount) / frame.mFrameCount;
+    },
+  },
+  Column {
+    "Skipped Display Slots",
+    ColumnUnit::Counter,
+    [](const FrameMetrics& frame) { return frame.mPacing.mSkippedSlots; },
+  },
+  Column {
+    "Repeated Display Slots",
+    ColumnUnit::Counter,
+    [](const FrameMetrics& frame) { return frame.mPacing.mRepeatedSlots; },
+  },
+  Column {
+    "Display Jitter",
+    [](const FrameMetrics& frame) { return frame.mPacing.mJitter; },
+  },
+  Column {
+    "App CPU Bound",
+    ColumnUnit::Percent,
+    &GetBottleneckPercent<FrameBottleneck::AppCpu>,
+  },
+  Column {
+    "Render CPU Bound",
+    ColumnUnit::Percent,
+    &GetBottleneckPercent<FrameBottleneck::RenderCpu>,
+  },
+  Column {
+    "Render GPU Bound",
+    ColumnUnit::Percent,
+    &GetBottleneckPercent<FrameBottleneck::RenderGpu>,
+  },
+  Column {
+    "Compositor Bound",
+    ColumnUnit::Percent,
+    &GetBottleneckPercent<FrameBottleneck::Compositor>,
   },
 };
 
@@ -245,37 +385,75 @@ std::string GetRow(const auto& columns, const FrameMetrics& frame) {
 CSVWriter::Result CSVWriter::Write(
   BinaryLogReader reader,
   const std::filesystem::path& outputPath,
-  size_t framesPerRow) {
+  size_t framesPerRow,
+  const Monitor& monitor) {
   if (!std::filesystem::exists(outputPath.parent_path())) {
     std::filesystem::create_directories(outputPath.parent_path());
   }
 
-  auto [handle, error] = wil::try_open_or_truncate_existing_file(
-    outputPath.wstring().c_str(), GENERIC_WRITE);
-  if (!handle) {
+  // Write to a temporary file in the same directory, then rename it over the
+  // output; this way, an incomplete file never has the output's name, so it
+  // can't be mistaken for an up-to-date conversion
+  auto temporaryPath = outputPath;
+  temporaryPath += std::format(".{:08x}.tmp", std::random_device {}());
+
+  auto file = PlatformFile::Open(temporaryPath, PlatformFile::Mode::Write);
+  if (!file) {
     throw std::filesystem::filesystem_error {
       "Couldn't open output file",
-      outputPath,
-      ECFromWin32(error),
+      temporaryPath,
+      file.error(),
     };
   }
+  const auto removeTemporaryFile = [&]() {
+    *file = {};
+    std::error_code ec;
+    std::filesystem::remove(temporaryPath, ec);
+  };
 
-  return Write(std::move(reader), handle.get(), framesPerRow);
+  Result ret;
+  try {
+    ret = Write(std::move(reader), *file, framesPerRow, monitor);
+  } catch (...) {
+    removeTemporaryFile();
+    throw;
+  }
+  if (ret.mCancelled) {
+    removeTemporaryFile();
+    return ret;
+  }
+
+  *file = {};
+  std::error_code ec;
+  std::filesystem::rename(temporaryPath, outputPath, ec);
+  if (ec) {
+    removeTemporaryFile();
+    throw std::filesystem::filesystem_error {
+      "Couldn't replace output file",
+      temporaryPath,
+      outputPath,
+      ec,
+    };
+  }
+  return ret;
 }
 
-CSVWriter::Result
-CSVWriter::Write(BinaryLogReader reader, HANDLE out, size_t framesPerRow) {
+CSVWriter::Result CSVWriter::Write(
+  BinaryLogReader reader,
+  PlatformFile& out,
+  size_t framesPerRow,
+  const Monitor& monitor) {
   const auto pcm = reader.GetPerformanceCounterMath();
   Result ret;
 
   auto& frameCount = ret.mFrameCount;
   auto& flushCount = ret.mRowCount;
   MetricsAggregator acc {pcm};
-  std::optional<LARGE_INTEGER> firstFrameTime {};
-  LARGE_INTEGER lastFrameTime {};
+  std::optional<int64_t> firstFrameTime {};
+  int64_t lastFrameTime {};
 
   const auto ToUTC = [clockCalibration = reader.GetClockCalibration(),
-                      pcm](const LARGE_INTEGER& time) {
+                      pcm](const int64_t time) {
     // As the binary logging happens in its own thread, it's possible for
     // the first few threads to have an end time that is earlier than the
     // log start time
@@ -315,7 +493,7 @@ CSVWriter::Write(BinaryLogReader reader, HANDLE out, size_t framesPerRow) {
       },
     },
   };
-  columns.append_range(BaseColumns);
+  columns.insert(columns.end(), BaseColumns.begin(), BaseColumns.end());
   const auto footer = reader.GetOrComputeFileFooter();
   using Bits = FramePerformanceCounters::ValidDataBits;
   if ((footer.mValidDataBits & Bits::NVEnc) == Bits::NVEnc) {
@@ -324,60 +502,128 @@ CSVWriter::Write(BinaryLogReader reader, HANDLE out, size_t framesPerRow) {
            footer.mMaxEncoderSessionCount,
            FramePerformanceCounters {}.mEncoders.mSessions.size());
          ++i) {
-      columns.append_range(
-        std::array {
-          Column {
-            std::format("NVEnc[{}] Process", i),
-            ColumnUnit::Opaque,
-            [i, &reader](const FrameMetrics& fm) {
-              const auto pid = fm.mEncoders.mSessions.at(i).mProcessID;
-              const auto path = reader.GetExecutablePath(pid);
-              if (path) {
-                return std::format("{} ({})", pid, path->filename().string());
-              }
-              return std::to_string(pid);
-            },
+      const std::array encoderColumns {
+        Column {
+          std::format("NVEnc[{}] Process", i),
+          ColumnUnit::Opaque,
+          [i, &reader](const FrameMetrics& fm) {
+            const auto pid = fm.mEncoders.mSessions.at(i).mProcessID;
+            const auto path = reader.GetExecutablePath(pid);
+            if (path) {
+              return std::format("{} ({})", pid, path->filename().string());
+            }
+            return std::to_string(pid);
           },
-          Column {
-            std::format("NVEnc[{}] FPS", i),
-            ColumnUnit::Counter,
-            [i](const FrameMetrics& fm) {
-              return fm.mEncoders.mSessions.at(i).mAverageFPS;
-            },
+        },
+        Column {
+          std::format("NVEnc[{}] FPS", i),
+          ColumnUnit::Counter,
+          [i](const FrameMetrics& fm) {
+            return fm.mEncoders.mSessions.at(i).mAverageFPS;
           },
-          Column {
-            std::format("NVEnc[{}] Latency", i),
-            ColumnUnit::Micros,
-            [i](const FrameMetrics& fm) {
-              return fm.mEncoders.mSessions.at(i).mAverageLatency;
-            },
+        },
+        Column {
+          std::format("NVEnc[{}] Latency", i),
+          ColumnUnit::Micros,
+          [i](const FrameMetrics& fm) {
+            return fm.mEncoders.mSessions.at(i).mAverageLatency;
           },
-        });
+        },
+      };
+      columns.insert(
+        columns.end(), encoderColumns.begin(), encoderColumns.end());
     }
   }
+  if ((footer.mValidDataBits & Bits::HostCpu) == Bits::HostCpu) {
+    columns.insert(columns.end(), HostCpuColumns.begin(), HostCpuColumns.end());
+  }
+  if (
+    (footer.mValidDataBits & Bits::ProcessResources)
+    == Bits::ProcessResources) {
+    columns.insert(
+      columns.end(),
+      ProcessResourcesColumns.begin(),
+      ProcessResourcesColumns.end());
+  }
 
   // Include the UTF-8 Byte Order Mark, because Excel and Google Sheets use it
   // as a magic value for UTF-8
-  win32::println(out, "\ufeff{}", GetColumnHeaders(columns));
+  out.Write(std::format("\ufeff{}\n", GetColumnHeaders(columns)));
+
+  const auto writeRow = [&](const FrameMetrics& row) {
+    out.Write(GetRow(columns, row) + '\n');
+    ++flushCount;
+    for (size_t i = 0; i < FrameBottleneckCount; ++i) {
+      ret.mBottleneckFrameCounts[i] += row.mBottleneckFrameCounts[i];
+    }
+  };
+
+  const auto streamSize = reader.GetStreamSize();
+  // Checking position is a syscall, so don't check every frame
+  constexpr size_t MonitorInterval = 1024;
+  size_t framesUntilMonitor {MonitorInterval};
+
+  // Frames since the last row, including frames skipped by the logging policy
+  size_t pendingFrames {};
+  const auto nextFrame
+    = [&reader, &monitor]() -> std::optional<FramePerformanceCounters> {
+    if (!monitor.mFollow) {
+      return reader.GetNextFrame();
+    }
+    while (true) {
+      if (auto frame = reader.FollowNextFrame(monitor.mStopToken)) {
+        return frame;
+      }
+      // Rotated logs continue in the next segment
+      auto next = reader.FollowNextSegment(monitor.mStopToken);
+      if (!next) {
+        return std::nullopt;
+      }
+      reader = std::move(next).value();
+    }
+  };
+  while (const auto frame = nextFrame()) {
+    if (--framesUntilMonitor == 0) {
+      framesUntilMonitor = MonitorInterval;
+      if (monitor.mStopToken.stop_requested()) {
+        ret.mCancelled = true;
+        return ret;
+      }
+      if (monitor.mProgress) {
+        monitor.mProgress(reader.GetStreamPosition(), streamSize);
+      }
+    }
 
-  while (const auto frame = reader.GetNextFrame()) {
     const auto& core = frame->mCore;
     if (!firstFrameTime) {
       firstFrameTime = core.mEndFrameStop;
     }
     lastFrameTime = core.mEndFrameStop;
 
-    acc.Push(*frame);
-    if (++frameCount % framesPerRow != 0) {
+    const auto representedFrames = reader.GetRepresentedFrameCount();
+    frameCount += representedFrames;
+
+    // Aggregated logs already contain a row's worth of metrics per frame
+    if (const auto summary = reader.GetFrameSummary()) {
+      writeRow(*summary);
+      continue;
+    }
+
+    acc.Push(*frame, representedFrames);
+    pendingFrames += representedFrames;
+    if (pendingFrames < framesPerRow) {
       continue;
     }
+    pendingFrames = 0;
     const auto row = acc.Flush();
     if (!row) {
       continue;
     };
 
-    win32::println(out, "{}", GetRow(columns, *row));
-    ++flushCount;
+    writeRow(*row);
+  }
+  if (monitor.mFollow && monitor.mStopToken.stop_requested()) {
+    ret.mCancelled = true;
   }
 
   if (firstFrameTime) {
@@ -385,5 +631,8 @@ CSVWriter::Write(BinaryLogReader reader, HANDLE out, size_t framesPerRow) {
       pcm.ToDuration(*firstFrameTime, lastFrameTime));
   }
 
+  if (monitor.mProgress) {
+    monitor.mProgress(streamSize, streamSize);
+  }
   return ret;
 }
@@ -2,7 +2,12 @@
 // SPDX-License-Identifier: MIT
 #pragma once
 
+#include <functional>
+#include <stop_token>
+
 #include "BinaryLogReader.hpp"
+#include "FrameBottleneck.hpp"
+#include "PlatformFile.hpp"
 
 namespace CSVWriter {
 static constexpr size_t DefaultFramesPerRow = 10;
@@ -11,9 +16,29 @@ struct Result {
   size_t mFrameCount {};
   size_t mRowCount {};
   std::optional<std::chrono::milliseconds> mLogDuration {};
+  // Whole-log attribution; indexed by `FrameBottleneck`
+  std::array<uint64_t, FrameBottleneckCount> mBottleneckFrameCounts {};
+  // If set, the output is incomplete; if writing to a path, it is unchanged
+  bool mCancelled {false};
+};
+
+/// Optional progress reporting and cancellation, checked periodically on the
+/// thread calling `Write()`
+struct Monitor {
+  std::stop_token mStopToken;
+  // Called with `GetStreamPosition()` and `GetStreamSize()`
+  std::function<void(uint64_t bytesRead, uint64_t totalBytes)> mProgress;
+  // Use `BinaryLogReader::FollowNextFrame()`, so rows are written as the log
+  // is written, until the log is finished or a stop is requested; if the log
+  // is rotated, this continues with the next segment
+  bool mFollow {false};
 };
 
 /** Write to CSV
+ *
+ * The output is written to a temporary file, which replaces `outputPath` on
+ * success; if the conversion fails or is cancelled, `outputPath` is
+ * unchanged.
  *
  * May throw `std::system_error`; you might want to specially handle
  * `std::filesystem::filesystem_error`
@@ -21,12 +46,17 @@ struct Result {
 Result Write(
   BinaryLogReader reader,
   const std::filesystem::path& outputPath,
-  size_t framesPerRow);
+  size_t framesPerRow,
+  const Monitor& = {});
 
 /** Write to CSV
  *
  * May throw `std::system_error`; you might want to specially handle
  * `std::filesystem::filesystem_error`
  */
-Result Write(BinaryLogReader reader, HANDLE outputFile, size_t framesPerRow);
+Result Write(
+  BinaryLogReader reader,
+  PlatformFile& outputFile,
+  size_t framesPerRow,
+  const Monitor& = {});
 }// namespace CSVWriter
@@ -81,6 +81,7 @@ void Set(
 #define DEFINE_SETTER(TYPE, NAME, DEFAULT) \
   void Config::Set##NAME(const TYPE& value) noexcept { \
     Set<TYPE>(mMutex, mAppKey.get(), L#NAME, mAppStorage.m##NAME, value); \
+    mChangeCount.fetch_add(1, std::memory_order_release); \
   }
 XRFT_ITERATE_SETTINGS(DEFINE_SETTER)
 #undef DEFINE_SETTER
@@ -95,6 +96,7 @@ void Config::Load() {
 
   Load(mDefaultsStorage, mDefaultsKey.get());
   Load(mAppStorage, mAppKey.get());
+  mChangeCount.fetch_add(1, std::memory_order_release);
 }
 
 void Config::Load(Storage& storage, HKEY key) {
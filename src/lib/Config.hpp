@@ -4,6 +4,7 @@
 
 #include <Windows.h>
 
+#include <atomic>
 #include <cinttypes>
 #include <expected>
 #include <filesystem>
@@ -15,7 +16,21 @@
 #include <wil/registry.h>
 
 #define XRFT_ITERATE_SETTINGS(X) \
-  X(int64_t, BinaryLoggingEnabledUntil, BinaryLoggingDisabled)
+  X(int64_t, BinaryLoggingEnabledUntil, BinaryLoggingDisabled) \
+  X(int64_t, BinaryLoggingPolicy, 0) \
+  X(int64_t, BinaryLoggingPolicyInterval, 10) \
+  X(int64_t, BinaryLoggingAdaptiveThresholdPercent, 20) \
+  X(int64_t, BinaryLoggingMaxSegmentMegabytes, 0) \
+  X(int64_t, BinaryLoggingMaxSegmentMinutes, 0) \
+  X(int64_t, LogRetentionMaxTotalMegabytes, 0) \
+  X(int64_t, LogRetentionMaxAgeDays, 0) \
+  X(int64_t, FlightRecorderSeconds, 0) \
+  X(int64_t, FlightRecorderPostTriggerSeconds, 2) \
+  X(int64_t, FlightRecorderFrameIntervalTriggerMicroseconds, 0) \
+  X(int64_t, FlightRecorderGpuTimeTriggerMicroseconds, 0) \
+  X(int64_t, FlightRecorderGpuThrottlingTrigger, 0) \
+  X(int64_t, GpuMetricsSampleIntervalMilliseconds, 10) \
+  X(int64_t, HostMetricsSampleIntervalMilliseconds, 100)
 
 class Config {
  public:
@@ -33,6 +48,7 @@ class Config {
 
   static constexpr int64_t BinaryLoggingDisabled = 0;
   static constexpr int64_t BinaryLoggingPermanentlyEnabled = -1;
+  // `BinaryLoggingPolicy` is a `BinaryLog::LoggingPolicy::Kind`
 
 #define DEFINE_GETTER(TYPE, NAME, DEFAULT) \
   inline TYPE Get##NAME() const noexcept { \
@@ -48,6 +64,16 @@ class Config {
   XRFT_ITERATE_SETTINGS(DECLARE_SETTER)
 #undef DEFINE_GETTER
 
+  /** Incremented whenever any setting may have changed.
+   *
+   * Callers on hot paths can cache settings, and only read them again when
+   * this changes.
+   */
+  [[nodiscard]]
+  uint64_t GetChangeCount() const noexcept {
+    return mChangeCount.load(std::memory_order_acquire);
+  }
+
   bool IsBinaryLoggingEnabled() const noexcept {
     switch (const auto value = this->GetBinaryLoggingEnabledUntil()) {
       case BinaryLoggingDisabled:
@@ -67,6 +93,7 @@ class Config {
   Config(wil::unique_hkey appKey, wil::unique_hkey defaultsKey);
 
   std::shared_mutex mMutex;
+  std::atomic_uint64_t mChangeCount {};
 
   struct Storage {
 #define DECLARE_SETTING_STORAGE(TYPE, NAME, DEFAULT) \
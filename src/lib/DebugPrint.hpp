@@ -0,0 +1,29 @@
+// Copyright 2024 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+
+/* `dprint()` for code that is also built on other platforms.
+ *
+ * On Windows, this is the TraceLogging implementation from `Win32Utils.hpp`;
+ * elsewhere, messages are written to stderr in debug builds.
+ */
+#ifdef _WIN32
+#include "Win32Utils.hpp"
+#else
+#include <cstdio>
+#include <format>
+#include <print>
+#include <utility>
+
+template <class... Args>
+void dprint(
+  [[maybe_unused]] std::format_string<Args...> format,
+  [[maybe_unused]] Args&&... args) {
+#ifndef NDEBUG
+  std::println(
+    stderr,
+    "XRFrameTools: {}",
+    std::format(format, std::forward<Args>(args)...));
+#endif
+}
+#endif
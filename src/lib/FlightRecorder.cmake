@@ -0,0 +1,20 @@
+include_guard(DIRECTORY)
+
+include(BinaryLogWriter.cmake)
+include(PerformanceCounters.cmake)
+include(Win32Utils.cmake)
+
+add_library(
+  FlightRecorder
+  STATIC
+  FlightRecorder.cpp FlightRecorder.hpp
+)
+target_link_libraries(
+  FlightRecorder
+  PUBLIC
+  WIL::WIL
+  PRIVATE
+  BinaryLogWriter
+  PerformanceCounters
+  Win32Utils
+)
\ No newline at end of file
@@ -0,0 +1,229 @@
+// Copyright 2024 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+
+#include "FlightRecorder.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <format>
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+#include "BinaryLogWriter.hpp"
+#include "PerformanceCounterMath.hpp"
+#include "Win32Utils.hpp"
+
+namespace {
+
+std::wstring_view GetTriggerName(const FlightRecorder::Trigger trigger) {
+  using enum FlightRecorder::Trigger;
+  switch (trigger) {
+    case None:
+      return L"None";
+    case FrameInterval:
+      return L"FrameInterval";
+    case GpuTime:
+      return L"GpuTime";
+    case GpuThrottling:
+      return L"GpuThrottling";
+  }
+  std::unreachable();
+}
+
+// Shared by every recorder in the process, so a recorder that is recreated
+// because the settings changed can't reuse a name. File names only have
+// second resolution, so this is needed to keep two snapshots in the same
+// second from overwriting each other.
+std::atomic_uint32_t gSnapshotCount {};
+
+}// namespace
+
+FlightRecorder::FlightRecorder(const Settings& unclamped)
+  : mSettings(unclamped) {
+  // Callers should clamp too, so that `GetSettings()` compares equal to their
+  // settings; this is so that huge values can't exhaust the game's memory, or
+  // overflow `toTicks()`
+  const auto clamp = [](const auto duration) {
+    using T = std::remove_const_t<decltype(duration)>;
+    return std::clamp<T>(duration, T::zero(), MaxDuration);
+  };
+  const Settings settings {
+    .mPreTriggerDuration = clamp(unclamped.mPreTriggerDuration),
+    .mPostTriggerDuration = clamp(unclamped.mPostTriggerDuration),
+    .mFrameIntervalTrigger = clamp(unclamped.mFrameIntervalTrigger),
+    .mGpuTimeTrigger = clamp(unclamped.mGpuTimeTrigger),
+    .mGpuThrottlingTrigger = unclamped.mGpuThrottlingTrigger,
+  };
+
+  const auto frequency
+    = PerformanceCounterMath::CreateForLiveData().GetResolution();
+  const auto toTicks = [frequency](const auto duration) {
+    return (std::chrono::duration_cast<std::chrono::microseconds>(duration)
+              .count()
+            * frequency)
+      / 1'000'000;
+  };
+
+  mFrameIntervalTriggerTicks = toTicks(settings.mFrameIntervalTrigger);
+  mGpuTimeTriggerMicroseconds
+    = static_cast<uint64_t>(settings.mGpuTimeTrigger.count());
+  mPreTriggerTicks = toTicks(settings.mPreTriggerDuration);
+  mPostTriggerTicks = toTicks(settings.mPostTriggerDuration);
+
+  mMaxPostTriggerFrames
+    = settings.mPostTriggerDuration.count() * MaxFramesPerSecond;
+  const auto capacity = mMaxPostTriggerFrames
+    + (settings.mPreTriggerDuration.count() * MaxFramesPerSecond) + 1;
+  mRingBuffer.resize(capacity);
+  mDumpBuffer.resize(capacity);
+
+  mDumpThread = std::jthread {std::bind_front(&FlightRecorder::Run, this)};
+}
+
+FlightRecorder::~FlightRecorder() {
+  mDumpThread = {};
+}
+
+const FlightRecorder::Settings& FlightRecorder::GetSettings() const noexcept {
+  return mSettings;
+}
+
+FlightRecorder::Trigger FlightRecorder::Evaluate(
+  const FramePerformanceCounters& fpc) noexcept {
+  using Bits = FramePerformanceCounters::ValidDataBits;
+
+  const auto endFrameStop = fpc.mCore.mEndFrameStop;
+  const auto previousEndFrameStop
+    = std::exchange(mPreviousEndFrameStop, endFrameStop);
+
+  uint32_t newDecreaseReasons {};
+  if ((fpc.mValidDataBits & Bits::NVAPI) == Bits::NVAPI) {
+    const auto reasons = fpc.mGpuPerformanceInformation.mDecreaseReasons;
+    newDecreaseReasons
+      = reasons & ~std::exchange(mPreviousDecreaseReasons, reasons);
+  }
+
+  if (
+    mFrameIntervalTriggerTicks && previousEndFrameStop
+    && (endFrameStop - previousEndFrameStop) > mFrameIntervalTriggerTicks) {
+    return Trigger::FrameInterval;
+  }
+
+  if (
+    mGpuTimeTriggerMicroseconds
+    && (fpc.mValidDataBits & Bits::GpuTime) == Bits::GpuTime
+    && fpc.mRenderGpu > mGpuTimeTriggerMicroseconds) {
+    return Trigger::GpuTime;
+  }
+
+  if (mSettings.mGpuThrottlingTrigger && newDecreaseReasons) {
+    return Trigger::GpuThrottling;
+  }
+
+  return Trigger::None;
+}
+
+void FlightRecorder::LogFrame(const FramePerformanceCounters& fpc) noexcept {
+  // Avoid a 64-bit modulo in the hot path
+  mRingBuffer[mNextIndex] = fpc;
+  if (++mNextIndex == mRingBuffer.size()) {
+    mNextIndex = 0;
+  }
+  const auto index = mProduced++;
+
+  const auto trigger = this->Evaluate(fpc);
+  const auto now = fpc.mCore.mEndFrameStop;
+
+  if (mPendingTrigger == Trigger::None) {
+    if (trigger == Trigger::None) [[likely]] {
+      return;
+    }
+    TraceLoggingWrite(
+      gTraceProvider,
+      "FlightRecorder/Trigger",
+      TraceLoggingValue(std::to_underlying(trigger), "Trigger"),
+      TraceLoggingValue(fpc.mCore.mXrDisplayTime, "DisplayTime"));
+    mPendingTrigger = trigger;
+    mTriggerFrame = index;
+    mTriggerTime = now;
+  }
+
+  if (
+    (now - mTriggerTime) < mPostTriggerTicks
+    && (mProduced - mTriggerFrame) <= mMaxPostTriggerFrames) {
+    return;
+  }
+
+  this->QueueDump();
+  mPendingTrigger = Trigger::None;
+}
+
+void FlightRecorder::QueueDump() noexcept {
+  // Never wait for the writer thread
+  std::unique_lock lock(mDumpMutex, std::try_to_lock);
+  if (!(lock.owns_lock() && !mDumpPending)) {
+    TraceLoggingWrite(
+      gTraceProvider,
+      "FlightRecorder/DumpSkipped",
+      TraceLoggingValue(std::to_underlying(mPendingTrigger), "Trigger"));
+    return;
+  }
+
+  const auto size = mRingBuffer.size();
+  auto first = mProduced - std::min<uint64_t>(mProduced, size);
+  // The ring buffer is sized for high frame rates; skip anything older than
+  // we were asked to keep
+  while (first < mTriggerFrame
+         && (mTriggerTime - mRingBuffer[first % size].mCore.mEndFrameStop)
+           > mPreTriggerTicks) {
+    ++first;
+  }
+
+  mDumpFrameCount = 0;
+  for (auto i = first; i < mProduced; ++i) {
+    mDumpBuffer[mDumpFrameCount++] = mRingBuffer[i % size];
+  }
+  mDumpTrigger = mPendingTrigger;
+  mDumpPending = true;
+  mDumpEvent.SetEvent();
+}
+
+void FlightRecorder::Run(std::stop_token tok) {
+  SetThreadDescription(GetCurrentThread(), L"XRFrameTools Flight Recorder");
+
+  const std::stop_callback wakeOnStop(
+    tok, std::bind_front(&SetEvent, mDumpEvent.get()));
+
+  while (WaitForSingleObject(mDumpEvent.get(), INFINITE) == WAIT_OBJECT_0) {
+    Trigger trigger {};
+    size_t frameCount {};
+    {
+      std::unique_lock lock(mDumpMutex);
+      trigger = mDumpTrigger;
+      frameCount = mDumpPending ? mDumpFrameCount : 0;
+    }
+
+    // Finish any pending dump before checking for stop; it was probably why
+    // we started the flight recorder in the first place
+    if (frameCount) {
+      dprint(
+        L"flight recorder triggered by {}; writing {} frames",
+        GetTriggerName(trigger),
+        frameCount);
+      BinaryLogWriter::WriteSnapshot(
+        std::format(
+          L" - flight recorder {} - {}",
+          ++gSnapshotCount,
+          GetTriggerName(trigger)),
+        std::span {mDumpBuffer}.first(frameCount));
+
+      std::unique_lock lock(mDumpMutex);
+      mDumpPending = false;
+    }
+
+    if (tok.stop_requested()) {
+      return;
+    }
+  }
+}
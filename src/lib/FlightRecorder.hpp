@@ -0,0 +1,106 @@
+// Copyright 2024 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <Windows.h>
+#include <wil/resource.h>
+
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "FramePerformanceCounters.hpp"
+
+/** Keeps the most recent frames in memory, and writes them to a binary log
+ * when a trigger fires - e.g. a hitch.
+ *
+ * The log contains the frames from `mPreTriggerDuration` before the trigger
+ * until `mPostTriggerDuration` after it.
+ *
+ * `LogFrame()` does not allocate or wait for I/O: the ring buffer is allocated
+ * up front, and logs are written by a separate thread. If a trigger fires
+ * while a previous log is still being collected or written, it is ignored.
+ */
+class FlightRecorder final {
+ public:
+  // The buffers are allocated up front in the game process, for
+  // `MaxFramesPerSecond`; at this limit, they are about 15MB in total.
+  static constexpr std::chrono::seconds MaxDuration {60};
+
+  struct Settings {
+    // Each is clamped to `MaxDuration`
+    std::chrono::seconds mPreTriggerDuration {};
+    std::chrono::seconds mPostTriggerDuration {};
+
+    // Each trigger is disabled if zero/false, and clamped to `MaxDuration`
+    std::chrono::microseconds mFrameIntervalTrigger {};
+    std::chrono::microseconds mGpuTimeTrigger {};
+    // Fires when NVAPI reports a performance decrease reason that wasn't
+    // present in the previous frame
+    bool mGpuThrottlingTrigger {false};
+
+    bool operator==(const Settings&) const noexcept = default;
+  };
+
+  enum class Trigger : uint8_t {
+    None,
+    FrameInterval,
+    GpuTime,
+    GpuThrottling,
+  };
+
+  FlightRecorder() = delete;
+  FlightRecorder(const FlightRecorder&) = delete;
+  FlightRecorder(FlightRecorder&&) = delete;
+  FlightRecorder& operator=(const FlightRecorder&) = delete;
+  FlightRecorder& operator=(FlightRecorder&&) = delete;
+
+  explicit FlightRecorder(const Settings&);
+  ~FlightRecorder();
+
+  [[nodiscard]]
+  const Settings& GetSettings() const noexcept;
+
+  void LogFrame(const FramePerformanceCounters&) noexcept;
+
+ private:
+  // The ring buffer is sized for this frame rate; at lower rates, it holds
+  // more history than needed, and the excess is trimmed when writing.
+  static constexpr size_t MaxFramesPerSecond = 240;
+
+  Settings mSettings;
+
+  // Settings converted to native units, so `Evaluate()` is just comparisons
+  int64_t mFrameIntervalTriggerTicks {};
+  uint64_t mGpuTimeTriggerMicroseconds {};
+  int64_t mPreTriggerTicks {};
+  int64_t mPostTriggerTicks {};
+  uint64_t mMaxPostTriggerFrames {};
+
+  std::vector<FramePerformanceCounters> mRingBuffer;
+  size_t mNextIndex {};// mProduced % mRingBuffer.size()
+  uint64_t mProduced {};
+
+  int64_t mPreviousEndFrameStop {};
+  uint32_t mPreviousDecreaseReasons {};
+
+  // Set while collecting post-trigger frames
+  Trigger mPendingTrigger {Trigger::None};
+  uint64_t mTriggerFrame {};
+  int64_t mTriggerTime {};
+
+  // Owned by the writer thread while `mDumpPending` is true
+  std::mutex mDumpMutex;
+  std::vector<FramePerformanceCounters> mDumpBuffer;
+  size_t mDumpFrameCount {};
+  Trigger mDumpTrigger {Trigger::None};
+  bool mDumpPending {false};
+  wil::unique_event mDumpEvent {wil::EventOptions::None};
+  std::jthread mDumpThread;
+
+  [[nodiscard]]
+  Trigger Evaluate(const FramePerformanceCounters&) noexcept;
+  void QueueDump() noexcept;
+  void Run(std::stop_token);
+};
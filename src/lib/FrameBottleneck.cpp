@@ -0,0 +1,76 @@
+// Copyright 2024 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+
+#include "FrameBottleneck.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+void FrameBottleneckClassifier::Push(const Stages& stages) {
+  mAppCpu[mSize] = stages.mAppCpu;
+  mRenderCpu[mSize] = stages.mRenderCpu;
+  mRenderGpu[mSize] = stages.mRenderGpu;
+  mCompositorCpu[mSize] = stages.mCompositorCpu;
+  if (++mSize == BatchSize) {
+    this->ClassifyBatch();
+  }
+}
+
+FrameBottleneckClassifier::Counts FrameBottleneckClassifier::Flush() {
+  this->ClassifyBatch();
+  return std::exchange(mCounts, {});
+}
+
+void FrameBottleneckClassifier::ClassifyBatch() {
+  if (mSize == 0) {
+    return;
+  }
+
+  std::array<FrameBottleneck, BatchSize> bottlenecks;
+  Classify(
+    std::span {mAppCpu}.first(mSize),
+    std::span {mRenderCpu}.first(mSize),
+    std::span {mRenderGpu}.first(mSize),
+    std::span {mCompositorCpu}.first(mSize),
+    std::span {bottlenecks}.first(mSize));
+
+  for (size_t i = 0; i < FrameBottleneckCount; ++i) {
+    mCounts[i] += static_cast<uint32_t>(std::ranges::count(
+      bottlenecks.begin(),
+      bottlenecks.begin() + mSize,
+      static_cast<FrameBottleneck>(i)));
+  }
+  mSize = 0;
+}
+
+void FrameBottleneckClassifier::Classify(
+  const std::span<const int64_t> appCpu,
+  const std::span<const int64_t> renderCpu,
+  const std::span<const int64_t> renderGpu,
+  const std::span<const int64_t> compositorCpu,
+  const std::span<FrameBottleneck> out) {
+  assert(appCpu.size() == out.size());
+  assert(renderCpu.size() == out.size());
+  assert(renderGpu.size() == out.size());
+  assert(compositorCpu.size() == out.size());
+
+  // Only selects in the loop body, so the compiler can vectorize it
+  using enum FrameBottleneck;
+  for (size_t i = 0; i < out.size(); ++i) {
+    const auto app = appCpu[i];
+    const auto render = renderCpu[i];
+    const auto compositor = compositorCpu[i];
+    const auto interval = app + render + compositor;
+
+    const auto cpu = (app >= render) ? AppCpu : RenderCpu;
+    const auto cpuTime = std::max(app, render);
+    const auto cpuOrCompositor = (compositor > cpuTime) ? Compositor : cpu;
+    // 'almost the entire frame' is 90%
+    const auto gpuBound = (renderGpu[i] * 10) >= (interval * 9);
+    const auto unknown = (interval <= 0) || (renderGpu[i] <= 0);
+
+    out[i] = unknown ? Unknown
+      : gpuBound     ? RenderGpu
+                     : cpuOrCompositor;
+  }
+}
@@ -0,0 +1,72 @@
+// Copyright 2024 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <utility>
+
+/// The stage on a frame's critical path
+enum class FrameBottleneck : uint8_t {
+  Unknown,
+  AppCpu,
+  RenderCpu,
+  RenderGpu,
+  // Time in `xrWaitFrame()`, `xrBeginFrame()`, and `xrEndFrame()`; usually
+  // waiting for the next display refresh, i.e. the frame was on time
+  Compositor,
+};
+static constexpr size_t FrameBottleneckCount
+  = std::to_underlying(FrameBottleneck::Compositor) + 1;
+
+/** Labels each frame with a `FrameBottleneck`, and counts the labels.
+ *
+ * This uses the 'flattened' timing diagram from `MetricsAggregator`, where the
+ * CPU stages add up to the frame interval; the GPU runs in parallel, so it is
+ * the bottleneck if it was busy for almost the entire frame interval.
+ * Otherwise, the bottleneck is the CPU stage that took the longest.
+ *
+ * Without GPU time, a GPU-bound frame can't be told apart from a CPU-bound
+ * one, so these frames are `Unknown`.
+ *
+ * Frames are batched into structure-of-arrays form, and classified without
+ * branches, so that classification can be vectorized.
+ */
+class FrameBottleneckClassifier final {
+ public:
+  static constexpr size_t BatchSize = 64;
+  using Counts = std::array<uint32_t, FrameBottleneckCount>;
+
+  // All in microseconds
+  struct Stages {
+    int64_t mAppCpu {};
+    int64_t mRenderCpu {};
+    // 0 if GPU time wasn't measured
+    int64_t mRenderGpu {};
+    int64_t mCompositorCpu {};
+  };
+
+  void Push(const Stages&);
+  /// Counts for every frame pushed since the last call
+  [[nodiscard]]
+  Counts Flush();
+
+  /// All spans must be the same size
+  static void Classify(
+    std::span<const int64_t> appCpu,
+    std::span<const int64_t> renderCpu,
+    std::span<const int64_t> renderGpu,
+    std::span<const int64_t> compositorCpu,
+    std::span<FrameBottleneck> out);
+
+ private:
+  alignas(64) std::array<int64_t, BatchSize> mAppCpu {};
+  alignas(64) std::array<int64_t, BatchSize> mRenderCpu {};
+  alignas(64) std::array<int64_t, BatchSize> mRenderGpu {};
+  alignas(64) std::array<int64_t, BatchSize> mCompositorCpu {};
+  size_t mSize {};
+  Counts mCounts {};
+
+  void ClassifyBatch();
+};
@@ -0,0 +1,14 @@
+include_guard(DIRECTORY)
+
+include(FrameMetrics.cmake)
+
+add_library(
+  FrameEventDetector
+  STATIC
+  FrameEventDetector.cpp FrameEventDetector.hpp
+)
+target_link_libraries(
+  FrameEventDetector
+  PRIVATE
+  FrameMetrics
+)
@@ -0,0 +1,218 @@
+// Copyright 2024 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+
+#include "FrameEventDetector.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <optional>
+
+void FrameEventDetector::RollingMedian::Push(const float value) {
+  if (mSize == WindowSize) {
+    const auto oldest = mHistory[mNext];
+    const auto it
+      = std::lower_bound(mSorted.begin(), mSorted.begin() + mSize, oldest);
+    std::shift_left(it, mSorted.begin() + mSize, 1);
+    --mSize;
+  }
+
+  const auto end = mSorted.begin() + mSize;
+  const auto it = std::upper_bound(mSorted.begin(), end, value);
+  std::shift_right(it, end + 1, 1);
+  *it = value;
+  ++mSize;
+
+  mHistory[mNext] = value;
+  mNext = (mNext + 1) % WindowSize;
+}
+
+float FrameEventDetector::RollingMedian::Get() const noexcept {
+  if (mSize == 0) {
+    return 0.0f;
+  }
+  return mSorted[mSize / 2];
+}
+
+std::span<const FrameEventDetector::Event> FrameEventDetector::Push(
+  const FrameMetrics& frame) {
+  mCompletedCount = 0;
+  if (frame.mFrameCount == 0) {
+    return {};
+  }
+
+  using Bits = FramePerformanceCounters::ValidDataBits;
+  const auto haveGpuTime
+    = (frame.mValidDataBits & Bits::GpuTime) == Bits::GpuTime;
+  const auto frameEnd = frame.mSinceFirstFrame;
+  const auto frameStart = frameEnd - frame.mSincePreviousFrame;
+
+  const auto us = [](const std::chrono::microseconds value) {
+    return static_cast<float>(value.count());
+  };
+  std::array<float, StageCount> values {};
+  values[std::to_underlying(Stage::FrameInterval)]
+    = us(frame.mSincePreviousFrame);
+  values[std::to_underlying(Stage::AppCpu)] = us(frame.mAppCpu);
+  values[std::to_underlying(Stage::RenderCpu)] = us(frame.mRenderCpu);
+  values[std::to_underlying(Stage::SubmitCpu)] = us(frame.mEndFrameCpu);
+  values[std::to_underlying(Stage::RenderGpu)] = us(frame.mRenderGpu);
+
+  // The stage in this frame with the highest z-score above `HitchZScore`
+  struct Worst {
+    Stage mStage {};
+    float mZScore {};
+    float mValue {};
+    float mBaseline {};
+  };
+  std::optional<Worst> worst;
+  // Bitmasks of `Stage`s
+  uint32_t hitchStages {};
+  uint32_t steppedUp {};
+
+  for (size_t i = 0; i < StageCount; ++i) {
+    const auto stage = static_cast<Stage>(i);
+    if (stage == Stage::RenderGpu && !haveGpuTime) {
+      continue;
+    }
+
+    auto& state = mStages[i];
+    const auto value = values[i];
+    const auto median = state.mMedian.Get();
+    const auto ready = state.mMedian.size() >= MinimumSamples;
+    if (state.mMedian.size()) {
+      state.mDeviation.Push(std::abs(value - median));
+    }
+    state.mMedian.Push(value);
+    if (!ready) {
+      continue;
+    }
+
+    const auto scale = std::max(
+      state.mDeviation.Get() * MADToStandardDeviation, MinimumScale);
+    const auto z = (value - median) / scale;
+    // After a step, the new level isn't a hitch while the median catches up
+    if (z > HitchZScore && !state.mCooldown) {
+      hitchStages |= 1u << i;
+      if (z > (worst ? worst->mZScore : 0.0f)) {
+        worst = Worst {stage, z, value, median};
+      }
+    }
+
+    if (state.mCooldown) {
+      --state.mCooldown;
+      continue;
+    }
+
+    const auto clamped = std::clamp(z, -StepClamp, StepClamp);
+    const auto track = [&](
+                         float& cusum,
+                         const float change,
+                         Event& candidate,
+                         double& sum,
+                         const Kind kind) {
+      if (cusum == 0.0f) {
+        candidate = {
+          .mKind = kind,
+          .mStage = stage,
+          .mStart = frameStart,
+          .mStartTime = frame.mLastEndFrameStop,
+          .mBaseline = median,
+        };
+        sum = 0;
+      }
+      cusum = std::max(0.0f, cusum + change - StepDrift);
+      candidate.mFrameCount += frame.mFrameCount;
+      sum += static_cast<double>(value) * frame.mFrameCount;
+      if (cusum <= StepThreshold) {
+        return false;
+      }
+
+      candidate.mDuration = frameEnd - candidate.mStart;
+      candidate.mValue = static_cast<float>(sum / candidate.mFrameCount);
+      candidate.mGpuPerformanceDecreaseReasons
+        = frame.mGpuPerformanceDecreaseReasons;
+      mCompleted[mCompletedCount++] = candidate;
+      return true;
+    };
+    const auto up = track(
+      state.mUp, clamped, state.mUpCandidate, state.mUpSum, Kind::StepUp);
+    if (
+      up
+      || track(
+        state.mDown,
+        -clamped,
+        state.mDownCandidate,
+        state.mDownSum,
+        Kind::StepDown)) {
+      if (up) {
+        steppedUp |= 1u << i;
+      }
+      state.mUp = 0;
+      state.mDown = 0;
+      state.mCooldown = WindowSize;
+    }
+  }
+
+  if (worst) {
+    // A pending hitch is continued rather than replaced, as the gap might
+    // just be a noisy frame
+    if (!(mInHitch || mHitchPending)) {
+      mHitch = {
+        .mKind = Kind::Hitch,
+        .mStart = frameStart,
+        .mStartTime = frame.mLastEndFrameStop,
+      };
+      mHitchPeakZScore = 0;
+      mHitchStages = 0;
+    }
+    mInHitch = true;
+    mHitchPending = false;
+    mHitchStages |= hitchStages;
+    if (worst->mZScore > mHitchPeakZScore) {
+      mHitchPeakZScore = worst->mZScore;
+      mHitch.mStage = worst->mStage;
+      mHitch.mValue = worst->mValue;
+      mHitch.mBaseline = worst->mBaseline;
+    }
+    mHitch.mFrameCount += frame.mFrameCount;
+    mHitch.mDuration = frameEnd - mHitch.mStart;
+    mHitch.mGpuPerformanceDecreaseReasons
+      |= frame.mGpuPerformanceDecreaseReasons;
+  } else if (mInHitch) {
+    mInHitch = false;
+    mHitchPending = true;
+  }
+
+  if ((mInHitch || mHitchPending) && (mHitchStages & steppedUp)) {
+    mInHitch = false;
+    mHitchPending = false;
+  } else if (mHitchPending && this->IsSettled(mHitchStages)) {
+    this->EndHitch();
+  }
+
+  return {mCompleted.data(), mCompletedCount};
+}
+
+bool FrameEventDetector::IsSettled(const uint32_t stages) const noexcept {
+  for (size_t i = 0; i < StageCount; ++i) {
+    if ((stages & (1u << i)) && mStages[i].mUp > 0.0f) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::span<const FrameEventDetector::Event> FrameEventDetector::Finish() {
+  mCompletedCount = 0;
+  // There's no way to tell if a pending hitch was the start of a step
+  if (mInHitch || mHitchPending) {
+    this->EndHitch();
+  }
+  return {mCompleted.data(), mCompletedCount};
+}
+
+void FrameEventDetector::EndHitch() {
+  mCompleted[mCompletedCount++] = mHitch;
+  mInHitch = false;
+  mHitchPending = false;
+}
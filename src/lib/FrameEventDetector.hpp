@@ -0,0 +1,151 @@
+// Copyright 2024 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <span>
+#include <utility>
+
+#include "FrameMetrics.hpp"
+
+/** Finds hitches and step changes in a stream of frames.
+ *
+ * For each stage, every frame gets a robust z-score: the difference from a
+ * rolling median, divided by a rolling median absolute deviation.
+ *
+ * - a *hitch* is a run of frames where any stage has a z-score above
+ *   `HitchZScore`, e.g. shader compilation
+ * - a *step* is a sustained change in a stage, found with a two-sided CUSUM of
+ *   the (clamped) z-scores, e.g. the GPU starting to throttle
+ *
+ * The start of a step looks like a hitch, so hitches are only reported once
+ * the CUSUMs of their stages have returned to zero; if one of those stages
+ * steps up first, the hitch was the start of the step, and is discarded.
+ * Stages can't hitch while the median catches up after a step.
+ *
+ * Memory use is fixed, and each frame takes constant time.
+ */
+class FrameEventDetector final {
+ public:
+  enum class Stage : uint8_t {
+    FrameInterval,
+    AppCpu,
+    RenderCpu,
+    SubmitCpu,
+    RenderGpu,
+  };
+  static constexpr size_t StageCount
+    = std::to_underlying(Stage::RenderGpu) + 1;
+
+  enum class Kind : uint8_t {
+    Hitch,
+    StepUp,
+    StepDown,
+  };
+
+  struct Event {
+    Kind mKind {};
+    // For hitches, the stage with the highest z-score
+    Stage mStage {};
+    // Since the first frame; for steps, this is the estimated onset
+    std::chrono::microseconds mStart {};
+    // For steps, the time from the onset to detection
+    std::chrono::microseconds mDuration {};
+    // `FrameMetrics::mLastEndFrameStop` of the first frame in the event
+    int64_t mStartTime {};
+    uint32_t mFrameCount {};
+    // In microseconds; the rolling median at the start of the event
+    float mBaseline {};
+    // In microseconds; for hitches, the worst frame; for steps, the mean
+    // since the onset
+    float mValue {};
+    // `GpuPerformanceInfo::DecreaseReason` bits during the event; for steps,
+    // the bits at the time of detection
+    uint32_t mGpuPerformanceDecreaseReasons {};
+  };
+
+  static constexpr float HitchZScore = 6.0f;
+
+  /** Add a frame, or a row from `MetricsAggregator`.
+   *
+   * Returns the events that were completed by this frame; this is valid until
+   * the next call. Hitches are usually completed a few frames after they end.
+   */
+  [[nodiscard]]
+  std::span<const Event> Push(const FrameMetrics&);
+  /// End any hitch that is still in progress
+  [[nodiscard]]
+  std::span<const Event> Finish();
+
+ private:
+  // Frames in the rolling window; about 1.4 seconds at 90hz
+  static constexpr size_t WindowSize = 127;
+  // Don't trust the median until there are this many samples
+  static constexpr size_t MinimumSamples = 32;
+  // Avoid huge z-scores when a stage is extremely consistent
+  static constexpr float MinimumScale = 250.0f;
+  // 1 / (the MAD of a standard normal distribution)
+  static constexpr float MADToStandardDeviation = 1.4826f;
+
+  // CUSUM parameters, in standard deviations; each frame contributes at most
+  // `StepClamp - StepDrift`, so a step must last at least
+  // `StepThreshold / (StepClamp - StepDrift)` frames
+  static constexpr float StepClamp = 3.0f;
+  static constexpr float StepDrift = 1.0f;
+  static constexpr float StepThreshold = 30.0f;
+
+  // Exact median of the last `WindowSize` values
+  class RollingMedian {
+   public:
+    void Push(float);
+    [[nodiscard]]
+    float Get() const noexcept;
+    [[nodiscard]]
+    size_t size() const noexcept {
+      return mSize;
+    }
+
+   private:
+    std::array<float, WindowSize> mHistory {};
+    std::array<float, WindowSize> mSorted {};
+    size_t mSize {};
+    size_t mNext {};
+  };
+
+  struct StageState {
+    RollingMedian mMedian;
+    // Median absolute deviation, from each value's difference from the
+    // median at the time
+    RollingMedian mDeviation;
+
+    float mUp {};
+    float mDown {};
+    Event mUpCandidate {};
+    Event mDownCandidate {};
+    double mUpSum {};
+    double mDownSum {};
+    // Frames until steps are detected again; the median takes time to catch
+    // up after a step
+    size_t mCooldown {};
+  };
+
+  std::array<StageState, StageCount> mStages {};
+
+  bool mInHitch {false};
+  // The hitch has ended, but might still be the start of a step
+  bool mHitchPending {false};
+  Event mHitch {};
+  float mHitchPeakZScore {};
+  // Bit `i` is set if stage `i` was above `HitchZScore` during the hitch
+  uint32_t mHitchStages {};
+
+  // Up to one hitch, and one step per stage
+  std::array<Event, StageCount + 1> mCompleted {};
+  size_t mCompletedCount {};
+
+  void EndHitch();
+  [[nodiscard]]
+  bool IsSettled(uint32_t stages) const noexcept;
+};
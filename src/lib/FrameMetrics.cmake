@@ -6,6 +6,8 @@ add_library(
   FrameMetrics
   STATIC
   FrameMetrics.cpp FrameMetrics.hpp
+  FrameBottleneck.cpp FrameBottleneck.hpp
+  FramePacingAnalyzer.cpp FramePacingAnalyzer.hpp
   MetricsAggregator.cpp MetricsAggregator.hpp
 )
 target_link_libraries(
@@ -2,10 +2,10 @@
 // SPDX-License-Identifier: MIT
 #pragma once
 
-#include <dxgi1_4.h>
-
+#include <array>
 #include <chrono>
 
+#include "FrameBottleneck.hpp"
 #include "FramePerformanceCounters.hpp"
 
 struct FrameMetrics {
@@ -13,7 +13,7 @@ struct FrameMetrics {
   std::chrono::microseconds mSincePreviousFrame {};
   std::chrono::microseconds mSinceFirstFrame {};
   uint64_t mLastXrDisplayTime {};
-  LARGE_INTEGER mLastEndFrameStop {};
+  int64_t mLastEndFrameStop {};
 
   uint64_t mValidDataBits {};
 
@@ -27,7 +27,7 @@ struct FrameMetrics {
 
   std::chrono::microseconds mRenderGpu {};
 
-  DXGI_QUERY_VIDEO_MEMORY_INFO mVideoMemoryInfo {};
+  FramePerformanceCounters::VideoMemoryInfo mVideoMemoryInfo {};
 
   uint32_t mGpuPerformanceDecreaseReasons {};
   uint32_t mGpuPStateMin {};
@@ -39,4 +39,42 @@ struct FrameMetrics {
   uint32_t mGpuMemoryKHzMax {};
 
   FramePerformanceCounters::EncoderInfo mEncoders;
+
+  // From `FramePacingAnalyzer`; all zero if the display period is unknown
+  struct Pacing {
+    std::chrono::microseconds mDisplayPeriod {};
+    // Mean
+    std::chrono::microseconds mJitter {};
+    // Frames that missed their display slot
+    uint32_t mLateFrameCount {};
+    uint32_t mSkippedSlots {};
+    uint32_t mRepeatedSlots {};
+    uint32_t mReserved {};
+  } mPacing;
+
+  // Number of frames with each `FrameBottleneck`
+  std::array<uint32_t, FrameBottleneckCount> mBottleneckFrameCounts {};
+  uint32_t mReserved {};
+
+  // Means of the distinct `HostMetrics::Cpu` samples in these frames
+  struct HostCpu {
+    uint32_t mSampleCount {};
+    uint32_t mFrequencyMHz {};
+    // Hundredths of a percent
+    uint32_t mUtilization {};
+    uint32_t mBusiestCoreUtilization {};
+    uint32_t mSampleCostMicroseconds {};
+    uint32_t mReserved {};
+  } mHostCpu;
+
+  // Means of the distinct `HostMetrics::Process` samples, except for
+  // `mPageFaults`, which is the total
+  struct ProcessResources {
+    uint32_t mSampleCount {};
+    // Hundredths of a percent of all logical processors
+    uint32_t mCpuUtilization {};
+    uint64_t mWorkingSetBytes {};
+    uint64_t mPrivateBytes {};
+    uint64_t mPageFaults {};
+  } mProcessResources;
 };
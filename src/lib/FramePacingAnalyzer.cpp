@@ -0,0 +1,79 @@
+// Copyright 2024 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+
+#include "FramePacingAnalyzer.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <utility>
+
+std::optional<FramePacingAnalyzer::Result> FramePacingAnalyzer::Push(
+  const uint64_t xrDisplayTime,
+  const uint64_t representedFrames) {
+  if (!xrDisplayTime) {
+    return std::nullopt;
+  }
+  const auto previous = std::exchange(mPreviousDisplayTime, xrDisplayTime);
+  if (!previous || xrDisplayTime < previous) {
+    // First frame, or a new session
+    return std::nullopt;
+  }
+
+  const auto frames
+    = static_cast<int64_t>(std::max<uint64_t>(representedFrames, 1));
+  const auto interval = static_cast<int64_t>(xrDisplayTime - previous);
+  // If frames weren't logged, we can't tell how many slots each took; e.g. 10
+  // frames in 11 slots would look like a slower display
+  if (frames == 1 && interval > 0) {
+    this->UpdateDisplayPeriod(interval);
+  }
+  if (!mDisplayPeriod) {
+    return std::nullopt;
+  }
+
+  const auto slots = (interval + (mDisplayPeriod / 2)) / mDisplayPeriod;
+  const auto error = interval - (slots * mDisplayPeriod);
+  Result ret {
+    .mDisplayPeriod = std::chrono::nanoseconds {mDisplayPeriod},
+    .mJitter = std::chrono::nanoseconds {std::abs(error)},
+  };
+  if (slots > frames) {
+    ret.mIsLate = true;
+    ret.mSkippedSlots = static_cast<uint32_t>(slots - frames);
+  } else if (slots < frames) {
+    ret.mRepeatedSlots = static_cast<uint32_t>(frames - slots);
+  }
+  return ret;
+}
+
+std::chrono::nanoseconds FramePacingAnalyzer::GetDisplayPeriod()
+  const noexcept {
+  return std::chrono::nanoseconds {mDisplayPeriod};
+}
+
+void FramePacingAnalyzer::UpdateDisplayPeriod(const int64_t interval) {
+  if (!mDisplayPeriod) {
+    mDisplayPeriod = interval;
+    mUnexplainedIntervals = 0;
+    return;
+  }
+
+  const auto slots = (interval + (mDisplayPeriod / 2)) / mDisplayPeriod;
+  const auto error = interval - (slots * mDisplayPeriod);
+  if (std::abs(error) <= mDisplayPeriod / 4) {
+    mUnexplainedIntervals = 0;
+    if (slots == 1) {
+      // Smooth out rounding in the predicted times
+      mDisplayPeriod += error / 16;
+    }
+    return;
+  }
+
+  // e.g. the display switched from 90hz to 72hz or 120hz, or the first
+  // interval was a missed slot. A single unexplained interval - e.g. a
+  // glitch in the predicted times - isn't enough to change the period.
+  if (++mUnexplainedIntervals >= RedetectThreshold) {
+    mDisplayPeriod = interval;
+    mUnexplainedIntervals = 0;
+  }
+}
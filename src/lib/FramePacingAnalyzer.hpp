@@ -0,0 +1,60 @@
+// Copyright 2024 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+
+/** Infers whether frames hit their display slots, from the sequence of
+ * predicted display times (`xrWaitFrame()`'s `XrFrameState`).
+ *
+ * Runtimes predict display times on the display's refresh grid, so the
+ * display period is inferred as the shortest regular interval between them;
+ * each interval is then classified as a whole number of display periods.
+ *
+ * Uses constant memory, so it can be used for streaming and live data.
+ */
+class FramePacingAnalyzer final {
+ public:
+  struct Result {
+    std::chrono::nanoseconds mDisplayPeriod {};
+    // Difference between the interval and a whole number of display periods
+    std::chrono::nanoseconds mJitter {};
+    // The frame was displayed more than one display period after the
+    // previous frame, i.e. it missed its display slot
+    bool mIsLate {false};
+    // Display slots that had no new frame, e.g. were reprojected
+    uint32_t mSkippedSlots {};
+    // Frames that were predicted to be displayed in the same slot as another
+    uint32_t mRepeatedSlots {};
+  };
+
+  /** Add a frame's predicted display time, in nanoseconds.
+   *
+   * If the frame was logged in place of others, `representedFrames` should be
+   * the number of frames it represents; these intervals are classified, but
+   * not used to infer the display period.
+   *
+   * Returns `std::nullopt` until the display period is known.
+   */
+  [[nodiscard]]
+  std::optional<Result> Push(
+    uint64_t xrDisplayTime,
+    uint64_t representedFrames = 1);
+
+  [[nodiscard]]
+  std::chrono::nanoseconds GetDisplayPeriod() const noexcept;
+
+ private:
+  // If this many consecutive intervals aren't a whole number of display
+  // periods, the refresh rate has probably changed, or was wrong to start
+  // with
+  static constexpr uint32_t RedetectThreshold = 32;
+
+  uint64_t mPreviousDisplayTime {};
+  int64_t mDisplayPeriod {};
+  uint32_t mUnexplainedIntervals {};
+
+  void UpdateDisplayPeriod(int64_t interval);
+};
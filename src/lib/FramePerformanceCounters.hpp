@@ -2,11 +2,17 @@
 // SPDX-License-Identifier: MIT
 #pragma once
 
-#include <Windows.h>
-#include <dxgi1_4.h>
-
 #include <array>
+#include <cstdint>
+#include <utility>
+
+#include "HostMetrics.hpp"
 
+/* Everything that is recorded about a frame.
+ *
+ * This is shared memory and binary log data, so it is platform-neutral; the
+ * Windows types it replaces have identical layouts.
+ */
 struct FramePerformanceCounters {
   // Used for BinLog
   static constexpr auto Version = "2025-06-05#01";
@@ -16,6 +22,8 @@ struct FramePerformanceCounters {
     VRAM = 1 << 1,
     NVAPI = 1 << 2,
     NVEnc = 1 << 3,
+    HostCpu = 1 << 4,
+    ProcessResources = 1 << 5,
   };
 
   uint64_t mValidDataBits {};
@@ -24,21 +32,38 @@ struct FramePerformanceCounters {
     uint64_t mXrDisplayTime {};
 
     // All values are from QueryPerformanceCounters
-    LARGE_INTEGER mWaitFrameStart {};
-    LARGE_INTEGER mWaitFrameStop {};
-    LARGE_INTEGER mBeginFrameStart {};
-    LARGE_INTEGER mBeginFrameStop {};
-    LARGE_INTEGER mEndFrameStart {};
-    LARGE_INTEGER mEndFrameStop {};
+    int64_t mWaitFrameStart {};
+    int64_t mWaitFrameStop {};
+    int64_t mBeginFrameStart {};
+    int64_t mBeginFrameStop {};
+    int64_t mEndFrameStart {};
+    int64_t mEndFrameStop {};
   } mCore;
 
   // d3d11_metrics
   uint64_t mRenderGpu {};// microseconds
-  DXGI_QUERY_VIDEO_MEMORY_INFO mVideoMemoryInfo {};
+
+  // As `DXGI_QUERY_VIDEO_MEMORY_INFO`
+  struct VideoMemoryInfo {
+    uint64_t mBudget {};
+    uint64_t mCurrentUsage {};
+    uint64_t mAvailableForReservation {};
+    uint64_t mCurrentReservation {};
+  } mVideoMemoryInfo {};
 
   // Currently only valid if (mValidData & NVAPI)
   struct GpuPerformanceInfo {
-    uint32_t mDecreaseReasons {};// NVAPI_GPU_PERF_DECREASE bitmask
+    // `NV_GPU_PERF_DECREASE_REASON_*` values, so that readers don't need
+    // `nvapi.h`; the nvapi layer asserts that these match
+    enum DecreaseReason : uint32_t {
+      ThermalProtection = 0x1,
+      PowerControl = 0x2,
+      ACBattery = 0x4,
+      APITriggered = 0x8,
+      InsufficientPower = 0x10,
+    };
+
+    uint32_t mDecreaseReasons {};// `DecreaseReason` bitmask
     uint32_t mPState {};// NVAPI_GPU_PSTATE_ID
     uint32_t mGraphicsKHz {};// NVAPI_GPU_PUBLIC_CLOCK_GRAPHICS
     uint32_t mMemoryKHz {};// NVAPI_GPU_PUBLIC_CLOCK_MEMORY
@@ -54,11 +79,16 @@ struct FramePerformanceCounters {
     std::array<Session, 4> mSessions {};
     uint32_t mSessionCount {};
   } mEncoders;
+
+  // core_metrics; these are sampled less often than frames are produced, so
+  // consecutive frames usually have the same sample
+  HostMetrics::Cpu mHostCpu {};
+  HostMetrics::Process mProcessResources {};
 };
 
 // Increase this if you add additional members; this assertion is here to make
 // sure the struct is the same size in 32-bit and 64-bit builds
-static_assert(sizeof(FramePerformanceCounters) == 192);
+static_assert(sizeof(FramePerformanceCounters) == 256);
 
 constexpr uint64_t& operator|=(
   uint64_t& lhs,
@@ -0,0 +1,20 @@
+include_guard(DIRECTORY)
+
+add_library(
+  HostMetrics
+  STATIC
+  HostMetrics.hpp
+)
+if(WIN32)
+  include(Win32Utils.cmake)
+  target_sources(HostMetrics PRIVATE Win32HostMetricsSource.cpp)
+  target_link_libraries(
+    HostMetrics
+    PRIVATE
+    WIL::WIL
+    Win32Utils
+    pdh
+  )
+else()
+  target_sources(HostMetrics PRIVATE ProcHostMetricsSource.cpp)
+endif()
\ No newline at end of file
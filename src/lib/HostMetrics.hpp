@@ -0,0 +1,68 @@
+// Copyright 2024 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+
+/* System context for frames: what the rest of the machine, and the process
+ * as a whole, were doing.
+ *
+ * This header is platform-neutral, so that sources can be built and tested on
+ * other platforms; it must not include `<Windows.h>`.
+ */
+namespace HostMetrics {
+
+struct Cpu {
+  // Platform performance counter - `QueryPerformanceCounter()` on Windows,
+  // `CLOCK_MONOTONIC` nanoseconds on Linux; 0 if this sample is unavailable
+  int64_t mSampleTime {};
+  // Mean across all logical processors
+  uint32_t mFrequencyMHz {};
+  // Since the previous sample, in hundredths of a percent
+  uint32_t mUtilization {};
+  uint32_t mBusiestCoreUtilization {};
+  uint32_t mLogicalProcessorCount {};
+  // Time taken to collect this sample, including `Process`
+  uint32_t mSampleCostMicroseconds {};
+  uint32_t mReserved {};
+};
+static_assert(sizeof(Cpu) == 32);
+
+struct Process {
+  // As `Cpu::mSampleTime`
+  int64_t mSampleTime {};
+  uint64_t mWorkingSetBytes {};
+  uint64_t mPrivateBytes {};
+  // Since the previous sample
+  uint32_t mPageFaults {};
+  // Since the previous sample, in hundredths of a percent of all logical
+  // processors
+  uint32_t mCpuUtilization {};
+};
+static_assert(sizeof(Process) == 32);
+
+struct Sample {
+  Cpu mCpu {};
+  Process mProcess {};
+};
+
+/** Collects `Sample`s for the current process.
+ *
+ * Values that are 'since the previous sample' are zero in the first sample.
+ * Not thread-safe; this is intended to be called from a `MetricsSampler`.
+ */
+class Source {
+ public:
+  virtual ~Source() = default;
+
+  [[nodiscard]]
+  virtual std::optional<Sample> GetSample() = 0;
+
+  /// The implementation for the current platform
+  [[nodiscard]]
+  static std::unique_ptr<Source> Create();
+};
+
+}// namespace HostMetrics
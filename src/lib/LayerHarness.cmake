@@ -0,0 +1,15 @@
+include_guard(DIRECTORY)
+
+add_library(
+  LayerHarness
+  STATIC
+  EXCLUDE_FROM_ALL
+  LayerHarness.cpp LayerHarness.hpp
+)
+target_link_libraries(
+  LayerHarness
+  PUBLIC
+  openxr
+  PRIVATE
+  WIL::WIL
+)
@@ -0,0 +1,382 @@
+// Copyright 2024 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+
+#include "LayerHarness.hpp"
+
+#include <openxr/openxr_loader_negotiation.h>
+#include <wil/resource.h>
+
+#include <atomic>
+#include <format>
+#include <stdexcept>
+#include <string_view>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+template <class T>
+T MakeFakeHandle(const uint64_t value) {
+  // Handles are pointers in 64-bit builds, but `uint64_t` in 32-bit builds
+  if constexpr (std::is_pointer_v<T>) {
+    return reinterpret_cast<T>(static_cast<uintptr_t>(value));
+  } else {
+    return static_cast<T>(value);
+  }
+}
+
+const auto FakeInstance = MakeFakeHandle<XrInstance>(0x1234);
+const auto FakeSession = MakeFakeHandle<XrSession>(0x5678);
+
+struct FakeRuntime {
+  // Arbitrary, but non-zero, and large enough to look like a real XrTime
+  XrTime mNextDisplayTime {1'000'000'000};
+  XrDuration mDisplayPeriod {1'000'000'000 / 90};
+
+  std::chrono::nanoseconds mNextCallDuration {};
+  std::chrono::nanoseconds mLastCallDuration {};
+};
+FakeRuntime gRuntime;
+std::atomic_flag gHaveInstance;
+
+class RuntimeCallScope {
+ public:
+  RuntimeCallScope() : mStart(Clock::now()) {
+    LayerHarness::Spin(std::exchange(gRuntime.mNextCallDuration, {}));
+  }
+
+  ~RuntimeCallScope() {
+    gRuntime.mLastCallDuration = Clock::now() - mStart;
+  }
+
+ private:
+  Clock::time_point mStart;
+};
+
+XRAPI_ATTR XrResult XRAPI_CALL fake_xrWaitFrame(
+  XrSession session,
+  const XrFrameWaitInfo*,
+  XrFrameState* frameState) {
+  const RuntimeCallScope scope;
+  if (session != FakeSession) {
+    return XR_ERROR_HANDLE_INVALID;
+  }
+  frameState->predictedDisplayTime = gRuntime.mNextDisplayTime;
+  frameState->predictedDisplayPeriod = gRuntime.mDisplayPeriod;
+  frameState->shouldRender = XR_TRUE;
+  gRuntime.mNextDisplayTime += gRuntime.mDisplayPeriod;
+  return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL
+fake_xrBeginFrame(XrSession session, const XrFrameBeginInfo*) {
+  const RuntimeCallScope scope;
+  if (session != FakeSession) {
+    return XR_ERROR_HANDLE_INVALID;
+  }
+  return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL
+fake_xrEndFrame(XrSession session, const XrFrameEndInfo*) {
+  const RuntimeCallScope scope;
+  if (session != FakeSession) {
+    return XR_ERROR_HANDLE_INVALID;
+  }
+  return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL fake_xrCreateSession(
+  XrInstance instance,
+  const XrSessionCreateInfo*,
+  XrSession* session) {
+  if (instance != FakeInstance) {
+    return XR_ERROR_HANDLE_INVALID;
+  }
+  // No graphics binding; graphics layers should detect this and disable
+  // themselves
+  *session = FakeSession;
+  return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL fake_xrDestroySession(XrSession session) {
+  if (session != FakeSession) {
+    return XR_ERROR_HANDLE_INVALID;
+  }
+  return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL fake_xrDestroyInstance(XrInstance instance) {
+  if (instance != FakeInstance) {
+    return XR_ERROR_HANDLE_INVALID;
+  }
+  return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL fake_xrGetInstanceProcAddr(
+  XrInstance,
+  const char* name,
+  PFN_xrVoidFunction* function) {
+  const std::string_view nameView {name};
+#define FAKE_FUNC(FN) \
+  if (nameView == "xr" #FN) { \
+    *function = reinterpret_cast<PFN_xrVoidFunction>(&fake_xr##FN); \
+    return XR_SUCCESS; \
+  }
+  FAKE_FUNC(GetInstanceProcAddr)
+  FAKE_FUNC(CreateSession)
+  FAKE_FUNC(DestroySession)
+  FAKE_FUNC(DestroyInstance)
+  FAKE_FUNC(WaitFrame)
+  FAKE_FUNC(BeginFrame)
+  FAKE_FUNC(EndFrame)
+#undef FAKE_FUNC
+
+  *function = nullptr;
+  return XR_ERROR_FUNCTION_UNSUPPORTED;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL fake_xrCreateApiLayerInstance(
+  const XrInstanceCreateInfo*,
+  const XrApiLayerCreateInfo*,
+  XrInstance* instance) {
+  *instance = FakeInstance;
+  return XR_SUCCESS;
+}
+
+struct NegotiatedLayer {
+  PFN_xrGetInstanceProcAddr mGetInstanceProcAddr {nullptr};
+  PFN_xrCreateApiLayerInstance mCreateApiLayerInstance {nullptr};
+};
+
+NegotiatedLayer Negotiate(HMODULE layer, const std::filesystem::path& path) {
+  const auto negotiate
+    = reinterpret_cast<PFN_xrNegotiateLoaderApiLayerInterface>(
+      GetProcAddress(layer, "xrNegotiateLoaderApiLayerInterface"));
+  if (!negotiate) {
+    throw std::runtime_error(std::format(
+      "`{}` does not export `xrNegotiateLoaderApiLayerInterface`",
+      path.string()));
+  }
+
+  const XrNegotiateLoaderInfo loaderInfo {
+    .structType = XR_LOADER_INTERFACE_STRUCT_LOADER_INFO,
+    .structVersion = XR_LOADER_INFO_STRUCT_VERSION,
+    .structSize = sizeof(XrNegotiateLoaderInfo),
+    .minInterfaceVersion = 1,
+    .maxInterfaceVersion = XR_CURRENT_LOADER_API_LAYER_VERSION,
+    .minApiVersion = XR_API_VERSION_1_0,
+    .maxApiVersion = XR_CURRENT_API_VERSION,
+  };
+  XrNegotiateApiLayerRequest request {
+    .structType = XR_LOADER_INTERFACE_STRUCT_API_LAYER_REQUEST,
+    .structVersion = XR_API_LAYER_INFO_STRUCT_VERSION,
+    .structSize = sizeof(XrNegotiateApiLayerRequest),
+  };
+  if (const auto ret
+      = negotiate(&loaderInfo, path.stem().string().c_str(), &request);
+      XR_FAILED(ret)) {
+    throw std::runtime_error(std::format(
+      "Negotiation with `{}` failed: {}",
+      path.string(),
+      static_cast<int>(ret)));
+  }
+
+  return {
+    .mGetInstanceProcAddr = request.getInstanceProcAddr,
+    .mCreateApiLayerInstance = request.createApiLayerInstance,
+  };
+}
+
+template <class T>
+void GetFunction(
+  PFN_xrGetInstanceProcAddr gipa,
+  XrInstance instance,
+  const char* name,
+  T* function) {
+  if (XR_FAILED(
+        gipa(instance, name, reinterpret_cast<PFN_xrVoidFunction*>(function)))
+      || !*function) {
+    throw std::runtime_error(std::format("Failed to get `{}`", name));
+  }
+}
+
+}// namespace
+
+LayerHarness::LayerHarness(std::span<const std::filesystem::path> layers) {
+  if (gHaveInstance.test_and_set()) {
+    throw std::logic_error("Only one LayerHarness can exist at a time");
+  }
+  auto releaseOnFailure = wil::scope_exit([]() { gHaveInstance.clear(); });
+
+  std::vector<NegotiatedLayer> negotiated;
+  for (auto&& path: layers) {
+    const auto layer = LoadLibraryW(path.wstring().c_str());
+    if (!layer) {
+      throw std::runtime_error(std::format(
+        "Failed to load `{}`: {:#010x}",
+        path.string(),
+        static_cast<uint32_t>(HRESULT_FROM_WIN32(GetLastError()))));
+    }
+    mLayers.push_back(layer);
+    negotiated.push_back(Negotiate(layer, path));
+  }
+
+  // nextInfos[i] describes the layer (or runtime) after layers[i]
+  std::vector<XrApiLayerNextInfo> nextInfos(negotiated.size());
+  for (size_t i = 0; i < nextInfos.size(); ++i) {
+    auto& it = nextInfos.at(i);
+    it = {
+      .structType = XR_LOADER_INTERFACE_STRUCT_API_LAYER_NEXT_INFO,
+      .structVersion = XR_API_LAYER_NEXT_INFO_STRUCT_VERSION,
+      .structSize = sizeof(XrApiLayerNextInfo),
+    };
+    if (i + 1 < negotiated.size()) {
+      const auto& next = negotiated.at(i + 1);
+      const auto name = layers[i + 1].stem().string();
+      strncpy_s(it.layerName, name.c_str(), _TRUNCATE);
+      it.nextGetInstanceProcAddr = next.mGetInstanceProcAddr;
+      it.nextCreateApiLayerInstance = next.mCreateApiLayerInstance;
+      it.next = &nextInfos.at(i + 1);
+    } else {
+      strncpy_s(it.layerName, "XRFrameTools fake runtime", _TRUNCATE);
+      it.nextGetInstanceProcAddr = &fake_xrGetInstanceProcAddr;
+      it.nextCreateApiLayerInstance = &fake_xrCreateApiLayerInstance;
+    }
+  }
+
+  XrInstanceCreateInfo createInfo {
+    .type = XR_TYPE_INSTANCE_CREATE_INFO,
+    .applicationInfo = {
+      .applicationVersion = 1,
+      .engineVersion = 1,
+      .apiVersion = XR_API_VERSION_1_0,
+    },
+  };
+  strncpy_s(
+    createInfo.applicationInfo.applicationName, "LayerHarness", _TRUNCATE);
+
+  auto gipa = &fake_xrGetInstanceProcAddr;
+  if (negotiated.empty()) {
+    mInstance = FakeInstance;
+  } else {
+    XrApiLayerCreateInfo layerInfo {
+      .structType = XR_LOADER_INTERFACE_STRUCT_API_LAYER_CREATE_INFO,
+      .structVersion = XR_API_LAYER_CREATE_INFO_STRUCT_VERSION,
+      .structSize = sizeof(XrApiLayerCreateInfo),
+      .nextInfo = nextInfos.data(),
+    };
+    if (const auto ret = negotiated.front().mCreateApiLayerInstance(
+          &createInfo, &layerInfo, &mInstance);
+        XR_FAILED(ret)) {
+      throw std::runtime_error(std::format(
+        "xrCreateApiLayerInstance failed: {}", static_cast<int>(ret)));
+    }
+    gipa = negotiated.front().mGetInstanceProcAddr;
+  }
+
+  PFN_xrCreateSession createSession {nullptr};
+  GetFunction(gipa, mInstance, "xrCreateSession", &createSession);
+  GetFunction(gipa, mInstance, "xrDestroySession", &mDestroySession);
+  GetFunction(gipa, mInstance, "xrDestroyInstance", &mDestroyInstance);
+  GetFunction(gipa, mInstance, "xrWaitFrame", &mWaitFrame);
+  GetFunction(gipa, mInstance, "xrBeginFrame", &mBeginFrame);
+  GetFunction(gipa, mInstance, "xrEndFrame", &mEndFrame);
+
+  const XrSessionCreateInfo sessionInfo {
+    .type = XR_TYPE_SESSION_CREATE_INFO,
+    .systemId = 1,
+  };
+  if (const auto ret = createSession(mInstance, &sessionInfo, &mSession);
+      XR_FAILED(ret)) {
+    throw std::runtime_error(
+      std::format("xrCreateSession failed: {}", static_cast<int>(ret)));
+  }
+  releaseOnFailure.release();
+}
+
+LayerHarness::~LayerHarness() {
+  if (mSession) {
+    mDestroySession(mSession);
+  }
+  if (mInstance) {
+    mDestroyInstance(mInstance);
+  }
+  gHaveInstance.clear();
+}
+
+void LayerHarness::SetNextPredictedDisplayTime(XrTime time) noexcept {
+  gRuntime.mNextDisplayTime = time;
+}
+
+void LayerHarness::SetDisplayPeriod(XrDuration period) noexcept {
+  gRuntime.mDisplayPeriod = period;
+}
+
+XrResult LayerHarness::WaitFrame(
+  std::chrono::nanoseconds runtimeDuration,
+  XrTime* predictedDisplayTime,
+  CallTiming* timing) {
+  gRuntime.mNextCallDuration = runtimeDuration;
+  const XrFrameWaitInfo waitInfo {XR_TYPE_FRAME_WAIT_INFO};
+  XrFrameState state {XR_TYPE_FRAME_STATE};
+
+  const auto start = Clock::now();
+  const auto ret = mWaitFrame(mSession, &waitInfo, &state);
+  const auto stop = Clock::now();
+
+  if (timing) {
+    *timing = {stop - start, gRuntime.mLastCallDuration};
+  }
+  if (predictedDisplayTime) {
+    *predictedDisplayTime = state.predictedDisplayTime;
+  }
+  return ret;
+}
+
+XrResult LayerHarness::BeginFrame(
+  std::chrono::nanoseconds runtimeDuration,
+  CallTiming* timing) {
+  gRuntime.mNextCallDuration = runtimeDuration;
+  const XrFrameBeginInfo beginInfo {XR_TYPE_FRAME_BEGIN_INFO};
+
+  const auto start = Clock::now();
+  const auto ret = mBeginFrame(mSession, &beginInfo);
+  const auto stop = Clock::now();
+
+  if (timing) {
+    *timing = {stop - start, gRuntime.mLastCallDuration};
+  }
+  return ret;
+}
+
+XrResult LayerHarness::EndFrame(
+  std::chrono::nanoseconds runtimeDuration,
+  XrTime displayTime,
+  CallTiming* timing) {
+  gRuntime.mNextCallDuration = runtimeDuration;
+  const XrFrameEndInfo endInfo {
+    .type = XR_TYPE_FRAME_END_INFO,
+    .displayTime = displayTime,
+    .environmentBlendMode = XR_ENVIRONMENT_BLEND_MODE_OPAQUE,
+  };
+
+  const auto start = Clock::now();
+  const auto ret = mEndFrame(mSession, &endInfo);
+  const auto stop = Clock::now();
+
+  if (timing) {
+    *timing = {stop - start, gRuntime.mLastCallDuration};
+  }
+  return ret;
+}
+
+void LayerHarness::Spin(std::chrono::nanoseconds duration) {
+  if (duration <= std::chrono::nanoseconds::zero()) {
+    return;
+  }
+  const auto until = Clock::now() + duration;
+  while (Clock::now() < until) {
+    YieldProcessor();
+  }
+}
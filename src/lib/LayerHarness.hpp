@@ -0,0 +1,85 @@
+// Copyright 2024 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <Windows.h>
+#include <openxr/openxr.h>
+
+#include <chrono>
+#include <filesystem>
+#include <span>
+#include <vector>
+
+/** Stands in for the OpenXR loader and runtime, so that API layers can be
+ * driven without a headset or graphics device.
+ *
+ * The layers are chained in the order given, with a fake headless runtime at
+ * the end of the chain; calls go through each layer's `xrGetInstanceProcAddr`
+ * and `XRFuncDelegator`, just like with the real loader.
+ *
+ * The fake runtime uses a stub clock for `XrTime` values, so predicted display
+ * times are deterministic; it can also be told to busy-wait inside each call to
+ * simulate runtime cost.
+ *
+ * As the runtime entrypoints are plain function pointers without any context,
+ * only one instance may exist at a time. Layers are never unloaded, as their
+ * static destructors may join threads, which is unsafe under the loader lock.
+ */
+class LayerHarness final {
+ public:
+  LayerHarness() = delete;
+  LayerHarness(const LayerHarness&) = delete;
+  LayerHarness(LayerHarness&&) = delete;
+  LayerHarness& operator=(const LayerHarness&) = delete;
+  LayerHarness& operator=(LayerHarness&&) = delete;
+
+  /** Load the layers, then create an instance and session through them.
+   *
+   * Throws `std::runtime_error` if the layers can't be loaded or negotiated.
+   */
+  explicit LayerHarness(std::span<const std::filesystem::path> layers);
+  ~LayerHarness();
+
+  struct CallTiming {
+    // Wall-clock time for the call, including the layers and the runtime
+    std::chrono::nanoseconds mTotal {};
+    // Time spent inside the fake runtime
+    std::chrono::nanoseconds mRuntime {};
+
+    [[nodiscard]]
+    std::chrono::nanoseconds GetLayerOverhead() const noexcept {
+      return mTotal - mRuntime;
+    }
+  };
+
+  // Stub clock: `xrWaitFrame` returns this time, then advances it by the
+  // display period
+  void SetNextPredictedDisplayTime(XrTime) noexcept;
+  void SetDisplayPeriod(XrDuration) noexcept;
+
+  XrResult WaitFrame(
+    std::chrono::nanoseconds runtimeDuration,
+    XrTime* predictedDisplayTime,
+    CallTiming* timing = nullptr);
+  XrResult BeginFrame(
+    std::chrono::nanoseconds runtimeDuration,
+    CallTiming* timing = nullptr);
+  XrResult EndFrame(
+    std::chrono::nanoseconds runtimeDuration,
+    XrTime displayTime,
+    CallTiming* timing = nullptr);
+
+  /// Busy-wait; `Sleep()` is far too coarse to reproduce frame timings
+  static void Spin(std::chrono::nanoseconds);
+
+ private:
+  std::vector<HMODULE> mLayers;
+  XrInstance mInstance {XR_NULL_HANDLE};
+  XrSession mSession {XR_NULL_HANDLE};
+
+  PFN_xrWaitFrame mWaitFrame {nullptr};
+  PFN_xrBeginFrame mBeginFrame {nullptr};
+  PFN_xrEndFrame mEndFrame {nullptr};
+  PFN_xrDestroySession mDestroySession {nullptr};
+  PFN_xrDestroyInstance mDestroyInstance {nullptr};
+};
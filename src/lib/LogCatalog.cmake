@@ -0,0 +1,19 @@
+include_guard(DIRECTORY)
+
+include(BinaryLogReader.cmake)
+include(PerformanceCounters.cmake)
+include(Win32Utils.cmake)
+
+add_library(
+  LogCatalog
+  STATIC
+  LogCatalog.cpp LogCatalog.hpp
+)
+target_link_libraries(
+  LogCatalog
+  PUBLIC
+  BinaryLogReader
+  PRIVATE
+  PerformanceCounters
+  Win32Utils
+)
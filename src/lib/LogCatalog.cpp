@@ -0,0 +1,357 @@
+// Copyright 2024 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+
+#include "LogCatalog.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cwctype>
+#include <format>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <ranges>
+#include <string_view>
+
+#include "BinaryLogReader.hpp"
+#include "Win32Utils.hpp"
+
+namespace {
+constexpr std::string_view IndexMagic = "XRFrameTools log catalog v2";
+
+std::string ToUTF8(const std::filesystem::path& path) {
+  const auto u8 = path.generic_u8string();
+  return {reinterpret_cast<const char*>(u8.data()), u8.size()};
+}
+
+std::filesystem::path FromUTF8(const std::string_view utf8) {
+  return std::filesystem::path {std::u8string_view {
+    reinterpret_cast<const char8_t*>(utf8.data()), utf8.size()}};
+}
+
+template <class T>
+bool ParseInteger(const std::string_view str, T& value) {
+  const auto end = str.data() + str.size();
+  const auto [ptr, ec] = std::from_chars(str.data(), end, value);
+  return ec == std::errc {} && ptr == end;
+}
+
+std::wstring ToLower(std::wstring_view str) {
+  std::wstring ret {str};
+  std::ranges::transform(ret, ret.begin(), [](const wchar_t c) {
+    return static_cast<wchar_t>(std::towlower(c));
+  });
+  return ret;
+}
+
+}// namespace
+
+double LogCatalog::Entry::GetAverageFPS() const noexcept {
+  if (mDuration <= std::chrono::microseconds::zero()) {
+    return 0;
+  }
+  return mFrameCount / std::chrono::duration<double>(mDuration).count();
+}
+
+bool LogCatalog::Filter::Matches(const Entry& entry) const {
+  if (!mExecutable.empty()) {
+    const auto haystack = ToLower(entry.mExecutable.filename().wstring());
+    if (haystack.find(ToLower(mExecutable)) == std::wstring::npos) {
+      return false;
+    }
+  }
+  if (mStartedAfter && entry.mStartTime < *mStartedAfter) {
+    return false;
+  }
+  if (mStartedBefore && entry.mStartTime >= *mStartedBefore) {
+    return false;
+  }
+  if (mMinDuration && entry.mDuration < *mMinDuration) {
+    return false;
+  }
+  if (mMaxDuration && entry.mDuration > *mMaxDuration) {
+    return false;
+  }
+  const auto fps = entry.GetAverageFPS();
+  if (mMinAverageFPS && fps < *mMinAverageFPS) {
+    return false;
+  }
+  if (mMaxAverageFPS && fps > *mMaxAverageFPS) {
+    return false;
+  }
+  return true;
+}
+
+LogCatalog::LogCatalog(const std::filesystem::path& root) : mRoot(root) {
+  this->Load();
+}
+
+LogCatalog::~LogCatalog() = default;
+
+std::filesystem::path LogCatalog::GetIndexPath(
+  const std::filesystem::path& root) {
+  return root / "catalog.tsv";
+}
+
+bool LogCatalog::IsRefreshing() const noexcept {
+  return mRefreshing;
+}
+
+void LogCatalog::RefreshInBackground() {
+  if (mRefreshing.exchange(true)) {
+    return;
+  }
+  mRefreshThread = std::jthread {[this](std::stop_token tok) {
+    SetThreadDescription(GetCurrentThread(), L"XRFrameTools Log Catalog");
+    this->Refresh(std::thread::hardware_concurrency(), tok);
+    mRefreshing = false;
+  }};
+}
+
+std::vector<LogCatalog::Entry> LogCatalog::Query(const Filter& filter) const {
+  std::shared_lock lock(mMutex);
+  std::vector<Entry> ret;
+  std::ranges::copy_if(
+    mEntries,
+    std::back_inserter(ret),
+    std::bind_front(&Filter::Matches, &filter));
+  return ret;
+}
+
+void LogCatalog::Refresh(const size_t jobs, std::stop_token tok) {
+  std::map<std::filesystem::path, Entry> previous;
+  {
+    std::shared_lock lock(mMutex);
+    for (auto&& it: mEntries) {
+      previous.emplace(it.mPath, it);
+    }
+  }
+
+  std::vector<Entry> entries;
+  using FooterCheckpoint = BinaryLogReader::FooterCheckpoint;
+  std::vector<std::pair<std::filesystem::directory_entry, FooterCheckpoint>>
+    changed;
+  std::error_code ec;
+  for (auto it = std::filesystem::recursive_directory_iterator(mRoot, ec);
+       !ec && it != std::filesystem::recursive_directory_iterator();
+       it.increment(ec)) {
+    if (
+      !it->is_regular_file(ec)
+      || _wcsicmp(it->path().extension().c_str(), L".XRFTBinLog") != 0) {
+      continue;
+    }
+    const auto cached = previous.find(it->path());
+    if (cached == previous.end()) {
+      changed.emplace_back(*it, FooterCheckpoint {});
+      continue;
+    }
+    const auto& entry = cached->second;
+    const auto fileSize = it->file_size(ec);
+    if (
+      entry.mFileSize == fileSize
+      && entry.mLastWriteTime == it->last_write_time(ec)) {
+      entries.push_back(entry);
+      continue;
+    }
+    // Still being written, so only the new frames need to be read
+    const auto isAppended = (!entry.mHasFooter) && fileSize > entry.mFileSize;
+    changed.emplace_back(
+      *it, isAppended ? entry.mFooterCheckpoint : FooterCheckpoint {});
+  }
+
+  // Opening logs - especially computing missing footers - is the slow part
+  std::vector<std::optional<Entry>> results(changed.size());
+  {
+    std::atomic<size_t> next {};
+    std::vector<std::jthread> workers;
+    const auto workerCount
+      = std::clamp<size_t>(jobs, 1, std::max<size_t>(changed.size(), 1));
+    for (size_t i = 0; i < workerCount; ++i) {
+      workers.emplace_back([&]() {
+        while (!tok.stop_requested()) {
+          const auto index = next++;
+          if (index >= changed.size()) {
+            return;
+          }
+          const auto& [file, checkpoint] = changed.at(index);
+          results.at(index) = ReadEntry(file, checkpoint);
+        }
+      });
+    }
+  }
+  if (tok.stop_requested()) {
+    return;
+  }
+
+  for (auto&& it: results) {
+    if (it) {
+      entries.push_back(std::move(*it));
+    }
+  }
+  std::ranges::sort(entries, {}, &Entry::mStartTime);
+
+  const auto isModified
+    = !(changed.empty() && entries.size() == previous.size());
+  {
+    std::unique_lock lock(mMutex);
+    mEntries = entries;
+  }
+  if (isModified) {
+    this->Save(entries);
+  }
+  dprint("log catalog: {} logs, {} re-read", entries.size(), changed.size());
+}
+
+std::optional<LogCatalog::Entry> LogCatalog::ReadEntry(
+  const std::filesystem::directory_entry& file,
+  BinaryLogReader::FooterCheckpoint checkpoint) {
+  std::error_code ec;
+  Entry ret {
+    .mPath = file.path(),
+    .mFileSize = file.file_size(ec),
+    .mLastWriteTime = file.last_write_time(ec),
+  };
+  if (ec) {
+    return std::nullopt;
+  }
+
+  auto reader = BinaryLogReader::Create(file.path());
+  if (!reader) {
+    return std::nullopt;
+  }
+  ret.mExecutable = reader->GetExecutablePath();
+  ret.mProcessID = reader->GetProcessID();
+  ret.mStartTime = std::chrono::system_clock::time_point {
+    std::chrono::microseconds {
+      reader->GetClockCalibration().mMicrosecondsSinceEpoch}};
+  ret.mLoggingPolicy = reader->GetLoggingPolicy().mKind;
+
+  const auto storedFooter = reader->GetFileFooter();
+  ret.mHasFooter = storedFooter.has_value();
+  const auto footer
+    = storedFooter ? *storedFooter : reader->ComputeFileFooter(checkpoint);
+  if (!storedFooter) {
+    ret.mFooterCheckpoint = checkpoint;
+  }
+  ret.mFrameCount = footer.mFrameCount;
+  ret.mDroppedFrameCount = footer.mDroppedFrameCount;
+  if (footer.mFirstEndFrameTime && footer.mLastEndFrameTime) {
+    ret.mDuration = std::max(
+      std::chrono::microseconds::zero(),
+      reader->GetPerformanceCounterMath().ToDurationAllowNegative(
+        footer.mFirstEndFrameTime, footer.mLastEndFrameTime));
+  }
+  return ret;
+}
+
+void LogCatalog::Load() {
+  std::ifstream in {GetIndexPath(mRoot), std::ios::binary};
+  if (!in) {
+    return;
+  }
+  std::string line;
+  if (!(std::getline(in, line) && line == IndexMagic)) {
+    dprint("ignoring log catalog with unrecognized format");
+    return;
+  }
+
+  std::vector<Entry> entries;
+  while (std::getline(in, line)) {
+    std::vector<std::string_view> fields;
+    for (auto&& field: std::views::split(line, '\t')) {
+      fields.emplace_back(field.begin(), field.end());
+    }
+    if (fields.size() != 17) {
+      continue;
+    }
+
+    Entry entry {
+      .mPath = mRoot / FromUTF8(fields[0]).make_preferred(),
+      .mExecutable = FromUTF8(fields[3]),
+    };
+    std::filesystem::file_time_type::rep lastWriteTime {};
+    int64_t startTime {};
+    uint32_t policy {};
+    uint32_t hasFooter {};
+    int64_t duration {};
+    auto& checkpoint = entry.mFooterCheckpoint;
+    if (!(ParseInteger(fields[1], entry.mFileSize)
+          && ParseInteger(fields[2], lastWriteTime)
+          && ParseInteger(fields[4], entry.mProcessID)
+          && ParseInteger(fields[5], startTime)
+          && ParseInteger(fields[6], policy)
+          && ParseInteger(fields[7], hasFooter)
+          && ParseInteger(fields[8], entry.mFrameCount)
+          && ParseInteger(fields[9], entry.mDroppedFrameCount)
+          && ParseInteger(fields[10], duration)
+          && ParseInteger(fields[11], checkpoint.mOffset)
+          && ParseInteger(fields[12], checkpoint.mFooter.mFrameCount)
+          && ParseInteger(fields[13], checkpoint.mFooter.mValidDataBits)
+          && ParseInteger(fields[14], checkpoint.mFooter.mFirstEndFrameTime)
+          && ParseInteger(fields[15], checkpoint.mFooter.mLastEndFrameTime)
+          && ParseInteger(
+            fields[16], checkpoint.mFooter.mMaxEncoderSessionCount))) {
+      continue;
+    }
+    entry.mLastWriteTime = std::filesystem::file_time_type {
+      std::filesystem::file_time_type::duration {lastWriteTime}};
+    entry.mStartTime = std::chrono::system_clock::time_point {
+      std::chrono::microseconds {startTime}};
+    entry.mLoggingPolicy = static_cast<BinaryLog::LoggingPolicy::Kind>(policy);
+    entry.mHasFooter = hasFooter != 0;
+    entry.mDuration = std::chrono::microseconds {duration};
+    entries.push_back(std::move(entry));
+  }
+
+  std::unique_lock lock(mMutex);
+  mEntries = std::move(entries);
+}
+
+void LogCatalog::Save(const std::vector<Entry>& entries) const {
+  const auto path = GetIndexPath(mRoot);
+  auto temporaryPath = path;
+  temporaryPath += std::format(L".{}.tmp", GetCurrentProcessId());
+
+  {
+    std::ofstream out {temporaryPath, std::ios::binary | std::ios::trunc};
+    if (!out) {
+      return;
+    }
+    out << IndexMagic << '\n';
+    for (auto&& it: entries) {
+      out << std::format(
+        "{}\t{}\t{}\t{}\t{}\t{}\t{}\t{}\t{}\t{}\t{}\t{}\t{}\t{}\t{}\t{}\t{}\n",
+        ToUTF8(it.mPath.lexically_relative(mRoot)),
+        it.mFileSize,
+        it.mLastWriteTime.time_since_epoch().count(),
+        ToUTF8(it.mExecutable),
+        it.mProcessID,
+        std::chrono::duration_cast<std::chrono::microseconds>(
+          it.mStartTime.time_since_epoch())
+          .count(),
+        std::to_underlying(it.mLoggingPolicy),
+        it.mHasFooter ? 1 : 0,
+        it.mFrameCount,
+        it.mDroppedFrameCount,
+        it.mDuration.count(),
+        it.mFooterCheckpoint.mOffset,
+        it.mFooterCheckpoint.mFooter.mFrameCount,
+        it.mFooterCheckpoint.mFooter.mValidDataBits,
+        it.mFooterCheckpoint.mFooter.mFirstEndFrameTime,
+        it.mFooterCheckpoint.mFooter.mLastEndFrameTime,
+        it.mFooterCheckpoint.mFooter.mMaxEncoderSessionCount);
+    }
+    if (!out) {
+      return;
+    }
+  }
+
+  // Replace atomically, so concurrent readers never see a partial index
+  std::error_code ec;
+  std::filesystem::rename(temporaryPath, path, ec);
+  if (ec) {
+    dprint("failed to save log catalog: {}", ec.message());
+    std::filesystem::remove(temporaryPath, ec);
+  }
+}
@@ -0,0 +1,106 @@
+// Copyright 2024 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <optional>
+#include <shared_mutex>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BinaryLog.hpp"
+#include "BinaryLogReader.hpp"
+
+/** An index of every binary log in a directory tree.
+ *
+ * The index is stored in `GetIndexPath()`, and caches the metadata needed to
+ * browse or filter logs without opening them. Refreshing only opens logs that
+ * are new, or have changed size or modification time since they were
+ * indexed; this includes logs without a footer, e.g. after a crash, so their
+ * footer only needs to be computed once. Logs that are still being written
+ * are re-read from the last indexed frame, rather than from the start.
+ */
+class LogCatalog final {
+ public:
+  struct Entry {
+    std::filesystem::path mPath;
+    uint64_t mFileSize {};
+    std::filesystem::file_time_type mLastWriteTime {};
+
+    std::filesystem::path mExecutable;
+    uint32_t mProcessID {};
+    std::chrono::system_clock::time_point mStartTime {};
+    BinaryLog::LoggingPolicy::Kind mLoggingPolicy {};
+
+    // False if the footer was computed, e.g. because the app crashed
+    bool mHasFooter {false};
+    uint64_t mFrameCount {};
+    uint32_t mDroppedFrameCount {};
+    std::chrono::microseconds mDuration {};
+    // Only for logs without a footer: where to resume if the log grows
+    BinaryLogReader::FooterCheckpoint mFooterCheckpoint {};
+
+    [[nodiscard]]
+    double GetAverageFPS() const noexcept;
+  };
+
+  struct Filter {
+    // Case-insensitive substring of the executable's file name
+    std::wstring mExecutable;
+    std::optional<std::chrono::system_clock::time_point> mStartedAfter;
+    std::optional<std::chrono::system_clock::time_point> mStartedBefore;
+    std::optional<std::chrono::microseconds> mMinDuration;
+    std::optional<std::chrono::microseconds> mMaxDuration;
+    std::optional<double> mMinAverageFPS;
+    std::optional<double> mMaxAverageFPS;
+
+    [[nodiscard]]
+    bool Matches(const Entry&) const;
+  };
+
+  LogCatalog() = delete;
+  LogCatalog(const LogCatalog&) = delete;
+  LogCatalog(LogCatalog&&) = delete;
+  LogCatalog& operator=(const LogCatalog&) = delete;
+  LogCatalog& operator=(LogCatalog&&) = delete;
+
+  /// Loads the existing index, if any; does not scan for logs
+  explicit LogCatalog(const std::filesystem::path& root);
+  ~LogCatalog();
+
+  [[nodiscard]]
+  static std::filesystem::path GetIndexPath(const std::filesystem::path& root);
+
+  /// Scan for new or changed logs using `jobs` threads, then save the index
+  void Refresh(
+    size_t jobs = std::thread::hardware_concurrency(),
+    std::stop_token = {});
+  /// As `Refresh()`, but returns immediately
+  void RefreshInBackground();
+  [[nodiscard]]
+  bool IsRefreshing() const noexcept;
+
+  /// Sorted by start time, oldest first
+  [[nodiscard]]
+  std::vector<Entry> Query(const Filter& = {}) const;
+
+ private:
+  std::filesystem::path mRoot;
+
+  mutable std::shared_mutex mMutex;
+  std::vector<Entry> mEntries;
+
+  std::atomic<bool> mRefreshing {false};
+  std::jthread mRefreshThread;
+
+  void Load();
+  void Save(const std::vector<Entry>&) const;
+  [[nodiscard]]
+  static std::optional<Entry> ReadEntry(
+    const std::filesystem::directory_entry&,
+    BinaryLogReader::FooterCheckpoint);
+};
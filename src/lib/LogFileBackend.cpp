@@ -0,0 +1,189 @@
+// Copyright 2024 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+
+#include "LogFileBackend.hpp"
+
+#include <Windows.h>
+#include <wil/resource.h>
+
+#include <cerrno>
+#include <condition_variable>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <system_error>
+#include <thread>
+
+#include "Win32Utils.hpp"
+
+namespace {
+
+class OverlappedLogFileBackend final : public LogFileBackend {
+ public:
+  explicit OverlappedLogFileBackend(wil::unique_hfile file)
+    : mFile(std::move(file)) {
+  }
+
+  ~OverlappedLogFileBackend() override {
+    this->WaitForWrite();
+  }
+
+  void BeginWrite(std::span<const char> data) override {
+    this->WaitForWrite();
+
+    mOverlapped = {};
+    mOverlapped.Offset = static_cast<DWORD>(mOffset);
+    mOverlapped.OffsetHigh = static_cast<DWORD>(mOffset >> 32);
+    mOverlapped.hEvent = mEvent.get();
+    mOffset += data.size();
+
+    if (
+      WriteFile(
+        mFile.get(),
+        data.data(),
+        static_cast<DWORD>(data.size()),
+        nullptr,
+        &mOverlapped)
+      || GetLastError() == ERROR_IO_PENDING) {
+      mPending = true;
+      return;
+    }
+    dprint("failed to start binary log write: {:#x}", GetLastError());
+  }
+
+  bool IsWriteComplete() override {
+    if (!mPending) {
+      return true;
+    }
+    DWORD bytesWritten {};
+    if (GetOverlappedResult(mFile.get(), &mOverlapped, &bytesWritten, FALSE)) {
+      mPending = false;
+      return true;
+    }
+    if (GetLastError() == ERROR_IO_INCOMPLETE) {
+      return false;
+    }
+    dprint("binary log write failed: {:#x}", GetLastError());
+    mPending = false;
+    return true;
+  }
+
+  void WaitForWrite() override {
+    if (!mPending) {
+      return;
+    }
+    DWORD bytesWritten {};
+    if (!GetOverlappedResult(mFile.get(), &mOverlapped, &bytesWritten, TRUE)) {
+      dprint("binary log write failed: {:#x}", GetLastError());
+    }
+    mPending = false;
+  }
+
+ private:
+  wil::unique_hfile mFile;
+  wil::unique_event mEvent {wil::EventOptions::ManualReset};
+  OVERLAPPED mOverlapped {};
+  uint64_t mOffset {};
+  bool mPending {false};
+};
+
+class ThreadedLogFileBackend final : public LogFileBackend {
+ public:
+  explicit ThreadedLogFileBackend(std::ofstream stream)
+    : mStream(std::move(stream)) {
+    mThread = std::jthread {std::bind_front(&ThreadedLogFileBackend::Run, this)};
+  }
+
+  ~ThreadedLogFileBackend() override {
+    this->WaitForWrite();
+    mThread = {};
+  }
+
+  void BeginWrite(std::span<const char> data) override {
+    this->WaitForWrite();
+    {
+      std::unique_lock lock(mMutex);
+      mPendingData = data;
+      mPending = true;
+    }
+    mCV.notify_all();
+  }
+
+  bool IsWriteComplete() override {
+    std::unique_lock lock(mMutex);
+    return !mPending;
+  }
+
+  void WaitForWrite() override {
+    std::unique_lock lock(mMutex);
+    mCV.wait(lock, [this]() { return !mPending; });
+  }
+
+ private:
+  std::ofstream mStream;
+
+  std::mutex mMutex;
+  std::condition_variable_any mCV;
+  std::span<const char> mPendingData;
+  bool mPending {false};
+
+  std::jthread mThread;
+
+  void Run(std::stop_token tok) {
+    while (true) {
+      std::span<const char> data;
+      {
+        std::unique_lock lock(mMutex);
+        if (!mCV.wait(lock, tok, [this]() { return mPending; })) {
+          return;
+        }
+        data = mPendingData;
+      }
+
+      // Flush so that readers see complete batches
+      mStream.write(data.data(), static_cast<std::streamsize>(data.size()));
+      mStream.flush();
+      if (!mStream) {
+        // The CRT sets `errno` when the underlying write fails
+        dprint(
+          "binary log write failed: {}",
+          std::error_code {errno, std::generic_category()}.message());
+        // Keep going with later writes, like the overlapped backend
+        mStream.clear();
+      }
+
+      {
+        std::unique_lock lock(mMutex);
+        mPending = false;
+      }
+      mCV.notify_all();
+    }
+  }
+};
+
+}// namespace
+
+std::unique_ptr<LogFileBackend> LogFileBackend::CreateOverlapped(
+  const std::filesystem::path& path) {
+  wil::unique_hfile file {CreateFileW(
+    path.c_str(),
+    GENERIC_WRITE,
+    FILE_SHARE_READ,
+    nullptr,
+    CREATE_ALWAYS,
+    FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED,
+    nullptr)};
+  if (!file) {
+    return nullptr;
+  }
+  return std::make_unique<OverlappedLogFileBackend>(std::move(file));
+}
+
+std::unique_ptr<LogFileBackend> LogFileBackend::CreateThreaded(
+  const std::filesystem::path& path) {
+  std::ofstream stream {path, std::ios::binary | std::ios::trunc};
+  if (!stream) {
+    return nullptr;
+  }
+  return std::make_unique<ThreadedLogFileBackend>(std::move(stream));
+}
@@ -0,0 +1,41 @@
+// Copyright 2024 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <span>
+
+/** Where `BinaryLogWriter` sends encoded data.
+ *
+ * Writes may complete asynchronously, so the writer can keep encoding into
+ * another buffer while the disk is slow - e.g. while an anti-virus scan or
+ * cloud sync has the file locked.
+ *
+ * At most one write is in flight at a time; data is always appended.
+ */
+class LogFileBackend {
+ public:
+  using Factory
+    = std::unique_ptr<LogFileBackend> (*)(const std::filesystem::path&);
+
+  virtual ~LogFileBackend() = default;
+
+  /// `data` must remain valid and unmodified until the write completes
+  virtual void BeginWrite(std::span<const char> data) = 0;
+  /// True if there is no write in flight
+  [[nodiscard]]
+  virtual bool IsWriteComplete() = 0;
+  /// Returns immediately if there is no write in flight
+  virtual void WaitForWrite() = 0;
+
+  /// Overlapped I/O; returns nullptr if the file can not be created
+  [[nodiscard]]
+  static std::unique_ptr<LogFileBackend> CreateOverlapped(
+    const std::filesystem::path&);
+
+  /// Blocking writes on a worker thread; only uses the standard library
+  [[nodiscard]]
+  static std::unique_ptr<LogFileBackend> CreateThreaded(
+    const std::filesystem::path&);
+};
@@ -0,0 +1,21 @@
+include_guard(DIRECTORY)
+
+include(BinaryLogReader.cmake)
+include(FrameMetrics.cmake)
+include(PerformanceCounters.cmake)
+include(Win32Utils.cmake)
+
+add_library(
+  LogPyramid
+  STATIC
+  LogPyramid.cpp LogPyramid.hpp
+)
+target_link_libraries(
+  LogPyramid
+  PUBLIC
+  BinaryLogReader
+  PRIVATE
+  FrameMetrics
+  PerformanceCounters
+  Win32Utils
+)
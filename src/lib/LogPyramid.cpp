@@ -0,0 +1,461 @@
+// Copyright 2024 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+
+#include "LogPyramid.hpp"
+
+#include <shlobj_core.h>
+
+#include <algorithm>
+#include <cwctype>
+#include <format>
+#include <fstream>
+#include <numeric>
+#include <ranges>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#include "MetricsAggregator.hpp"
+#include "Win32Utils.hpp"
+
+namespace {
+using Bucket = LogPyramid::Bucket;
+using Metric = LogPyramid::Metric;
+
+static_assert(std::is_trivially_copyable_v<Bucket>);
+
+constexpr std::string_view CacheMagic = "XRFrameTools LOD cache v2\n";
+
+// Followed by every level, most detailed first; the size of each level is
+// determined by the size of level 0
+struct CacheHeader {
+  uint64_t mLogFileSize {};
+  int64_t mLogLastWriteTime {};
+  uint32_t mFramesPerBucket {};
+  uint32_t mMetricCount {};
+  uint64_t mLevel0BucketCount {};
+  uint32_t mLevelFactor {};
+  uint32_t mReserved {};
+};
+
+std::vector<size_t> GetLevelSizes(size_t level0BucketCount) {
+  std::vector<size_t> ret {level0BucketCount};
+  while (ret.back() > 1) {
+    ret.push_back(
+      (ret.back() + LogPyramid::LevelFactor - 1) / LogPyramid::LevelFactor);
+  }
+  return ret;
+}
+
+// Deletes the least-recently-used caches, other than `keep`, until the
+// directory is within `LogPyramid::MaxCacheBytes`.
+//
+// Caches are named by a hash of their log's path, so caches for deleted logs
+// can't be found directly; they stop being used, so they are pruned here.
+void PruneCache(const std::filesystem::path& keep) {
+  struct CacheFile {
+    std::filesystem::path mPath;
+    std::filesystem::file_time_type mLastWriteTime;
+    uint64_t mSize {};
+  };
+
+  std::vector<CacheFile> files;
+  std::error_code ec;
+  for (auto it = std::filesystem::directory_iterator(keep.parent_path(), ec);
+       !ec && it != std::filesystem::directory_iterator();
+       it.increment(ec)) {
+    if (!it->is_regular_file(ec) || it->path().extension() != ".XRFTLOD") {
+      continue;
+    }
+    CacheFile file {
+      .mPath = it->path(),
+      .mLastWriteTime = it->last_write_time(ec),
+      .mSize = it->file_size(ec),
+    };
+    if (!ec) {
+      files.push_back(std::move(file));
+    }
+  }
+
+  uint64_t totalBytes {};
+  for (auto&& file: files) {
+    totalBytes += file.mSize;
+  }
+  if (totalBytes <= LogPyramid::MaxCacheBytes) {
+    return;
+  }
+
+  // Oldest first
+  std::ranges::sort(files, {}, &CacheFile::mLastWriteTime);
+
+  uint64_t deletedFiles {};
+  for (auto&& file: files) {
+    if (totalBytes <= LogPyramid::MaxCacheBytes) {
+      break;
+    }
+    if (file.mPath == keep || !std::filesystem::remove(file.mPath, ec)) {
+      continue;
+    }
+    totalBytes -= file.mSize;
+    ++deletedFiles;
+  }
+  if (deletedFiles) {
+    dprint(
+      "deleted {} log LOD caches; {} bytes remaining",
+      deletedFiles,
+      totalBytes);
+  }
+}
+
+std::array<float, LogPyramid::MetricCount> GetValues(const FrameMetrics& fm) {
+  const auto us = [](const std::chrono::microseconds value) {
+    return static_cast<float>(value.count());
+  };
+  std::array<float, LogPyramid::MetricCount> ret {};
+  ret[std::to_underlying(Metric::FrameInterval)] = us(fm.mSincePreviousFrame);
+  ret[std::to_underlying(Metric::WaitFrameCpu)] = us(fm.mWaitFrameCpu);
+  ret[std::to_underlying(Metric::AppCpu)] = us(fm.mAppCpu);
+  ret[std::to_underlying(Metric::BeginFrameCpu)] = us(fm.mBeginFrameCpu);
+  ret[std::to_underlying(Metric::RenderCpu)] = us(fm.mRenderCpu);
+  ret[std::to_underlying(Metric::EndFrameCpu)] = us(fm.mEndFrameCpu);
+  ret[std::to_underlying(Metric::RenderGpu)] = us(fm.mRenderGpu);
+  return ret;
+}
+
+// Accumulates in double precision, so long runs of frames don't lose
+// precision in the mean
+class BucketBuilder {
+ public:
+  void Add(
+    const Bucket& in,
+    std::span<const float, LogPyramid::MetricCount> means) {
+    if (mInputCount++ == 0) {
+      mBucket = in;
+      mBucket.mFrameCount = 0;
+    }
+    mBucket.mEnd = in.mEnd;
+    mBucket.mFrameCount += in.mFrameCount;
+    for (size_t i = 0; i < LogPyramid::MetricCount; ++i) {
+      auto& out = mBucket.mMetrics[i];
+      out.mMin = std::min(out.mMin, in.mMetrics[i].mMin);
+      out.mMax = std::max(out.mMax, in.mMetrics[i].mMax);
+      mSums[i] += static_cast<double>(means[i]) * in.mFrameCount;
+    }
+  }
+
+  void Add(const Bucket& in) {
+    std::array<float, LogPyramid::MetricCount> means {};
+    std::ranges::transform(
+      in.mMetrics, means.begin(), &LogPyramid::Summary::mMean);
+    this->Add(in, means);
+  }
+
+  [[nodiscard]]
+  size_t GetInputCount() const noexcept {
+    return mInputCount;
+  }
+
+  [[nodiscard]]
+  Bucket Finish() {
+    for (size_t i = 0; i < LogPyramid::MetricCount; ++i) {
+      mBucket.mMetrics[i].mMean = mBucket.mFrameCount
+        ? static_cast<float>(mSums[i] / mBucket.mFrameCount)
+        : 0.0f;
+    }
+    const auto ret = mBucket;
+    *this = {};
+    return ret;
+  }
+
+ private:
+  Bucket mBucket {};
+  std::array<double, LogPyramid::MetricCount> mSums {};
+  size_t mInputCount {};
+};
+
+}// namespace
+
+LogPyramid::LogPyramid(std::vector<std::vector<Bucket>>&& levels)
+  : mLevels(std::move(levels)) {
+}
+
+LogPyramid::LogPyramid(std::vector<Bucket>&& level0) {
+  mLevels.push_back(std::move(level0));
+  while (mLevels.back().size() > 1) {
+    const auto& below = mLevels.back();
+    std::vector<Bucket> level;
+    level.reserve((below.size() + LevelFactor - 1) / LevelFactor);
+    for (auto&& chunk: below | std::views::chunk(LevelFactor)) {
+      BucketBuilder builder;
+      for (auto&& it: chunk) {
+        builder.Add(it);
+      }
+      level.push_back(builder.Finish());
+    }
+    mLevels.push_back(std::move(level));
+  }
+}
+
+std::optional<LogPyramid> LogPyramid::Build(
+  BinaryLogReader& reader,
+  std::stop_token stopToken,
+  const ProgressCallback& progress) {
+  const auto pcm = reader.GetPerformanceCounterMath();
+  const auto streamSize = reader.GetStreamSize();
+  MetricsAggregator aggregator {pcm};
+
+  std::vector<Bucket> level0;
+  BucketBuilder builder;
+  std::optional<int64_t> firstFrameEnd;
+
+  // Checking position is a syscall, so don't check every frame
+  constexpr size_t MonitorInterval = 1024;
+  size_t framesUntilMonitor {MonitorInterval};
+
+  while (const auto frame = reader.GetNextFrame()) {
+    if (--framesUntilMonitor == 0) {
+      framesUntilMonitor = MonitorInterval;
+      if (stopToken.stop_requested()) {
+        return std::nullopt;
+      }
+      if (progress && streamSize) {
+        progress(static_cast<float>(
+          static_cast<double>(reader.GetStreamPosition()) / streamSize));
+      }
+    }
+
+    const auto representedFrames = reader.GetRepresentedFrameCount();
+    auto metrics = reader.GetFrameSummary();
+    if (!metrics) {
+      aggregator.Push(*frame, representedFrames);
+      metrics = aggregator.Flush();
+    }
+    if (!metrics) {
+      continue;
+    }
+
+    const auto& endFrameStop = frame->mCore.mEndFrameStop;
+    if (!firstFrameEnd) {
+      firstFrameEnd = endFrameStop;
+    }
+    const auto at
+      = pcm.ToDurationAllowNegative(*firstFrameEnd, endFrameStop).count();
+
+    const auto values = GetValues(*metrics);
+    Bucket bucket {
+      .mBegin = at,
+      .mEnd = at,
+      .mFrameCount = representedFrames,
+    };
+    for (size_t i = 0; i < MetricCount; ++i) {
+      bucket.mMetrics[i] = {values[i], values[i], values[i]};
+    }
+    builder.Add(bucket, values);
+
+    if (builder.GetInputCount() == FramesPerBucket) {
+      level0.push_back(builder.Finish());
+    }
+  }
+  if (builder.GetInputCount()) {
+    level0.push_back(builder.Finish());
+  }
+
+  if (progress) {
+    progress(1.0f);
+  }
+  if (level0.empty()) {
+    return std::nullopt;
+  }
+  return LogPyramid {std::move(level0)};
+}
+
+std::optional<LogPyramid> LogPyramid::LoadOrBuild(
+  BinaryLogReader& reader,
+  std::stop_token stopToken,
+  const ProgressCallback& progress) {
+  const auto logPath = reader.GetLogFilePath();
+  const auto cachePath = GetCachePath(logPath);
+  // Read before building, so that if the log is still being written, the
+  // cache is considered stale instead of claiming to include later frames
+  const auto version = GetLogVersion(logPath);
+  if (!version) {
+    return Build(reader, stopToken, progress);
+  }
+
+  if (auto cached = Load(cachePath, *version)) {
+    if (progress) {
+      progress(1.0f);
+    }
+    return cached;
+  }
+
+  auto ret = Build(reader, stopToken, progress);
+  if (ret) {
+    ret->Save(cachePath, *version);
+  }
+  return ret;
+}
+
+std::optional<LogPyramid::LogVersion> LogPyramid::GetLogVersion(
+  const std::filesystem::path& logPath) {
+  std::error_code ec;
+  const auto size = std::filesystem::file_size(logPath, ec);
+  if (ec) {
+    return std::nullopt;
+  }
+  const auto lastWriteTime = std::filesystem::last_write_time(logPath, ec);
+  if (ec) {
+    return std::nullopt;
+  }
+  return LogVersion {size, lastWriteTime.time_since_epoch().count()};
+}
+
+std::filesystem::path LogPyramid::GetCachePath(
+  const std::filesystem::path& logPath) {
+  std::error_code ec;
+  auto key = std::filesystem::weakly_canonical(logPath, ec).wstring();
+  if (ec) {
+    key = std::filesystem::absolute(logPath).wstring();
+  }
+  std::ranges::transform(key, key.begin(), [](const wchar_t c) {
+    return static_cast<wchar_t>(std::towlower(c));
+  });
+
+  const auto fileName = std::format(
+    L"{} {:016x}.XRFTLOD",
+    logPath.stem().wstring(),
+    std::hash<std::wstring> {}(key));
+  return GetKnownFolderPath(FOLDERID_LocalAppData) / "XRFrameTools" / "Cache"
+    / fileName;
+}
+
+std::optional<LogPyramid> LogPyramid::Load(
+  const std::filesystem::path& cachePath,
+  const LogVersion& version) {
+  std::ifstream in {cachePath, std::ios::binary};
+  if (!in) {
+    return std::nullopt;
+  }
+
+  std::string magic(CacheMagic.size(), '\0');
+  CacheHeader header {};
+  if (!(in.read(magic.data(), magic.size())
+        && in.read(reinterpret_cast<char*>(&header), sizeof(header)))) {
+    return std::nullopt;
+  }
+  if (
+    magic != CacheMagic || header.mLogFileSize != version.mFileSize
+    || header.mLogLastWriteTime != version.mLastWriteTime
+    || header.mFramesPerBucket != FramesPerBucket
+    || header.mMetricCount != MetricCount || header.mLevelFactor != LevelFactor
+    || header.mLevel0BucketCount == 0) {
+    return std::nullopt;
+  }
+
+  // Don't trust the count enough to allocate it before checking the size
+  std::error_code ec;
+  const auto cacheSize = std::filesystem::file_size(cachePath, ec);
+  if (ec || header.mLevel0BucketCount > cacheSize / sizeof(Bucket)) {
+    return std::nullopt;
+  }
+  const auto levelSizes = GetLevelSizes(header.mLevel0BucketCount);
+  const auto expectedSize = CacheMagic.size() + sizeof(header)
+    + (std::accumulate(levelSizes.begin(), levelSizes.end(), size_t {})
+       * sizeof(Bucket));
+  if (cacheSize != expectedSize) {
+    return std::nullopt;
+  }
+
+  std::vector<std::vector<Bucket>> levels;
+  levels.reserve(levelSizes.size());
+  for (auto&& size: levelSizes) {
+    auto& level = levels.emplace_back(size);
+    if (!in.read(
+          reinterpret_cast<char*>(level.data()),
+          level.size() * sizeof(Bucket))) {
+      return std::nullopt;
+    }
+  }
+  in.close();
+
+  // Used by `PruneCache()` to find the least-recently-used caches
+  std::filesystem::last_write_time(
+    cachePath, std::filesystem::file_time_type::clock::now(), ec);
+
+  return LogPyramid {std::move(levels)};
+}
+
+void LogPyramid::Save(
+  const std::filesystem::path& cachePath,
+  const LogVersion& version) const {
+  std::error_code ec;
+  std::filesystem::create_directories(cachePath.parent_path(), ec);
+  auto temporaryPath = cachePath;
+  temporaryPath += std::format(L".{}.tmp", GetCurrentProcessId());
+
+  {
+    std::ofstream out {temporaryPath, std::ios::binary | std::ios::trunc};
+    const CacheHeader header {
+      .mLogFileSize = version.mFileSize,
+      .mLogLastWriteTime = version.mLastWriteTime,
+      .mFramesPerBucket = FramesPerBucket,
+      .mMetricCount = MetricCount,
+      .mLevel0BucketCount = mLevels.front().size(),
+      .mLevelFactor = LevelFactor,
+    };
+    out.write(CacheMagic.data(), CacheMagic.size());
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    // Loading doesn't need to rebuild the higher levels
+    for (auto&& level: mLevels) {
+      out.write(
+        reinterpret_cast<const char*>(level.data()),
+        level.size() * sizeof(Bucket));
+    }
+    if (!out) {
+      dprint("failed to write log LOD cache");
+      out.close();
+      std::filesystem::remove(temporaryPath, ec);
+      return;
+    }
+  }
+
+  std::filesystem::rename(temporaryPath, cachePath, ec);
+  if (ec) {
+    dprint("failed to save log LOD cache: {}", ec.message());
+    std::filesystem::remove(temporaryPath, ec);
+    return;
+  }
+  PruneCache(cachePath);
+}
+
+std::span<const Bucket> LogPyramid::Query(
+  const std::chrono::microseconds begin,
+  const std::chrono::microseconds end,
+  const size_t maxBuckets) const {
+  for (auto&& level: mLevels) {
+    auto first
+      = std::ranges::lower_bound(level, begin.count(), {}, &Bucket::mEnd);
+    auto last
+      = std::ranges::upper_bound(level, end.count(), {}, &Bucket::mBegin);
+    if (first != level.begin()) {
+      --first;
+    }
+    if (last != level.end()) {
+      ++last;
+    }
+    if (
+      first >= last || static_cast<size_t>(last - first) <= maxBuckets
+      || &level == &mLevels.back()) {
+      return {first, last};
+    }
+  }
+  std::unreachable();
+}
+
+const Bucket& LogPyramid::GetTotal() const noexcept {
+  return mLevels.back().front();
+}
+
+size_t LogPyramid::GetLevelCount() const noexcept {
+  return mLevels.size();
+}
@@ -0,0 +1,139 @@
+// Copyright 2024 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <span>
+#include <stop_token>
+#include <vector>
+
+#include "BinaryLogReader.hpp"
+
+/** Min/max/mean summaries of every frame in a binary log, at several
+ * resolutions.
+ *
+ * Each bucket in level 0 summarizes `FramesPerBucket` frames, and each bucket
+ * in a higher level summarizes `LevelFactor` buckets from the level below, up
+ * to a level with a single bucket. This lets any time range be plotted using
+ * a number of buckets proportional to the plot's width, instead of the number
+ * of frames.
+ *
+ * As building this requires reading the entire log, it is cached; see
+ * `LoadOrBuild()`.
+ */
+class LogPyramid final {
+ public:
+  enum class Metric : uint32_t {
+    FrameInterval,
+    WaitFrameCpu,
+    AppCpu,
+    BeginFrameCpu,
+    RenderCpu,
+    EndFrameCpu,
+    RenderGpu,
+  };
+  static constexpr size_t MetricCount
+    = std::to_underlying(Metric::RenderGpu) + 1;
+
+  static constexpr size_t FramesPerBucket = 16;
+  static constexpr size_t LevelFactor = 4;
+
+  // All in microseconds
+  struct Summary {
+    float mMin {};
+    float mMax {};
+    float mMean {};
+  };
+
+  struct Bucket {
+    // Microseconds since the end of the first frame
+    int64_t mBegin {};
+    int64_t mEnd {};
+    // Includes frames that were skipped by the logging policy
+    uint64_t mFrameCount {};
+    std::array<Summary, MetricCount> mMetrics {};
+
+    [[nodiscard]]
+    const Summary& Get(const Metric metric) const noexcept {
+      return mMetrics[std::to_underlying(metric)];
+    }
+  };
+
+  /// Caches are identified by the size and modification time of their log
+  struct LogVersion {
+    uint64_t mFileSize {};
+    int64_t mLastWriteTime {};
+  };
+
+  /// The least-recently-used caches are deleted to stay within this size
+  static constexpr uint64_t MaxCacheBytes = 256 * 1024 * 1024;
+
+  using ProgressCallback = std::function<void(float)>;
+
+  LogPyramid() = delete;
+
+  /// Read every frame; returns `std::nullopt` if stopped, or if there are no
+  /// frames
+  [[nodiscard]]
+  static std::optional<LogPyramid>
+  Build(BinaryLogReader&, std::stop_token = {}, const ProgressCallback& = {});
+
+  /// Use the cache if it matches the log, otherwise build and cache it
+  [[nodiscard]]
+  static std::optional<LogPyramid> LoadOrBuild(
+    BinaryLogReader&,
+    std::stop_token = {},
+    const ProgressCallback& = {});
+
+  /// `std::nullopt` if missing, invalid, or for a different version of the log
+  [[nodiscard]]
+  static std::optional<LogPyramid> Load(
+    const std::filesystem::path& cachePath,
+    const LogVersion&);
+  /** Save a pyramid built from the given version of the log.
+   *
+   * The version should be read before building, so that if the log is
+   * modified while building, the cache is considered stale.
+   *
+   * Old caches are deleted to stay within `MaxCacheBytes`.
+   */
+  void Save(const std::filesystem::path& cachePath, const LogVersion&) const;
+
+  [[nodiscard]]
+  static std::filesystem::path GetCachePath(
+    const std::filesystem::path& logPath);
+
+  [[nodiscard]]
+  static std::optional<LogVersion> GetLogVersion(
+    const std::filesystem::path& logPath);
+
+  /** The buckets covering `[begin, end]` from the most detailed level that
+   * needs no more than `maxBuckets` buckets.
+   *
+   * Includes one bucket either side of the range where possible, so that
+   * lines continue to the edge of a plot.
+   */
+  [[nodiscard]]
+  std::span<const Bucket> Query(
+    std::chrono::microseconds begin,
+    std::chrono::microseconds end,
+    size_t maxBuckets) const;
+
+  /// A single bucket for the whole log
+  [[nodiscard]]
+  const Bucket& GetTotal() const noexcept;
+
+  [[nodiscard]]
+  size_t GetLevelCount() const noexcept;
+
+ private:
+  std::vector<std::vector<Bucket>> mLevels;
+
+  // Builds the higher levels
+  explicit LogPyramid(std::vector<Bucket>&& level0);
+  explicit LogPyramid(std::vector<std::vector<Bucket>>&& levels);
+};
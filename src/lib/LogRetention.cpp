@@ -0,0 +1,113 @@
+// Copyright 2024 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+
+#include "LogRetention.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+#include "Win32Utils.hpp"
+
+LogRetention::LogRetention(
+  const std::filesystem::path& root,
+  const Policy& policy)
+  : mRoot(root), mPolicy(policy) {
+  mThread = std::jthread {std::bind_front(&LogRetention::Run, this)};
+}
+
+LogRetention::~LogRetention() {
+  mThread = {};
+}
+
+void LogRetention::Enforce() noexcept {
+  if (mPolicy.IsEnabled()) {
+    mWakeEvent.SetEvent();
+  }
+}
+
+void LogRetention::Run(std::stop_token tok) {
+  SetThreadDescription(GetCurrentThread(), L"XRFrameTools Log Retention");
+  // Lowers CPU, I/O, and memory priority
+  SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN);
+
+  const std::stop_callback wakeOnStop(
+    tok, std::bind_front(&SetEvent, mWakeEvent.get()));
+
+  while (WaitForSingleObject(mWakeEvent.get(), INFINITE) == WAIT_OBJECT_0) {
+    if (tok.stop_requested()) {
+      return;
+    }
+    this->RunPass(tok);
+  }
+}
+
+void LogRetention::RunPass(const std::stop_token& tok) {
+  struct LogFile {
+    std::filesystem::path mPath;
+    std::filesystem::file_time_type mLastWriteTime;
+    uint64_t mSize {};
+  };
+
+  std::vector<LogFile> files;
+  std::error_code ec;
+  for (auto it = std::filesystem::recursive_directory_iterator(mRoot, ec);
+       !ec && it != std::filesystem::recursive_directory_iterator();
+       it.increment(ec)) {
+    if (tok.stop_requested()) {
+      return;
+    }
+    if (!it->is_regular_file(ec) || it->path().extension() != ".XRFTBinLog") {
+      continue;
+    }
+    LogFile file {
+      .mPath = it->path(),
+      .mLastWriteTime = it->last_write_time(ec),
+      .mSize = it->file_size(ec),
+    };
+    if (!ec) {
+      files.push_back(std::move(file));
+    }
+  }
+
+  // Oldest first
+  std::ranges::sort(files, {}, &LogFile::mLastWriteTime);
+
+  uint64_t totalBytes {};
+  for (auto&& file: files) {
+    totalBytes += file.mSize;
+  }
+
+  const auto now = std::filesystem::file_time_type::clock::now();
+  uint64_t deletedFiles {};
+  uint64_t deletedBytes {};
+  for (auto&& file: files) {
+    if (tok.stop_requested()) {
+      break;
+    }
+    const auto tooOld
+      = mPolicy.mMaxAge.count() && (now - file.mLastWriteTime) > mPolicy.mMaxAge;
+    const auto overBudget
+      = mPolicy.mMaxTotalBytes && totalBytes > mPolicy.mMaxTotalBytes;
+    if (!(tooOld || overBudget)) {
+      // Sorted by age, so nothing newer is too old either
+      break;
+    }
+
+    // Fails for logs that are still being written; that's fine
+    if (!std::filesystem::remove(file.mPath, ec)) {
+      continue;
+    }
+    totalBytes -= file.mSize;
+    ++deletedFiles;
+    deletedBytes += file.mSize;
+  }
+
+  if (deletedFiles) {
+    dprint(
+      "log retention: deleted {} files ({} bytes); {} bytes remaining",
+      deletedFiles,
+      deletedBytes,
+      totalBytes);
+  }
+}
@@ -0,0 +1,56 @@
+// Copyright 2024 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <Windows.h>
+#include <wil/resource.h>
+
+#include <chrono>
+#include <filesystem>
+#include <thread>
+
+/** Deletes old binary logs.
+ *
+ * Passes are requested with `Enforce()`, and run on a background-priority
+ * thread, so never delay the logger thread or the app.
+ *
+ * Files that are still open - e.g. the current log of any running app - can't
+ * be deleted, so are skipped.
+ */
+class LogRetention final {
+ public:
+  struct Policy {
+    // Each is unlimited if 0
+    uint64_t mMaxTotalBytes {};
+    std::chrono::hours mMaxAge {};
+
+    [[nodiscard]]
+    bool IsEnabled() const noexcept {
+      return mMaxTotalBytes || mMaxAge.count();
+    }
+
+    bool operator==(const Policy&) const noexcept = default;
+  };
+
+  LogRetention() = delete;
+  LogRetention(const LogRetention&) = delete;
+  LogRetention(LogRetention&&) = delete;
+  LogRetention& operator=(const LogRetention&) = delete;
+  LogRetention& operator=(LogRetention&&) = delete;
+
+  LogRetention(const std::filesystem::path& root, const Policy&);
+  ~LogRetention();
+
+  /// Request a pass; returns immediately
+  void Enforce() noexcept;
+
+ private:
+  std::filesystem::path mRoot;
+  Policy mPolicy;
+
+  wil::unique_event mWakeEvent {wil::EventOptions::None};
+  std::jthread mThread;
+
+  void Run(std::stop_token);
+  void RunPass(const std::stop_token&);
+};
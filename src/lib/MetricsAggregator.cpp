@@ -3,6 +3,10 @@
 
 #include "MetricsAggregator.hpp"
 
+#include <algorithm>
+#include <limits>
+#include <utility>
+
 #include "FrameMetrics.hpp"
 #include "FramePerformanceCounters.hpp"
 
@@ -14,11 +18,6 @@ void SetIfLarger(T* a, T b) {
   }
 }
 
-template <>
-void SetIfLarger<LARGE_INTEGER>(LARGE_INTEGER* a, LARGE_INTEGER b) {
-  SetIfLarger(&a->QuadPart, b.QuadPart);
-}
-
 template <class T>
 void SetIfSmallerOrTargetIsZero(T* a, T b) {
   if (*a == 0 || b < *a) {
@@ -32,9 +31,11 @@ MetricsAggregator::MetricsAggregator(const PerformanceCounterMath& pc)
   : mPerformanceCounterMath(pc) {
 }
 
-void MetricsAggregator::Push(const FramePerformanceCounters& rawFpc) {
+void MetricsAggregator::Push(
+  const FramePerformanceCounters& rawFpc,
+  const uint64_t representedFrames) {
   const auto& rawCore = rawFpc.mCore;
-  if (!rawCore.mBeginFrameStart.QuadPart) {
+  if (!rawCore.mBeginFrameStart) {
     // We couldn't match the predicted display time in xrEndFrame,
     // so all core stats are bogus
     //
@@ -42,18 +43,24 @@ void MetricsAggregator::Push(const FramePerformanceCounters& rawFpc) {
     // in a layer closer to the game
     return;
   }
-  if (rawCore.mEndFrameStop.QuadPart && !mPreviousFrameEndTime.QuadPart) {
+  const auto pacing
+    = mPacingAnalyzer.Push(rawCore.mXrDisplayTime, representedFrames);
+  if (rawCore.mEndFrameStop && !mPreviousFrameEndTime) {
     // While the frame is overall valid, without an interval (and FPS)
     // we can't draw useful conclusions from it
     mPreviousFrameEndTime = rawCore.mEndFrameStop;
     return;
   }
-  if (rawCore.mEndFrameStop.QuadPart && !mFirstFrameEndTime.QuadPart) {
+  if (rawCore.mEndFrameStop && !mFirstFrameEndTime) {
     mFirstFrameEndTime = rawCore.mEndFrameStop;
   }
-  if (rawCore.mEndFrameStop.QuadPart < mPreviousFrameEndTime.QuadPart) {
+  if (rawCore.mEndFrameStop < mPreviousFrameEndTime) {
     mPreviousFrameEndTime = {};
     mAccumulator = {};
+    mPacingJitter = {};
+    mPacedFrameCount = 0;
+    mBottleneckClassifier = {};
+    mHostMetricsSums = {};
     mHavePartialData = false;
     return;
   }
@@ -66,12 +73,23 @@ void MetricsAggregator::Push(const FramePerformanceCounters& rawFpc) {
   // what's blocking the render loop, not actual time spent on the frame.
   //
   // Actual time on the frame needs in-engine metrics and/or profiling tools
+  //
+  // If this frame represents others that weren't logged, the previous
+  // *logged* frame ended several frames ago; measure from where this frame
+  // would have started at the average interval instead, otherwise the
+  // skipped frames would be counted as app CPU time.
+  const auto frameCount
+    = static_cast<int64_t>(std::max<uint64_t>(representedFrames, 1));
+  const auto frameStart = std::max(
+    mPreviousFrameEndTime,
+    rawCore.mEndFrameStop
+      - ((rawCore.mEndFrameStop - mPreviousFrameEndTime) / frameCount));
   auto fpc = rawFpc;
   auto& core = fpc.mCore;
-  SetIfLarger(&core.mWaitFrameStart, mPreviousFrameEndTime);
-  SetIfLarger(&core.mWaitFrameStop, mPreviousFrameEndTime);
-  SetIfLarger(&core.mBeginFrameStart, mPreviousFrameEndTime);
-  SetIfLarger(&core.mBeginFrameStop, mPreviousFrameEndTime);
+  SetIfLarger(&core.mWaitFrameStart, frameStart);
+  SetIfLarger(&core.mWaitFrameStop, frameStart);
+  SetIfLarger(&core.mBeginFrameStart, frameStart);
+  SetIfLarger(&core.mBeginFrameStop, frameStart);
 
   auto& acc = mAccumulator;
   SetIfLarger(&acc.mLastXrDisplayTime, core.mXrDisplayTime);
@@ -85,29 +103,56 @@ void MetricsAggregator::Push(const FramePerformanceCounters& rawFpc) {
     acc.mValidDataBits &= fpc.mValidDataBits;
   }
 
-  const auto& pcm = mPerformanceCounterMath;
+  if (pacing) {
+    acc.mPacing.mDisplayPeriod
+      = duration_cast<std::chrono::microseconds>(pacing->mDisplayPeriod);
+    acc.mPacing.mLateFrameCount += pacing->mIsLate;
+    acc.mPacing.mSkippedSlots += pacing->mSkippedSlots;
+    acc.mPacing.mRepeatedSlots += pacing->mRepeatedSlots;
+    mPacingJitter += pacing->mJitter;
+    ++mPacedFrameCount;
+  }
 
-  acc.mWaitFrameCpu
-    += pcm.ToDuration(core.mWaitFrameStart, core.mWaitFrameStop);
-  acc.mRenderCpu += pcm.ToDuration(core.mBeginFrameStop, core.mEndFrameStart);
-  acc.mBeginFrameCpu
-    += pcm.ToDuration(core.mBeginFrameStart, core.mBeginFrameStop);
-  acc.mEndFrameCpu = pcm.ToDuration(core.mEndFrameStart, core.mEndFrameStop);
+  const auto& pcm = mPerformanceCounterMath;
 
-  acc.mAppCpu += pcm.ToDuration(mPreviousFrameEndTime, core.mWaitFrameStart)
+  const auto waitFrameCpu
+    = pcm.ToDuration(core.mWaitFrameStart, core.mWaitFrameStop);
+  const auto renderCpu
+    = pcm.ToDuration(core.mBeginFrameStop, core.mEndFrameStart);
+  const auto beginFrameCpu
+    = pcm.ToDuration(core.mBeginFrameStart, core.mBeginFrameStop);
+  const auto endFrameCpu
+    = pcm.ToDuration(core.mEndFrameStart, core.mEndFrameStop);
+  const auto appCpu = pcm.ToDuration(frameStart, core.mWaitFrameStart)
     + pcm.ToDuration(core.mWaitFrameStop, core.mBeginFrameStart);
+  const std::chrono::microseconds renderGpu {fpc.mRenderGpu};
 
-  acc.mRenderGpu += std::chrono::microseconds(fpc.mRenderGpu);
+  acc.mWaitFrameCpu += waitFrameCpu;
+  acc.mRenderCpu += renderCpu;
+  acc.mBeginFrameCpu += beginFrameCpu;
+  acc.mEndFrameCpu += endFrameCpu;
+  acc.mAppCpu += appCpu;
+  acc.mRenderGpu += renderGpu;
 
-  SetIfLarger(&acc.mVideoMemoryInfo.Budget, fpc.mVideoMemoryInfo.Budget);
+  using Bits = FramePerformanceCounters::ValidDataBits;
+  const auto hasGpuTime
+    = (fpc.mValidDataBits & Bits::GpuTime) == Bits::GpuTime;
+  mBottleneckClassifier.Push({
+    .mAppCpu = appCpu.count(),
+    .mRenderCpu = renderCpu.count(),
+    .mRenderGpu = hasGpuTime ? renderGpu.count() : 0,
+    .mCompositorCpu = (waitFrameCpu + beginFrameCpu + endFrameCpu).count(),
+  });
+
+  SetIfLarger(&acc.mVideoMemoryInfo.mBudget, fpc.mVideoMemoryInfo.mBudget);
   SetIfLarger(
-    &acc.mVideoMemoryInfo.CurrentUsage, fpc.mVideoMemoryInfo.CurrentUsage);
+    &acc.mVideoMemoryInfo.mCurrentUsage, fpc.mVideoMemoryInfo.mCurrentUsage);
   SetIfLarger(
-    &acc.mVideoMemoryInfo.AvailableForReservation,
-    fpc.mVideoMemoryInfo.AvailableForReservation);
+    &acc.mVideoMemoryInfo.mAvailableForReservation,
+    fpc.mVideoMemoryInfo.mAvailableForReservation);
   SetIfLarger(
-    &acc.mVideoMemoryInfo.CurrentReservation,
-    fpc.mVideoMemoryInfo.CurrentReservation);
+    &acc.mVideoMemoryInfo.mCurrentReservation,
+    fpc.mVideoMemoryInfo.mCurrentReservation);
 
   acc.mGpuPerformanceDecreaseReasons
     |= fpc.mGpuPerformanceInformation.mDecreaseReasons;
@@ -126,11 +171,10 @@ void MetricsAggregator::Push(const FramePerformanceCounters& rawFpc) {
   SetIfLarger(&acc.mGpuMemoryKHzMax, fpc.mGpuPerformanceInformation.mMemoryKHz);
 
   acc.mSincePreviousFrame
-    += pcm.ToDuration(mPreviousFrameEndTime, core.mEndFrameStop);
+    += pcm.ToDuration(mPreviousFrameEndTime, core.mEndFrameStop) / frameCount;
   acc.mSinceFirstFrame = pcm.ToDuration(mFirstFrameEndTime, core.mEndFrameStop);
   mPreviousFrameEndTime = core.mEndFrameStop;
 
-  using Bits = FramePerformanceCounters::ValidDataBits;
   if ((fpc.mValidDataBits & Bits::NVEnc) == Bits::NVEnc) {
     const auto sessionCount = std::min<uint32_t>(
       std::size(fpc.mEncoders.mSessions), fpc.mEncoders.mSessionCount);
@@ -155,6 +199,163 @@ void MetricsAggregator::Push(const FramePerformanceCounters& rawFpc) {
         / newFrameCount;
     }
   }
+
+  this->PushHostMetrics(fpc);
+}
+
+void MetricsAggregator::PushHostMetrics(const FramePerformanceCounters& fpc) {
+  using Bits = FramePerformanceCounters::ValidDataBits;
+  auto& sums = mHostMetricsSums;
+
+  const auto& cpu = fpc.mHostCpu;
+  if (
+    (fpc.mValidDataBits & Bits::HostCpu) == Bits::HostCpu
+    && cpu.mSampleTime != mLastHostCpuSampleTime) {
+    mLastHostCpuSampleTime = cpu.mSampleTime;
+    ++sums.mCpuSampleCount;
+    sums.mFrequencyMHz += cpu.mFrequencyMHz;
+    sums.mUtilization += cpu.mUtilization;
+    sums.mBusiestCoreUtilization += cpu.mBusiestCoreUtilization;
+    sums.mSampleCostMicroseconds += cpu.mSampleCostMicroseconds;
+  }
+
+  const auto& process = fpc.mProcessResources;
+  if (
+    (fpc.mValidDataBits & Bits::ProcessResources) == Bits::ProcessResources
+    && process.mSampleTime != mLastProcessSampleTime) {
+    mLastProcessSampleTime = process.mSampleTime;
+    ++sums.mProcessSampleCount;
+    sums.mProcessCpuUtilization += process.mCpuUtilization;
+    sums.mWorkingSetBytes += process.mWorkingSetBytes;
+    sums.mPrivateBytes += process.mPrivateBytes;
+    sums.mPageFaults += process.mPageFaults;
+  }
+}
+
+void MetricsAggregator::Push(const FrameMetrics& in) {
+  const auto n = in.mFrameCount;
+  auto& acc = mAccumulator;
+  if (n == 0) {
+    return;
+  }
+  if (acc.mFrameCount > std::numeric_limits<uint16_t>::max() - n) {
+    // Would overflow `mFrameCount`; drop it rather than corrupt the averages
+    return;
+  }
+
+  if (acc.mFrameCount == 0) {
+    acc.mValidDataBits = in.mValidDataBits;
+    acc.mGpuPStateMin = in.mGpuPStateMin;
+  } else {
+    acc.mValidDataBits &= in.mValidDataBits;
+    acc.mGpuPStateMin = std::min(acc.mGpuPStateMin, in.mGpuPStateMin);
+  }
+  acc.mFrameCount += n;
+
+  // Divided by the total frame count in `Flush()`
+  acc.mSincePreviousFrame += in.mSincePreviousFrame * n;
+  acc.mWaitFrameCpu += in.mWaitFrameCpu * n;
+  acc.mRenderCpu += in.mRenderCpu * n;
+  acc.mBeginFrameCpu += in.mBeginFrameCpu * n;
+  acc.mEndFrameCpu += in.mEndFrameCpu * n;
+  acc.mAppCpu += in.mAppCpu * n;
+  acc.mRenderGpu += in.mRenderGpu * n;
+
+  SetIfLarger(&acc.mLastXrDisplayTime, in.mLastXrDisplayTime);
+  SetIfLarger(&acc.mLastEndFrameStop, in.mLastEndFrameStop);
+  acc.mSinceFirstFrame = in.mSinceFirstFrame;
+
+  SetIfLarger(&acc.mVideoMemoryInfo.mBudget, in.mVideoMemoryInfo.mBudget);
+  SetIfLarger(
+    &acc.mVideoMemoryInfo.mCurrentUsage, in.mVideoMemoryInfo.mCurrentUsage);
+  SetIfLarger(
+    &acc.mVideoMemoryInfo.mAvailableForReservation,
+    in.mVideoMemoryInfo.mAvailableForReservation);
+  SetIfLarger(
+    &acc.mVideoMemoryInfo.mCurrentReservation,
+    in.mVideoMemoryInfo.mCurrentReservation);
+
+  acc.mGpuPerformanceDecreaseReasons |= in.mGpuPerformanceDecreaseReasons;
+  acc.mGpuPStateMax = std::max(acc.mGpuPStateMax, in.mGpuPStateMax);
+  SetIfSmallerOrTargetIsZero(&acc.mGpuGraphicsKHzMin, in.mGpuGraphicsKHzMin);
+  SetIfSmallerOrTargetIsZero(&acc.mGpuMemoryKHzMin, in.mGpuMemoryKHzMin);
+  SetIfLarger(&acc.mGpuGraphicsKHzMax, in.mGpuGraphicsKHzMax);
+  SetIfLarger(&acc.mGpuMemoryKHzMax, in.mGpuMemoryKHzMax);
+
+  for (size_t i = 0; i < FrameBottleneckCount; ++i) {
+    acc.mBottleneckFrameCounts[i] += in.mBottleneckFrameCounts[i];
+  }
+
+  if (in.mPacing.mDisplayPeriod.count()) {
+    acc.mPacing.mDisplayPeriod = in.mPacing.mDisplayPeriod;
+    acc.mPacing.mLateFrameCount += in.mPacing.mLateFrameCount;
+    acc.mPacing.mSkippedSlots += in.mPacing.mSkippedSlots;
+    acc.mPacing.mRepeatedSlots += in.mPacing.mRepeatedSlots;
+    mPacingJitter += in.mPacing.mJitter * n;
+    mPacedFrameCount += n;
+  }
+
+  // Per-session averages aren't weighted; the latest sessions are the most
+  // useful for history
+  if (in.mEncoders.mSessionCount) {
+    acc.mEncoders = in.mEncoders;
+  }
+
+  auto& sums = mHostMetricsSums;
+  if (const auto cpuSamples = in.mHostCpu.mSampleCount) {
+    sums.mCpuSampleCount += cpuSamples;
+    sums.mFrequencyMHz += uint64_t {in.mHostCpu.mFrequencyMHz} * cpuSamples;
+    sums.mUtilization += uint64_t {in.mHostCpu.mUtilization} * cpuSamples;
+    sums.mBusiestCoreUtilization
+      += uint64_t {in.mHostCpu.mBusiestCoreUtilization} * cpuSamples;
+    sums.mSampleCostMicroseconds
+      += uint64_t {in.mHostCpu.mSampleCostMicroseconds} * cpuSamples;
+  }
+  if (const auto processSamples = in.mProcessResources.mSampleCount) {
+    const auto& process = in.mProcessResources;
+    sums.mProcessSampleCount += processSamples;
+    sums.mProcessCpuUtilization
+      += uint64_t {process.mCpuUtilization} * processSamples;
+    sums.mWorkingSetBytes += process.mWorkingSetBytes * processSamples;
+    sums.mPrivateBytes += process.mPrivateBytes * processSamples;
+    // Already a total
+    sums.mPageFaults += process.mPageFaults;
+  }
+}
+
+void MetricsAggregator::FlushHostMetrics() {
+  using Bits = FramePerformanceCounters::ValidDataBits;
+  auto& acc = mAccumulator;
+  const auto sums = std::exchange(mHostMetricsSums, {});
+
+  // Most frames don't have their own sample, so the bits are cleared by the
+  // usual 'all frames' logic; instead, they're valid if any frame had one
+  acc.mValidDataBits &= ~std::to_underlying(Bits::HostCpu);
+  acc.mValidDataBits &= ~std::to_underlying(Bits::ProcessResources);
+
+  if (const auto n = sums.mCpuSampleCount) {
+    acc.mValidDataBits |= Bits::HostCpu;
+    acc.mHostCpu = {
+      .mSampleCount = static_cast<uint32_t>(n),
+      .mFrequencyMHz = static_cast<uint32_t>(sums.mFrequencyMHz / n),
+      .mUtilization = static_cast<uint32_t>(sums.mUtilization / n),
+      .mBusiestCoreUtilization
+      = static_cast<uint32_t>(sums.mBusiestCoreUtilization / n),
+      .mSampleCostMicroseconds
+      = static_cast<uint32_t>(sums.mSampleCostMicroseconds / n),
+    };
+  }
+
+  if (const auto n = sums.mProcessSampleCount) {
+    acc.mValidDataBits |= Bits::ProcessResources;
+    acc.mProcessResources = {
+      .mSampleCount = static_cast<uint32_t>(n),
+      .mCpuUtilization = static_cast<uint32_t>(sums.mProcessCpuUtilization / n),
+      .mWorkingSetBytes = sums.mWorkingSetBytes / n,
+      .mPrivateBytes = sums.mPrivateBytes / n,
+      .mPageFaults = sums.mPageFaults,
+    };
+  }
 }
 
 std::optional<FrameMetrics> MetricsAggregator::Flush() {
@@ -173,6 +374,20 @@ std::optional<FrameMetrics> MetricsAggregator::Flush() {
 
   acc.mRenderGpu /= n;
 
+  if (mPacedFrameCount) {
+    acc.mPacing.mJitter = std::chrono::round<std::chrono::microseconds>(
+      mPacingJitter / mPacedFrameCount);
+  }
+  mPacingJitter = {};
+  mPacedFrameCount = 0;
+
+  const auto bottlenecks = mBottleneckClassifier.Flush();
+  for (size_t i = 0; i < FrameBottleneckCount; ++i) {
+    acc.mBottleneckFrameCounts[i] += bottlenecks[i];
+  }
+
+  this->FlushHostMetrics();
+
   mHavePartialData = false;
   mEncoderSessionFrameCounts.clear();
   return std::exchange(mAccumulator, {});
@@ -3,8 +3,11 @@
 #pragma once
 
 #include <optional>
+#include <vector>
 
+#include "FrameBottleneck.hpp"
 #include "FrameMetrics.hpp"
+#include "FramePacingAnalyzer.hpp"
 #include "FramePerformanceCounters.hpp"
 #include "PerformanceCounterMath.hpp"
 
@@ -18,22 +21,66 @@ class MetricsAggregator final {
 
   explicit MetricsAggregator(const PerformanceCounterMath&);
 
-  void Push(const FramePerformanceCounters&);
+  /** Add a frame.
+   *
+   * If the frame was logged in place of others - e.g. with a decimating
+   * `BinaryLog::LoggingPolicy` - `representedFrames` should be the number of
+   * frames it represents, so that the frame interval and the time before
+   * `xrWaitFrame()` are per real frame.
+   */
+  void Push(const FramePerformanceCounters&, uint64_t representedFrames = 1);
+  /** Add the output of another aggregator's `Flush()`, e.g. to build
+   * lower-resolution history from higher-resolution history.
+   *
+   * Averages are weighted by each input's `mFrameCount`.
+   */
+  void Push(const FrameMetrics&);
   [[nodiscard]] std::optional<FrameMetrics> Flush();
 
   void Reset() {
-    auto pcm = mPerformanceCounterMath;
+    // Copied first, as members can't be read once we're destroyed
+    const auto pcm = mPerformanceCounterMath;
     this->~MetricsAggregator();
-    new (this) MetricsAggregator(mPerformanceCounterMath);
+    new (this) MetricsAggregator(pcm);
   }
 
  private:
   const PerformanceCounterMath mPerformanceCounterMath;
 
   FrameMetrics mAccumulator {};
-  LARGE_INTEGER mPreviousFrameEndTime {};
-  LARGE_INTEGER mFirstFrameEndTime {};
+  int64_t mPreviousFrameEndTime {};
+  int64_t mFirstFrameEndTime {};
   bool mHavePartialData = false;
 
+  // Unlike the accumulator, this is kept between `Flush()` calls
+  FramePacingAnalyzer mPacingAnalyzer;
+  std::chrono::nanoseconds mPacingJitter {};
+  uint64_t mPacedFrameCount {};
+
+  FrameBottleneckClassifier mBottleneckClassifier;
+
   std::vector<uint32_t> mEncoderSessionFrameCounts;
+
+  // `HostMetrics` samples are shared by many frames, so are averaged per
+  // distinct sample rather than per frame
+  struct HostMetricsSums {
+    uint64_t mCpuSampleCount {};
+    uint64_t mFrequencyMHz {};
+    uint64_t mUtilization {};
+    uint64_t mBusiestCoreUtilization {};
+    uint64_t mSampleCostMicroseconds {};
+
+    uint64_t mProcessSampleCount {};
+    uint64_t mProcessCpuUtilization {};
+    uint64_t mWorkingSetBytes {};
+    uint64_t mPrivateBytes {};
+    uint64_t mPageFaults {};
+  };
+  HostMetricsSums mHostMetricsSums {};
+  // Kept between `Flush()` calls, so a sample isn't counted twice
+  int64_t mLastHostCpuSampleTime {};
+  int64_t mLastProcessSampleTime {};
+
+  void PushHostMetrics(const FramePerformanceCounters&);
+  void FlushHostMetrics();
 };
\ No newline at end of file
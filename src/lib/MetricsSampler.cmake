@@ -0,0 +1,8 @@
+include_guard(DIRECTORY)
+
+add_library(MetricsSampler INTERFACE MetricsSampler.hpp)
+target_link_libraries(
+  MetricsSampler
+  INTERFACE
+  PerformanceCounters
+)
\ No newline at end of file
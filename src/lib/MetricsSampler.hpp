@@ -0,0 +1,190 @@
+// Copyright 2024 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#ifdef _WIN32
+#include <Windows.h>
+#endif
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+
+#include "PerformanceCounterMath.hpp"
+
+/** Polls slow-changing metrics on a separate thread.
+ *
+ * Some metrics - e.g. GPU clocks and throttling, or VRAM usage - change much
+ * more slowly than frames are produced, but are expensive to query; querying
+ * them in `xrEndFrame()` adds that cost to the game's submit thread.
+ *
+ * Instead, the sampler calls `Source` every `interval`, and stores the results
+ * with a timestamp from `Clock` - by default, the same clock as frame
+ * timestamps; `LogFrameHook`s can then look up the sample nearest to the frame.
+ *
+ * There is a single writer (the sampler thread); readers never block it, or
+ * each other. Each slot has a sequence number, and readers discard any slot
+ * that was written to while they were reading it.
+ */
+template <class T>
+  requires std::is_trivially_copyable_v<T>
+class MetricsSampler final {
+ public:
+  // Return `std::nullopt` if the metrics aren't currently available
+  using Source = std::function<std::optional<T>()>;
+  struct Clock {
+    std::function<int64_t()> mNow;
+    // Ticks per second
+    int64_t mFrequency {};
+
+    static Clock ForLiveData() {
+      return {
+        &PerformanceCounterMath::GetLiveDataTime,
+        PerformanceCounterMath::CreateForLiveData().GetResolution(),
+      };
+    }
+  };
+
+  // At the default 10ms interval, this covers 640ms; this is more than the
+  // `LogFrameHook` timeout, so any frame that is still being logged has
+  // samples around it
+  static constexpr size_t Capacity = 64;
+
+  MetricsSampler() = delete;
+  MetricsSampler(const MetricsSampler&) = delete;
+  MetricsSampler(MetricsSampler&&) = delete;
+  MetricsSampler& operator=(const MetricsSampler&) = delete;
+  MetricsSampler& operator=(MetricsSampler&&) = delete;
+
+  MetricsSampler(
+    const std::chrono::milliseconds interval,
+    Source source,
+    Clock clock = Clock::ForLiveData())
+    : mInterval(interval),
+      mSource(std::move(source)),
+      mClock(std::move(clock)) {
+    // A sample is stale if we missed a few in a row, e.g. if the source is
+    // failing, or the thread is starved
+    mMaxAgeTicks = (mClock.mFrequency * interval.count() * 4) / 1000;
+    mThread = std::jthread {std::bind_front(&MetricsSampler::Run, this)};
+  }
+
+  ~MetricsSampler() {
+    mThread = {};
+  }
+
+  [[nodiscard]]
+  std::chrono::milliseconds GetInterval() const noexcept {
+    return mInterval;
+  }
+
+  /// The sample closest to `time`, if there is one that isn't stale
+  [[nodiscard]]
+  std::optional<T> GetNearest(const int64_t time) const noexcept {
+    const auto written = mWritten.load(std::memory_order_acquire);
+    const auto oldest = (written > Capacity) ? (written - Capacity) : 0;
+
+    std::optional<Sample> ret;
+    int64_t retDistance {};
+    // Samples are in time order, so walk back from the newest until we've
+    // passed `time`
+    for (auto i = written; i > oldest; --i) {
+      const auto sample = this->Read(i - 1);
+      if (!sample) {
+        // Overwritten while we were reading; everything older is too
+        break;
+      }
+      const auto distance = std::abs(sample->mTime - time);
+      if (ret && distance >= retDistance) {
+        break;
+      }
+      ret = sample;
+      retDistance = distance;
+    }
+
+    if (!(ret && retDistance <= mMaxAgeTicks)) {
+      return std::nullopt;
+    }
+    return ret->mValue;
+  }
+
+ private:
+  struct Sample {
+    int64_t mTime {};
+    T mValue {};
+  };
+  struct Slot {
+    // Odd while being written; otherwise, `(index / Capacity + 1) * 2`
+    std::atomic_uint64_t mSequence {};
+    Sample mSample {};
+  };
+
+  std::chrono::milliseconds mInterval {};
+  int64_t mMaxAgeTicks {};
+  Source mSource;
+  Clock mClock;
+
+  std::array<Slot, Capacity> mSlots {};
+  std::atomic_uint64_t mWritten {};
+
+  std::jthread mThread;
+
+  [[nodiscard]]
+  std::optional<Sample> Read(const uint64_t index) const noexcept {
+    const auto& slot = mSlots[index % Capacity];
+    const auto expected = ((index / Capacity) + 1) * 2;
+    if (slot.mSequence.load(std::memory_order_acquire) != expected) {
+      return std::nullopt;
+    }
+    const auto ret = slot.mSample;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.mSequence.load(std::memory_order_relaxed) != expected) {
+      return std::nullopt;
+    }
+    return ret;
+  }
+
+  void Write(const Sample& sample) noexcept {
+    const auto index = mWritten.load(std::memory_order_relaxed);
+    auto& slot = mSlots[index % Capacity];
+    slot.mSequence.store(
+      (((index / Capacity) + 1) * 2) - 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.mSample = sample;
+    slot.mSequence.store(
+      ((index / Capacity) + 1) * 2, std::memory_order_release);
+    mWritten.store(index + 1, std::memory_order_release);
+  }
+
+  void Run(std::stop_token tok) {
+#ifdef _WIN32
+    SetThreadDescription(GetCurrentThread(), L"XRFrameTools Metrics Sampler");
+#endif
+
+    // Only used to sleep until the next sample, or until we're stopped
+    std::mutex mutex;
+    std::condition_variable_any wake;
+    std::unique_lock lock {mutex};
+    do {
+      const auto start = mClock.mNow();
+      const auto value = mSource();
+      const auto stop = mClock.mNow();
+      if (value) {
+        // The source may take a while; the midpoint is our best guess of when
+        // the values were current
+        this->Write({
+          .mTime = (start + stop) / 2,
+          .mValue = *value,
+        });
+      }
+    } while (!wake.wait_for(lock, tok, mInterval, [] { return false; })
+             && !tok.stop_requested());
+  }
+};
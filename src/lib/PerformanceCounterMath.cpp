@@ -2,17 +2,92 @@
 // SPDX-License-Identifier: MIT
 #include "PerformanceCounterMath.hpp"
 
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <ctime>
+#endif
+
+#include <bit>
 #include <numeric>
-PerformanceCounterMath::PerformanceCounterMath(LARGE_INTEGER frequency)
-  : mResolution(frequency),
-    mMicrosGCD(std::gcd(frequency.QuadPart, MicrosPerSecond)) {
-  if (frequency.QuadPart == 0) {
-    throw std::out_of_range("Frequency can not be 0");
+
+namespace {
+
+// ceil(2^(64 + shift) / divisor), for 2^shift < divisor; the result fits
+// in 64 bits.
+//
+// Only called when constructing a PerformanceCounterMath, so a bitwise long
+// division is fine, and avoids needing a 128-bit divide instruction.
+uint64_t ComputeReciprocal(const uint64_t divisor, const uint8_t shift) {
+  // Dividend is 2^(64 + shift) - 1; we're computing floor() of that, + 1
+  uint64_t remainder = (uint64_t {1} << shift) - 1;
+  uint64_t quotient = 0;
+  for (int bit = 63; bit >= 0; --bit) {
+    // Shift in a 1 bit from the low word; `remainder < divisor` so the
+    // top bit being set means we're definitely >= divisor
+    const bool carry = remainder >> 63;
+    remainder = (remainder << 1) | 1;
+    quotient <<= 1;
+    if (carry || remainder >= divisor) {
+      remainder -= divisor;
+      quotient |= 1;
+    }
+  }
+  return quotient + 1;
+}
+
+}// namespace
+
+PerformanceCounterMath::PerformanceCounterMath(const int64_t frequency)
+  : mResolution(frequency) {
+  if (frequency <= 0) {
+    throw std::out_of_range("Frequency must be positive");
+  }
+  mMicrosGCD = std::gcd(frequency, MicrosPerSecond);
+  mNumerator = MicrosPerSecond / mMicrosGCD;
+  mDenominator = frequency / mMicrosGCD;
+
+  // The remainder is < mDenominator, so `remainder * mNumerator` must fit
+  // in the 63 bits the reciprocal is exact for
+  mIsReducible = mDenominator
+    <= (std::numeric_limits<int64_t>::max() / mNumerator);
+  if (mDenominator > 1) {
+    const auto denominator = static_cast<uint64_t>(mDenominator);
+    mReciprocalShift
+      = static_cast<uint8_t>(std::bit_width(denominator - 1) - 1);
+    mReciprocal = ComputeReciprocal(denominator, mReciprocalShift);
+  }
+}
+
+void PerformanceCounterMath::ToDurations(
+  std::span<const int64_t> ticks,
+  std::span<std::chrono::microseconds> out) const {
+  if (out.size() < ticks.size()) {
+    throw std::out_of_range("Output span is smaller than input span");
+  }
+  for (size_t i = 0; i < ticks.size(); ++i) {
+    out[i] = ToDuration(ticks[i]);
   }
 }
 
 PerformanceCounterMath PerformanceCounterMath::CreateForLiveData() {
+#ifdef _WIN32
   LARGE_INTEGER pf {};
   QueryPerformanceFrequency(&pf);
-  return {pf};
-}
\ No newline at end of file
+  return {pf.QuadPart};
+#else
+  return {1'000'000'000};
+#endif
+}
+
+int64_t PerformanceCounterMath::GetLiveDataTime() noexcept {
+#ifdef _WIN32
+  LARGE_INTEGER pc {};
+  QueryPerformanceCounter(&pc);
+  return pc.QuadPart;
+#else
+  timespec ts {};
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (static_cast<int64_t>(ts.tv_sec) * 1'000'000'000) + ts.tv_nsec;
+#endif
+}
@@ -2,9 +2,18 @@
 // SPDX-License-Identifier: MIT
 #pragma once
 
-#include <Windows.h>
-
 #include <chrono>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <stdexcept>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+#include <intrin.h>
+#define XRFT_HAVE_MULTIPLY_HIGH_64
+#elif defined(__SIZEOF_INT128__)
+#define XRFT_HAVE_MULTIPLY_HIGH_64
+#endif
 
 class PerformanceCounterMath {
  public:
@@ -13,29 +22,54 @@ class PerformanceCounterMath {
    *
    * @see PerformanceCounters::ForLiveData()
    */
-  PerformanceCounterMath(LARGE_INTEGER frequency);
+  PerformanceCounterMath(int64_t frequency);
 
-  [[nodiscard]] inline LARGE_INTEGER GetResolution() const noexcept {
+  [[nodiscard]] inline int64_t GetResolution() const noexcept {
     return mResolution;
   }
 
+  /** Convert a tick count to microseconds, truncating towards zero.
+   *
+   * This is exact for any tick count where the result is representable;
+   * rather than `ticks * 1'000'000 / frequency` - which overflows for large
+   * tick counts at high frequencies - it is `ticks = q * D + r`, then
+   * `q * N + (r * N) / D`, where `N / D` is the reduced fraction
+   * `1'000'000 / frequency`.
+   *
+   * Where a 64x64->128-bit multiply is available, the divisions by `D` are
+   * replaced by a precomputed multiply-shift reciprocal.
+   */
   [[nodiscard]]
   inline std::chrono::microseconds ToDuration(
-    const LARGE_INTEGER diff) const noexcept {
-    auto duration = diff.QuadPart;
-    duration *= (MicrosPerSecond / mMicrosGCD);
-    duration /= (mResolution.QuadPart / mMicrosGCD);
-    return std::chrono::microseconds {duration};
+    const int64_t ticks) const noexcept {
+    if (!mIsReducible || ticks == std::numeric_limits<int64_t>::min())
+      [[unlikely]] {
+      return std::chrono::microseconds {
+        (ticks * mNumerator) / mDenominator,
+      };
+    }
+    const auto magnitude = static_cast<uint64_t>(ticks < 0 ? -ticks : ticks);
+    const auto micros = static_cast<int64_t>(ScaleMagnitude(magnitude));
+    return std::chrono::microseconds {ticks < 0 ? -micros : micros};
   }
 
+  /** Convert a span of tick counts to microseconds.
+   *
+   * Equivalent to calling `ToDuration()` for each element; `out` must be at
+   * least as large as `ticks`.
+   */
+  void ToDurations(
+    std::span<const int64_t> ticks,
+    std::span<std::chrono::microseconds> out) const;
+
   [[nodiscard]]
   inline std::chrono::microseconds ToDuration(
-    const LARGE_INTEGER begin,
-    const LARGE_INTEGER end) const {
-    if (end.QuadPart < begin.QuadPart) {
+    const int64_t begin,
+    const int64_t end) const {
+    if (end < begin) {
       throw std::invalid_argument("end must be greater than begin");
     }
-    return ToDuration({.QuadPart = end.QuadPart - begin.QuadPart});
+    return ToDuration(end - begin);
   }
 
   /* e.g.:
@@ -47,19 +81,64 @@ class PerformanceCounterMath {
    */
   [[nodiscard]]
   inline std::chrono::microseconds ToDurationAllowNegative(
-    const LARGE_INTEGER begin,
-    const LARGE_INTEGER end) const {
-    return ToDuration({.QuadPart = end.QuadPart - begin.QuadPart});
+    const int64_t begin,
+    const int64_t end) const {
+    return ToDuration(end - begin);
   }
 
   /** Get an instance that is only valid for data collected on this system,
    * since the last reboot.
+   *
+   * On Windows, this is for `QueryPerformanceCounter()`; elsewhere, it is for
+   * `CLOCK_MONOTONIC` nanoseconds.
    */
   [[nodiscard]]
   static PerformanceCounterMath CreateForLiveData();
 
+  /// The current time, in the units of `CreateForLiveData()`
+  [[nodiscard]]
+  static int64_t GetLiveDataTime() noexcept;
+
  private:
   static constexpr int64_t MicrosPerSecond = 1000 * 1000;
-  LARGE_INTEGER mResolution {};
+  int64_t mResolution {};
   int64_t mMicrosGCD {};
+
+  // `MicrosPerSecond / frequency`, as a reduced fraction
+  int64_t mNumerator {};
+  int64_t mDenominator {};
+  // False if `mNumerator * mDenominator` doesn't fit in 63 bits; only for
+  // unrealistic frequencies
+  bool mIsReducible {};
+
+  // floor(n / mDenominator) == (n * mReciprocal) >> (64 + mReciprocalShift)
+  // for all n < 2^63; see Granlund & Montgomery, 'Division by Invariant
+  // Integers using Multiplication', theorem 4.2
+  uint64_t mReciprocal {};
+  uint8_t mReciprocalShift {};
+
+  [[nodiscard]]
+  inline uint64_t DivideByDenominator(const uint64_t n) const noexcept {
+    if (mDenominator == 1) {
+      return n;
+    }
+#if defined(XRFT_HAVE_MULTIPLY_HIGH_64) && defined(_MSC_VER)
+    return __umulh(n, mReciprocal) >> mReciprocalShift;
+#elif defined(XRFT_HAVE_MULTIPLY_HIGH_64)
+    using uint128_t = unsigned __int128;
+    const auto product = static_cast<uint128_t>(n) * mReciprocal;
+    return static_cast<uint64_t>(product >> 64) >> mReciprocalShift;
+#else
+    return n / static_cast<uint64_t>(mDenominator);
+#endif
+  }
+
+  [[nodiscard]]
+  inline uint64_t ScaleMagnitude(const uint64_t ticks) const noexcept {
+    const auto quotient = DivideByDenominator(ticks);
+    const auto remainder
+      = ticks - (quotient * static_cast<uint64_t>(mDenominator));
+    return (quotient * static_cast<uint64_t>(mNumerator))
+      + DivideByDenominator(remainder * static_cast<uint64_t>(mNumerator));
+  }
 };
\ No newline at end of file
@@ -0,0 +1,12 @@
+include_guard(DIRECTORY)
+
+add_library(
+  PlatformFile
+  STATIC
+  PlatformFile.cpp PlatformFile.hpp
+)
+if(WIN32)
+  target_sources(PlatformFile PRIVATE Win32PlatformFile.cpp)
+else()
+  target_sources(PlatformFile PRIVATE PosixPlatformFile.cpp)
+endif()
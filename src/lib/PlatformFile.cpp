@@ -0,0 +1,30 @@
+// Copyright 2024 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+
+#include "PlatformFile.hpp"
+
+#include <utility>
+
+PlatformFile::PlatformFile(
+  const NativeHandle handle,
+  const bool isOwned) noexcept
+  : mHandle(handle), mIsOwned(isOwned) {
+}
+
+PlatformFile::PlatformFile(PlatformFile&& other) noexcept
+  : mHandle(std::exchange(other.mHandle, InvalidHandle)),
+    mIsOwned(std::exchange(other.mIsOwned, false)) {
+}
+
+PlatformFile& PlatformFile::operator=(PlatformFile&& other) noexcept {
+  if (this != &other) {
+    this->Close();
+    mHandle = std::exchange(other.mHandle, InvalidHandle);
+    mIsOwned = std::exchange(other.mIsOwned, false);
+  }
+  return *this;
+}
+
+PlatformFile::~PlatformFile() {
+  this->Close();
+}
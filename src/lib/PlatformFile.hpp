@@ -0,0 +1,82 @@
+// Copyright 2024 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <optional>
+#include <string_view>
+#include <system_error>
+
+/** Minimal unbuffered file I/O, so that log readers and converters don't
+ * depend on `<Windows.h>`.
+ *
+ * This is a thin wrapper around `ReadFile()`/`WriteFile()` on Windows, and
+ * `read()`/`write()` elsewhere; it is not a general-purpose file API.
+ */
+class PlatformFile final {
+ public:
+  enum class Mode {
+    // Other processes can keep writing to the file, e.g. a log that is still
+    // being written
+    Read,
+    // Create, or truncate if it already exists
+    Write,
+  };
+  enum class SeekOrigin {
+    Begin,
+    Current,
+    End,
+  };
+
+  PlatformFile() = default;
+  PlatformFile(const PlatformFile&) = delete;
+  PlatformFile& operator=(const PlatformFile&) = delete;
+  PlatformFile(PlatformFile&&) noexcept;
+  PlatformFile& operator=(PlatformFile&&) noexcept;
+  ~PlatformFile();
+
+  [[nodiscard]]
+  static std::expected<PlatformFile, std::error_code> Open(
+    const std::filesystem::path&,
+    Mode);
+
+  /// Not closed when this object is destroyed
+  [[nodiscard]]
+  static PlatformFile GetStandardOutput();
+
+  [[nodiscard]]
+  explicit operator bool() const noexcept {
+    return mHandle != InvalidHandle;
+  }
+
+  /// Returns the number of bytes read, which is less than `size` at the end
+  /// of the file, or `std::nullopt` on error
+  [[nodiscard]]
+  std::optional<size_t> Read(void* buffer, size_t size) noexcept;
+
+  /// Writes all of `data`; throws `std::system_error` on failure
+  void Write(std::string_view data);
+
+  /// Returns the new position from the start of the file
+  std::optional<uint64_t> Seek(int64_t offset, SeekOrigin) noexcept;
+
+  [[nodiscard]]
+  std::optional<uint64_t> GetPosition() const noexcept;
+
+  [[nodiscard]]
+  std::optional<uint64_t> GetSize() const noexcept;
+
+ private:
+  // A `HANDLE` on Windows, or a file descriptor elsewhere; -1 is
+  // `INVALID_HANDLE_VALUE` on Windows
+  using NativeHandle = intptr_t;
+  static constexpr NativeHandle InvalidHandle = -1;
+
+  NativeHandle mHandle {InvalidHandle};
+  bool mIsOwned {false};
+
+  PlatformFile(NativeHandle, bool isOwned) noexcept;
+  void Close() noexcept;
+};
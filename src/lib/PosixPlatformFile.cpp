@@ -0,0 +1,121 @@
+// Copyright 2024 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+
+#include "PlatformFile.hpp"
+
+namespace {
+
+int ToDescriptor(const intptr_t handle) {
+  return static_cast<int>(handle);
+}
+
+std::error_code GetErrnoCode() {
+  return {errno, std::generic_category()};
+}
+
+}// namespace
+
+std::expected<PlatformFile, std::error_code> PlatformFile::Open(
+  const std::filesystem::path& path,
+  const Mode mode) {
+  const auto fd = (mode == Mode::Read)
+    ? open(path.c_str(), O_RDONLY | O_CLOEXEC)
+    : open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+  if (fd == -1) {
+    return std::unexpected {GetErrnoCode()};
+  }
+  return PlatformFile {fd, true};
+}
+
+PlatformFile PlatformFile::GetStandardOutput() {
+  return {STDOUT_FILENO, false};
+}
+
+void PlatformFile::Close() noexcept {
+  if (mIsOwned && mHandle != InvalidHandle) {
+    close(ToDescriptor(mHandle));
+  }
+  mHandle = InvalidHandle;
+  mIsOwned = false;
+}
+
+std::optional<size_t> PlatformFile::Read(
+  void* const buffer,
+  const size_t size) noexcept {
+  auto bytes = static_cast<std::byte*>(buffer);
+  size_t total {};
+  // `read()` may return less than requested before the end of the file,
+  // e.g. if interrupted by a signal
+  while (total < size) {
+    const auto result
+      = read(ToDescriptor(mHandle), bytes + total, size - total);
+    if (result < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return std::nullopt;
+    }
+    if (result == 0) {
+      break;
+    }
+    total += static_cast<size_t>(result);
+  }
+  return total;
+}
+
+void PlatformFile::Write(std::string_view data) {
+  while (!data.empty()) {
+    const auto result = write(ToDescriptor(mHandle), data.data(), data.size());
+    if (result < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw std::system_error(GetErrnoCode());
+    }
+    data.remove_prefix(static_cast<size_t>(result));
+  }
+}
+
+std::optional<uint64_t> PlatformFile::Seek(
+  const int64_t offset,
+  const SeekOrigin origin) noexcept {
+  int whence {SEEK_SET};
+  switch (origin) {
+    case SeekOrigin::Begin:
+      whence = SEEK_SET;
+      break;
+    case SeekOrigin::Current:
+      whence = SEEK_CUR;
+      break;
+    case SeekOrigin::End:
+      whence = SEEK_END;
+      break;
+  }
+  const auto position = lseek(ToDescriptor(mHandle), offset, whence);
+  if (position < 0) {
+    return std::nullopt;
+  }
+  return static_cast<uint64_t>(position);
+}
+
+std::optional<uint64_t> PlatformFile::GetPosition() const noexcept {
+  const auto position = lseek(ToDescriptor(mHandle), 0, SEEK_CUR);
+  if (position < 0) {
+    return std::nullopt;
+  }
+  return static_cast<uint64_t>(position);
+}
+
+std::optional<uint64_t> PlatformFile::GetSize() const noexcept {
+  struct stat info {};
+  if (fstat(ToDescriptor(mHandle), &info) != 0) {
+    return std::nullopt;
+  }
+  return static_cast<uint64_t>(info.st_size);
+}
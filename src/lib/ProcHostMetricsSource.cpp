@@ -0,0 +1,280 @@
+// Copyright 2024 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "HostMetrics.hpp"
+
+namespace {
+
+int64_t GetMonotonicNanoseconds() {
+  timespec ts {};
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (static_cast<int64_t>(ts.tv_sec) * 1'000'000'000) + ts.tv_nsec;
+}
+
+uint32_t ToHundredthsOfPercent(const double percent) {
+  return static_cast<uint32_t>(
+    std::lround(std::clamp(percent, 0.0, 100.0) * 100));
+}
+
+// Reads the whole of a small `/proc` file; these don't report a size
+[[nodiscard]]
+bool ReadFile(const char* path, std::string& out) {
+  out.clear();
+  auto f = std::fopen(path, "r");
+  if (!f) {
+    return false;
+  }
+  char buffer[4096];
+  while (const auto n = std::fread(buffer, 1, sizeof(buffer), f)) {
+    out.append(buffer, n);
+  }
+  std::fclose(f);
+  return !out.empty();
+}
+
+// Splits on spaces, skipping empty fields
+template <class F>
+void ForEachField(std::string_view line, F&& f) {
+  while (!line.empty()) {
+    const auto start = line.find_first_not_of(' ');
+    if (start == std::string_view::npos) {
+      return;
+    }
+    line.remove_prefix(start);
+    const auto end = std::min(line.find(' '), line.size());
+    f(line.substr(0, end));
+    line.remove_prefix(end);
+  }
+}
+
+template <class T>
+T ParseNumber(const std::string_view s) {
+  T ret {};
+  std::from_chars(s.data(), s.data() + s.size(), ret);
+  return ret;
+}
+
+/* `/proc`-based implementation, so that sampling can be built and tested on
+ * Linux.
+ *
+ * - CPU utilization is from the jiffy counters in `/proc/stat`
+ * - frequency is the mean `cpu MHz` from `/proc/cpuinfo`
+ * - process values are from `/proc/self/stat` and `/proc/self/statm`; page
+ *   faults include both minor and major faults, as on Windows
+ */
+class ProcSource final : public HostMetrics::Source {
+ public:
+  std::optional<HostMetrics::Sample> GetSample() override {
+    const auto start = GetMonotonicNanoseconds();
+    HostMetrics::Sample ret {
+      .mCpu = this->GetCpuSample(start),
+      .mProcess = this->GetProcessSample(start),
+    };
+    if (ret.mCpu.mSampleTime) {
+      ret.mCpu.mSampleCostMicroseconds
+        = static_cast<uint32_t>((GetMonotonicNanoseconds() - start) / 1000);
+    }
+    if (!(ret.mCpu.mSampleTime || ret.mProcess.mSampleTime)) {
+      return std::nullopt;
+    }
+    return ret;
+  }
+
+ private:
+  struct CpuTimes {
+    uint64_t mBusy {};
+    uint64_t mTotal {};
+  };
+
+  // Reused between samples to avoid allocations
+  std::string mBuffer;
+
+  // Index 0 is the total; 1+ are individual logical processors
+  std::vector<CpuTimes> mPreviousCpuTimes;
+  std::vector<CpuTimes> mCpuTimes;
+
+  int64_t mPreviousProcessTime {};
+  uint64_t mPreviousProcessJiffies {};
+  uint64_t mPreviousPageFaults {};
+  const int64_t mPageSize {sysconf(_SC_PAGESIZE)};
+  const int64_t mJiffiesPerSecond {sysconf(_SC_CLK_TCK)};
+
+  [[nodiscard]]
+  HostMetrics::Cpu GetCpuSample(const int64_t now) {
+    if (!ReadFile("/proc/stat", mBuffer)) {
+      return {};
+    }
+
+    mCpuTimes.clear();
+    std::string_view remaining {mBuffer};
+    while (remaining.starts_with("cpu")) {
+      const auto eol = std::min(remaining.find('\n'), remaining.size());
+      const auto line = remaining.substr(0, eol);
+      remaining.remove_prefix(std::min(eol + 1, remaining.size()));
+
+      // cpuN user nice system idle iowait irq softirq steal guest guest_nice
+      CpuTimes times;
+      size_t field = 1;
+      ForEachField(line, [&](const std::string_view value) {
+        const auto index = field++;
+        // Skip the name, and guest time, which is also included in user time
+        if (index == 1 || index >= 10) {
+          return;
+        }
+        const auto jiffies = ParseNumber<uint64_t>(value);
+        times.mTotal += jiffies;
+        // Everything except idle and iowait
+        if (index != 5 && index != 6) {
+          times.mBusy += jiffies;
+        }
+      });
+      mCpuTimes.push_back(times);
+    }
+    if (mCpuTimes.empty()) {
+      return {};
+    }
+
+    HostMetrics::Cpu ret {
+      .mSampleTime = now,
+      .mLogicalProcessorCount = static_cast<uint32_t>(mCpuTimes.size() - 1),
+    };
+    if (mPreviousCpuTimes.size() == mCpuTimes.size()) {
+      for (size_t i = 0; i < mCpuTimes.size(); ++i) {
+        const auto total = mCpuTimes[i].mTotal - mPreviousCpuTimes[i].mTotal;
+        if (total == 0) {
+          continue;
+        }
+        const auto utilization = ToHundredthsOfPercent(
+          (100.0 * (mCpuTimes[i].mBusy - mPreviousCpuTimes[i].mBusy)) / total);
+        if (i == 0) {
+          ret.mUtilization = utilization;
+        } else {
+          ret.mBusiestCoreUtilization
+            = std::max(ret.mBusiestCoreUtilization, utilization);
+        }
+      }
+    }
+    std::swap(mPreviousCpuTimes, mCpuTimes);
+
+    if (ReadFile("/proc/cpuinfo", mBuffer)) {
+      double sum {};
+      size_t count {};
+      std::string_view cpuinfo {mBuffer};
+      for (auto pos = cpuinfo.find("cpu MHz"); pos != std::string_view::npos;
+           pos = cpuinfo.find("cpu MHz", pos + 1)) {
+        const auto colon = cpuinfo.find(':', pos);
+        if (colon == std::string_view::npos) {
+          break;
+        }
+        auto value = cpuinfo.substr(colon + 1);
+        value.remove_prefix(
+          std::min(value.find_first_not_of(' '), value.size()));
+        sum += ParseNumber<double>(value.substr(0, value.find('\n')));
+        ++count;
+      }
+      if (count) {
+        ret.mFrequencyMHz = static_cast<uint32_t>(std::lround(sum / count));
+      }
+    }
+    return ret;
+  }
+
+  [[nodiscard]]
+  HostMetrics::Process GetProcessSample(const int64_t now) {
+    if (!ReadFile("/proc/self/stat", mBuffer)) {
+      return {};
+    }
+    // The executable name is in parentheses, and may contain spaces
+    const auto afterName = mBuffer.rfind(')');
+    if (afterName == std::string::npos) {
+      return {};
+    }
+    // Fields are numbered from 1 in proc(5); field 3 follows the name
+    uint64_t minorFaults {};
+    uint64_t majorFaults {};
+    uint64_t jiffies {};
+    size_t field = 3;
+    ForEachField(
+      std::string_view {mBuffer}.substr(afterName + 1),
+      [&](const std::string_view value) {
+        switch (field++) {
+          case 10:
+            minorFaults = ParseNumber<uint64_t>(value);
+            break;
+          case 12:
+            majorFaults = ParseNumber<uint64_t>(value);
+            break;
+          case 14:// utime
+          case 15:// stime
+            jiffies += ParseNumber<uint64_t>(value);
+            break;
+          default:
+            break;
+        }
+      });
+
+    if (!ReadFile("/proc/self/statm", mBuffer)) {
+      return {};
+    }
+    // size resident shared ...; in pages
+    uint64_t resident {};
+    uint64_t shared {};
+    field = 1;
+    ForEachField(mBuffer, [&](const std::string_view value) {
+      switch (field++) {
+        case 2:
+          resident = ParseNumber<uint64_t>(value);
+          break;
+        case 3:
+          shared = ParseNumber<uint64_t>(value);
+          break;
+        default:
+          break;
+      }
+    });
+
+    HostMetrics::Process ret {
+      .mSampleTime = now,
+      .mWorkingSetBytes = resident * mPageSize,
+      .mPrivateBytes = (resident - std::min(resident, shared)) * mPageSize,
+    };
+
+    const auto pageFaults = minorFaults + majorFaults;
+    if (mPreviousProcessTime) {
+      ret.mPageFaults = static_cast<uint32_t>(pageFaults - mPreviousPageFaults);
+      const auto elapsed = now - mPreviousProcessTime;
+      // Index 0 is the total
+      const auto processors
+        = std::max<size_t>(mPreviousCpuTimes.size(), 1) - 1;
+      if (elapsed > 0 && processors > 0) {
+        const auto busyNanoseconds
+          = ((jiffies - mPreviousProcessJiffies) * 1'000'000'000.0)
+          / mJiffiesPerSecond;
+        ret.mCpuUtilization = ToHundredthsOfPercent(
+          (100.0 * busyNanoseconds)
+          / (static_cast<double>(elapsed) * processors));
+      }
+    }
+    mPreviousProcessTime = now;
+    mPreviousProcessJiffies = jiffies;
+    mPreviousPageFaults = pageFaults;
+    return ret;
+  }
+};
+
+}// namespace
+
+std::unique_ptr<HostMetrics::Source> HostMetrics::Source::Create() {
+  return std::make_unique<ProcSource>();
+}
@@ -0,0 +1,154 @@
+// Copyright 2024 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+
+#include "ProcessResolver.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <functional>
+#include <iterator>
+#include <ranges>
+
+#include "Win32Utils.hpp"
+
+ProcessResolver::ProcessResolver() {
+  mCache.reserve(MaxCachedProcesses);
+  mThread = std::jthread {std::bind_front(&ProcessResolver::Run, this)};
+}
+
+ProcessResolver::~ProcessResolver() {
+  mThread = {};
+}
+
+void ProcessResolver::Request(const DWORD processID) {
+  {
+    std::unique_lock lock(mMutex);
+    if (std::ranges::contains(mPending, processID)) {
+      return;
+    }
+    if (mPending.size() >= MaxPendingRequests) [[unlikely]] {
+      // The caller will ask again later
+      return;
+    }
+    mPending.push_back(processID);
+  }
+  mWakeEvent.SetEvent();
+}
+
+std::vector<ProcessResolver::Process> ProcessResolver::TakeResolved() {
+  std::unique_lock lock(mMutex);
+  return std::exchange(mResolved, {});
+}
+
+void ProcessResolver::WaitForPending() {
+  std::unique_lock lock(mMutex);
+  mIdleCV.wait(lock, [this]() { return mPending.empty() && !mBusy; });
+}
+
+void ProcessResolver::Run(std::stop_token tok) {
+  SetThreadDescription(GetCurrentThread(), L"XRFrameTools Process Resolver");
+
+  const std::stop_callback wakeOnStop(
+    tok, std::bind_front(&SetEvent, mWakeEvent.get()));
+
+  std::vector<DWORD> requests;
+  while (WaitForSingleObject(mWakeEvent.get(), INFINITE) == WAIT_OBJECT_0) {
+    if (tok.stop_requested()) {
+      return;
+    }
+
+    {
+      std::unique_lock lock(mMutex);
+      requests.swap(mPending);
+      mBusy = true;
+    }
+
+    std::vector<Process> resolved;
+    for (auto&& pid: requests) {
+      if (auto process = this->Resolve(pid)) {
+        resolved.push_back(std::move(*process));
+      }
+    }
+    requests.clear();
+
+    {
+      std::unique_lock lock(mMutex);
+      std::ranges::move(resolved, std::back_inserter(mResolved));
+      mBusy = false;
+    }
+    mIdleCV.notify_all();
+  }
+}
+
+std::optional<ProcessResolver::Process> ProcessResolver::Resolve(
+  const DWORD pid) {
+  wil::unique_process_handle process {
+    OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid)};
+  if (!process) {
+    return std::nullopt;
+  }
+
+  FILETIME creationTime {}, exitTime {}, kernelTime {}, userTime {};
+  if (!GetProcessTimes(
+        process.get(), &creationTime, &exitTime, &kernelTime, &userTime)) {
+    return std::nullopt;
+  }
+  const auto creation
+    = (static_cast<uint64_t>(creationTime.dwHighDateTime) << 32)
+    | creationTime.dwLowDateTime;
+
+  const auto lookup = ++mLookupCount;
+  const auto cached = std::ranges::find_if(mCache, [=](const auto& it) {
+    return it.mProcess.mProcessID == pid
+      && it.mProcess.mCreationTime == creation;
+  });
+  if (cached != mCache.end()) {
+    cached->mLastUsed = lookup;
+    return cached->mProcess;
+  }
+
+  // Usually fits in MAX_PATH, but long paths are possible
+  std::wstring path(MAX_PATH, L'\0');
+  while (true) {
+    auto pathLength = static_cast<DWORD>(path.size());
+    if (QueryFullProcessImageNameW(
+          process.get(), 0, path.data(), &pathLength)) {
+      path.resize(pathLength);
+      break;
+    }
+    constexpr size_t MaxPathLength = 64 * 1024;
+    if (
+      GetLastError() != ERROR_INSUFFICIENT_BUFFER
+      || path.size() >= MaxPathLength) {
+      return std::nullopt;
+    }
+    path.resize(path.size() * 2);
+  }
+  if (path.empty()) {
+    return std::nullopt;
+  }
+
+  Process ret {
+    .mProcessID = pid,
+    .mCreationTime = creation,
+  };
+  try {
+    ret.mPath = std::filesystem::path {path}.u8string();
+  } catch (const std::system_error& e) {
+    dprint("failed to convert process path to UTF-8: {}", e.what());
+    return std::nullopt;
+  }
+
+  // Replaces any entry for an earlier process with the same PID
+  const auto evict = std::ranges::find(
+    mCache, pid, [](const auto& it) { return it.mProcess.mProcessID; });
+  if (evict != mCache.end()) {
+    *evict = {ret, lookup};
+  } else if (mCache.size() < MaxCachedProcesses) {
+    mCache.push_back({ret, lookup});
+  } else {
+    *std::ranges::min_element(mCache, {}, &CacheEntry::mLastUsed)
+      = {ret, lookup};
+  }
+  return ret;
+}
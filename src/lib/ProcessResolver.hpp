@@ -0,0 +1,78 @@
+// Copyright 2024 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <Windows.h>
+#include <wil/resource.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+/** Finds the executable paths of other processes on a worker thread.
+ *
+ * `OpenProcess()` and `QueryFullProcessImageNameW()` can be slow, so callers
+ * on latency-sensitive threads request a lookup, and later collect the
+ * results.
+ *
+ * Paths are cached by PID and process creation time, so each request only
+ * needs to re-check the creation time; if a PID has been reused, the new
+ * process's path is looked up instead of returning the cached one.
+ */
+class ProcessResolver final {
+ public:
+  struct Process {
+    DWORD mProcessID {};
+    uint64_t mCreationTime {};// FILETIME
+    std::u8string mPath;
+  };
+
+  ProcessResolver();
+  ~ProcessResolver();
+
+  ProcessResolver(const ProcessResolver&) = delete;
+  ProcessResolver(ProcessResolver&&) = delete;
+  ProcessResolver& operator=(const ProcessResolver&) = delete;
+  ProcessResolver& operator=(ProcessResolver&&) = delete;
+
+  /// Queue a lookup; does not wait for the process
+  void Request(DWORD processID);
+
+  /// Results for completed requests, oldest first; processes that have
+  /// exited are omitted
+  [[nodiscard]]
+  std::vector<Process> TakeResolved();
+
+  /// Wait until all requests so far have completed
+  void WaitForPending();
+
+ private:
+  static constexpr size_t MaxCachedProcesses = 64;
+  static constexpr size_t MaxPendingRequests = 64;
+
+  struct CacheEntry {
+    Process mProcess;
+    uint64_t mLastUsed {};
+  };
+
+  // Only used by the worker thread
+  std::vector<CacheEntry> mCache;
+  uint64_t mLookupCount {};
+
+  std::mutex mMutex;
+  std::condition_variable mIdleCV;
+  std::vector<DWORD> mPending;
+  std::vector<Process> mResolved;
+  bool mBusy {false};
+  wil::unique_event mWakeEvent {wil::EventOptions::None};
+
+  std::jthread mThread;
+
+  void Run(std::stop_token);
+  [[nodiscard]]
+  std::optional<Process> Resolve(DWORD processID);
+};
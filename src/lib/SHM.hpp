@@ -9,6 +9,10 @@
 #include "FramePerformanceCounters.hpp"
 
 struct SHM final {
+  // Part of the mapping name, so that readers and writers with different
+  // layouts don't see each other; increment when the layout changes, e.g. if
+  // `FramePerformanceCounters` grows
+  static constexpr auto Version = 2;
   static constexpr auto MaxFrameCount = 128;
   alignas(16) LONGLONG mWriterCount {};
   LARGE_INTEGER mLastUpdate {};
@@ -24,4 +28,4 @@ struct SHM final {
 };
 
 // This can change, just check that 32-bit and 64-bit builds get the same value
-static_assert(sizeof(SHM) == 24608);
+static_assert(sizeof(SHM) == 32800);
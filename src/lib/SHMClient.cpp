@@ -9,7 +9,8 @@
 #include "SHM.hpp"
 
 static inline auto GetSHMPath() {
-  return std::format(L"com.fredemmott.XRFrameTools/SHM/{}", ABIKeyW);
+  return std::format(
+    L"com.fredemmott.XRFrameTools/SHM/{}/v{}", ABIKeyW, SHM::Version);
 }
 
 SHMClient::SHMClient() {
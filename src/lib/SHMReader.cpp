@@ -29,5 +29,5 @@ std::chrono::microseconds SHMReader::GetAge() const {
   QueryPerformanceCounter(&now);
 
   static const auto pcm = PerformanceCounterMath::CreateForLiveData();
-  return pcm.ToDuration(shm->mLastUpdate, now);
+  return pcm.ToDuration(shm->mLastUpdate.QuadPart, now.QuadPart);
 }
@@ -0,0 +1,16 @@
+include_guard(DIRECTORY)
+
+include(BinaryLogEncoder.cmake)
+include(PlatformFile.cmake)
+
+add_library(
+  SyntheticLog
+  STATIC
+  SyntheticLog.cpp SyntheticLog.hpp
+)
+target_link_libraries(
+  SyntheticLog
+  PRIVATE
+  BinaryLogEncoder
+  PlatformFile
+)
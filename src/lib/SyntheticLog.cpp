@@ -0,0 +1,661 @@
+// Copyright 2024 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+
+#include "SyntheticLog.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <deque>
+#include <format>
+#include <functional>
+#include <future>
+#include <string>
+#include <system_error>
+
+#include "BinaryLog.hpp"
+#include "BinaryLogEncoder.hpp"
+#include "PlatformFile.hpp"
+
+namespace SyntheticLog {
+
+namespace {
+using ValidDataBits = FramePerformanceCounters::ValidDataBits;
+using DecreaseReason
+  = FramePerformanceCounters::GpuPerformanceInfo::DecreaseReason;
+
+constexpr int64_t StartTime = PerformanceCounterFrequency * 60 * 60;
+constexpr uint32_t ProcessID = 1234;
+
+constexpr uint32_t MaxEncoderSessions
+  = FramePerformanceCounters::EncoderInfo {}.mSessions.size();
+// Windows process IDs are multiples of 4; the pool is small so that later
+// sessions reuse the IDs of earlier ones
+constexpr uint32_t FirstEncoderProcessID = 5000;
+constexpr uint32_t EncoderProcessIDCount = 16;
+
+constexpr uint32_t NominalGraphicsKHz = 2'520'000;
+
+constexpr uint64_t MiB = 1024 * 1024;
+constexpr uint64_t GiB = 1024 * MiB;
+
+// Flushed to the file whenever it's larger than this
+constexpr size_t WriteBufferSize = 4 * 1024 * 1024;
+
+int64_t TicksToNanoseconds(const int64_t ticks) {
+  return ticks * (1'000'000'000 / PerformanceCounterFrequency);
+}
+
+bool HasData(const uint64_t validDataBits, const ValidDataBits bit) {
+  return (validDataBits & bit) == bit;
+}
+
+// SplitMix64; unlike the `<random>` distributions, this gives the same
+// results with every standard library
+class Random final {
+ public:
+  Random() = delete;
+  explicit Random(const uint64_t seed) : mState(seed) {
+  }
+
+  // An independent stream for the same seed, e.g. for each chunk
+  static uint64_t GetStreamSeed(const uint64_t seed, const uint64_t stream) {
+    Random ret {seed ^ (stream * 0xd1b54a32d192ed03)};
+    return ret.Next();
+  }
+
+  uint64_t Next() noexcept {
+    auto z = (mState += 0x9e3779b97f4a7c15);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+    return z ^ (z >> 31);
+  }
+
+  // [0, 1)
+  double NextUniform() noexcept {
+    return static_cast<double>(this->Next() >> 11) * 0x1.0p-53;
+  }
+
+  bool NextBool(const double probability) noexcept {
+    return this->NextUniform() < probability;
+  }
+
+  // Irwin-Hall with 4 terms: close enough to normal for this, and much
+  // cheaper than Box-Muller
+  double Next(const Distribution& distribution) noexcept {
+    double sum {};
+    for (int i = 0; i < 4; ++i) {
+      sum += this->NextUniform();
+    }
+    // `sum` has a mean of 2, and a variance of 1/3
+    constexpr auto Sqrt3 = 1.7320508075688772;
+    return std::max(
+      0.0,
+      distribution.mMean
+        + ((sum - 2) * Sqrt3 * distribution.mStandardDeviation));
+  }
+
+ private:
+  uint64_t mState {};
+};
+
+/* Calls `f` with the index of each frame where an event starts, for events
+ * that happen `perMinute` times a minute on average.
+ *
+ * The gaps between events are geometrically distributed, so this takes time
+ * proportional to the number of events, not the number of frames.
+ */
+template <class F>
+void ForEachEvent(
+  Random& random,
+  const Options& options,
+  const double perMinute,
+  F&& f) {
+  const auto probability = perMinute / (60 * options.mFramesPerSecond);
+  if (!(probability > 0)) {
+    return;
+  }
+  const auto logNoEvent = std::log1p(-std::min(probability, 1 - 1e-9));
+  for (uint64_t frame = 0; frame < options.mFrameCount; ++frame) {
+    const auto gap = std::log(1 - random.NextUniform()) / logNoEvent;
+    if (gap >= static_cast<double>(options.mFrameCount - frame)) {
+      return;
+    }
+    frame += static_cast<uint64_t>(gap);
+    f(frame);
+  }
+}
+
+struct Hitch {
+  uint64_t mFrame {};
+  bool mIsGpu {};
+  double mIntervals {};
+};
+
+struct ThrottleEpisode {
+  uint64_t mFirstFrame {};
+  uint64_t mEndFrame {};
+  uint32_t mDecreaseReasons {};
+};
+
+struct EncoderProcess {
+  uint32_t mProcessID {};
+  // Used for the executable path, so that processes with reused IDs can be
+  // told apart
+  uint32_t mGeneration {};
+};
+
+// The encoder sessions from `mFirstFrame` until the next change
+struct EncoderSessions {
+  uint64_t mFirstFrame {};
+  uint32_t mCount {};
+  std::array<EncoderProcess, MaxEncoderSessions> mProcesses {};
+  // Sessions that started on `mFirstFrame`, by index into `mProcesses`
+  uint32_t mStartedMask {};
+};
+
+std::u8string GetExecutablePath(const EncoderProcess& process) {
+  const auto path = std::format(
+    "C:\\Program Files\\Encoder\\{}\\Encoder.exe", process.mGeneration);
+  return {path.begin(), path.end()};
+}
+
+/* Rare events, planned for the whole log.
+ *
+ * This is sequential, but only takes time proportional to the number of
+ * events; chunks look up events here, so that throttle episodes and encoder
+ * sessions continue across chunks.
+ */
+class Timeline final {
+ public:
+  Timeline() = delete;
+  explicit Timeline(const Options& options) {
+    Random random {Random::GetStreamSeed(options.mSeed, 0)};
+
+    ForEachEvent(
+      random, options, options.mHitchesPerMinute, [&](const uint64_t frame) {
+        mHitches.push_back({
+          .mFrame = frame,
+          .mIsGpu = random.NextBool(0.5),
+          .mIntervals = std::max(1.0, random.Next(options.mHitchDuration)),
+        });
+      });
+
+    uint64_t throttledUntil {};
+    ForEachEvent(
+      random,
+      options,
+      options.mThrottleEpisodesPerMinute,
+      [&](const uint64_t frame) {
+        if (frame < throttledUntil) {
+          return;
+        }
+        const auto frames = static_cast<uint64_t>(
+          random.Next(options.mThrottleDuration) * options.mFramesPerSecond);
+        if (frames == 0) {
+          return;
+        }
+        throttledUntil = frame + frames;
+        mThrottleEpisodes.push_back({
+          .mFirstFrame = frame,
+          .mEndFrame = throttledUntil,
+          .mDecreaseReasons = random.NextBool(0.5)
+            ? DecreaseReason::ThermalProtection
+            : DecreaseReason::PowerControl,
+        });
+      });
+
+    const auto maxSessions
+      = std::min(options.mEncoderSessionCount, MaxEncoderSessions);
+    if (!HasData(options.mValidDataBits, ValidDataBits::NVEnc)) {
+      return;
+    }
+
+    uint32_t generation {};
+    const auto start = [&generation](EncoderSessions& sessions) {
+      sessions.mProcesses.at(sessions.mCount) = {
+        .mProcessID
+        = FirstEncoderProcessID + (4 * (generation % EncoderProcessIDCount)),
+        .mGeneration = generation,
+      };
+      ++generation;
+      sessions.mStartedMask |= (1u << sessions.mCount);
+      ++sessions.mCount;
+    };
+
+    EncoderSessions initial {};
+    while (initial.mCount < maxSessions) {
+      start(initial);
+    }
+    mEncoderSessions.push_back(initial);
+    if (maxSessions == 0) {
+      return;
+    }
+
+    ForEachEvent(
+      random,
+      options,
+      options.mEncoderSessionChangesPerMinute,
+      [&](const uint64_t frame) {
+        if (frame == mEncoderSessions.back().mFirstFrame) {
+          return;
+        }
+        auto next = mEncoderSessions.back();
+        next.mFirstFrame = frame;
+        next.mStartedMask = 0;
+        if (
+          next.mCount == 0
+          || (next.mCount < maxSessions && random.NextBool(0.5))) {
+          start(next);
+        } else {
+          const auto stopped = random.Next() % next.mCount;
+          std::shift_left(
+            next.mProcesses.begin() + stopped,
+            next.mProcesses.begin() + next.mCount,
+            1);
+          --next.mCount;
+        }
+        mEncoderSessions.push_back(next);
+      });
+  }
+
+  std::vector<Hitch> mHitches;
+  std::vector<ThrottleEpisode> mThrottleEpisodes;
+  // Empty if NVEnc data is disabled
+  std::vector<EncoderSessions> mEncoderSessions;
+};
+
+struct Chunk {
+  uint64_t mIndex {};
+  std::vector<FramePerformanceCounters> mFrames;
+  // Chunks are generated as if they start at time 0 on a display slot; this
+  // is when the next chunk should start, relative to this one
+  int64_t mDuration {};
+};
+
+HostMetrics::Sample GetHostMetrics(Random& random, const int64_t time) {
+  // Hundredths of a percent
+  const auto utilization = [&random](const double mean, const double stdDev) {
+    return static_cast<uint32_t>(
+      std::min(random.Next({mean, stdDev}), 100.0) * 100);
+  };
+  return {
+    .mCpu = {
+      .mSampleTime = time,
+      .mFrequencyMHz = 4'500,
+      .mUtilization = utilization(25, 3),
+      .mBusiestCoreUtilization = utilization(90, 5),
+      .mLogicalProcessorCount = 16,
+      .mSampleCostMicroseconds = static_cast<uint32_t>(random.Next({200, 50})),
+    },
+    .mProcess = {
+      .mSampleTime = time,
+      .mWorkingSetBytes = 2 * GiB,
+      .mPrivateBytes = 3 * GiB,
+      .mPageFaults = static_cast<uint32_t>(random.Next({100, 50})),
+      .mCpuUtilization = utilization(12, 2),
+    },
+  };
+}
+
+Chunk GenerateChunk(
+  const Options& options,
+  const Timeline& timeline,
+  const uint64_t chunkIndex) {
+  Random random {Random::GetStreamSeed(options.mSeed, chunkIndex + 1)};
+  const auto validDataBits = options.mValidDataBits;
+
+  const auto interval = static_cast<int64_t>(
+    std::llround(PerformanceCounterFrequency / options.mFramesPerSecond));
+  const auto toTicks = [interval](const double intervals) {
+    return static_cast<int64_t>(std::llround(intervals * interval));
+  };
+  const auto hostMetricsInterval
+    = (PerformanceCounterFrequency * options.mHostMetricsInterval.count())
+    / 1000;
+  // VRAM usage rises and falls over a few minutes, as if assets are being
+  // loaded and unloaded
+  const auto vramPeriod = std::max<uint64_t>(
+    1, static_cast<uint64_t>(std::llround(options.mFramesPerSecond * 240)));
+
+  const auto firstFrame = chunkIndex * FramesPerChunk;
+  const auto endFrame
+    = std::min(firstFrame + FramesPerChunk, options.mFrameCount);
+
+  // Events that are in progress, or start later
+  auto hitch = std::ranges::lower_bound(
+    timeline.mHitches, firstFrame, {}, &Hitch::mFrame);
+  auto throttle = std::ranges::upper_bound(
+    timeline.mThrottleEpisodes, firstFrame, {}, &ThrottleEpisode::mEndFrame);
+  auto encoders = std::ranges::upper_bound(
+    timeline.mEncoderSessions, firstFrame, {}, &EncoderSessions::mFirstFrame);
+  if (encoders != timeline.mEncoderSessions.begin()) {
+    --encoders;
+  }
+
+  Chunk ret {};
+  ret.mIndex = chunkIndex;
+  ret.mFrames.reserve(endFrame - firstFrame);
+
+  int64_t previousEndFrameStop {};
+  int64_t gpuBusyUntil {};
+  HostMetrics::Sample hostMetrics {};
+
+  for (auto frameIndex = firstFrame; frameIndex < endFrame; ++frameIndex) {
+    FramePerformanceCounters fpc {};
+    fpc.mValidDataBits = validDataBits;
+
+    auto appCpu = random.Next(options.mAppCpu);
+    auto renderGpu = random.Next(options.mRenderGpu);
+    if (hitch != timeline.mHitches.end() && hitch->mFrame == frameIndex) {
+      (hitch->mIsGpu ? renderGpu : appCpu) += hitch->mIntervals;
+      ++hitch;
+    }
+    if (
+      throttle != timeline.mThrottleEpisodes.end()
+      && throttle->mEndFrame <= frameIndex) {
+      ++throttle;
+    }
+    const auto throttled = throttle != timeline.mThrottleEpisodes.end()
+      && throttle->mFirstFrame <= frameIndex;
+    if (throttled) {
+      renderGpu /= options.mThrottleClockRatio;
+    }
+
+    // `xrWaitFrame()` returns on a display slot, with at most one frame
+    // queued for the GPU
+    auto& core = fpc.mCore;
+    core.mWaitFrameStart = previousEndFrameStop;
+    const auto earliest
+      = std::max(core.mWaitFrameStart, gpuBusyUntil - interval);
+    core.mWaitFrameStop = ((earliest + interval - 1) / interval) * interval;
+    core.mBeginFrameStart = core.mWaitFrameStop;
+    core.mBeginFrameStop
+      = core.mBeginFrameStart + toTicks(random.Next(options.mBeginFrame));
+    core.mEndFrameStart = core.mBeginFrameStop + toTicks(appCpu);
+    core.mEndFrameStop
+      = core.mEndFrameStart + toTicks(random.Next(options.mEndFrame));
+    // Predicted a couple of frames ahead
+    core.mXrDisplayTime = static_cast<uint64_t>(
+      TicksToNanoseconds(core.mWaitFrameStop + (2 * interval)));
+
+    const auto renderGpuTicks = toTicks(renderGpu);
+    gpuBusyUntil
+      = std::max(core.mEndFrameStop, gpuBusyUntil) + renderGpuTicks;
+    previousEndFrameStop = core.mEndFrameStop;
+
+    if (HasData(validDataBits, ValidDataBits::GpuTime)) {
+      fpc.mRenderGpu = static_cast<uint64_t>(
+        (renderGpuTicks * 1'000'000) / PerformanceCounterFrequency);
+    }
+
+    if (HasData(validDataBits, ValidDataBits::VRAM)) {
+      const auto phase = static_cast<double>(frameIndex % vramPeriod)
+        / static_cast<double>(vramPeriod);
+      const auto triangle = (phase < 0.5) ? (phase * 2) : (2 - (phase * 2));
+      const auto usage = (3 * GiB)
+        + static_cast<uint64_t>(triangle * static_cast<double>(2 * GiB))
+        + (random.Next() % MiB);
+      fpc.mVideoMemoryInfo = {
+        .mBudget = 8 * GiB,
+        .mCurrentUsage = usage,
+        .mAvailableForReservation = (8 * GiB) - usage,
+      };
+    }
+
+    if (HasData(validDataBits, ValidDataBits::NVAPI)) {
+      fpc.mGpuPerformanceInformation = {
+        .mDecreaseReasons = throttled ? throttle->mDecreaseReasons : 0,
+        .mPState = 0,
+        .mGraphicsKHz = throttled
+          ? static_cast<uint32_t>(
+              NominalGraphicsKHz * options.mThrottleClockRatio)
+          : NominalGraphicsKHz,
+        .mMemoryKHz = 10'501'000,
+      };
+    }
+
+    if (encoders != timeline.mEncoderSessions.end()) {
+      while (std::next(encoders) != timeline.mEncoderSessions.end()
+             && std::next(encoders)->mFirstFrame <= frameIndex) {
+        ++encoders;
+      }
+      auto& info = fpc.mEncoders;
+      info.mSessionCount = encoders->mCount;
+      for (uint32_t i = 0; i < encoders->mCount; ++i) {
+        info.mSessions.at(i) = {
+          .mAverageFPS = static_cast<uint32_t>(options.mFramesPerSecond),
+          .mAverageLatency = static_cast<uint32_t>(random.Next({2000, 300})),
+          .mProcessID = encoders->mProcesses.at(i).mProcessID,
+        };
+      }
+    }
+
+    // Shared by every frame until the next sample
+    if (
+      frameIndex == firstFrame
+      || core.mEndFrameStop - hostMetrics.mCpu.mSampleTime
+        >= hostMetricsInterval) {
+      hostMetrics = GetHostMetrics(random, core.mEndFrameStop);
+    }
+    if (HasData(validDataBits, ValidDataBits::HostCpu)) {
+      fpc.mHostCpu = hostMetrics.mCpu;
+    }
+    if (HasData(validDataBits, ValidDataBits::ProcessResources)) {
+      fpc.mProcessResources = hostMetrics.mProcess;
+    }
+
+    ret.mFrames.push_back(fpc);
+  }
+
+  const auto next = std::max(previousEndFrameStop, gpuBusyUntil - interval);
+  ret.mDuration = ((next + interval - 1) / interval) * interval;
+  return ret;
+}
+
+/// Moves each chunk so that it follows the previous one
+class ChunkPlacer final {
+ public:
+  void Place(Chunk& chunk) {
+    if (chunk.mFrames.empty()) {
+      return;
+    }
+    const auto offset = mNextStart;
+    for (auto&& fpc: chunk.mFrames) {
+      auto& core = fpc.mCore;
+      core.mWaitFrameStart += offset;
+      core.mWaitFrameStop += offset;
+      core.mBeginFrameStart += offset;
+      core.mBeginFrameStop += offset;
+      core.mEndFrameStart += offset;
+      core.mEndFrameStop += offset;
+      core.mXrDisplayTime += TicksToNanoseconds(offset);
+      if (HasData(fpc.mValidDataBits, ValidDataBits::HostCpu)) {
+        fpc.mHostCpu.mSampleTime += offset;
+      }
+      if (HasData(fpc.mValidDataBits, ValidDataBits::ProcessResources)) {
+        fpc.mProcessResources.mSampleTime += offset;
+      }
+    }
+    // The game called `xrWaitFrame()` after the previous chunk's last frame,
+    // not when this chunk starts
+    if (mPreviousEndFrameStop) {
+      chunk.mFrames.front().mCore.mWaitFrameStart = mPreviousEndFrameStop;
+    }
+    mPreviousEndFrameStop = chunk.mFrames.back().mCore.mEndFrameStop;
+    mNextStart += chunk.mDuration;
+  }
+
+ private:
+  int64_t mNextStart {StartTime};
+  int64_t mPreviousEndFrameStop {};
+};
+
+struct EncodedChunk {
+  std::string mData;
+  // Where the last frame's packets start in `mData`
+  size_t mLastFrameOffset {};
+  BinaryLog::FileFooter mFooter {};
+};
+
+EncodedChunk Encode(const Timeline& timeline, const Chunk& chunk) {
+  EncodedChunk ret;
+  ret.mData.reserve(chunk.mFrames.size() * 256);
+
+  const auto firstFrame = chunk.mIndex * FramesPerChunk;
+  auto encoders = std::ranges::lower_bound(
+    timeline.mEncoderSessions, firstFrame, {}, &EncoderSessions::mFirstFrame);
+
+  // Each chunk starts with a fresh encoder, so it repeats the host metrics
+  // packets; this is valid, just slightly larger
+  BinaryLogEncoder encoder;
+  for (uint64_t i = 0; i < chunk.mFrames.size(); ++i) {
+    const auto& frame = chunk.mFrames.at(i);
+    ret.mFooter.Update(frame);
+    ret.mLastFrameOffset = ret.mData.size();
+    const auto packets = encoder.EncodeFrame(frame);
+    ret.mData.append(packets.data(), packets.size());
+
+    // Like `BinaryLogWriter`, process info follows the first frame that
+    // references it
+    if (
+      encoders == timeline.mEncoderSessions.end()
+      || encoders->mFirstFrame != firstFrame + i) {
+      continue;
+    }
+    for (uint32_t j = 0; j < encoders->mCount; ++j) {
+      if (encoders->mStartedMask & (1u << j)) {
+        const auto& process = encoders->mProcesses.at(j);
+        ret.mData += BinaryLogEncoder::EncodeProcess(
+          process.mProcessID, GetExecutablePath(process));
+      }
+    }
+    ++encoders;
+  }
+  return ret;
+}
+
+void Merge(BinaryLog::FileFooter& footer, const BinaryLog::FileFooter& chunk) {
+  if (!footer.mFirstEndFrameTime) {
+    footer.mFirstEndFrameTime = chunk.mFirstEndFrameTime;
+  }
+  if (chunk.mLastEndFrameTime) {
+    footer.mLastEndFrameTime = chunk.mLastEndFrameTime;
+  }
+  footer.mFrameCount += chunk.mFrameCount;
+  footer.mValidDataBits |= chunk.mValidDataBits;
+  footer.mMaxEncoderSessionCount
+    = std::max(footer.mMaxEncoderSessionCount, chunk.mMaxEncoderSessionCount);
+}
+
+uint64_t GetChunkCount(const Options& options) {
+  return (options.mFrameCount + FramesPerChunk - 1) / FramesPerChunk;
+}
+
+}// namespace
+
+std::vector<FramePerformanceCounters> GenerateFrames(const Options& options) {
+  const Timeline timeline {options};
+  ChunkPlacer placer;
+
+  std::vector<FramePerformanceCounters> ret;
+  ret.reserve(options.mFrameCount);
+  for (uint64_t i = 0; i < GetChunkCount(options); ++i) {
+    auto chunk = GenerateChunk(options, timeline, i);
+    placer.Place(chunk);
+    ret.insert(ret.end(), chunk.mFrames.begin(), chunk.mFrames.end());
+  }
+  return ret;
+}
+
+void Write(
+  const std::filesystem::path& path,
+  const Options& options,
+  const size_t threadCount) {
+  auto file = PlatformFile::Open(path, PlatformFile::Mode::Write);
+  if (!file) {
+    throw std::system_error(file.error());
+  }
+
+  BinaryLog::SessionInfo session {};
+  const auto sessionSeed = options.mSeed;
+  memcpy(session.mSessionID.data(), &sessionSeed, sizeof(sessionSeed));
+
+  std::string buffer = BinaryLogEncoder::EncodeHeader(
+    {
+      .mProducedBy = "XRFrameTools SyntheticLog",
+      .mExecutablePath = "C:\\Games\\Synthetic\\Synthetic.exe",
+    },
+    BinaryLog::FileHeader::Create(
+      PerformanceCounterFrequency,
+      StartTime,
+      // 2024-01-01T00:00:00Z
+      1'704'067'200'000'000,
+      ProcessID),
+    {},
+    session);
+
+  const Timeline timeline {options};
+  ChunkPlacer placer;
+  BinaryLog::FileFooter footer {};
+
+  // Chunks must be placed and written in order, but can be generated and
+  // encoded in parallel
+  const auto chunkCount = GetChunkCount(options);
+  const auto maxInFlight = std::max<size_t>(threadCount, 1);
+  std::deque<std::future<Chunk>> generating;
+  std::deque<std::future<EncodedChunk>> encoding;
+  uint64_t nextChunk {};
+  uint64_t writtenChunks {};
+
+  const auto writeNext = [&]() {
+    auto encoded = encoding.front().get();
+    encoding.pop_front();
+    Merge(footer, encoded.mFooter);
+    if (
+      ++writtenChunks == chunkCount && options.mEnding == Ending::Truncated) {
+      // Part-way through the last frame's packets
+      encoded.mData.resize(
+        encoded.mLastFrameOffset
+        + ((encoded.mData.size() - encoded.mLastFrameOffset) / 2));
+    }
+    buffer += encoded.mData;
+    if (buffer.size() >= WriteBufferSize) {
+      file->Write(buffer);
+      buffer.clear();
+    }
+  };
+
+  for (uint64_t i = 0; i < chunkCount; ++i) {
+    while (generating.size() < maxInFlight && nextChunk < chunkCount) {
+      generating.push_back(std::async(
+        std::launch::async,
+        &GenerateChunk,
+        std::cref(options),
+        std::cref(timeline),
+        nextChunk++));
+    }
+    auto chunk = generating.front().get();
+    generating.pop_front();
+    placer.Place(chunk);
+
+    if (encoding.size() >= maxInFlight) {
+      writeNext();
+    }
+    encoding.push_back(std::async(
+      std::launch::async, [&timeline, chunk = std::move(chunk)]() {
+        return Encode(timeline, chunk);
+      }));
+  }
+  while (!encoding.empty()) {
+    writeNext();
+  }
+
+  if (options.mEnding == Ending::Footer) {
+    buffer += BinaryLogEncoder::EncodeFooter(footer);
+  }
+  file->Write(buffer);
+}
+
+}// namespace SyntheticLog
@@ -0,0 +1,115 @@
+// Copyright 2024 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+#include "FramePerformanceCounters.hpp"
+
+/* Plausible frames and logs that weren't recorded from a real game.
+ *
+ * These are for testing and measuring the log tools - e.g. benchmarks, or
+ * load-testing conversion - on any platform, without needing a VR headset or
+ * sharing real captures.
+ *
+ * Frames are generated in chunks of `FramesPerChunk`, each with its own random
+ * stream; rare events such as hitches and throttling are planned for the whole
+ * log first, so they can span chunks. This means chunks can be generated in
+ * parallel, and the output only depends on the options, not on the number of
+ * threads.
+ */
+namespace SyntheticLog {
+
+// As `QueryPerformanceFrequency()` on most Windows systems
+static constexpr int64_t PerformanceCounterFrequency = 10'000'000;
+
+static constexpr uint64_t FramesPerChunk = 16384;
+
+/// Approximately normal, but never negative; units depend on the option
+struct Distribution {
+  double mMean {};
+  double mStandardDeviation {};
+};
+
+enum class Ending {
+  Footer,
+  // As if the game was killed between frames
+  NoFooter,
+  // As if the game was killed part-way through writing a frame
+  Truncated,
+};
+
+struct Options {
+  uint64_t mFrameCount {90 * 60};
+  double mFramesPerSecond {90};
+
+  // Stage durations are in frame intervals. `xrWaitFrame()` returns on the
+  // next display slot after the previous frame, so the wait time is whatever
+  // is left over
+  Distribution mBeginFrame {0.01, 0.002};
+  // From `xrBeginFrame()` returning, to `xrEndFrame()` being called
+  Distribution mAppCpu {0.5, 0.05};
+  Distribution mEndFrame {0.05, 0.01};
+  Distribution mRenderGpu {0.6, 0.05};
+
+  // A single frame's app CPU or render GPU time is increased by
+  // `mHitchDuration` frame intervals
+  double mHitchesPerMinute {};
+  Distribution mHitchDuration {4, 2};
+
+  // The GPU clock is reduced to `mThrottleClockRatio` of normal for
+  // `mThrottleDuration` seconds, with thermal or power limit reasons; render
+  // GPU times are increased to match
+  double mThrottleEpisodesPerMinute {};
+  Distribution mThrottleDuration {10, 5};
+  double mThrottleClockRatio {0.7};
+
+  /** Which optional packets each frame has.
+   *
+   * This is a mask of `FramePerformanceCounters::ValidDataBits`; `Core`
+   * packets are always present.
+   */
+  uint64_t mValidDataBits {
+    std::to_underlying(FramePerformanceCounters::ValidDataBits::GpuTime)
+    | std::to_underlying(FramePerformanceCounters::ValidDataBits::VRAM)
+    | std::to_underlying(FramePerformanceCounters::ValidDataBits::NVAPI)
+    | std::to_underlying(FramePerformanceCounters::ValidDataBits::HostCpu)
+    | std::to_underlying(
+      FramePerformanceCounters::ValidDataBits::ProcessResources),
+  };
+
+  // Only used if `mValidDataBits` includes `NVEnc`. Sessions running at the
+  // start of the log; this is also the most that can run at once
+  uint32_t mEncoderSessionCount {1};
+  // A session starts or stops; each new session is from a new process, so
+  // adds a `CompactProcessInfo` packet. Process IDs are reused, as on Windows
+  double mEncoderSessionChangesPerMinute {};
+
+  // `HostMetrics` samples are shared by all frames within an interval
+  std::chrono::milliseconds mHostMetricsInterval {100};
+
+  Ending mEnding {Ending::Footer};
+
+  uint64_t mSeed {};
+};
+
+/// `Options::mFrameCount` frames
+[[nodiscard]]
+std::vector<FramePerformanceCounters> GenerateFrames(const Options&);
+
+/** Write a log with the `Full` logging policy.
+ *
+ * Up to `threadCount` chunks are generated at a time, and up to `threadCount`
+ * are encoded at a time.
+ *
+ * Throws `std::system_error` on failure.
+ */
+void Write(
+  const std::filesystem::path&,
+  const Options&,
+  size_t threadCount = 1);
+
+}// namespace SyntheticLog
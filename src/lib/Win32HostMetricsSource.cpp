@@ -0,0 +1,239 @@
+// Copyright 2024 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+
+// clang-format off
+#include <Windows.h>
+#include <Psapi.h>
+#include <pdh.h>
+#include <pdhmsg.h>
+// clang-format on
+
+#include <wil/resource.h>
+
+#include <algorithm>
+#include <cmath>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "HostMetrics.hpp"
+#include "Win32Utils.hpp"
+
+namespace {
+
+using unique_pdh_query
+  = wil::unique_any<PDH_HQUERY, decltype(&PdhCloseQuery), PdhCloseQuery>;
+
+uint64_t ToUInt64(const FILETIME& ft) {
+  return (static_cast<uint64_t>(ft.dwHighDateTime) << 32) | ft.dwLowDateTime;
+}
+
+uint32_t ToHundredthsOfPercent(const double percent) {
+  return static_cast<uint32_t>(
+    std::lround(std::clamp(percent, 0.0, 100.0) * 100));
+}
+
+/* Uses the same performance counters as Task Manager; in particular,
+ * `CallNtPowerInformation()` reports the nominal frequency rather than the
+ * current frequency on modern systems, so the current frequency is
+ * `% Processor Performance` of the nominal `Processor Frequency`.
+ */
+class Win32Source final : public HostMetrics::Source {
+ public:
+  Win32Source() {
+    QueryPerformanceFrequency(&mFrequency);
+    if (PdhOpenQueryW(nullptr, 0, mQuery.put()) != ERROR_SUCCESS) {
+      dprint("HostMetrics: PdhOpenQuery failed");
+      mQuery.reset();
+      return;
+    }
+    const auto add = [this](const wchar_t* path, PDH_HCOUNTER* counter) {
+      if (
+        PdhAddEnglishCounterW(mQuery.get(), path, 0, counter)
+        != ERROR_SUCCESS) {
+        dprint(L"HostMetrics: failed to add counter `{}`", path);
+        return false;
+      }
+      return true;
+    };
+    if (!(add(
+            LR"(\Processor Information(_Total)\% Processor Time)",
+            &mUtilization)
+          && add(LR"(\Processor Information(*)\% Processor Time)", &mCores)
+          && add(
+            LR"(\Processor Information(_Total)\% Processor Performance)",
+            &mPerformance)
+          && add(
+            LR"(\Processor Information(_Total)\Processor Frequency)",
+            &mNominalFrequency))) {
+      mQuery.reset();
+      return;
+    }
+    // Rate counters need two collections before they have a value
+    PdhCollectQueryData(mQuery.get());
+  }
+
+  std::optional<HostMetrics::Sample> GetSample() override {
+    LARGE_INTEGER start {};
+    QueryPerformanceCounter(&start);
+
+    HostMetrics::Sample ret {
+      .mProcess = this->GetProcessSample(start),
+    };
+    if (mQuery && PdhCollectQueryData(mQuery.get()) == ERROR_SUCCESS) {
+      ret.mCpu = this->GetCpuSample(start);
+    }
+
+    LARGE_INTEGER stop {};
+    QueryPerformanceCounter(&stop);
+    if (ret.mCpu.mSampleTime) {
+      ret.mCpu.mSampleCostMicroseconds = static_cast<uint32_t>(
+        ((stop.QuadPart - start.QuadPart) * 1'000'000) / mFrequency.QuadPart);
+    }
+
+    if (!(ret.mCpu.mSampleTime || ret.mProcess.mSampleTime)) {
+      return std::nullopt;
+    }
+    return ret;
+  }
+
+ private:
+  LARGE_INTEGER mFrequency {};
+  unique_pdh_query mQuery;
+  PDH_HCOUNTER mUtilization {};
+  PDH_HCOUNTER mCores {};
+  PDH_HCOUNTER mPerformance {};
+  PDH_HCOUNTER mNominalFrequency {};
+  // Reused by `PdhGetFormattedCounterArrayW()`
+  std::vector<std::byte> mCoreBuffer;
+
+  // For 'since the previous sample' process values
+  LARGE_INTEGER mPreviousTime {};
+  uint64_t mPreviousProcessTime {};// 100ns units
+  DWORD mPreviousPageFaults {};
+  uint32_t mLogicalProcessorCount {
+    GetActiveProcessorCount(ALL_PROCESSOR_GROUPS)};
+
+  [[nodiscard]]
+  std::optional<double> GetValue(const PDH_HCOUNTER counter) const {
+    PDH_FMT_COUNTERVALUE value {};
+    if (
+      PdhGetFormattedCounterValue(
+        counter, PDH_FMT_DOUBLE | PDH_FMT_NOCAP100, nullptr, &value)
+        != ERROR_SUCCESS
+      || value.CStatus != ERROR_SUCCESS) {
+      return std::nullopt;
+    }
+    return value.doubleValue;
+  }
+
+  [[nodiscard]]
+  HostMetrics::Cpu GetCpuSample(const LARGE_INTEGER& now) {
+    const auto utilization = this->GetValue(mUtilization);
+    if (!utilization) {
+      return {};
+    }
+
+    HostMetrics::Cpu ret {
+      .mSampleTime = now.QuadPart,
+      .mUtilization = ToHundredthsOfPercent(*utilization),
+      .mLogicalProcessorCount = mLogicalProcessorCount,
+    };
+
+    const auto performance = this->GetValue(mPerformance);
+    const auto nominal = this->GetValue(mNominalFrequency);
+    if (performance && nominal) {
+      ret.mFrequencyMHz
+        = static_cast<uint32_t>(std::lround((*nominal * *performance) / 100));
+    }
+
+    DWORD itemCount {};
+    const auto getCores = [this, &itemCount]() {
+      auto bufferSize = static_cast<DWORD>(mCoreBuffer.size());
+      const auto result = PdhGetFormattedCounterArrayW(
+        mCores,
+        PDH_FMT_DOUBLE,
+        &bufferSize,
+        &itemCount,
+        mCoreBuffer.empty()
+          ? nullptr
+          : reinterpret_cast<PDH_FMT_COUNTERVALUE_ITEM_W*>(mCoreBuffer.data()));
+      if (result == PDH_MORE_DATA) {
+        mCoreBuffer.resize(bufferSize);
+      }
+      return result;
+    };
+    // Only allocates on the first sample, or if processors are added
+    auto result = getCores();
+    if (result == PDH_MORE_DATA) {
+      result = getCores();
+    }
+    if (result != ERROR_SUCCESS) {
+      return ret;
+    }
+    const std::span items {
+      reinterpret_cast<const PDH_FMT_COUNTERVALUE_ITEM_W*>(mCoreBuffer.data()),
+      itemCount,
+    };
+    for (auto&& item: items) {
+      // Instances are `GROUP,CORE`, with `_Total` for each group and overall
+      if (std::wstring_view {item.szName}.contains(L"_Total")) {
+        continue;
+      }
+      if (item.FmtValue.CStatus != ERROR_SUCCESS) {
+        continue;
+      }
+      ret.mBusiestCoreUtilization = std::max(
+        ret.mBusiestCoreUtilization,
+        ToHundredthsOfPercent(item.FmtValue.doubleValue));
+    }
+    return ret;
+  }
+
+  [[nodiscard]]
+  HostMetrics::Process GetProcessSample(const LARGE_INTEGER& now) {
+    const auto process = GetCurrentProcess();
+    PROCESS_MEMORY_COUNTERS_EX memory {.cb = sizeof(memory)};
+    FILETIME creation {};
+    FILETIME exit {};
+    FILETIME kernel {};
+    FILETIME user {};
+    if (!(GetProcessMemoryInfo(
+            process,
+            reinterpret_cast<PROCESS_MEMORY_COUNTERS*>(&memory),
+            sizeof(memory))
+          && GetProcessTimes(process, &creation, &exit, &kernel, &user))) {
+      return {};
+    }
+
+    HostMetrics::Process ret {
+      .mSampleTime = now.QuadPart,
+      .mWorkingSetBytes = memory.WorkingSetSize,
+      .mPrivateBytes = memory.PrivateUsage,
+    };
+
+    const auto processTime = ToUInt64(kernel) + ToUInt64(user);
+    if (mPreviousTime.QuadPart) {
+      ret.mPageFaults = memory.PageFaultCount - mPreviousPageFaults;
+      // 100ns units
+      const auto elapsed
+        = ((now.QuadPart - mPreviousTime.QuadPart) * 10'000'000)
+        / mFrequency.QuadPart;
+      if (elapsed > 0 && mLogicalProcessorCount) {
+        ret.mCpuUtilization = ToHundredthsOfPercent(
+          (100.0 * (processTime - mPreviousProcessTime))
+          / (static_cast<double>(elapsed) * mLogicalProcessorCount));
+      }
+    }
+    mPreviousTime = now;
+    mPreviousProcessTime = processTime;
+    mPreviousPageFaults = memory.PageFaultCount;
+    return ret;
+  }
+};
+
+}// namespace
+
+std::unique_ptr<HostMetrics::Source> HostMetrics::Source::Create() {
+  return std::make_unique<Win32Source>();
+}
@@ -0,0 +1,136 @@
+// Copyright 2024 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+
+#include <Windows.h>
+
+#include <algorithm>
+#include <limits>
+
+#include "PlatformFile.hpp"
+
+namespace {
+
+HANDLE ToHandle(const intptr_t handle) {
+  return reinterpret_cast<HANDLE>(handle);
+}
+
+std::error_code GetLastErrorCode() {
+  return {static_cast<int>(GetLastError()), std::system_category()};
+}
+
+}// namespace
+
+std::expected<PlatformFile, std::error_code> PlatformFile::Open(
+  const std::filesystem::path& path,
+  const Mode mode) {
+  const auto handle = (mode == Mode::Read)
+    ? CreateFileW(
+        path.c_str(),
+        GENERIC_READ,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL,
+        nullptr)
+    : CreateFileW(
+        path.c_str(),
+        GENERIC_WRITE,
+        FILE_SHARE_READ,
+        nullptr,
+        CREATE_ALWAYS,
+        FILE_ATTRIBUTE_NORMAL,
+        nullptr);
+  if (handle == INVALID_HANDLE_VALUE) {
+    return std::unexpected {GetLastErrorCode()};
+  }
+  return PlatformFile {reinterpret_cast<NativeHandle>(handle), true};
+}
+
+PlatformFile PlatformFile::GetStandardOutput() {
+  return {
+    reinterpret_cast<NativeHandle>(GetStdHandle(STD_OUTPUT_HANDLE)),
+    false,
+  };
+}
+
+void PlatformFile::Close() noexcept {
+  if (mIsOwned && mHandle != InvalidHandle) {
+    CloseHandle(ToHandle(mHandle));
+  }
+  mHandle = InvalidHandle;
+  mIsOwned = false;
+}
+
+std::optional<size_t> PlatformFile::Read(
+  void* const buffer,
+  const size_t size) noexcept {
+  auto bytes = static_cast<std::byte*>(buffer);
+  size_t total {};
+  // `ReadFile()` takes a `DWORD`
+  while (total < size) {
+    const auto chunk = static_cast<DWORD>(std::min<size_t>(
+      size - total, std::numeric_limits<DWORD>::max()));
+    DWORD bytesRead {};
+    if (!ReadFile(
+          ToHandle(mHandle), bytes + total, chunk, &bytesRead, nullptr)) {
+      return std::nullopt;
+    }
+    total += bytesRead;
+    if (bytesRead < chunk) {
+      break;
+    }
+  }
+  return total;
+}
+
+void PlatformFile::Write(std::string_view data) {
+  while (!data.empty()) {
+    const auto chunk = static_cast<DWORD>(std::min<size_t>(
+      data.size(), std::numeric_limits<DWORD>::max()));
+    DWORD bytesWritten {};
+    if (!WriteFile(
+          ToHandle(mHandle), data.data(), chunk, &bytesWritten, nullptr)) {
+      throw std::system_error(GetLastErrorCode());
+    }
+    data.remove_prefix(bytesWritten);
+  }
+}
+
+std::optional<uint64_t> PlatformFile::Seek(
+  const int64_t offset,
+  const SeekOrigin origin) noexcept {
+  DWORD method {FILE_BEGIN};
+  switch (origin) {
+    case SeekOrigin::Begin:
+      method = FILE_BEGIN;
+      break;
+    case SeekOrigin::Current:
+      method = FILE_CURRENT;
+      break;
+    case SeekOrigin::End:
+      method = FILE_END;
+      break;
+  }
+  LARGE_INTEGER position {};
+  if (!SetFilePointerEx(
+        ToHandle(mHandle), {.QuadPart = offset}, &position, method)) {
+    return std::nullopt;
+  }
+  return static_cast<uint64_t>(position.QuadPart);
+}
+
+std::optional<uint64_t> PlatformFile::GetPosition() const noexcept {
+  LARGE_INTEGER position {};
+  if (!SetFilePointerEx(ToHandle(mHandle), {}, &position, FILE_CURRENT)) {
+    return std::nullopt;
+  }
+  return static_cast<uint64_t>(position.QuadPart);
+}
+
+std::optional<uint64_t> PlatformFile::GetSize() const noexcept {
+  LARGE_INTEGER size {};
+  if (!GetFileSizeEx(ToHandle(mHandle), &size)) {
+    return std::nullopt;
+  }
+  return static_cast<uint64_t>(size.QuadPart);
+}
@@ -28,6 +28,14 @@ consteval GUID operator"" _guid() {
 }
 
 namespace win32 {
+/// As used in `FramePerformanceCounters`
+[[nodiscard]]
+inline int64_t QueryPerformanceCounter() noexcept {
+  LARGE_INTEGER ret {};
+  ::QueryPerformanceCounter(&ret);
+  return ret.QuadPart;
+}
+
 // like std::println, but writing to a HANDLE
 template <class... Args>
 void println(
@@ -0,0 +1,283 @@
+// Copyright 2024 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <optional>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include "BinaryLogEncoder.hpp"
+#include "BinaryLogReader.hpp"
+#include "PlatformFile.hpp"
+#include "TemporaryPath.hpp"
+
+namespace {
+
+constexpr uint32_t EncoderProcessID = 5678;
+
+FramePerformanceCounters GetFrame(const int64_t start) {
+  FramePerformanceCounters ret {};
+  ret.mCore.mXrDisplayTime = 1;
+  ret.mCore.mWaitFrameStart = start;
+  ret.mCore.mWaitFrameStop = start + 1;
+  ret.mCore.mBeginFrameStart = start + 2;
+  ret.mCore.mBeginFrameStop = start + 3;
+  ret.mCore.mEndFrameStart = start + 4;
+  ret.mCore.mEndFrameStop = start + 5;
+  return ret;
+}
+
+std::string GetHeader(const BinaryLog::SessionInfo& session = {}) {
+  return BinaryLogEncoder::EncodeHeader(
+    {.mProducedBy = "tests", .mExecutablePath = "game.exe"},
+    BinaryLog::FileHeader::Create(10'000'000, 1'000, 1'704'067'200'000'000, 1),
+    {},
+    session);
+}
+
+std::string GetFrameData(
+  const int64_t start,
+  const uint64_t representedFrames = 1,
+  const std::optional<FrameMetrics>& summary = std::nullopt) {
+  BinaryLogEncoder encoder;
+  const auto packets
+    = encoder.EncodeFrame(GetFrame(start), representedFrames, summary);
+  return {packets.data(), packets.size()};
+}
+
+// A `CompactProcessInfo` packet that claims a path of `pathByteCount`, but
+// only contains `path`
+std::string GetProcessInfo(
+  const uint32_t pathByteCount,
+  const std::string_view path) {
+  using namespace BinaryLog;
+  const PacketHeader header {
+    PacketHeader::PacketType::CompactProcessInfo,
+    static_cast<uint32_t>(sizeof(CompactProcessInfo) + pathByteCount),
+  };
+  const CompactProcessInfo info {
+    .mProcessID = EncoderProcessID,
+    .mPathByteCount = pathByteCount,
+  };
+  std::string ret {static_cast<std::string_view>(header)};
+  ret.append(reinterpret_cast<const char*>(&info), sizeof(info));
+  ret.append(path);
+  return ret;
+}
+
+void WriteFile(const std::filesystem::path& path, const std::string& data) {
+  auto file = PlatformFile::Open(path, PlatformFile::Mode::Write);
+  ASSERT_TRUE(file.has_value());
+  file->Write(data);
+}
+
+BinaryLogReader Open(
+  const std::filesystem::path& path,
+  const std::string& data) {
+  WriteFile(path, data);
+  auto reader = BinaryLogReader::Create(path);
+  EXPECT_TRUE(reader.has_value());
+  return std::move(reader).value();
+}
+
+BinaryLogReader Open(const TemporaryPath& path, const std::string& data) {
+  return Open(path.Get(), data);
+}
+
+// A complete segment of a rotated log
+std::string GetSegment(const BinaryLog::SessionInfo& session) {
+  return GetHeader(session) + GetFrameData(100)
+    + BinaryLogEncoder::EncodeFooter({.mFrameCount = 1});
+}
+
+TEST(BinaryLogReader, ReadsProcessInfo) {
+  const TemporaryPath path {".XRFTBinLog"};
+  auto reader = Open(
+    path,
+    GetHeader() + GetFrameData(100) + GetProcessInfo(8, "test.exe")
+      + GetFrameData(200));
+  EXPECT_TRUE(reader.GetNextFrame());
+  EXPECT_TRUE(reader.GetNextFrame());
+  EXPECT_EQ(reader.GetExecutablePath(EncoderProcessID), "test.exe");
+}
+
+// Allocating this would throw `std::bad_alloc` on 32-bit builds, and use
+// 4GB on 64-bit builds
+TEST(BinaryLogReader, RejectsHugeProcessPaths) {
+  const TemporaryPath path {".XRFTBinLog"};
+  auto reader = Open(
+    path,
+    GetHeader() + GetFrameData(100) + GetProcessInfo(0xffff'fff0, "test.exe")
+      + GetFrameData(200));
+  EXPECT_TRUE(reader.GetNextFrame());
+  EXPECT_FALSE(reader.GetExecutablePath(EncoderProcessID));
+}
+
+TEST(BinaryLogReader, RejectsProcessPathsLargerThanTheFile) {
+  const TemporaryPath path {".XRFTBinLog"};
+  auto reader = Open(
+    path,
+    GetHeader() + GetFrameData(100) + GetProcessInfo(1024, "test.exe")
+      + GetFrameData(200));
+  EXPECT_TRUE(reader.GetNextFrame());
+  EXPECT_FALSE(reader.GetExecutablePath(EncoderProcessID));
+}
+
+TEST(BinaryLogReader, RejectsProcessPathsLongerThanWindowsAllows) {
+  const TemporaryPath path {".XRFTBinLog"};
+  const std::string longPath(
+    BinaryLog::CompactProcessInfo::MaxPathByteCount + 1, 'a');
+  auto reader = Open(
+    path,
+    GetHeader() + GetFrameData(100)
+      + GetProcessInfo(static_cast<uint32_t>(longPath.size()), longPath)
+      + GetFrameData(200));
+  EXPECT_TRUE(reader.GetNextFrame());
+  EXPECT_FALSE(reader.GetExecutablePath(EncoderProcessID));
+}
+
+TEST(BinaryLogReader, ResumesFooterComputation) {
+  const TemporaryPath path {".XRFTBinLog"};
+  const auto header = GetHeader();
+  const auto first = GetFrameData(100);
+  const auto second = GetFrameData(200);
+  const auto third = GetFrameData(300, 5);
+
+  // The writer is part-way through the third frame; as the reader can't tell
+  // if the second frame is complete yet, the checkpoint is before it
+  BinaryLogReader::FooterCheckpoint checkpoint;
+  auto footer = Open(path, header + first + second + third.substr(0, 10))
+                  .ComputeFileFooter(checkpoint);
+  EXPECT_EQ(footer.mFrameCount, 2);
+  EXPECT_EQ(checkpoint.mOffset, header.size() + first.size());
+  EXPECT_EQ(checkpoint.mFooter.mFrameCount, 1);
+
+  const auto data = header + first + second + third;
+  footer = Open(path, data).ComputeFileFooter(checkpoint);
+  EXPECT_EQ(checkpoint.mOffset, header.size() + first.size() + second.size());
+  EXPECT_EQ(footer.mFrameCount, 7);
+  EXPECT_EQ(footer.mFirstEndFrameTime, 104);
+  EXPECT_EQ(footer.mLastEndFrameTime, 304);
+
+  auto fresh = Open(path, data);
+  EXPECT_EQ(fresh.GetOrComputeFileFooter().mFrameCount, 7);
+}
+
+TEST(BinaryLogReader, IgnoresStaleFooterCheckpoints) {
+  const TemporaryPath path {".XRFTBinLog"};
+  const auto header = GetHeader();
+  BinaryLogReader::FooterCheckpoint checkpoint {
+    .mOffset = header.size() + 3,
+    .mFooter = {.mFrameCount = 100},
+  };
+  auto reader = Open(path, header + GetFrameData(100) + GetFrameData(200));
+  EXPECT_EQ(reader.ComputeFileFooter(checkpoint).mFrameCount, 2);
+  EXPECT_TRUE(reader.GetNextFrame());
+}
+
+TEST(BinaryLogReader, FollowsIntoTheNextSegment) {
+  const TemporaryPath directory;
+  std::filesystem::create_directory(directory.Get());
+  const auto first = directory.Get() / "first.XRFTBinLog";
+  const auto next = directory.Get() / "next.XRFTBinLog";
+  const BinaryLog::SessionInfo session {.mSessionID = {1, 2, 3}};
+
+  WriteFile(
+    directory.Get() / "other.XRFTBinLog",
+    GetSegment({.mSessionID = {4, 5, 6}, .mSegmentIndex = 1}));
+  WriteFile(directory.Get() / "unrelated.txt", "not a log");
+  WriteFile(next, GetSegment({.mSessionID = {1, 2, 3}, .mSegmentIndex = 1}));
+
+  auto reader = Open(first, GetSegment(session));
+  EXPECT_TRUE(reader.FollowNextFrame({}));
+  EXPECT_FALSE(reader.FollowNextFrame({}));
+
+  const auto nextReader = reader.FollowNextSegment({});
+  ASSERT_TRUE(nextReader);
+  EXPECT_EQ(nextReader->GetLogFilePath(), next);
+}
+
+TEST(BinaryLogReader, WaitsForTheNextSegmentHeader) {
+  const TemporaryPath directory;
+  std::filesystem::create_directory(directory.Get());
+  const auto next = directory.Get() / "next.XRFTBinLog";
+  const BinaryLog::SessionInfo session {.mSessionID = {1, 2, 3}};
+
+  // Rotation creates the next segment before finishing the previous one
+  WriteFile(next, {});
+  auto reader = Open(directory.Get() / "first.XRFTBinLog", GetSegment(session));
+  EXPECT_TRUE(reader.FollowNextFrame({}));
+  EXPECT_FALSE(reader.FollowNextFrame({}));
+
+  std::jthread writer {[&next]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    WriteFile(next, GetSegment({.mSessionID = {1, 2, 3}, .mSegmentIndex = 1}));
+  }};
+  const auto nextReader = reader.FollowNextSegment({});
+  ASSERT_TRUE(nextReader);
+  EXPECT_EQ(nextReader->GetLogFilePath(), next);
+}
+
+TEST(BinaryLogReader, StopsAfterTheLastSegment) {
+  const TemporaryPath directory;
+  std::filesystem::create_directory(directory.Get());
+  auto reader = Open(
+    directory.Get() / "first.XRFTBinLog",
+    GetSegment({.mSessionID = {1, 2, 3}}));
+  WriteFile(
+    directory.Get() / "other.XRFTBinLog",
+    GetSegment({.mSessionID = {4, 5, 6}, .mSegmentIndex = 1}));
+  EXPECT_TRUE(reader.FollowNextFrame({}));
+  EXPECT_FALSE(reader.FollowNextFrame({}));
+  EXPECT_FALSE(reader.FollowNextSegment({}));
+}
+
+TEST(BinaryLogReader, ReadsFrameSummaries) {
+  using namespace std::chrono_literals;
+  FrameMetrics summary {};
+  summary.mFrameCount = 10;
+  summary.mSincePreviousFrame = 11111us;
+  summary.mLastEndFrameStop = 105;
+  summary.mAppCpu = 2500us;
+  summary.mRenderGpu = 9000us;
+  summary.mGpuMemoryKHzMax = 1234;
+  summary.mPacing.mDisplayPeriod = 11111us;
+  summary.mPacing.mJitter = 12us;
+  summary.mPacing.mRepeatedSlots = 3;
+  summary.mBottleneckFrameCounts
+    [std::to_underlying(FrameBottleneck::RenderGpu)]
+    = 7;
+  summary.mHostCpu.mSampleCount = 2;
+  summary.mProcessResources.mPrivateBytes = 1ull << 40;
+
+  const TemporaryPath path {".XRFTBinLog"};
+  auto reader = Open(
+    path, GetHeader() + GetFrameData(100) + GetFrameData(200, 10, summary));
+  EXPECT_TRUE(reader.GetNextFrame());
+  EXPECT_FALSE(reader.GetFrameSummary());
+  EXPECT_TRUE(reader.GetNextFrame());
+  EXPECT_EQ(reader.GetRepresentedFrameCount(), 10);
+
+  const auto read = reader.GetFrameSummary();
+  ASSERT_TRUE(read);
+  EXPECT_EQ(read->mFrameCount, summary.mFrameCount);
+  EXPECT_EQ(read->mSincePreviousFrame, summary.mSincePreviousFrame);
+  EXPECT_EQ(read->mLastEndFrameStop, summary.mLastEndFrameStop);
+  EXPECT_EQ(read->mAppCpu, summary.mAppCpu);
+  EXPECT_EQ(read->mRenderGpu, summary.mRenderGpu);
+  EXPECT_EQ(read->mGpuMemoryKHzMax, summary.mGpuMemoryKHzMax);
+  EXPECT_EQ(read->mPacing.mDisplayPeriod, summary.mPacing.mDisplayPeriod);
+  EXPECT_EQ(read->mPacing.mJitter, summary.mPacing.mJitter);
+  EXPECT_EQ(read->mPacing.mRepeatedSlots, summary.mPacing.mRepeatedSlots);
+  EXPECT_EQ(read->mBottleneckFrameCounts, summary.mBottleneckFrameCounts);
+  EXPECT_EQ(read->mHostCpu.mSampleCount, summary.mHostCpu.mSampleCount);
+  EXPECT_EQ(
+    read->mProcessResources.mPrivateBytes,
+    summary.mProcessResources.mPrivateBytes);
+}
+
+}// namespace
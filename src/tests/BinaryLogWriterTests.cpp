@@ -0,0 +1,128 @@
+// Copyright 2024 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+
+#include <Windows.h>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <filesystem>
+#include <thread>
+
+#include "BinaryLogReader.hpp"
+#include "BinaryLogWriter.hpp"
+#include "StallingLogFileBackend.hpp"
+#include "SyntheticLog.hpp"
+#include "TemporaryPath.hpp"
+
+namespace {
+
+using namespace std::chrono_literals;
+
+// As `BinaryLogWriter::BufferSize`
+constexpr uintmax_t WriterBufferSize = 1024 * 1024;
+// Synthetic frames are about 150 bytes, so this is a few buffers' worth
+constexpr uint64_t FrameCount = 30'000;
+// Less than half of the writer's ring buffer, so that the writer thread can
+// always keep up with a burst unless it is waiting for the disk
+constexpr size_t FramesPerBurst = 64;
+constexpr auto BurstInterval = 2ms;
+
+// `LogFileBackend::Factory` is a function pointer, so these can't be captured
+LogFileBackend::Factory gInnerFactory {};
+std::chrono::milliseconds gWriteStall {};
+std::filesystem::path gLogPath;
+
+std::unique_ptr<LogFileBackend> CreateStallingBackend(
+  const std::filesystem::path& path) {
+  auto inner = gInnerFactory(path);
+  if (!inner) {
+    return nullptr;
+  }
+  gLogPath = path;
+  return std::make_unique<StallingLogFileBackend>(
+    std::move(inner), gWriteStall);
+}
+
+class BinaryLogWriterStallTest
+  : public testing::TestWithParam<LogFileBackend::Factory> {
+ protected:
+  TemporaryPath mLogsRoot;
+
+  // Returns the size of the log
+  uintmax_t WriteLog(const std::chrono::milliseconds writeStall) {
+    gInnerFactory = GetParam();
+    gWriteStall = writeStall;
+    gLogPath.clear();
+
+    const auto frames
+      = SyntheticLog::GenerateFrames({.mFrameCount = FrameCount});
+    {
+      BinaryLogWriter writer {{
+        .mBackendFactory = &CreateStallingBackend,
+        .mLogsRoot = mLogsRoot.Get(),
+      }};
+      for (size_t i = 0; i < frames.size(); ++i) {
+        writer.LogFrame(frames.at(i));
+        // Not `sleep_until()`: catching up after oversleeping would produce
+        // larger bursts
+        if ((i + 1) % FramesPerBurst == 0) {
+          std::this_thread::sleep_for(BurstInterval);
+        }
+      }
+      // Frames that are still queued when the writer is destroyed are
+      // discarded, not dropped; give it a chance to finish waiting for the
+      // disk, and take them
+      std::this_thread::sleep_for(writeStall + 100ms);
+    }
+    EXPECT_FALSE(gLogPath.empty());
+    EXPECT_TRUE(gLogPath.string().starts_with(mLogsRoot.Get().string()));
+    return std::filesystem::file_size(gLogPath);
+  }
+
+  static uint64_t CountFrames(BinaryLogReader& reader) {
+    uint64_t ret {};
+    while (reader.GetNextFrame()) {
+      ++ret;
+    }
+    return ret;
+  }
+};
+
+// Each buffer takes longer to fill than a write takes to complete, so the
+// writer should never wait for the disk while frames are arriving
+TEST_P(BinaryLogWriterStallTest, DoesNotDropFramesWhileWritesAreStalled) {
+  const auto size = WriteLog(100ms);
+  ASSERT_GT(size, 3 * WriterBufferSize);
+
+  auto reader = BinaryLogReader::Create(gLogPath);
+  ASSERT_TRUE(reader.has_value());
+  const auto footer = reader->GetFileFooter();
+  ASSERT_TRUE(footer.has_value());
+  EXPECT_EQ(footer->mDroppedFrameCount, 0);
+  EXPECT_EQ(footer->mFrameCount, FrameCount);
+  EXPECT_EQ(CountFrames(*reader), FrameCount);
+}
+
+// Both buffers fill before the first write completes, so frames must be
+// dropped - and counted
+TEST_P(BinaryLogWriterStallTest, CountsDroppedFrames) {
+  const auto size = WriteLog(2s);
+  ASSERT_GT(size, WriterBufferSize);
+
+  auto reader = BinaryLogReader::Create(gLogPath);
+  ASSERT_TRUE(reader.has_value());
+  const auto footer = reader->GetFileFooter();
+  ASSERT_TRUE(footer.has_value());
+  EXPECT_GT(footer->mDroppedFrameCount, 0);
+  EXPECT_EQ(footer->mFrameCount + footer->mDroppedFrameCount, FrameCount);
+  EXPECT_EQ(CountFrames(*reader), footer->mFrameCount);
+}
+
+INSTANTIATE_TEST_SUITE_P(
+  LogFileBackends,
+  BinaryLogWriterStallTest,
+  testing::Values(
+    &LogFileBackend::CreateThreaded,
+    &LogFileBackend::CreateOverlapped));
+
+}// namespace
@@ -0,0 +1,146 @@
+// Copyright 2024 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "FrameEventDetector.hpp"
+
+namespace {
+
+using namespace std::chrono_literals;
+using Kind = FrameEventDetector::Kind;
+using Stage = FrameEventDetector::Stage;
+
+constexpr size_t WarmupFrames = 500;
+
+// 90hz, with normally-distributed stage times
+class FrameEventDetectorTest : public ::testing::Test {
+ protected:
+  FrameEventDetector mDetector;
+  std::vector<FrameEventDetector::Event> mEvents;
+
+  // Added to the next frames' app CPU time
+  std::chrono::microseconds mAppCpuOffset {};
+
+  void Push(
+    const size_t count,
+    const std::chrono::microseconds hitch = {}) {
+    for (size_t i = 0; i < count; ++i) {
+      const auto extra = mAppCpuOffset + hitch;
+      FrameMetrics frame {};
+      frame.mFrameCount = 1;
+      frame.mSincePreviousFrame = Noise(11111, 300) + hitch;
+      mSinceFirstFrame += frame.mSincePreviousFrame;
+      frame.mSinceFirstFrame = mSinceFirstFrame;
+      frame.mLastEndFrameStop = mSinceFirstFrame.count() * 10;
+      frame.mEndFrameCpu = Noise(200, 20);
+      frame.mRenderCpu = Noise(1000, 100);
+      frame.mAppCpu = Noise(5000, 300) + extra;
+      for (auto&& event: mDetector.Push(frame)) {
+        mEvents.push_back(event);
+      }
+    }
+  }
+
+  void Finish() {
+    for (auto&& event: mDetector.Finish()) {
+      mEvents.push_back(event);
+    }
+  }
+
+  [[nodiscard]]
+  size_t Count(const Kind kind) const {
+    return std::ranges::count(mEvents, kind, &FrameEventDetector::Event::mKind);
+  }
+
+ private:
+  std::mt19937 mRandom {42};
+  std::chrono::microseconds mSinceFirstFrame {};
+
+  std::chrono::microseconds Noise(const double mean, const double stddev) {
+    std::normal_distribution<double> distribution {mean, stddev};
+    return std::chrono::microseconds {
+      static_cast<int64_t>(std::max(distribution(mRandom), 0.0))};
+  }
+};
+
+}// namespace
+
+TEST_F(FrameEventDetectorTest, NoEventsForNoise) {
+  Push(10'000);
+  Finish();
+  EXPECT_EQ(mEvents.size(), 0);
+}
+
+TEST_F(FrameEventDetectorTest, IsolatedHitch) {
+  Push(WarmupFrames);
+  Push(1, 20ms);
+  Push(WarmupFrames);
+  Finish();
+
+  ASSERT_EQ(mEvents.size(), 1);
+  const auto& hitch = mEvents.front();
+  EXPECT_EQ(hitch.mKind, Kind::Hitch);
+  EXPECT_EQ(hitch.mFrameCount, 1);
+  // Both are about 20ms over, with the same noise
+  if (hitch.mStage == Stage::AppCpu) {
+    EXPECT_NEAR(hitch.mBaseline, 5000, 500);
+    EXPECT_NEAR(hitch.mValue, 25'000, 1500);
+  } else {
+    EXPECT_EQ(hitch.mStage, Stage::FrameInterval);
+    EXPECT_NEAR(hitch.mBaseline, 11'111, 500);
+    EXPECT_NEAR(hitch.mValue, 31'111, 1500);
+  }
+}
+
+TEST_F(FrameEventDetectorTest, HitchIsReportedWithoutFinish) {
+  Push(WarmupFrames);
+  Push(1, 20ms);
+  // Reported once the CUSUM settles, which is usually a few frames
+  Push(30);
+  EXPECT_EQ(Count(Kind::Hitch), 1);
+}
+
+TEST_F(FrameEventDetectorTest, StepUpAndDown) {
+  Push(WarmupFrames);
+  mAppCpuOffset = 3ms;
+  Push(1000);
+  mAppCpuOffset = {};
+  Push(1000);
+  Finish();
+
+  ASSERT_EQ(mEvents.size(), 2);
+  EXPECT_EQ(Count(Kind::Hitch), 0);
+
+  const auto& up = mEvents.at(0);
+  EXPECT_EQ(up.mKind, Kind::StepUp);
+  EXPECT_EQ(up.mStage, Stage::AppCpu);
+  // The mean since the estimated onset, which may be a little early
+  EXPECT_NEAR(up.mBaseline, 5000, 500);
+  EXPECT_GT(up.mValue, 6500);
+
+  const auto& down = mEvents.at(1);
+  EXPECT_EQ(down.mKind, Kind::StepDown);
+  EXPECT_EQ(down.mStage, Stage::AppCpu);
+  EXPECT_NEAR(down.mBaseline, 8000, 500);
+  EXPECT_LT(down.mValue, 6500);
+}
+
+TEST_F(FrameEventDetectorTest, HitchAfterStep) {
+  Push(WarmupFrames);
+  mAppCpuOffset = 3ms;
+  Push(1000);
+  Push(1, 20ms);
+  Push(WarmupFrames);
+  Finish();
+
+  ASSERT_EQ(mEvents.size(), 2);
+  EXPECT_EQ(mEvents.at(0).mKind, Kind::StepUp);
+  EXPECT_EQ(mEvents.at(1).mKind, Kind::Hitch);
+  EXPECT_EQ(mEvents.at(1).mFrameCount, 1);
+}
@@ -0,0 +1,157 @@
+// Copyright 2024 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdint>
+
+#include "FramePacingAnalyzer.hpp"
+
+namespace {
+
+using namespace std::chrono_literals;
+
+constexpr int64_t Period90Hz = 11'111'111;
+constexpr int64_t Period60Hz = 16'666'667;
+
+class FramePacingAnalyzerTest : public ::testing::Test {
+ protected:
+  FramePacingAnalyzer mAnalyzer;
+  uint64_t mDisplayTime {1'000'000'000};
+
+  void Start() {
+    ASSERT_EQ(mAnalyzer.Push(mDisplayTime), std::nullopt);
+  }
+
+  std::optional<FramePacingAnalyzer::Result> Push(
+    const int64_t interval,
+    const uint64_t representedFrames = 1) {
+    mDisplayTime += interval;
+    return mAnalyzer.Push(mDisplayTime, representedFrames);
+  }
+
+  // Alternates early and late by `jitter`, as predicted times are rounded
+  void PushSteady(
+    const size_t count,
+    const int64_t period = Period90Hz,
+    const int64_t jitter = 50'000) {
+    for (size_t i = 0; i < count; ++i) {
+      const auto result = Push(period + ((i % 2) ? jitter : -jitter));
+      ASSERT_TRUE(result.has_value());
+      EXPECT_FALSE(result->mIsLate);
+      EXPECT_EQ(result->mSkippedSlots, 0);
+      EXPECT_EQ(result->mRepeatedSlots, 0);
+    }
+  }
+
+  void ExpectPeriodNear(const int64_t period) const {
+    EXPECT_NEAR(
+      mAnalyzer.GetDisplayPeriod().count(),
+      static_cast<double>(period),
+      period / 100.0);
+  }
+};
+
+}// namespace
+
+TEST_F(FramePacingAnalyzerTest, NeedsAnIntervalFirst) {
+  EXPECT_EQ(mAnalyzer.Push(0), std::nullopt);
+  EXPECT_EQ(mAnalyzer.Push(mDisplayTime), std::nullopt);
+  EXPECT_EQ(mAnalyzer.GetDisplayPeriod(), 0ns);
+  EXPECT_TRUE(Push(Period90Hz).has_value());
+}
+
+TEST_F(FramePacingAnalyzerTest, SteadyPacing) {
+  Start();
+  PushSteady(1000);
+  ExpectPeriodNear(Period90Hz);
+}
+
+TEST_F(FramePacingAnalyzerTest, MissedAndRepeatedSlots) {
+  Start();
+  PushSteady(100);
+
+  const auto missed = Push(Period90Hz * 3);
+  ASSERT_TRUE(missed.has_value());
+  EXPECT_TRUE(missed->mIsLate);
+  EXPECT_EQ(missed->mSkippedSlots, 2);
+  EXPECT_EQ(missed->mRepeatedSlots, 0);
+
+  // Predicted for the same slot as the previous frame
+  const auto repeated = Push(0);
+  ASSERT_TRUE(repeated.has_value());
+  EXPECT_FALSE(repeated->mIsLate);
+  EXPECT_EQ(repeated->mRepeatedSlots, 1);
+
+  PushSteady(100);
+  ExpectPeriodNear(Period90Hz);
+}
+
+TEST_F(FramePacingAnalyzerTest, SingleGlitch) {
+  Start();
+  PushSteady(100);
+
+  ASSERT_TRUE(Push(Period90Hz / 2).has_value());
+  PushSteady(1000);
+  ExpectPeriodNear(Period90Hz);
+}
+
+TEST_F(FramePacingAnalyzerTest, DecimatedInput) {
+  constexpr uint64_t N = 10;
+  Start();
+  PushSteady(100);
+
+  // Each logged frame represents 10 frames, one of which missed a slot
+  for (int i = 0; i < 200; ++i) {
+    const auto result = Push(Period90Hz * (N + 1), N);
+    ASSERT_TRUE(result.has_value());
+    EXPECT_TRUE(result->mIsLate);
+    EXPECT_EQ(result->mSkippedSlots, 1);
+  }
+  ExpectPeriodNear(Period90Hz);
+
+  for (int i = 0; i < 10; ++i) {
+    const auto result = Push(Period90Hz * N, N);
+    ASSERT_TRUE(result.has_value());
+    EXPECT_FALSE(result->mIsLate);
+    EXPECT_EQ(result->mSkippedSlots, 0);
+  }
+}
+
+TEST_F(FramePacingAnalyzerTest, OnlyDecimatedInput) {
+  // 10 frames in 11 slots is indistinguishable from a slower display
+  Start();
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_EQ(Push(Period90Hz * 11, 10), std::nullopt);
+  }
+}
+
+TEST_F(FramePacingAnalyzerTest, RefreshRateChange) {
+  Start();
+  PushSteady(100, Period90Hz);
+
+  for (int i = 0; i < 100; ++i) {
+    ASSERT_TRUE(Push(Period60Hz).has_value());
+  }
+  ExpectPeriodNear(Period60Hz);
+  PushSteady(100, Period60Hz);
+  ExpectPeriodNear(Period60Hz);
+
+  for (int i = 0; i < 100; ++i) {
+    ASSERT_TRUE(Push(Period90Hz).has_value());
+  }
+  ExpectPeriodNear(Period90Hz);
+  PushSteady(100, Period90Hz);
+  ExpectPeriodNear(Period90Hz);
+}
+
+TEST_F(FramePacingAnalyzerTest, FirstIntervalMissedASlot) {
+  Start();
+  ASSERT_TRUE(Push(Period90Hz * 2).has_value());
+  for (int i = 0; i < 100; ++i) {
+    ASSERT_TRUE(Push(Period90Hz).has_value());
+  }
+  ExpectPeriodNear(Period90Hz);
+  PushSteady(100);
+}
@@ -0,0 +1,64 @@
+// Copyright 2024 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <memory>
+
+#include "HostMetrics.hpp"
+#include "PerformanceCounterMath.hpp"
+
+// These use the real source for the current platform - `/proc` on Linux - so
+// only check values that any machine should produce
+
+TEST(HostMetrics, SamplesCurrentProcess) {
+  const auto source = HostMetrics::Source::Create();
+  const auto before = PerformanceCounterMath::GetLiveDataTime();
+  const auto sample = source->GetSample();
+  const auto after = PerformanceCounterMath::GetLiveDataTime();
+  ASSERT_TRUE(sample.has_value());
+
+  const auto& cpu = sample->mCpu;
+  ASSERT_NE(cpu.mSampleTime, 0);
+  // Timestamps must be comparable with frame timestamps
+  EXPECT_GE(cpu.mSampleTime, before);
+  EXPECT_LE(cpu.mSampleTime, after);
+  EXPECT_GT(cpu.mLogicalProcessorCount, 0);
+  // 'Since the previous sample'
+  EXPECT_EQ(cpu.mUtilization, 0);
+  EXPECT_EQ(cpu.mBusiestCoreUtilization, 0);
+
+  const auto& process = sample->mProcess;
+  ASSERT_NE(process.mSampleTime, 0);
+  EXPECT_GE(process.mSampleTime, before);
+  EXPECT_LE(process.mSampleTime, after);
+  EXPECT_GT(process.mWorkingSetBytes, 0);
+  EXPECT_GT(process.mPrivateBytes, 0);
+  EXPECT_EQ(process.mPageFaults, 0);
+  EXPECT_EQ(process.mCpuUtilization, 0);
+}
+
+TEST(HostMetrics, MeasuresChangesSincePreviousSample) {
+  const auto source = HostMetrics::Source::Create();
+  const auto first = source->GetSample();
+  ASSERT_TRUE(first.has_value());
+
+  // Touch memory that isn't mapped yet, so that there are page faults
+  constexpr size_t Size = 64 * 1024 * 1024;
+  const auto buffer = std::make_unique_for_overwrite<char[]>(Size);
+  std::memset(buffer.get(), 1, Size);
+
+  const auto second = source->GetSample();
+  ASSERT_TRUE(second.has_value());
+  EXPECT_GT(second->mCpu.mSampleTime, first->mCpu.mSampleTime);
+  EXPECT_LE(second->mCpu.mUtilization, 10000);
+  EXPECT_LE(second->mCpu.mBusiestCoreUtilization, 10000);
+  EXPECT_GE(second->mCpu.mBusiestCoreUtilization, second->mCpu.mUtilization);
+
+  EXPECT_GT(second->mProcess.mSampleTime, first->mProcess.mSampleTime);
+  EXPECT_GT(second->mProcess.mPageFaults, 0);
+  EXPECT_GE(
+    second->mProcess.mWorkingSetBytes, first->mProcess.mWorkingSetBytes);
+  EXPECT_LE(second->mProcess.mCpuUtilization, 10000);
+}
@@ -0,0 +1,111 @@
+// Copyright 2024 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+
+#include <gtest/gtest.h>
+
+#include <optional>
+#include <utility>
+
+#include "MetricsAggregator.hpp"
+
+namespace {
+
+using namespace std::chrono_literals;
+
+// One tick per microsecond, to keep the expected values readable
+constexpr int64_t Frequency = 1'000'000;
+constexpr int64_t FrameInterval = 10'000;
+
+// Every frame spends 2ms in the app before `xrWaitFrame()`, and 0.5ms between
+// `xrWaitFrame()` and `xrBeginFrame()`
+constexpr auto ExpectedAppCpu = 2500us;
+
+FramePerformanceCounters GetFrame(
+  const int64_t index,
+  const std::optional<uint64_t> renderGpu = std::nullopt) {
+  const auto previousEnd = index * FrameInterval;
+  FramePerformanceCounters ret {};
+  if (renderGpu) {
+    ret.mRenderGpu = *renderGpu;
+    ret.mValidDataBits |= FramePerformanceCounters::ValidDataBits::GpuTime;
+  }
+  auto& core = ret.mCore;
+  core.mXrDisplayTime = previousEnd + (3 * FrameInterval);
+  core.mWaitFrameStart = previousEnd + 2000;
+  core.mWaitFrameStop = previousEnd + 5000;
+  core.mBeginFrameStart = previousEnd + 5500;
+  core.mBeginFrameStop = previousEnd + 5600;
+  core.mEndFrameStart = previousEnd + 9000;
+  core.mEndFrameStop = previousEnd + FrameInterval;
+  return ret;
+}
+
+FrameMetrics Aggregate(const uint64_t representedFrames) {
+  MetricsAggregator aggregator {PerformanceCounterMath {Frequency}};
+  aggregator.Push(GetFrame(0));
+  for (int64_t i = representedFrames; i <= 100; i += representedFrames) {
+    aggregator.Push(GetFrame(i), representedFrames);
+  }
+  return aggregator.Flush().value();
+}
+
+TEST(MetricsAggregator, MeasuresEveryFrame) {
+  const auto metrics = Aggregate(1);
+  EXPECT_EQ(metrics.mFrameCount, 100);
+  EXPECT_EQ(metrics.mSincePreviousFrame, 10ms);
+  EXPECT_EQ(metrics.mAppCpu, ExpectedAppCpu);
+  EXPECT_EQ(metrics.mWaitFrameCpu, 3000us);
+  EXPECT_EQ(metrics.mEndFrameCpu, 1000us);
+}
+
+TEST(MetricsAggregator, ClassifiesBottlenecks) {
+  const auto count = [](const FrameMetrics& metrics, FrameBottleneck it) {
+    return metrics.mBottleneckFrameCounts[std::to_underlying(it)];
+  };
+
+  MetricsAggregator aggregator {PerformanceCounterMath {Frequency}};
+  aggregator.Push(GetFrame(0));
+  for (int64_t i = 1; i <= 10; ++i) {
+    aggregator.Push(GetFrame(i, 9500));
+  }
+  auto metrics = aggregator.Flush().value();
+  EXPECT_EQ(count(metrics, FrameBottleneck::RenderGpu), 10);
+
+  // 4.1ms in the runtime is the longest CPU stage
+  for (int64_t i = 11; i <= 20; ++i) {
+    aggregator.Push(GetFrame(i, 1000));
+  }
+  metrics = aggregator.Flush().value();
+  EXPECT_EQ(count(metrics, FrameBottleneck::Compositor), 10);
+}
+
+// Without GPU time, a GPU-bound frame looks the same as a CPU-bound one
+TEST(MetricsAggregator, DoesNotClassifyFramesWithoutGpuTime) {
+  const auto metrics = Aggregate(1);
+  const auto unknown = std::to_underlying(FrameBottleneck::Unknown);
+  EXPECT_EQ(metrics.mBottleneckFrameCounts[unknown], 100);
+}
+
+// The time between the previous logged frame and this one includes the
+// skipped frames; it should not be counted as app time
+TEST(MetricsAggregator, MeasuresRepresentedFramesOnly) {
+  const auto full = Aggregate(1);
+  for (auto&& representedFrames: {2, 5, 10}) {
+    const auto metrics = Aggregate(representedFrames);
+    EXPECT_EQ(metrics.mFrameCount, 100 / representedFrames);
+    EXPECT_EQ(metrics.mSincePreviousFrame, full.mSincePreviousFrame);
+    EXPECT_EQ(metrics.mAppCpu, full.mAppCpu);
+    EXPECT_EQ(metrics.mWaitFrameCpu, full.mWaitFrameCpu);
+    EXPECT_EQ(metrics.mBeginFrameCpu, full.mBeginFrameCpu);
+    EXPECT_EQ(metrics.mRenderCpu, full.mRenderCpu);
+    EXPECT_EQ(metrics.mEndFrameCpu, full.mEndFrameCpu);
+    // Counted per logged frame
+    for (size_t i = 0; i < FrameBottleneckCount; ++i) {
+      EXPECT_EQ(
+        metrics.mBottleneckFrameCounts[i] * representedFrames,
+        full.mBottleneckFrameCounts[i]);
+    }
+  }
+}
+
+}// namespace
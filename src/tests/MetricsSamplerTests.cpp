@@ -0,0 +1,123 @@
+// Copyright 2024 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "MetricsSampler.hpp"
+
+namespace {
+
+using namespace std::chrono_literals;
+
+// One tick per microsecond; with a 1ms interval, samples are stale after 4ms
+constexpr int64_t Frequency = 1'000'000;
+constexpr int64_t MaxAge = 4000;
+constexpr int SampleCount = 5;
+
+using Sampler = MetricsSampler<int>;
+
+// Each call advances the clock by 1ms, so the Nth sample is taken at
+// `(N * 2000) - 500`
+struct FakeClock {
+  std::atomic_int64_t mTicks {};
+
+  Sampler::Clock Get() {
+    return {
+      [this] { return (++mTicks) * 1000; },
+      Frequency,
+    };
+  }
+};
+
+// Returns 1 to `SampleCount`, then fails
+struct FakeSource {
+  std::atomic_int mCalls {};
+
+  Sampler::Source Get() {
+    return [this] -> std::optional<int> {
+      const auto call = ++mCalls;
+      if (call > SampleCount) {
+        return std::nullopt;
+      }
+      return call;
+    };
+  }
+
+  [[nodiscard]]
+  bool WaitForCalls(const int count) const {
+    const auto timeout = std::chrono::steady_clock::now() + 10s;
+    while (mCalls < count) {
+      if (std::chrono::steady_clock::now() > timeout) {
+        return false;
+      }
+      std::this_thread::sleep_for(1ms);
+    }
+    return true;
+  }
+};
+
+constexpr int64_t GetSampleTime(const int sample) {
+  return (sample * 2000) - 500;
+}
+
+}// namespace
+
+TEST(MetricsSampler, FindsNearestSample) {
+  FakeClock clock;
+  FakeSource source;
+  const Sampler sampler {1ms, source.Get(), clock.Get()};
+  ASSERT_TRUE(source.WaitForCalls(SampleCount + 1));
+
+  for (int i = 1; i <= SampleCount; ++i) {
+    EXPECT_EQ(sampler.GetNearest(GetSampleTime(i)), i);
+  }
+  EXPECT_EQ(sampler.GetNearest(GetSampleTime(2) + 900), 2);
+  EXPECT_EQ(sampler.GetNearest(GetSampleTime(2) + 1100), 3);
+}
+
+TEST(MetricsSampler, IgnoresStaleSamples) {
+  FakeClock clock;
+  FakeSource source;
+  const Sampler sampler {1ms, source.Get(), clock.Get()};
+  ASSERT_TRUE(source.WaitForCalls(SampleCount + 1));
+
+  EXPECT_EQ(sampler.GetNearest(GetSampleTime(1) - MaxAge), 1);
+  EXPECT_EQ(sampler.GetNearest(GetSampleTime(1) - MaxAge - 1), std::nullopt);
+  EXPECT_EQ(sampler.GetNearest(GetSampleTime(SampleCount) + MaxAge), 5);
+  EXPECT_EQ(
+    sampler.GetNearest(GetSampleTime(SampleCount) + MaxAge + 1), std::nullopt);
+}
+
+TEST(MetricsSampler, WithoutSamples) {
+  FakeClock clock;
+  std::atomic_int calls {};
+  const Sampler sampler {
+    1ms,
+    [&calls] -> std::optional<int> {
+      ++calls;
+      return std::nullopt;
+    },
+    clock.Get(),
+  };
+  while (calls < 3) {
+    std::this_thread::sleep_for(1ms);
+  }
+  EXPECT_EQ(sampler.GetNearest(0), std::nullopt);
+  EXPECT_EQ(sampler.GetNearest(clock.mTicks * 1000), std::nullopt);
+}
+
+TEST(MetricsSampler, StopsWithoutWaitingForTheInterval) {
+  FakeClock clock;
+  FakeSource source;
+  const auto start = std::chrono::steady_clock::now();
+  {
+    const Sampler sampler {1h, source.Get(), clock.Get()};
+    ASSERT_TRUE(source.WaitForCalls(1));
+  }
+  EXPECT_LT(std::chrono::steady_clock::now() - start, 10s);
+  EXPECT_EQ(source.mCalls, 1);
+}
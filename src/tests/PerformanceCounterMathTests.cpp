@@ -0,0 +1,237 @@
+// Copyright 2024 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "PerformanceCounterMath.hpp"
+
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#endif
+
+namespace {
+
+constexpr int64_t MicrosPerSecond = 1'000'000;
+
+// - 10MHz: `QueryPerformanceCounter()` on most Windows systems
+// - 1GHz: `CLOCK_MONOTONIC` nanoseconds
+// - 3.579545MHz and 14.31818MHz: ACPI PM timer and HPET; these don't reduce
+//   to a small fraction
+// - 24MHz and 19.2MHz: common on ARM
+// - 2.4GHz: TSC-based
+// - 10000019Hz: prime, so the fraction doesn't reduce at all
+constexpr std::array Frequencies {
+  int64_t {10'000'000},
+  int64_t {1'000'000'000},
+  int64_t {3'579'545},
+  int64_t {14'318'180},
+  int64_t {24'000'000},
+  int64_t {19'200'000},
+  int64_t {2'400'000'000},
+  int64_t {10'000'019},
+  int64_t {1'000'000},
+};
+
+// The implementation before the reciprocal fast path; only valid if
+// `ticks * MicrosPerSecond` doesn't overflow
+int64_t NarrowReference(const int64_t frequency, const int64_t ticks) {
+  return (ticks * MicrosPerSecond) / frequency;
+}
+
+constexpr int64_t MaxNarrowTicks
+  = std::numeric_limits<int64_t>::max() / MicrosPerSecond;
+
+#if defined(__SIZEOF_INT128__) || (defined(_MSC_VER) && defined(_M_X64))
+#define XRFT_HAVE_WIDE_REFERENCE
+// As `NarrowReference()`, but with a 128-bit intermediate, so it is valid
+// for any tick count; the result fits as all frequencies are >= 1MHz
+int64_t WideReference(const int64_t frequency, const int64_t ticks) {
+#ifdef __SIZEOF_INT128__
+  return static_cast<int64_t>(
+    (static_cast<__int128>(ticks) * MicrosPerSecond) / frequency);
+#else
+  int64_t high {};
+  const auto low = _mul128(ticks, MicrosPerSecond, &high);
+  int64_t remainder {};
+  return _div128(high, low, frequency, &remainder);
+#endif
+}
+#endif
+
+// `std::mt19937_64`'s output is fully specified, unlike the distributions
+std::vector<int64_t> GetRandomTicks(const int64_t frequency) {
+  std::mt19937_64 random {static_cast<uint64_t>(frequency)};
+  std::vector<int64_t> ret;
+  ret.reserve(1 << 20);
+  for (size_t i = 0; i < ret.capacity(); ++i) {
+    auto ticks = static_cast<int64_t>(random());
+    // Also cover realistic magnitudes, not just huge ones
+    ticks >>= (i % 64);
+    if (ticks == std::numeric_limits<int64_t>::min()) {
+      ++ticks;
+    }
+    ret.push_back(ticks);
+  }
+  return ret;
+}
+
+class PerformanceCounterMathTest : public testing::TestWithParam<int64_t> {};
+
+TEST_P(PerformanceCounterMathTest, MatchesReferenceNearZero) {
+  const auto frequency = GetParam();
+  const PerformanceCounterMath pcm {frequency};
+  constexpr int64_t Limit = 1 << 21;
+  for (int64_t ticks = -Limit; ticks <= Limit; ++ticks) {
+    const auto actual = pcm.ToDuration(ticks).count();
+    const auto expected = NarrowReference(frequency, ticks);
+    if (actual != expected) {
+      FAIL() << ticks << " ticks: got " << actual << ", expected "
+             << expected;
+    }
+  }
+}
+
+// The largest tick counts where the previous implementation didn't overflow
+TEST_P(PerformanceCounterMathTest, MatchesReferenceAtNarrowLimit) {
+  const auto frequency = GetParam();
+  const PerformanceCounterMath pcm {frequency};
+  for (int64_t ticks = MaxNarrowTicks - (1 << 20); ticks <= MaxNarrowTicks;
+       ++ticks) {
+    for (const auto signedTicks: {ticks, -ticks}) {
+      const auto actual = pcm.ToDuration(signedTicks).count();
+      const auto expected = NarrowReference(frequency, signedTicks);
+      if (actual != expected) {
+        FAIL() << signedTicks << " ticks: got " << actual << ", expected "
+               << expected;
+      }
+    }
+  }
+}
+
+#ifdef XRFT_HAVE_WIDE_REFERENCE
+// `ToDuration()` splits ticks into `quotient * denominator + remainder`;
+// check every remainder, for small and huge quotients
+TEST_P(PerformanceCounterMathTest, MatchesWideReferenceForEveryRemainder) {
+  const auto frequency = GetParam();
+  const PerformanceCounterMath pcm {frequency};
+  const auto denominator
+    = frequency / std::gcd(frequency, MicrosPerSecond);
+  const auto maxQuotient = std::numeric_limits<int64_t>::max() / denominator;
+  for (const auto quotient: {int64_t {0}, int64_t {1}, maxQuotient - 1}) {
+    for (int64_t remainder = 0; remainder < denominator; ++remainder) {
+      const auto ticks = (quotient * denominator) + remainder;
+      const auto actual = pcm.ToDuration(ticks).count();
+      const auto expected = WideReference(frequency, ticks);
+      if (actual != expected) {
+        FAIL() << ticks << " ticks: got " << actual << ", expected "
+               << expected;
+      }
+    }
+  }
+}
+
+TEST_P(PerformanceCounterMathTest, MatchesWideReferenceForRandomTicks) {
+  const auto frequency = GetParam();
+  const PerformanceCounterMath pcm {frequency};
+  for (auto&& ticks: GetRandomTicks(frequency)) {
+    const auto actual = pcm.ToDuration(ticks).count();
+    const auto expected = WideReference(frequency, ticks);
+    if (actual != expected) {
+      FAIL() << ticks << " ticks: got " << actual << ", expected "
+             << expected;
+    }
+  }
+}
+#endif
+
+TEST_P(PerformanceCounterMathTest, IsOdd) {
+  const PerformanceCounterMath pcm {GetParam()};
+  for (auto&& ticks: GetRandomTicks(GetParam())) {
+    if (pcm.ToDuration(-ticks) != -pcm.ToDuration(ticks)) {
+      FAIL() << ticks << " ticks";
+    }
+  }
+}
+
+TEST_P(PerformanceCounterMathTest, IsMonotonic) {
+  const PerformanceCounterMath pcm {GetParam()};
+  auto ticks = GetRandomTicks(GetParam());
+  std::ranges::sort(ticks);
+  for (size_t i = 1; i < ticks.size(); ++i) {
+    if (pcm.ToDuration(ticks.at(i - 1)) > pcm.ToDuration(ticks.at(i))) {
+      FAIL() << ticks.at(i - 1) << " and " << ticks.at(i) << " ticks";
+    }
+  }
+}
+
+TEST_P(PerformanceCounterMathTest, WholeSecondsAreExact) {
+  const auto frequency = GetParam();
+  const PerformanceCounterMath pcm {frequency};
+  const auto maxSeconds = std::min(
+    std::numeric_limits<int64_t>::max() / frequency,
+    std::numeric_limits<int64_t>::max() / MicrosPerSecond);
+  for (auto&& seconds: {int64_t {1}, int64_t {60 * 60}, maxSeconds}) {
+    EXPECT_EQ(
+      pcm.ToDuration(seconds * frequency).count(), seconds * MicrosPerSecond);
+  }
+}
+
+// floor(a + b) - floor(a) - floor(b) is 0 or 1 for non-negative a and b
+TEST_P(PerformanceCounterMathTest, IsAdditiveWithinRounding) {
+  const PerformanceCounterMath pcm {GetParam()};
+  const auto ticks = GetRandomTicks(GetParam());
+  for (size_t i = 1; i < ticks.size(); ++i) {
+    const auto a = std::abs(ticks.at(i - 1)) / 2;
+    const auto b = std::abs(ticks.at(i)) / 2;
+    const auto error = pcm.ToDuration(a + b) - pcm.ToDuration(a)
+      - pcm.ToDuration(b);
+    if (error.count() != 0 && error.count() != 1) {
+      FAIL() << a << " and " << b << " ticks: error " << error.count();
+    }
+  }
+}
+
+TEST_P(PerformanceCounterMathTest, ToDurationsMatchesToDuration) {
+  const PerformanceCounterMath pcm {GetParam()};
+  const auto ticks = GetRandomTicks(GetParam());
+  std::vector<std::chrono::microseconds> out(ticks.size());
+  pcm.ToDurations(ticks, out);
+  for (size_t i = 0; i < ticks.size(); ++i) {
+    if (out.at(i) != pcm.ToDuration(ticks.at(i))) {
+      FAIL() << ticks.at(i) << " ticks";
+    }
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+  Frequencies,
+  PerformanceCounterMathTest,
+  testing::ValuesIn(Frequencies));
+
+TEST(PerformanceCounterMath, RejectsInvalidFrequencies) {
+  EXPECT_THROW(PerformanceCounterMath {0}, std::out_of_range);
+  EXPECT_THROW(PerformanceCounterMath {-1}, std::out_of_range);
+}
+
+TEST(PerformanceCounterMath, ToDurationsRejectsSmallOutput) {
+  const PerformanceCounterMath pcm {10'000'000};
+  const std::array<int64_t, 2> ticks {};
+  std::array<std::chrono::microseconds, 1> out {};
+  EXPECT_THROW(pcm.ToDurations(ticks, out), std::out_of_range);
+}
+
+TEST(PerformanceCounterMath, ToDurationRejectsNegativeRanges) {
+  const PerformanceCounterMath pcm {10'000'000};
+  EXPECT_THROW(std::ignore = pcm.ToDuration(2, 1), std::invalid_argument);
+  EXPECT_EQ(pcm.ToDurationAllowNegative(20, 10).count(), -1);
+}
+
+}// namespace
@@ -0,0 +1,45 @@
+// Copyright 2024 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <span>
+#include <thread>
+
+#include "LogFileBackend.hpp"
+
+/// Delays completion of every write by `stall`, to simulate a slow disk
+class StallingLogFileBackend final : public LogFileBackend {
+ public:
+  StallingLogFileBackend(
+    std::unique_ptr<LogFileBackend> inner,
+    const std::chrono::milliseconds stall)
+    : mInner(std::move(inner)), mStall(stall) {
+  }
+
+  ~StallingLogFileBackend() override {
+    this->WaitForWrite();
+  }
+
+  void BeginWrite(std::span<const char> data) override {
+    this->WaitForWrite();
+    mInner->BeginWrite(data);
+    mCompleteAfter = std::chrono::steady_clock::now() + mStall;
+  }
+
+  bool IsWriteComplete() override {
+    return std::chrono::steady_clock::now() >= mCompleteAfter
+      && mInner->IsWriteComplete();
+  }
+
+  void WaitForWrite() override {
+    std::this_thread::sleep_until(mCompleteAfter);
+    mInner->WaitForWrite();
+  }
+
+ private:
+  std::unique_ptr<LogFileBackend> mInner;
+  std::chrono::milliseconds mStall {};
+  std::chrono::steady_clock::time_point mCompleteAfter {};
+};
@@ -0,0 +1,40 @@
+// Copyright 2024 Fred Emmott <fred@fredemmott.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <format>
+#include <random>
+#include <string_view>
+
+/// A unique path in the temporary directory, removed when destroyed
+class TemporaryPath final {
+ public:
+  explicit TemporaryPath(const std::string_view extension = {}) {
+    const auto test = testing::UnitTest::GetInstance()->current_test_info();
+    mPath = std::filesystem::temp_directory_path()
+      / std::format(
+              "xrft-{}-{}-{:016x}{}",
+              test ? test->test_suite_name() : "test",
+              test ? test->name() : "",
+              std::random_device {}(),
+              extension);
+  }
+  ~TemporaryPath() {
+    std::error_code ignored;
+    std::filesystem::remove_all(mPath, ignored);
+  }
+
+  TemporaryPath(const TemporaryPath&) = delete;
+  TemporaryPath& operator=(const TemporaryPath&) = delete;
+
+  [[nodiscard]]
+  const std::filesystem::path& Get() const noexcept {
+    return mPath;
+  }
+
+ private:
+  std::filesystem::path mPath;
+};